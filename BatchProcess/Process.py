@@ -1,6 +1,7 @@
 import os
 import shutil
 import re
+import subprocess
 import multiprocessing
 from multiprocessing import Pool, Manager
 from multiprocessing.sharedctypes import Value
@@ -29,27 +30,28 @@ def SingleTask(param) :
     fileGroupSubPath : str = param[0]
     sbfresFile : str = param[1]
     fileNameNoExt : str = param[2]
+    sbfresPath : str = param[3]
 
-    share_context_progress : Value = param[3]
-    share_context_total : Value = param[4]
+    share_context_progress : Value = param[4]
+    share_context_total : Value = param[5]
     share_context_progress.value = share_context_progress.value + 1
     print("[{}/{}] {}".format( share_context_progress.value, share_context_total.value, sbfresFile) )
 
     importerCommand = "\"" + global_importer_bin + "\" \"" + \
-        os.path.join(global_in_dir, sbfresFile) + "\" \"" + \
-        fileGroupSubPath + "/\""
+        sbfresPath + "\" \"" + \
+        fileGroupSubPath + "/\" -b"
     os.system("\"" + importerCommand + "\"")
 
     # If it's not a texture Bfres, run the exporter
-    inputXMLPath = os.path.join(fileGroupSubPath, fileNameNoExt + ".xml")
+    inputMedianPath = os.path.join(fileGroupSubPath, fileNameNoExt + ".mbin")
     if not sbfresFile.endswith(".Tex1.sbfres"):
         if not sbfresFile.endswith(".Tex2.sbfres"):
             outputFBXPath = fileGroupSubPath + "/"
-            exporterCommand = "\"" + global_exporter_bin + "\" \"" + inputXMLPath + \
-                "\" \"" + outputFBXPath + "\"" + " -t"
+            exporterCommand = "\"" + global_exporter_bin + "\" \"" + inputMedianPath + \
+                "\" \"" + outputFBXPath + "\"" + " -t -s"
             os.system("\"" + exporterCommand + "\"")
 
-    #os.system("del /q \"" + inputXMLPath + "\"")
+    #os.system("del /q \"" + inputMedianPath + "\"")
 
 # it just divide lines to process, not balanced control
 if __name__ == '__main__':   
@@ -70,18 +72,25 @@ if __name__ == '__main__':
         if not file and not dir:
             os.rmdir(root)
 
-    # step1. extract pack
-    for pack in sorted(os.listdir(global_pack_dir)):
-        purename = os.path.splitext(pack)[0]
-        if pack.endswith(".pack") and not os.path.exists(os.path.join(global_pack_dir, purename)):
-            os.system("sarc extract {}".format( os.path.join(global_pack_dir, pack) ))
+    # step1. collect sbfres in In, loose ones below Pack and the ones inside packs, the first of a name wins
+    sbfresPaths = {}
+    for sbfresFile in sorted(os.listdir(global_in_dir)):
+        if sbfresFile.endswith(".sbfres"):
+            sbfresPaths.setdefault(sbfresFile, os.path.join(global_in_dir, sbfresFile))
 
-    # step2. move sbfres to In
+    packs = []
     for root, dir, file in os.walk(global_pack_dir):
-        for f in file:
+        for f in sorted(file):
             if f.endswith(".sbfres"):
-                print('moving {}...'.format(f))
-                shutil.move(os.path.join(root, f), global_in_dir)
+                sbfresPaths.setdefault(f, os.path.join(root, f))
+            elif f.endswith(".pack"):
+                packs.append(os.path.join(root, f))
+
+    # step2. list the sbfres inside the packs, the importer reads them from there without extracting
+    if packs:
+        listCommand = [global_exporter_bin, "-list"] + packs
+        for sbfresPath in subprocess.run(listCommand, stdout=subprocess.PIPE, universal_newlines=True).stdout.splitlines():
+            sbfresPaths.setdefault(os.path.basename(sbfresPath.replace("\\", "/")), sbfresPath)
 
     # step3. -xx, sub pack rename, Item_ exception, remove this logic, -xx is partial one, but _xx isnot
     # for sbfresFile in sorted(os.listdir(global_in_dir)):
@@ -91,7 +100,7 @@ if __name__ == '__main__':
 
     # step4. prepare tasks
     lines = []
-    for sbfresFile in sorted(os.listdir(global_in_dir)):
+    for sbfresFile in sorted(sbfresPaths):
         if sbfresFile.endswith(".sbfres"):		
             fileNameNoExt = sbfresFile[0:len(sbfresFile) - len(".sbfres")]
             # Set file group name
@@ -132,7 +141,7 @@ if __name__ == '__main__':
                 os.makedirs(fileGroupSubPath)
 
             task_count = len(lines)
-            lines.append((fileGroupSubPath, sbfresFile, fileNameNoExt, share_context_progress, share_context_total))
+            lines.append((fileGroupSubPath, sbfresFile, fileNameNoExt, sbfresPaths[sbfresFile], share_context_progress, share_context_total))
 
     share_context_progress.value = 0
     share_context_total.value = len(lines)
@@ -410,7 +410,6 @@ namespace BFRES_Importer
         {
             writer.WriteStartElement("TextureRefs");
 
-            int AlbedoCount = 0;
             int id = 0;
             string TextureName = "";
             if (mat.TextureRefs == null)
@@ -483,39 +482,7 @@ namespace BFRES_Importer
                     useSampler = mat.ShaderAssign.SamplerAssigns[ useSampler ];
                 writer.WriteAttributeString( "UseSampler", useSampler );
                 // Texture type
-                if (useSampler == "s_diffuse")       { AlbedoCount++;  writer.WriteAttributeString("Type", "Diffuse"             ); }
-                else if (useSampler == "s_normal")                     writer.WriteAttributeString("Type", "Normal"              );
-                else if (useSampler == "s_specmask")                   writer.WriteAttributeString("Type", "Specular"            );
-                else if (useSampler == "_a0")        { AlbedoCount++;  writer.WriteAttributeString("Type", "Diffuse"             ); }
-                else if (useSampler == "_a1")        { AlbedoCount++;  writer.WriteAttributeString("Type", "DiffuseLayer2"       ); }
-                else if (useSampler == "_a2")        { AlbedoCount++;  writer.WriteAttributeString("Type", "DiffuseLayer3"       ); }
-                else if (useSampler == "_n0")                          writer.WriteAttributeString("Type", "Normal"              );
-                else if (TextureName.Contains("_Nrm"))                 writer.WriteAttributeString("Type", "Normal"              );
-                else if (useSampler == "_s0")                          writer.WriteAttributeString("Type", "Specular"            );
-                else if (useSampler == "_ao0")                         writer.WriteAttributeString("Type", "AO"                  );
-                else if (useSampler == "_e0")                          writer.WriteAttributeString("Type", "Emission"            );
-                else if (useSampler == "_b0")                          writer.WriteAttributeString("Type", "Shadow"              );
-                else if (useSampler == "_b1")                          writer.WriteAttributeString("Type", "Light"               );
-                else if (TextureName.Contains("Emm"))                  writer.WriteAttributeString("Type", "Emission"            );
-                else if (TextureName.Contains("Spm"))                  writer.WriteAttributeString("Type", "Specular"            );
-                else if (TextureName.Contains("b00"))                  writer.WriteAttributeString("Type", "Shadow"              );
-                else if (texSamplerName == "bake0")                    writer.WriteAttributeString("Type", "Shadow"              );
-                else if (TextureName.Contains("Moc"))                  writer.WriteAttributeString("Type", "AO"                  );
-                else if (TextureName.Contains("AO"))                   writer.WriteAttributeString("Type", "AO"                  );
-                else if (TextureName.Contains("b01"))                  writer.WriteAttributeString("Type", "Light"               );
-                //Metalness, Roughness, and Cavity Map in one
-                else if (TextureName.Contains("MRA"))                  writer.WriteAttributeString("Type", "MRA"                 );
-                else if (TextureName.Contains("mtl"))                  writer.WriteAttributeString("Type", "Metalness"           );
-                else if (TextureName.Contains("rgh"))                  writer.WriteAttributeString("Type", "Roughness"           );
-                else if (TextureName.Contains("sss"))                  writer.WriteAttributeString("Type", "SubSurfaceScattering");
-                else if (texSamplerName == "_ao0")                     writer.WriteAttributeString("Type", "AO"                  );
-                else if (TextureName.Contains("Alb")) { AlbedoCount++; writer.WriteAttributeString("Type", "Diffuse"             ); }
-                else if (texSamplerName == "_sd0") { writer.WriteAttributeString("Type", "Shadow"); }
-                else if (texSamplerName == "_ms0") { writer.WriteAttributeString("Type", "Mask"); }
-                else
-                {
-                    writer.WriteAttributeString("Type", "unknown");
-                }
+                writer.WriteAttributeString("Type", GetTextureType(useSampler, texSamplerName, TextureName));
 
                 writer.WriteAttributeString("ClampX", mat.Samplers[id].TexSampler.ClampX.ToString());
                 writer.WriteAttributeString("ClampY", mat.Samplers[id].TexSampler.ClampY.ToString());
@@ -581,6 +548,46 @@ namespace BFRES_Importer
             writer.WriteEndElement();
         }
         /// <summary>
+        /// Works out what kind of map a texture is from its sampler, falling back to its name
+        /// </summary>
+        /// <param name="useSampler"></param>
+        /// <param name="texSamplerName"></param>
+        /// <param name="TextureName"></param>
+        /// <returns></returns>
+        public static string GetTextureType(string useSampler, string texSamplerName, string TextureName)
+        {
+            if (useSampler == "s_diffuse")                    return "Diffuse";
+            else if (useSampler == "s_normal")                return "Normal";
+            else if (useSampler == "s_specmask")              return "Specular";
+            else if (useSampler == "_a0")                     return "Diffuse";
+            else if (useSampler == "_a1")                     return "DiffuseLayer2";
+            else if (useSampler == "_a2")                     return "DiffuseLayer3";
+            else if (useSampler == "_n0")                     return "Normal";
+            else if (TextureName.Contains("_Nrm"))            return "Normal";
+            else if (useSampler == "_s0")                     return "Specular";
+            else if (useSampler == "_ao0")                    return "AO";
+            else if (useSampler == "_e0")                     return "Emission";
+            else if (useSampler == "_b0")                     return "Shadow";
+            else if (useSampler == "_b1")                     return "Light";
+            else if (TextureName.Contains("Emm"))             return "Emission";
+            else if (TextureName.Contains("Spm"))             return "Specular";
+            else if (TextureName.Contains("b00"))             return "Shadow";
+            else if (texSamplerName == "bake0")               return "Shadow";
+            else if (TextureName.Contains("Moc"))             return "AO";
+            else if (TextureName.Contains("AO"))              return "AO";
+            else if (TextureName.Contains("b01"))             return "Light";
+            //Metalness, Roughness, and Cavity Map in one
+            else if (TextureName.Contains("MRA"))             return "MRA";
+            else if (TextureName.Contains("mtl"))             return "Metalness";
+            else if (TextureName.Contains("rgh"))             return "Roughness";
+            else if (TextureName.Contains("sss"))             return "SubSurfaceScattering";
+            else if (texSamplerName == "_ao0")                return "AO";
+            else if (TextureName.Contains("Alb"))             return "Diffuse";
+            else if (texSamplerName == "_sd0")                return "Shadow";
+            else if (texSamplerName == "_ms0")                return "Mask";
+            else                                              return "unknown";
+        }
+        /// <summary>
         /// 
         /// </summary>
         /// <param name="writer"></param>
@@ -164,10 +164,6 @@ namespace BFRES_Importer
             writer.WriteAttributeString( "LODMeshCount", shp.Meshes.Count.ToString() );
             foreach( Mesh msh in shp.Meshes )
             {
-                uint FaceCount = msh.IndexCount;
-                uint[] indicesArray = msh.GetIndices().ToArray();
-
-
                 writer.WriteStartElement( "LODMesh" );
 
                 Program.AssertAndLog( Program.ErrorType.eNonTrianglePolygon      , msh.PrimitiveType == GX2PrimitiveType.Triangles, "Mesh is not using triangles. Case is not handled." );
@@ -178,11 +174,8 @@ namespace BFRES_Importer
                 writer.WriteAttributeString( "IndexCount"   , msh.IndexCount   .ToString() );
                 writer.WriteAttributeString( "FirstVertex"  , msh.FirstVertex  .ToString() );
 
-                List<int> tempFaceList = new List<int>();
-                for( int face = 0; face < FaceCount; face++ )
-                    tempFaceList.Add( (int)indicesArray[ face ] + (int)msh.FirstVertex );
                 string tempFaces = "";
-                foreach( int fc in tempFaceList )
+                foreach( int fc in GetFaceVertices( msh ) )
                     tempFaces += ( fc + "," );
                 tempFaces = tempFaces.Trim( ',' );
                 writer.WriteAttributeString( "FaceVertices", tempFaces );
@@ -210,6 +203,76 @@ namespace BFRES_Importer
         /// <param name="vtx"></param>
         /// <param name="model"></param>
         private static void WriteVertexBuffer(XmlWriter writer, Shape shp, VertexBuffer vtx, ResU.Model model, JPSkeleton jPSkeleton)
+        {
+            List<Vertex> vertices = BuildVertices(shp, vtx, model, jPSkeleton);
+
+            // Write Vertex Data
+            writer.WriteStartElement("Vertices");
+            writer.WriteAttributeString("VertexCount", vtx.VertexCount.ToString());
+            for (int i = 0; i < vertices.Count; i++)
+            {
+                writer.WriteStartElement("Vertex");
+
+                writer.WriteAttributeString("Index"    , i                              .ToString());
+                writer.WriteAttributeString("Position0", Program.Vector3ToString(vertices[i].pos)  );
+                writer.WriteAttributeString("Position1", Program.Vector3ToString(vertices[i].pos1) ); Program.AssertAndLog( Program.ErrorType.eVertexPosSet, vertices[ i ].pos1 == OpenTK.Vector3.Zero, $"Vertex index {i} pos1 is set to {vertices[i].pos1} and not 0"); // Add C++ support
+                writer.WriteAttributeString("Position2", Program.Vector3ToString(vertices[i].pos2) ); Program.AssertAndLog( Program.ErrorType.eVertexPosSet, vertices[ i ].pos2 == OpenTK.Vector3.Zero, $"Vertex index {i} pos2 is set to {vertices[i].pos2} and not 0"); // Add C++ support
+                writer.WriteAttributeString("Normal"   , Program.Vector3ToString(vertices[i].nrm)  );
+                writer.WriteAttributeString("UV0"      , Program.Vector2ToString(vertices[i].uv0)  );
+                writer.WriteAttributeString("UV1"      , Program.Vector2ToString(vertices[i].uv1)  );
+                writer.WriteAttributeString("UV2"      , Program.Vector2ToString(vertices[i].uv2)  );
+                writer.WriteAttributeString("Color0"   , Program.Vector4ToString(vertices[i].col)  );
+                writer.WriteAttributeString("Color1"   , Program.Vector4ToString(vertices[i].col2) ); Program.AssertAndLog( Program.ErrorType.eVertexPosSet, vertices[ i ].col2 == OpenTK.Vector4.One, $"Vertex index {i} col2 is set to {vertices[i].col2} and not One"); // Add C++ support. Unknown use of col2
+                writer.WriteAttributeString("Tangent"  , Program.Vector4ToString(vertices[i].tan)  );
+                writer.WriteAttributeString("Binormal" , Program.Vector4ToString(vertices[i].bitan));
+                
+                string tempBoneWeights = "";
+                foreach (var w in vertices[i].boneWeights)
+                {
+                    tempBoneWeights += (w.ToString() + ',');
+                }
+                tempBoneWeights = tempBoneWeights.Trim(',');
+                writer.WriteAttributeString("BlendWeights", tempBoneWeights);
+
+                string tempBoneIds = "";
+                foreach (var w in vertices[i].boneIds)
+                {
+                    tempBoneIds += (w.ToString() + ',');
+                }
+                tempBoneIds = tempBoneIds.Trim(',');
+                writer.WriteAttributeString("BlendIndex", tempBoneIds);
+                writer.WriteEndElement();
+            }
+            writer.WriteEndElement();
+
+
+
+        }
+
+        /// <summary>
+        /// Returns the mesh indices with the first vertex already added, one entry per face corner
+        /// </summary>
+        /// <param name="msh"></param>
+        /// <returns></returns>
+        public static int[] GetFaceVertices( Mesh msh )
+        {
+            uint FaceCount = msh.IndexCount;
+            uint[] indicesArray = msh.GetIndices().ToArray();
+
+            int[] faceVertices = new int[ FaceCount ];
+            for( int face = 0; face < FaceCount; face++ )
+                faceVertices[ face ] = (int)indicesArray[ face ] + (int)msh.FirstVertex;
+            return faceVertices;
+        }
+
+        /// <summary>
+        /// Reads the vertex buffer of a shape and applies the rigid and unskinned bone transforms
+        /// </summary>
+        /// <param name="shp"></param>
+        /// <param name="vtx"></param>
+        /// <param name="model"></param>
+        /// <returns></returns>
+        public static List<Vertex> BuildVertices(Shape shp, VertexBuffer vtx, ResU.Model model, JPSkeleton jPSkeleton)
         {
             //Create a buffer instance which stores all the buffer data
             VertexBufferHelper helper = new VertexBufferHelper(vtx, Syroot.BinaryData.ByteOrder.BigEndian); // TODO if this supports Switch files, you will need to re-look at this
@@ -385,47 +448,7 @@ namespace BFRES_Importer
 
             }
 
-            // Write Vertex Data
-            writer.WriteStartElement("Vertices");
-            writer.WriteAttributeString("VertexCount", vtx.VertexCount.ToString());
-            for (int i = 0; i < vertices.Count; i++)
-            {
-                writer.WriteStartElement("Vertex");
-
-                writer.WriteAttributeString("Index"    , i                              .ToString());
-                writer.WriteAttributeString("Position0", Program.Vector3ToString(vertices[i].pos)  );
-                writer.WriteAttributeString("Position1", Program.Vector3ToString(vertices[i].pos1) ); Program.AssertAndLog( Program.ErrorType.eVertexPosSet, vertices[ i ].pos1 == OpenTK.Vector3.Zero, $"Vertex index {i} pos1 is set to {vertices[i].pos1} and not 0"); // Add C++ support
-                writer.WriteAttributeString("Position2", Program.Vector3ToString(vertices[i].pos2) ); Program.AssertAndLog( Program.ErrorType.eVertexPosSet, vertices[ i ].pos2 == OpenTK.Vector3.Zero, $"Vertex index {i} pos2 is set to {vertices[i].pos2} and not 0"); // Add C++ support
-                writer.WriteAttributeString("Normal"   , Program.Vector3ToString(vertices[i].nrm)  );
-                writer.WriteAttributeString("UV0"      , Program.Vector2ToString(vertices[i].uv0)  );
-                writer.WriteAttributeString("UV1"      , Program.Vector2ToString(vertices[i].uv1)  );
-                writer.WriteAttributeString("UV2"      , Program.Vector2ToString(vertices[i].uv2)  );
-                writer.WriteAttributeString("Color0"   , Program.Vector4ToString(vertices[i].col)  );
-                writer.WriteAttributeString("Color1"   , Program.Vector4ToString(vertices[i].col2) ); Program.AssertAndLog( Program.ErrorType.eVertexPosSet, vertices[ i ].col2 == OpenTK.Vector4.One, $"Vertex index {i} col2 is set to {vertices[i].col2} and not One"); // Add C++ support. Unknown use of col2
-                writer.WriteAttributeString("Tangent"  , Program.Vector4ToString(vertices[i].tan)  );
-                writer.WriteAttributeString("Binormal" , Program.Vector4ToString(vertices[i].bitan));
-                
-                string tempBoneWeights = "";
-                foreach (var w in vertices[i].boneWeights)
-                {
-                    tempBoneWeights += (w.ToString() + ',');
-                }
-                tempBoneWeights = tempBoneWeights.Trim(',');
-                writer.WriteAttributeString("BlendWeights", tempBoneWeights);
-
-                string tempBoneIds = "";
-                foreach (var w in vertices[i].boneIds)
-                {
-                    tempBoneIds += (w.ToString() + ',');
-                }
-                tempBoneIds = tempBoneIds.Trim(',');
-                writer.WriteAttributeString("BlendIndex", tempBoneIds);
-                writer.WriteEndElement();
-            }
-            writer.WriteEndElement();
-
-
-
+            return vertices;
         }
         /// <summary>
         /// 
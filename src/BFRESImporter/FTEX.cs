@@ -340,18 +340,20 @@ namespace BFRES_Importer
             if (!IsReplaced && Tex1 != null && Tex1.Contains(".Tex1"))
             {
                 string Tex2 = Tex1.Replace(".Tex1", ".Tex2");
-                Console.WriteLine(Tex2 + " " + System.IO.File.Exists(Tex2) + " " + texture.Name);
+                bool Tex2Exists = PackFile.Exists(Tex2);
+                Console.WriteLine(Tex2 + " " + Tex2Exists + " " + texture.Name);
 
-                if (System.IO.File.Exists(Tex2))
+                // Tex2 sits next to Tex1, either on disk or in the same .pack
+                if (Tex2Exists)
                 {
                     if (Tex2.EndsWith(".sbfres"))
                     {
                         ResFileTexture2 = new ResFile(new System.IO.MemoryStream(
-                                        EveryFileExplorer.YAZ0.Decompress(Tex2)));
+                                        EveryFileExplorer.YAZ0.Decompress(PackFile.ReadAllBytes(Tex2))));
                     }
                     else
                     {
-                        ResFileTexture2 = new ResFile(Tex2);
+                        ResFileTexture2 = new ResFile(new System.IO.MemoryStream(PackFile.ReadAllBytes(Tex2)));
                     }
                 }
             }
@@ -0,0 +1,452 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using Syroot.NintenTools.Bfres;
+using Syroot.NintenTools.Bfres.GX2;
+using ResU = Syroot.NintenTools.Bfres;
+
+namespace BFRES_Importer
+{
+    /// <summary>
+    /// Writes the median dump as a binary container instead of xml. Everything the exporter reads is stored as
+    /// little endian records and typed arrays that the C++ side maps and reads in place, see MedianBinary.h.
+    ///
+    /// Layout: header, then all arrays (each 16 byte aligned), then the record arrays that point at them, then
+    /// the string table. Records always come after the arrays they reference, so the file is written in one pass.
+    /// </summary>
+    class MedianBinaryWriter
+    {
+        const uint Magic   = 0x4E49424D; // "MBIN"
+        const uint Version = 1;
+        const int  HeaderSize = 48;
+
+        // Enum names in the order of the C++ enums in BFRES.h, the index is the value written
+        static readonly string[] TexClampNames        = { "Wrap", "Mirror", "Clamp", "MirrorOnce", "ClampHalfBorder", "MirrorOnceHalfBorder", "ClampBorder", "MirrorOnceBorder" };
+        static readonly string[] TexXYFilterNames     = { "Point", "Bilinear" };
+        static readonly string[] TexZFilterNames      = { "UseXY", "Point", "Linear" };
+        static readonly string[] TexMipFilterNames    = { "NoMip", "Point", "Linear" };
+        static readonly string[] TexAnisoRatioNames   = { "OneToOne", "TwoToOne", "FourToOne", "EightToOne", "SixteenToOne" };
+        static readonly string[] TexBorderTypeNames   = { "ClearBlack", "SolidBlack", "SolidWhite", "UseRegister" };
+        static readonly string[] CompareFunctionNames = { "Never", "Less", "Equal", "LessOrEqual", "Greater", "NotEqual", "GreaterOrEqual", "Always" };
+        static readonly string[] ScalingTypeNames     = { "None", "Standard", "Maya", "Softimage" };
+        static readonly string[] InterpolationNames   = { "LINEAR", "CONSTANT", "HERMITE", "STEP", "STEPBOOL" };
+        static readonly string[] UserDataTypeNames    = { "Int32", "Single", "String", "WString", "Byte" };
+
+        static readonly Dictionary<string, uint> TextureMapTypes = new Dictionary<string, uint>()
+        {
+            { "Albedo", 0 }, { "Diffuse", 0 }, { "Normal", 1 }, { "Specular", 2 }, { "AmbientOcclusion", 3 }, { "AO", 3 },
+            { "Emission", 4 }, { "Shadow", 5 }, { "Light", 6 }, { "MRA", 7 }, { "Metalness", 8 }, { "Roughness", 9 },
+            { "SubSurfaceScattering", 10 }, { "bake0", 11 }, { "Mask", 12 }
+        };
+        const uint TextureMapTypeMax = 13;
+
+        struct ArrayRef
+        {
+            public uint Offset;
+            public uint Count;
+        }
+
+        class ModelRefs
+        {
+            public ResU.Model Model;
+            public ArrayRef BoneList, Bones, Materials, Shapes;
+        }
+
+        class ShapeRefs
+        {
+            public Shape Shape;
+            public uint VertexCount;
+            public ArrayRef Radius, SkinBoneIndices, LODMeshes;
+            public ArrayRef[] Streams = new ArrayRef[ StreamCount ];
+        }
+
+        class AnimRefs
+        {
+            public SkeletalAnim Anim;
+            public ArrayRef BoneAnims, UserData;
+        }
+
+        // Same order as the stream refs in MedianBinary::ShapeRecord
+        const int StreamCount = 13;
+
+        BinaryWriter writer;
+        Dictionary<string, uint> stringOffsets = new Dictionary<string, uint>();
+        MemoryStream strings = new MemoryStream();
+
+        /// <summary>
+        /// Writes every model and skeletal animation of the res file to filePath and saves the textures next to it.
+        /// </summary>
+        /// <param name="res"></param>
+        /// <param name="filePath"></param>
+        public static void Write(ResU.ResFile res, string filePath)
+        {
+            if (!Directory.Exists(Program.OutputDir))
+                Directory.CreateDirectory(Program.OutputDir);
+
+            for (int ii = 0; ii < res.Textures.Count; ii++)
+                Program.SaveTexture(res.Textures[ii]);
+
+            using (FileStream stream = new FileStream(filePath, FileMode.Create, FileAccess.Write))
+            {
+                MedianBinaryWriter median = new MedianBinaryWriter();
+                median.writer = new BinaryWriter(stream);
+                median.WriteRes(res);
+            }
+        }
+
+        void WriteRes(ResU.ResFile res)
+        {
+            writer.Write(new byte[ HeaderSize ]);
+
+            List<ModelRefs> models = new List<ModelRefs>();
+            foreach (ResU.Model model in res.Models.Values)
+                models.Add(WriteModelArrays(model));
+
+            List<AnimRefs> anims = new List<AnimRefs>();
+            foreach (SkeletalAnim anim in res.SkeletalAnims.Values)
+                anims.Add(WriteAnimArrays(anim));
+
+            ArrayRef modelArray = WriteArray(models.Count, m => WriteModelRecord(m), models);
+            ArrayRef animArray  = WriteArray(anims.Count, a => WriteAnimRecord(a), anims);
+
+            Align();
+            ArrayRef stringTable = new ArrayRef() { Offset = (uint)writer.BaseStream.Position, Count = (uint)strings.Length };
+            strings.WriteTo(writer.BaseStream);
+            uint fileSize = (uint)writer.BaseStream.Position;
+
+            writer.Seek(0, SeekOrigin.Begin);
+            writer.Write(Magic);
+            writer.Write(Version);
+            writer.Write(fileSize);
+            WriteRef(modelArray);
+            WriteRef(animArray);
+            WriteRef(stringTable);
+            writer.Flush();
+        }
+
+        ModelRefs WriteModelArrays(ResU.Model model)
+        {
+            ModelRefs refs = new ModelRefs() { Model = model };
+
+            JPSkeleton jpSkeleton = new JPSkeleton();
+            jpSkeleton.ReadSkeleton(model.Skeleton);
+
+            Skeleton skeleton = model.Skeleton;
+            if (skeleton.MatrixToBoneList == null)
+                skeleton.MatrixToBoneList = new List<ushort>();
+            refs.BoneList = WriteArray(skeleton.MatrixToBoneList.Count, bn => writer.Write((uint)bn), skeleton.MatrixToBoneList);
+
+            List<Bone> bones = skeleton.Bones.Values.ToList();
+            int boneIndex = 0;
+            refs.Bones = WriteArray(bones.Count, bn => WriteBoneRecord(bn, boneIndex++), bones);
+
+            List<Material> materials = model.Materials.Values.ToList();
+            List<ArrayRef> textureArrays = materials.Select(mat => WriteTextureArray(mat)).ToList();
+            int matIndex = 0;
+            refs.Materials = WriteArray(materials.Count, mat =>
+            {
+                WriteString(mat.Name);
+                writer.Write(mat.Flags == MaterialFlags.Visible ? 1u : 0u);
+                WriteRef(textureArrays[ matIndex++ ]);
+            }, materials);
+
+            List<ShapeRefs> shapes = new List<ShapeRefs>();
+            foreach (Shape shp in model.Shapes.Values)
+                shapes.Add(WriteShapeArrays(shp, model.VertexBuffers[ shp.VertexBufferIndex ], model, jpSkeleton));
+            refs.Shapes = WriteArray(shapes.Count, shp => WriteShapeRecord(shp), shapes);
+
+            return refs;
+        }
+
+        void WriteModelRecord(ModelRefs refs)
+        {
+            WriteString(refs.Model.Name);
+            writer.Write((uint)refs.Model.Skeleton.MatrixToBoneList.Count);
+            writer.Write((uint)refs.Model.TotalVertexCount);
+            WriteRef(refs.BoneList);
+            WriteRef(refs.Bones);
+            WriteRef(refs.Materials);
+            WriteRef(refs.Shapes);
+        }
+
+        void WriteBoneRecord(Bone bn, int boneIndex)
+        {
+            WriteString(bn.Name);
+            writer.Write((uint)boneIndex);
+            writer.Write((int)bn.RigidMatrixIndex);
+            writer.Write((int)bn.SmoothMatrixIndex);
+            writer.Write((int)bn.BillboardIndex);
+            writer.Write((int)(short)bn.ParentIndex);
+            writer.Write(bn.FlagsRotation == BoneFlagsRotation.EulerXYZ ? 4096u : 0u);
+            writer.Write((byte)(bn.Flags.HasFlag(BoneFlags.Visible) ? 1 : 0));
+            writer.Write((byte)(bn.RigidMatrixIndex != -1 ? 1 : 0));
+            writer.Write((byte)(bn.SmoothMatrixIndex != -1 ? 1 : 0));
+            writer.Write((byte)0);
+            writer.Write(bn.Scale.X);    writer.Write(bn.Scale.Y);    writer.Write(bn.Scale.Z);
+            writer.Write(bn.Rotation.X); writer.Write(bn.Rotation.Y); writer.Write(bn.Rotation.Z); writer.Write(bn.Rotation.W);
+            writer.Write(bn.Position.X); writer.Write(bn.Position.Y); writer.Write(bn.Position.Z);
+        }
+
+        ArrayRef WriteTextureArray(Material mat)
+        {
+            if (mat.TextureRefs == null)
+                mat.TextureRefs = new List<TextureRef>();
+
+            int id = 0;
+            return WriteArray(mat.TextureRefs.Count, tex =>
+            {
+                TexSampler sampler = mat.Samplers[ id ].TexSampler;
+
+                string texSamplerName;
+                mat.Samplers.TryGetKey(mat.Samplers[ id ], out texSamplerName);
+                string useSampler = texSamplerName;
+                if (mat.ShaderAssign.SamplerAssigns.ContainsKey(useSampler))
+                    useSampler = mat.ShaderAssign.SamplerAssigns[ useSampler ];
+
+                uint type;
+                if (!TextureMapTypes.TryGetValue(FMAT.GetTextureType(useSampler, texSamplerName, tex.Name), out type))
+                    type = TextureMapTypeMax;
+
+                WriteString(tex.Name);
+                WriteString(texSamplerName);
+                WriteString(useSampler);
+                writer.Write(EnumIndex(TexClampNames, sampler.ClampX.ToString()));
+                writer.Write(EnumIndex(TexClampNames, sampler.ClampY.ToString()));
+                writer.Write(EnumIndex(TexClampNames, sampler.ClampZ.ToString()));
+                writer.Write(EnumIndex(TexXYFilterNames, sampler.MinFilter.ToString()));
+                writer.Write(EnumIndex(TexXYFilterNames, sampler.MagFilter.ToString()));
+                writer.Write(EnumIndex(TexZFilterNames, sampler.ZFilter.ToString()));
+                writer.Write(EnumIndex(TexMipFilterNames, sampler.MipFilter.ToString()));
+                writer.Write(EnumIndex(TexAnisoRatioNames, sampler.MaxAnisotropicRatio.ToString()));
+                writer.Write(EnumIndex(TexBorderTypeNames, sampler.BorderType.ToString()));
+                writer.Write(EnumIndex(CompareFunctionNames, sampler.DepthCompareFunc.ToString()));
+                writer.Write(type);
+                writer.Write(sampler.MinLod);
+                writer.Write(sampler.MaxLod);
+                writer.Write(sampler.LodBias);
+                writer.Write(sampler.DepthCompareEnabled ? 1u : 0u);
+                writer.Write((uint)(id + 1));
+                id++;
+            }, mat.TextureRefs);
+        }
+
+        ShapeRefs WriteShapeArrays(Shape shp, VertexBuffer vertexBuffer, ResU.Model model, JPSkeleton jpSkeleton)
+        {
+            ShapeRefs refs = new ShapeRefs() { Shape = shp };
+
+            refs.Radius = WriteArray(shp.RadiusArray.Count, rad => writer.Write(rad), shp.RadiusArray);
+            if (shp.SkinBoneIndices != null)
+                refs.SkinBoneIndices = WriteArray(shp.SkinBoneIndices.Count, bn => writer.Write((uint)bn), shp.SkinBoneIndices);
+
+            List<ArrayRef> faceArrays = new List<ArrayRef>();
+            foreach (Mesh msh in shp.Meshes)
+            {
+                int[] faceVertices = FMDL.GetFaceVertices(msh);
+                faceArrays.Add(WriteArray(faceVertices.Length, fc => writer.Write(fc), faceVertices));
+            }
+            int meshIndex = 0;
+            refs.LODMeshes = WriteArray(shp.Meshes.Count, msh =>
+            {
+                writer.Write((uint)msh.PrimitiveType);
+                writer.Write((uint)msh.IndexFormat);
+                writer.Write(msh.IndexCount);
+                writer.Write(msh.FirstVertex);
+                WriteRef(faceArrays[ meshIndex++ ]);
+                writer.Write(msh.SubMeshes.Count > 0 ? (int)msh.SubMeshes[ 0 ].Count  : 0);
+                writer.Write(msh.SubMeshes.Count > 0 ? (int)msh.SubMeshes[ 0 ].Offset : 0);
+            }, shp.Meshes);
+
+            // One tightly packed array per attribute instead of one element per vertex
+            List<Vertex> vertices = FMDL.BuildVertices(shp, vertexBuffer, model, jpSkeleton);
+            refs.VertexCount = (uint)vertices.Count;
+            refs.Streams[ 0  ] = WriteArray(vertices.Count, v => { writer.Write(v.pos.X);   writer.Write(v.pos.Y);   writer.Write(v.pos.Z);   }, vertices);
+            refs.Streams[ 1  ] = WriteArray(vertices.Count, v => { writer.Write(v.pos1.X);  writer.Write(v.pos1.Y);  writer.Write(v.pos1.Z);  }, vertices);
+            refs.Streams[ 2  ] = WriteArray(vertices.Count, v => { writer.Write(v.pos2.X);  writer.Write(v.pos2.Y);  writer.Write(v.pos2.Z);  }, vertices);
+            refs.Streams[ 3  ] = WriteArray(vertices.Count, v => { writer.Write(v.nrm.X);   writer.Write(v.nrm.Y);   writer.Write(v.nrm.Z);   }, vertices);
+            refs.Streams[ 4  ] = WriteArray(vertices.Count, v => { writer.Write(v.uv0.X);   writer.Write(v.uv0.Y);   }, vertices);
+            refs.Streams[ 5  ] = WriteArray(vertices.Count, v => { writer.Write(v.uv1.X);   writer.Write(v.uv1.Y);   }, vertices);
+            refs.Streams[ 6  ] = WriteArray(vertices.Count, v => { writer.Write(v.uv2.X);   writer.Write(v.uv2.Y);   }, vertices);
+            refs.Streams[ 7  ] = WriteArray(vertices.Count, v => WriteVector4(v.col),   vertices);
+            refs.Streams[ 8  ] = WriteArray(vertices.Count, v => WriteVector4(v.col2),  vertices);
+            refs.Streams[ 9  ] = WriteArray(vertices.Count, v => WriteVector4(v.tan),   vertices);
+            refs.Streams[ 10 ] = WriteArray(vertices.Count, v => WriteVector4(v.bitan), vertices);
+
+            // Shapes without skinning have no blend data, the exporter falls back to the same defaults as for the xml
+            if (vertices.Count > 0 && vertices.All(v => v.boneWeights.Count == 4))
+                refs.Streams[ 11 ] = WriteArray(vertices.Count, v => { foreach (float w in v.boneWeights) writer.Write(w); }, vertices);
+            if (vertices.Count > 0 && vertices.All(v => v.boneIds.Count == 4))
+                refs.Streams[ 12 ] = WriteArray(vertices.Count, v => { foreach (int id in v.boneIds) writer.Write((uint)id); }, vertices);
+
+            return refs;
+        }
+
+        void WriteShapeRecord(ShapeRefs refs)
+        {
+            Shape shp = refs.Shape;
+            WriteString(shp.Name);
+            writer.Write((uint)shp.MaterialIndex);
+            writer.Write((uint)shp.BoneIndex);
+            writer.Write((uint)shp.VertexBufferIndex);
+            writer.Write((uint)shp.VertexSkinCount);
+            writer.Write((uint)shp.TargetAttribCount);
+            writer.Write(refs.VertexCount);
+            WriteRef(refs.Radius);
+            WriteRef(refs.SkinBoneIndices);
+            WriteRef(refs.LODMeshes);
+            foreach (ArrayRef stream in refs.Streams)
+                WriteRef(stream);
+        }
+
+        AnimRefs WriteAnimArrays(SkeletalAnim anim)
+        {
+            AnimRefs refs = new AnimRefs() { Anim = anim };
+
+            JPSkeletalAnim jPSkeletalAnim = new JPSkeletalAnim();
+            jPSkeletalAnim.LoadAnimData(anim);
+
+            // Key frames first, the bone anim records hold the refs of all ten tracks
+            List<ArrayRef[]> keyArrays = new List<ArrayRef[]>();
+            foreach (KeyNode bone in jPSkeletalAnim.Bones)
+                keyArrays.Add(GetTracks(bone).Select(track => WriteArray(track.Keys.Count, key =>
+                {
+                    writer.Write(key.Frame);
+                    writer.Write(key.Value);
+                    writer.Write(key.Slope1);
+                    writer.Write(key.Slope2);
+                    writer.Write((byte)(key.Degrees ? 1 : 0));
+                    writer.Write((byte)(key.Weighted ? 1 : 0));
+                    writer.Write((ushort)0);
+                }, track.Keys)).ToArray());
+
+            int boneIndex = 0;
+            refs.BoneAnims = WriteArray(jPSkeletalAnim.Bones.Count, bone =>
+            {
+                WriteString(bone.Name);
+                writer.Write(bone.Hash);
+                writer.Write((uint)bone.RotType);
+                writer.Write(bone.UseSegmentScaleCompensate ? 1u : 0u);
+
+                KeyGroup[] tracks = GetTracks(bone);
+                for (int i = 0; i < tracks.Length; i++)
+                {
+                    KeyGroup track = tracks[ i ];
+                    WriteString(track.Name);
+                    writer.Write(EnumIndex(InterpolationNames, track.InterpolationType.ToString()));
+                    writer.Write(track.Constant ? 1u : 0u);
+                    writer.Write(track.FrameCount);
+                    writer.Write(track.StartFrame);
+                    writer.Write(track.EndFrame);
+                    writer.Write(track.Delta);
+                    WriteRef(keyArrays[ boneIndex ][ i ]);
+                }
+                boneIndex++;
+            }, jPSkeletalAnim.Bones);
+
+            List<ArrayRef> valueArrays = new List<ArrayRef>();
+            foreach (UserData userData in anim.UserData.Values)
+            {
+                float[] values = new float[ 0 ];
+                switch (userData.Type)
+                {
+                    case UserDataType.Int32:  values = userData.GetValueInt32Array() .Select(v => (float)v).ToArray(); break;
+                    case UserDataType.Single: values = userData.GetValueSingleArray();                                 break;
+                    case UserDataType.Byte:   values = userData.GetValueByteArray()  .Select(v => (float)v).ToArray(); break;
+                    default: break;
+                }
+                valueArrays.Add(WriteArray(values.Length, v => writer.Write(v), values));
+            }
+            int userDataIndex = 0;
+            refs.UserData = WriteArray(anim.UserData.Count, userData =>
+            {
+                WriteString(userData.Name);
+                writer.Write(EnumIndex(UserDataTypeNames, userData.Type.ToString()));
+                WriteRef(valueArrays[ userDataIndex++ ]);
+            }, anim.UserData.Values);
+
+            return refs;
+        }
+
+        void WriteAnimRecord(AnimRefs refs)
+        {
+            SkeletalAnim anim = refs.Anim;
+            WriteString(anim.Name);
+            writer.Write((byte)(anim.Baked ? 1 : 0));
+            writer.Write((byte)(anim.Loop ? 1 : 0));
+            writer.Write((ushort)0);
+            writer.Write(EnumIndex(ScalingTypeNames, anim.FlagsScale.ToString()) << 8);
+            writer.Write((uint)anim.FrameCount);
+            WriteRef(refs.BoneAnims);
+            WriteRef(refs.UserData);
+        }
+
+        static KeyGroup[] GetTracks(KeyNode bone)
+        {
+            return new KeyGroup[] { bone.XSCA, bone.YSCA, bone.ZSCA, bone.XROT, bone.YROT, bone.ZROT, bone.WROT, bone.XPOS, bone.YPOS, bone.ZPOS };
+        }
+
+        /// <summary>
+        /// Writes count elements 16 byte aligned and returns where they ended up. Empty arrays are not written at all.
+        /// </summary>
+        ArrayRef WriteArray<T>(int count, Action<T> writeElement, IEnumerable<T> elements)
+        {
+            if (count == 0)
+                return new ArrayRef();
+
+            Align();
+            ArrayRef array = new ArrayRef() { Offset = (uint)writer.BaseStream.Position, Count = (uint)count };
+            foreach (T element in elements)
+                writeElement(element);
+            return array;
+        }
+
+        void WriteRef(ArrayRef array)
+        {
+            writer.Write(array.Offset);
+            writer.Write(array.Count);
+        }
+
+        /// <summary>
+        /// Writes the string table offset and byte length of str, adding it to the table the first time it is seen.
+        /// </summary>
+        void WriteString(string str)
+        {
+            if (str == null)
+                str = "";
+
+            uint offset;
+            if (!stringOffsets.TryGetValue(str, out offset))
+            {
+                byte[] bytes = Encoding.UTF8.GetBytes(str);
+                offset = (uint)strings.Length;
+                strings.Write(bytes, 0, bytes.Length);
+                strings.WriteByte(0);
+                stringOffsets.Add(str, offset);
+            }
+            writer.Write(offset);
+            writer.Write((uint)Encoding.UTF8.GetByteCount(str));
+        }
+
+        void WriteVector4(OpenTK.Vector4 vec4)
+        {
+            writer.Write(vec4.X);
+            writer.Write(vec4.Y);
+            writer.Write(vec4.Z);
+            writer.Write(vec4.W);
+        }
+
+        void Align()
+        {
+            while (writer.BaseStream.Position % 16 != 0)
+                writer.Write((byte)0);
+        }
+
+        static uint EnumIndex(string[] names, string value)
+        {
+            int index = Array.IndexOf(names, value);
+            Program.AssertAndLog(Program.ErrorType.eUnhandled, index != -1, $"{value} has no matching value in the exporter");
+            return index == -1 ? 0 : (uint)index;
+        }
+    }
+}
@@ -0,0 +1,151 @@
+using System;
+using System.IO;
+using System.Text;
+
+namespace BFRES_Importer
+{
+    /// <summary>
+    /// Reads files straight out of SARC archives (.pack) without extracting them. A file inside an archive is
+    /// addressed as if the archive were a directory, e.g. Pack\TitleBG.pack\Model\Npc_Gerudo_Queen.sbfres, which is
+    /// what FBXExporter -list prints. Only the archive's node and name tables and the requested file are read, out of
+    /// the decompressed archive if it is Yaz0. Paths outside of archives are read as plain files.
+    /// </summary>
+    static class PackFile
+    {
+        const uint SARCMagic = 0x53415243; // "SARC"
+        const uint Yaz0Magic = 0x59617A30; // "Yaz0"
+        const uint NodeHasName = 0x01000000;
+
+        public static bool Exists(string path)
+        {
+            if (File.Exists(path))
+                return true;
+
+            string archivePath, entryName;
+            return SplitPath(path, out archivePath, out entryName) && ReadEntry(archivePath, entryName) != null;
+        }
+
+        public static byte[] ReadAllBytes(string path)
+        {
+            string archivePath, entryName;
+            if (File.Exists(path) || !SplitPath(path, out archivePath, out entryName))
+                return File.ReadAllBytes(path);
+
+            byte[] data = ReadEntry(archivePath, entryName);
+            if (data == null)
+                throw new FileNotFoundException($"{entryName} is not in {archivePath}", path);
+            return data;
+        }
+
+        // The first leading part of the path that is a file is the archive, the rest the name inside it
+        static bool SplitPath(string path, out string archivePath, out string entryName)
+        {
+            for (int separator = path.IndexOfAny(new[] { '\\', '/' }); separator >= 0; separator = path.IndexOfAny(new[] { '\\', '/' }, separator + 1))
+            {
+                if (separator == 0 || !File.Exists(path.Substring(0, separator)))
+                    continue;
+
+                archivePath = path.Substring(0, separator);
+                entryName = path.Substring(separator + 1).Replace('\\', '/');
+                return entryName.Length > 0;
+            }
+
+            archivePath = entryName = null;
+            return false;
+        }
+
+        // Null if the archive doesn't hold the entry or isn't a SARC archive at all, a broken one throws
+        static byte[] ReadEntry(string archivePath, string entryName)
+        {
+            using (Stream file = File.OpenRead(archivePath))
+            {
+                if (file.Length < 4)
+                    return null;
+
+                // A compressed archive has to be decompressed as a whole, a plain one is only read where needed
+                if (ReadUInt32(ReadBytes(file, 0, 4, archivePath), 0, true) == Yaz0Magic)
+                {
+                    byte[] compressed = ReadBytes(file, 0, (int)file.Length, archivePath);
+                    using (Stream decompressed = new MemoryStream(EveryFileExplorer.YAZ0.Decompress(compressed)))
+                        return ReadEntry(decompressed, archivePath, entryName);
+                }
+                return ReadEntry(file, archivePath, entryName);
+            }
+        }
+
+        static byte[] ReadEntry(Stream archive, string archivePath, string entryName)
+        {
+            if (archive.Length < 0x14 || ReadUInt32(ReadBytes(archive, 0, 4, archivePath), 0, true) != SARCMagic)
+                return null;
+            byte[] header = ReadBytes(archive, 0, 0x14, archivePath);
+
+            // The byte order mark is stored in the archive's own byte order
+            if (!(header[6] == 0xFE && header[7] == 0xFF) && !(header[6] == 0xFF && header[7] == 0xFE))
+                throw new InvalidDataException($"{archivePath} has no valid byte order mark");
+            bool bigEndian = header[6] == 0xFE;
+            int headerSize = ReadUInt16(header, 4, bigEndian);
+            uint dataOffset = ReadUInt32(header, 0x0C, bigEndian);
+
+            byte[] sfatHeader = ReadBytes(archive, headerSize, 0x0C, archivePath);
+            int nodeCount = ReadUInt16(sfatHeader, 6, bigEndian);
+            int nodesOffset = headerSize + ReadUInt16(sfatHeader, 4, bigEndian);
+
+            // Node table, name table header and names all sit in front of the data
+            int sfnt = nodeCount * 16;
+            if (dataOffset > archive.Length || nodesOffset + sfnt + 8 > dataOffset)
+                throw new InvalidDataException($"{archivePath} has its file tables outside of the archive");
+            byte[] tables = ReadBytes(archive, nodesOffset, (int)dataOffset - nodesOffset, archivePath);
+            int names = sfnt + ReadUInt16(tables, sfnt + 4, bigEndian);
+
+            for (int i = 0; i < nodeCount; i++)
+            {
+                uint attributes = ReadUInt32(tables, i * 16 + 4, bigEndian);
+                if ((attributes & NodeHasName) == 0)
+                    continue;
+
+                int name = names + (int)(attributes & 0xFFFF) * 4;
+                int nameEnd = name < tables.Length ? Array.IndexOf(tables, (byte)0, name) : -1;
+                if (nameEnd < 0)
+                    throw new InvalidDataException($"{archivePath} has a file name outside of its name table");
+                if (Encoding.UTF8.GetString(tables, name, nameEnd - name) != entryName)
+                    continue;
+
+                uint begin = ReadUInt32(tables, i * 16 + 8, bigEndian);
+                uint end = ReadUInt32(tables, i * 16 + 12, bigEndian);
+                if (end < begin || dataOffset + (long)end > archive.Length)
+                    throw new InvalidDataException($"{entryName} lies outside of {archivePath}");
+                return ReadBytes(archive, dataOffset + begin, (int)(end - begin), archivePath);
+            }
+            return null;
+        }
+
+        static byte[] ReadBytes(Stream stream, long offset, int count, string archivePath)
+        {
+            if (offset + count > stream.Length)
+                throw new EndOfStreamException($"{archivePath} is cut short");
+
+            byte[] buffer = new byte[count];
+            stream.Position = offset;
+            for (int read = 0; read < count; )
+            {
+                int chunk = stream.Read(buffer, read, count - read);
+                if (chunk <= 0)
+                    throw new EndOfStreamException($"{archivePath} is cut short");
+                read += chunk;
+            }
+            return buffer;
+        }
+
+        static ushort ReadUInt16(byte[] data, int offset, bool bigEndian)
+        {
+            return bigEndian ? (ushort)((data[offset] << 8) | data[offset + 1]) : (ushort)((data[offset + 1] << 8) | data[offset]);
+        }
+
+        static uint ReadUInt32(byte[] data, int offset, bool bigEndian)
+        {
+            return bigEndian
+                ? ((uint)data[offset] << 24) | ((uint)data[offset + 1] << 16) | ((uint)data[offset + 2] << 8) | data[offset + 3]
+                : ((uint)data[offset + 3] << 24) | ((uint)data[offset + 2] << 16) | ((uint)data[offset + 1] << 8) | data[offset];
+        }
+    }
+}
@@ -14,6 +14,8 @@ namespace BFRES_Importer
         public static string FilePath;
         public static string FileName;
         public static string OutputDir;
+        public static bool WriteBinary = false;
+        public static bool WriteDDS = false;
 
         public enum ErrorType
         {
@@ -79,18 +81,29 @@ namespace BFRES_Importer
             {
                 FilePath = args[0];
                 OutputDir = args[1];
+
+                // -b writes the binary median instead of the xml one
+                // -dds leaves BCn textures to FBXExporter -dds, which writes them as they are
+                for (int i = 2; i < args.Length; i++)
+                {
+                    if (args[i] == "-b")
+                        WriteBinary = true;
+                    else if (args[i] == "-dds")
+                        WriteDDS = true;
+                }
             }
             FileName = Path.GetFileNameWithoutExtension(FilePath);
 
-            ResU.ResFile res;
+            // The file may sit inside a .pack, PackFile reads it from there without extracting
+            byte[] data = PackFile.ReadAllBytes(FilePath);
+
             // Decompress sbfres with Yaz0
             if (FilePath.EndsWith(".sbfres"))
-                res = new ResU.ResFile(new System.IO.MemoryStream(EveryFileExplorer.YAZ0.Decompress(FilePath)));
-            else
-                res = new ResU.ResFile(FilePath);
+                data = EveryFileExplorer.YAZ0.Decompress(data);
+            ResU.ResFile res = new ResU.ResFile(new System.IO.MemoryStream(data));
 
             // Check if it is a WiiU file or not
-            using( FileReader reader = new FileReader( FilePath, true ) )
+            using( FileReader reader = new FileReader( new System.IO.MemoryStream(data) ) )
             {
                 reader.ByteOrder = Syroot.BinaryData.ByteOrder.BigEndian;
                 reader.Position = 4;
@@ -103,7 +116,10 @@ namespace BFRES_Importer
             }
 
             // Begin main writing
-            WriteResToXML(res);
+            if (WriteBinary)
+                MedianBinaryWriter.Write(res, Program.OutputDir + FileName + ".mbin");
+            else
+                WriteResToXML(res);
         }
 
         public static void WriteResToXML(ResU.ResFile res)
@@ -135,23 +151,7 @@ namespace BFRES_Importer
                 writer.WriteStartElement("FTEXes");
                 for (int ii = 0; ii < res.Textures.Count; ii++)
                 {
-                    JPTexture jpTexture = new JPTexture();
-                    jpTexture.Read(res.Textures[ii]);
-                    if (jpTexture.isTex2)
-                    {
-                        // for (int i = 1; i < jpTexture.MipCount; i++)
-                        // {
-                        //     if (!Directory.Exists(OutputDir + "Mips/"))
-                        //         Directory.CreateDirectory(OutputDir + "Mips/");
-                        //     jpTexture.SaveBitMap(OutputDir + "Mips/" + jpTexture.Name + i + ".tga", false, false, 0, i);
-                        // }   
-                    }
-                    else
-                    {
-                        if (!Directory.Exists(OutputDir + "Textures/"))
-                            Directory.CreateDirectory(OutputDir + "Textures/");
-                        jpTexture.SaveBitMap(OutputDir + "Textures/" + jpTexture.Name + ".tga");
-                    }
+                    SaveTexture(res.Textures[ii]);
                     FTEX.WriteFTEXData(writer, res.Textures[ii]);
                 }
                 writer.WriteEndElement();
@@ -169,6 +169,34 @@ namespace BFRES_Importer
             writer.Close();
         }
 
+        /// <summary>
+        /// Decodes a texture and saves it next to the median dump as a tga. With -dds BCn textures are
+        /// skipped, FBXExporter -dds writes those without decoding them.
+        /// </summary>
+        /// <param name="texture"></param>
+        public static void SaveTexture(ResU.Texture texture)
+        {
+            JPTexture jpTexture = new JPTexture();
+            jpTexture.Read(texture);
+            if (WriteDDS && JPTexture.IsCompressed(jpTexture.Format))
+                return;
+            if (jpTexture.isTex2)
+            {
+                // for (int i = 1; i < jpTexture.MipCount; i++)
+                // {
+                //     if (!Directory.Exists(OutputDir + "Mips/"))
+                //         Directory.CreateDirectory(OutputDir + "Mips/");
+                //     jpTexture.SaveBitMap(OutputDir + "Mips/" + jpTexture.Name + i + ".tga", false, false, 0, i);
+                // }   
+            }
+            else
+            {
+                if (!Directory.Exists(OutputDir + "Textures/"))
+                    Directory.CreateDirectory(OutputDir + "Textures/");
+                jpTexture.SaveBitMap(OutputDir + "Textures/" + jpTexture.Name + ".tga");
+            }
+        }
+
         /// <summary>
         /// Returns string in a format of "X,Y" without parentheses.
         /// </summary>
@@ -0,0 +1,25 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// -----------------------------------------------------------------------
+// Process wide count of heap allocations. With TRACK_ALLOCATIONS set in
+// Globals.h the global operator new/delete are replaced by counting ones,
+// otherwise every counter stays at zero and nothing is replaced.
+// -----------------------------------------------------------------------
+class AllocationStats
+{
+public:
+    struct Counters
+    {
+        uint64_t uiAllocations;
+        uint64_t uiBytes;
+        uint64_t uiPeakBytes; // most bytes ever allocated and not yet deleted at once, since the process started
+    };
+
+    static bool     IsEnabled();
+    static Counters Get();
+
+    // Prints what was allocated since start and the peak so far, also per shape when uiShapeCount isn't zero
+    static void     Print(const char* szLabel, const Counters& start, size_t uiShapeCount);
+};
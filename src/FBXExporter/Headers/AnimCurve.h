@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include "BFRES.h"
+#include "Primitives.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// Wii U AnimCurve decoding, a whole curve at a time. Frames and keys are
+// converted out of their big endian arrays by the vertex attribute
+// kernels, a chunk of keys per pass, then dequantized (key * scale +
+// offset) and written as key frames straight into the track.
+//
+// Cubic keys hold the coefficients of the segment up to the next key,
+// value(t) = c0 + c1 t + c2 t^2 + c3 t^3 with t going from 0 to 1. They
+// become Hermite keys: the value c0, slope 1 the slope coming in from the
+// segment before and slope 2 the one going out, both per frame. Linear
+// keys hold the value and its change over the segment and get the same
+// slopes. The first key comes in with its outgoing slope, the last
+// segment ends at the curve's end frame.
+// -----------------------------------------------------------------------
+namespace AnimCurve
+{
+
+enum FrameType
+{
+    eFrameSingle  = 0x0,
+    eFrameFixed16 = 0x1, // 10.5 fixed point
+    eFrameByte    = 0x2
+};
+
+enum KeyType
+{
+    eKeySingle = 0x0,
+    eKeyInt16  = 0x1,
+    eKeySByte  = 0x2
+};
+
+enum CurveType
+{
+    eCurveCubic      = 0x00,
+    eCurveLinear     = 0x10,
+    eCurveBakedFloat = 0x20,
+    eCurveStepInt    = 0x40,
+    eCurveBakedInt   = 0x50,
+    eCurveStepBool   = 0x60,
+    eCurveBakedBool  = 0x70
+};
+
+// The header fields of a curve, its frame and key arrays already located
+struct Curve
+{
+    uint16      uiFlags;      // frame type in bits 0-1, key type in bits 2-3, curve type in bits 4-6
+    uint32      uiKeyCount;
+    float       fEndFrame;
+    float       fScale;
+    uint32      uiOffsetBits; // the offset, a float or for step curves an int
+    const char* pFrames;
+    const char* pKeys;
+};
+
+// Whether the curve can be decoded: cubic, linear and step int curves with known frame and key types
+bool IsSupported(const Curve& curve);
+
+// Bytes of the frame and key arrays of a supported curve
+size_t GetFramesSize(const Curve& curve);
+size_t GetKeysSize(const Curve& curve);
+
+// Appends the keys of the curve to keyFrames. Returns false, appending nothing, for curves that can't be decoded.
+bool Decode(const Curve& curve, std::pmr::vector<KeyFrame>& keyFrames);
+
+}
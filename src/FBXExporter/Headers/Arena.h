@@ -0,0 +1,73 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+// -----------------------------------------------------------------------
+// Monotonic memory for one parsed BFRES tree. Every string and vector of
+// the tree is cut out of big blocks and the blocks all go back in one go
+// with the tree. Deallocating frees nothing, except that the latest
+// allocation of a thread's block is taken back, which is what a growing
+// vector gives up when it moves to a bigger buffer.
+//
+// The parsers allocate from every thread of the pool at once. Each thread
+// cuts from a block of its own, only taking a new block locks. While a
+// Scope is alive the arena is the default memory resource, so the tree's
+// pmr containers pick it up without any allocator plumbing in the structs.
+// -----------------------------------------------------------------------
+class Arena : public std::pmr::memory_resource
+{
+public:
+    struct Stats
+    {
+        uint64_t uiAllocations;   // counted with TRACK_ALLOCATIONS only, see Globals.h
+        uint64_t uiBytes;         // counted with TRACK_ALLOCATIONS only
+        uint64_t uiReservedBytes; // held in blocks, which is also the peak as nothing is given back
+        uint64_t uiBlocks;
+    };
+
+    // Makes the arena the default memory resource of the whole process, for every thread, and puts the
+    // previous one back when it ends. Only one parse may run under a scope at a time.
+    class Scope
+    {
+    public:
+        explicit Scope(Arena& arena);
+        ~Scope();
+
+    private:
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        std::pmr::memory_resource* m_pPrevious;
+    };
+
+    Arena();
+    ~Arena();
+
+    // Gives every block back at once. Nothing allocated from the arena may be used afterwards and no
+    // thread may be allocating from it meanwhile.
+    void  Release();
+
+    Stats GetStats() const;
+    void  Print(const char* szLabel) const;
+
+private:
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* do_allocate(size_t uiBytes, size_t uiAlignment) override;
+    void  do_deallocate(void* pMemory, size_t uiBytes, size_t uiAlignment) override;
+    bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    char* AllocateBlock(size_t uiBytes);
+
+    std::vector<char*>    m_blocks;
+    mutable std::mutex    m_mutex;
+    uint64_t              m_uiGeneration;    // tells the blocks threads still hold of an earlier generation apart
+    uint64_t              m_uiReservedBytes;
+    std::atomic<uint64_t> m_uiAllocations;
+    std::atomic<uint64_t> m_uiBytes;
+};
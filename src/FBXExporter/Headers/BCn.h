@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "Primitives.h"
+#include "SIMD.h"
+
+// -----------------------------------------------------------------------
+// BC1-BC5 (DXT1-5, ATI1/2) block decoding to RGBA8, for deswizzled GX2
+// surfaces. Every block's palettes are built once, then its 16 texels are
+// looked up together: SSE2 selects palette entries across byte planes of a
+// whole block, AVX2 does two neighbouring blocks per pass with byte
+// shuffles. The surface's component selectors and, for BC5 normal maps,
+// the reconstructed Z are applied in the same pass, so the output is the
+// final image.
+//
+// Values are decoded the way the D3D spec describes: integer
+// interpolation, BC4/BC5 in R and G with B = 0 and A = 1. Signed BC4/BC5
+// values are biased by 128 to fit a byte.
+// -----------------------------------------------------------------------
+namespace BCn
+{
+
+// GX2CompSel, the source of each output channel
+enum CompSel
+{
+    eCompSelR = 0,
+    eCompSelG = 1,
+    eCompSelB = 2,
+    eCompSelA = 3,
+    eCompSel0 = 4,
+    eCompSel1 = 5
+};
+
+struct DecodeParams
+{
+    uint32  uiFormat;      // GX2SurfaceFormat, BC1 to BC5 in UNorm, SNorm or SRGB
+    uint8_t compSel[4];    // source of R, G, B and A
+    bool    bReconstructZ; // BC5: B becomes sqrt(1 - x^2 - y^2), the Z of a tangent space normal
+};
+
+bool IsSupported(uint32 uiFormat);
+
+// Decodes a uiWidth x uiHeight image from its blocks, stored row by row as GX2::Deswizzle leaves them, into
+// RGBA8 rows of uiWidth * 4 bytes. A path the CPU doesn't support falls back to SSE2. Returns false for
+// formats that aren't BCn, invalid component selectors or too little data.
+bool Decode(const char* pBlocks, size_t uiSize, uint32 uiWidth, uint32 uiHeight, const DecodeParams& params, uint8_t* pRGBA, SIMD::Path ePath);
+bool Decode(const char* pBlocks, size_t uiSize, uint32 uiWidth, uint32 uiHeight, const DecodeParams& params, uint8_t* pRGBA);
+
+// Plain texel by texel decoder following the spec, what the other paths are checked against
+bool DecodeReference(const char* pBlocks, size_t uiSize, uint32 uiWidth, uint32 uiHeight, const DecodeParams& params, uint8_t* pRGBA);
+
+}
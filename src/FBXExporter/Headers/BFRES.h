@@ -1,7 +1,10 @@
 #pragma once
+#include <memory_resource>
 #include <string>
 #include <vector>
+#include "Arena.h"
 #include "JPMath.h"
+#include "GX2.h"
 #include "Primitives.h"
 
 namespace BFRESStructs
@@ -140,12 +143,12 @@ struct TextureRef
 		MirrorOnceBorder
 	};
 
-    std::string         name;
+    pmr::string         name;
     GX2TexClamp         clampX;
     GX2TexClamp         clampY;
     GX2TexClamp         clampZ;
-    std::string         samplerName;
-    std::string         useSampler;
+    pmr::string         samplerName;
+    pmr::string         useSampler;
     GX2TexXYFilterType  minFilter;
     GX2TexXYFilterType  magFilter;
     GX2TexZFilterType   zFilter;
@@ -166,20 +169,20 @@ struct TextureRef
 // -----------------------------------------------------------------------
 struct TextureRefs
 {
-    uint32 textureCount;
-    vector<TextureRef> textures;
+    uint32                  textureCount;
+    pmr::vector<TextureRef> textures;
 };
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
 struct FMAT
 {
-    string               name;
-    bool                 isVisible;
-    vector<RenderInfo>   renderInfo;
-    ShaderAssign         shaderAssign;
-    vector<ShaderParams> shaderParams;
-    TextureRefs          textureRefs;
+    pmr::string               name;
+    bool                      isVisible;
+    pmr::vector<RenderInfo>   renderInfo;
+    ShaderAssign              shaderAssign;
+    pmr::vector<ShaderParams> shaderParams;
+    TextureRefs               textureRefs;
     // TODO
 };
 
@@ -206,22 +209,69 @@ struct SubMesh
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
-struct FVTX
+// Vertices of a shape, one array per attribute. An attribute is either
+// there for every vertex or missing: its array stays empty and its bit of
+// the presence mask clear.
+struct VertexStreams
 {
-    uint32         index;
-    Math::vector3F position0;
-    Math::vector3F position1;
-    Math::vector3F position2;
-    Math::vector3F normal;
-    Math::vector2F uv0;
-    Math::vector2F uv1;
-    Math::vector2F uv2;
-    Math::vector4F color0;
-    Math::vector4F color1;
-    Math::vector4F tangent;
-    Math::vector4F binormal;
-    Math::vector4F blendWeights;
-    Math::vector4  blendIndex;
+    enum Stream
+    {
+        ePosition0,
+        ePosition1,
+        ePosition2,
+        eNormal,
+        eUV0,
+        eUV1,
+        eUV2,
+        eColor0,
+        eColor1,
+        eTangent,
+        eBinormal,
+        eBlendWeights,
+        eBlendIndex,
+        eStreamCount
+    };
+
+    uint32                      count = 0;
+    uint32                      presence = 0; // a bit per Stream
+    pmr::vector<Math::vector3F> position0;
+    pmr::vector<Math::vector3F> position1;
+    pmr::vector<Math::vector3F> position2;
+    pmr::vector<Math::vector3F> normal;
+    pmr::vector<Math::vector2F> uv0;
+    pmr::vector<Math::vector2F> uv1;
+    pmr::vector<Math::vector2F> uv2;
+    pmr::vector<Math::vector4F> color0;
+    pmr::vector<Math::vector4F> color1;
+    pmr::vector<Math::vector4F> tangent;
+    pmr::vector<Math::vector4F> binormal;
+    pmr::vector<Math::vector4F> blendWeights;
+    pmr::vector<Math::vector4>  blendIndex;
+
+    bool Has(Stream eStream) const { return (presence & (1u << eStream)) != 0; }
+
+    // Marks the attribute present and sizes its array for every vertex, each one set to the attribute's
+    // default: white for colors, all weight on the first bone, zero otherwise
+    void Add(Stream eStream);
+
+    // Drops the streams where every vertex still holds the attribute's default. The median dumps carry
+    // every attribute whether the shape has it or not, this is the closest they get to the real presence.
+    // Positions always stay.
+    void DropDefaultStreams();
+};
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Triangle list, three vertex indices per face. Only one of the arrays is
+// filled: the 16 bit one when every index fits, the 32 bit one otherwise.
+struct FaceIndices
+{
+    pmr::vector<uint16> indices16;
+    pmr::vector<uint32> indices32;
+
+    size_t size() const { return indices16.size() + indices32.size(); }
+    uint32 operator[](size_t i) const { return indices32.empty() ? indices16[i] : indices32[i]; }
 };
 
 
@@ -323,7 +373,7 @@ struct LODMesh
     GX2IndexFormat   indexFormat;
     uint32           indexCount;
     uint32           firstVertex;
-    vector<int32>    faceVertices; // TODO should this be uint32?
+    FaceIndices      faceVertices; // first vertex added and expanded to triangles, whatever the primitive type
     SubMesh          subMesh;
 };
 
@@ -344,21 +394,21 @@ struct FSHP
 		/// </summary>
 		SubMeshBoundaryConsistent = 1 << 2
 	};
-    string                  name;
-    ShapeFlags              flags;
-    uint32                  modelIndex;
-    uint32                  materialIndex;
-    uint32                  boneIndex;
-    uint32                  vertexBufferIndex;
-    vector<float>           radiusArray;
-    uint32                  vertexSkinCount;
-    uint32                  targetAttributeCount;
-    vector<LODMesh>         lodMeshes;
-    vector<uint32>          skinBoneIndices;
+    pmr::string                  name;
+    ShapeFlags                   flags;
+    uint32                       modelIndex;
+    uint32                       materialIndex;
+    uint32                       boneIndex;
+    uint32                       vertexBufferIndex;
+    pmr::vector<float>           radiusArray;
+    uint32                       vertexSkinCount;
+    uint32                       targetAttributeCount;
+    pmr::vector<LODMesh>         lodMeshes;
+    pmr::vector<uint32>          skinBoneIndices;
     // TODO add KeyShapes
-    vector<SubMeshBounding> boundings;
+    pmr::vector<SubMeshBounding> boundings;
     // TODO add SubmeshBoundingNodes and SubmeshBoundingIndices
-    vector<FVTX>            vertices;
+    VertexStreams                vertices;
 
 };
 
@@ -450,7 +500,7 @@ struct Bone
 		Identity
 	};
     uint32                       index;
-    string                       name;
+    pmr::string                  name;
     bool                         isVisible;
     int32                        rigidMatrixIndex;
     int32                        smoothMatrixIndex;
@@ -473,9 +523,9 @@ struct Bone
 // -----------------------------------------------------------------------
 struct FSKL
 {
-    uint32         boneCount;
-    vector<uint32> boneList;
-    vector<Bone>   bones;
+    uint32              boneCount;
+    pmr::vector<uint32> boneList;
+    pmr::vector<Bone>   bones;
     // TODO check that there is not more data to grab from the FSKL class in Nintentools
 };
 
@@ -484,15 +534,15 @@ struct FSKL
 // -----------------------------------------------------------------------
 struct FMDL
 {
-    string       name;
-    uint32       index;
-    int          fvtxCount;
-    int          fshpCount;
-    int          fmatCount;
-    int          totalVertices;
-    FSKL         fskl;
-    vector<FMAT> fmats;
-    vector<FSHP> fshps;
+    pmr::string       name;
+    uint32            index;
+    int               fvtxCount;
+    int               fshpCount;
+    int               fmatCount;
+    int               totalVertices;
+    FSKL              fskl;
+    pmr::vector<FMAT> fmats;
+    pmr::vector<FSHP> fshps;
 };
 
 
@@ -521,7 +571,7 @@ struct AnimTrack
         STEP     = 3,
         STEPBOOL = 4
     };
-    string                 m_szName;
+    pmr::string            m_szName;
     CurveInterpolationType m_eInterpolationType;
     bool                   m_bConstant;
     uint32                 m_cFrames;
@@ -529,7 +579,7 @@ struct AnimTrack
     uint32                 m_uiEndFrame;
     float                  m_fDelta;
     uint32                 m_cKeys;
-    vector<KeyFrame>       m_vKeyFrames;
+    pmr::vector<KeyFrame>  m_vKeyFrames;
 };
 
 
@@ -543,7 +593,7 @@ struct BoneAnim
 		QUATERNION
 	};
 
-    string           m_szName;
+    pmr::string      m_szName;
     int32            m_iHash;
     AnimRotationType m_eRotType;
     bool             m_bUseSegmentScaleCompensate;
@@ -595,9 +645,9 @@ struct UserData
 		Byte
 	};
 
-    string        m_szName;
-    UserDataType  m_eType;
-    vector<float> m_vfValues;
+    pmr::string        m_szName;
+    UserDataType       m_eType;
+    pmr::vector<float> m_vfValues;
 };
 
 // -----------------------------------------------------------------------
@@ -629,7 +679,7 @@ struct Anim
 		/// </summary>
 		Softimage = 3 << 8
 	};
-    std::string            m_szName;
+    pmr::string            m_szName;
     bool                   m_bIsBaked;
     bool                   m_bIsLooping;
     SkeletalAnimFlagsScale m_eScalingType;
@@ -638,8 +688,8 @@ struct Anim
     // BakedSize not stored
     uint32                 m_cUserData;
     // BindIndices not stored
-    vector<BoneAnim>       m_vBoneAnims;
-    vector<UserData>       m_vUserData;
+    pmr::vector<BoneAnim>  m_vBoneAnims;
+    pmr::vector<UserData>  m_vUserData;
 };
 
 
@@ -647,16 +697,36 @@ struct Anim
 // -----------------------------------------------------------------------
 struct FSKA
 {
-    vector<Anim> anims;
+    pmr::vector<Anim> anims;
+};
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// A texture with its GX2 surface deswizzled, every level and slice the file has data for
+struct FTEX
+{
+    std::string        name;
+    uint32             format;     // GX2SurfaceFormat
+    uint32             dim;        // GX2::SurfaceDim
+    uint32             width;
+    uint32             height;
+    uint32             depth;
+    uint32             mipCount;
+    uint8_t            compSel[4]; // source channel of R, G, B and A
+    vector<GX2::Image> images;
 };
 
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
+// The parsers fill the tree under an Arena::Scope, so its strings and arrays all live in the arena and
+// go back with it in one go. The arena comes first to outlive them.
 struct BFRES
 {
-	vector<FMDL> fmdl;
-    FSKA         fska;
+    Arena             arena;
+    pmr::vector<FMDL> fmdl;
+    FSKA              fska;
 };
 
 class BFRESManager
@@ -691,7 +761,7 @@ public:
         return &m_pBFRES->fmdl[modelIndex].fmats[materialIndex];
     }
 
-    TextureRef* GetTextureFromMaterialByType(FMAT* fmat, GX2TextureMapType type)
+    const TextureRef* GetTextureFromMaterialByType(const FMAT* fmat, GX2TextureMapType type)
     {
         for (uint32 i = 0; i < fmat->textureRefs.textureCount; i++)
         {
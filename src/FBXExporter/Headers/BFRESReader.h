@@ -0,0 +1,152 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <functional>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include "BFRES.h"
+#include "Primitives.h"
+#include "MappedFile.h"
+#include "SARC.h"
+#include "ParseProfile.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// Wii U BFRES (FRES version 3/4), read straight from the binary instead of
+// going through the importer's dump. Everything is big endian. Sections
+// reference each other through offsets that are relative to the offset field
+// itself, zero meaning null; strings are referenced by their first character.
+// -----------------------------------------------------------------------
+namespace WiiU
+{
+
+static const uint32 s_uiFRESMagic = 0x46524553; // "FRES"
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Bounds checked big endian view of a mapped file. Every read checks its range; a read outside the file
+// returns zero and marks the view as failed, so a corrupt file can't read past the mapping.
+class ResView
+{
+public:
+    ResView(const char* pData, size_t uiSize) : m_pData(reinterpret_cast<const uint8_t*>(pData)), m_uiSize(uiSize), m_bFailed(false) {}
+
+    bool     IsInRange(uint32 uiOffset, size_t uiSize) const { return uiOffset <= m_uiSize && uiSize <= m_uiSize - uiOffset; }
+    bool     HasFailed() const { return m_bFailed; }
+
+    // Raw bytes at uiOffset, for data read in bulk; check the range with IsInRange first
+    const char* GetData(uint32 uiOffset) const { return reinterpret_cast<const char*>(m_pData) + uiOffset; }
+
+    uint8_t  ReadU8(uint32 uiOffset) const;
+    uint16   ReadU16(uint32 uiOffset) const;
+    int16    ReadS16(uint32 uiOffset) const { return static_cast<int16>(ReadU16(uiOffset)); }
+    uint32   ReadU32(uint32 uiOffset) const;
+    int32    ReadS32(uint32 uiOffset) const { return static_cast<int32>(ReadU32(uiOffset)); }
+    float    ReadF32(uint32 uiOffset) const;
+
+    // Resolves the relative offset stored at uiOffset to a file offset, 0 for null
+    uint32   ReadOffset(uint32 uiOffset) const;
+
+    // Reads the string referenced by the offset stored at uiOffset, empty for null. It points into the
+    // file and is copied by whatever keeps it.
+    std::string_view ReadString(uint32 uiOffset) const;
+    std::string_view ReadStringAt(uint32 uiChars) const;
+
+    Math::vector3F ReadVector3F(uint32 uiOffset) const { return { ReadF32(uiOffset), ReadF32(uiOffset + 4), ReadF32(uiOffset + 8) }; }
+    Math::vector4F ReadVector4F(uint32 uiOffset) const { return Math::vector4F(ReadF32(uiOffset), ReadF32(uiOffset + 4), ReadF32(uiOffset + 8), ReadF32(uiOffset + 12)); }
+
+    // Marks the view as failed, for structural errors the reads themselves can't see
+    void     Fail() const;
+
+private:
+    const uint8_t*            m_pData;
+    size_t                    m_uiSize;
+    mutable std::atomic<bool> m_bFailed; // set from the parse threads
+};
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// A ResDict (patricia tree of named entries), read in entry order. The data offset of every entry is
+// already resolved; for dicts of strings it points at the characters.
+struct DictEntry
+{
+    std::string name;
+    uint32      uiData;
+};
+std::vector<DictEntry> ReadDict(const ResView& view, uint32 uiDict);
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// BotW splits its textures in two files: .Tex1 with level 0 of every texture and .Tex2 with the mips
+enum class TexturePart
+{
+    Whole,
+    Tex1,
+    Tex2
+};
+TexturePart GetTexturePart(const char* filePath);
+
+// An FTEX's surface, its data pointing into the view it was read from
+struct TextureSurface
+{
+    std::string  name;
+    GX2::Surface surface;
+    uint8_t      compSel[4];
+};
+std::vector<TextureSurface> ReadTextureSurfaces(const ResView& view, TexturePart ePart = TexturePart::Whole);
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Fills BFRESStructs from a .bfres or Yaz0 compressed .sbfres file, with the same results as running the importer and parsing its dump:
+// vertex buffers are decoded to floats, rigid and unskinned shapes are moved into model space and anim curves
+// become key frames. Textures are read on their own through ReadTextures, the importer still exports them.
+class BFRESReader
+{
+public:
+    typedef std::function<void(FMDL&)> ModelCallback;
+    typedef std::function<void(Anim&)> AnimCallback;
+
+    static bool IsBFRES(const char* filePath);
+
+    static void Parse(const char* filePath, BFRES& bfres, ParseProfile eProfile = ParseProfile::Full);
+    static void ParseStreaming(const char* filePath, const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile = ParseProfile::Full);
+
+    // Deswizzles every texture of the file, all levels and slices in parallel. Only the levels the file holds
+    // are read: level 0 from a BotW .Tex1, the mips from its .Tex2. Returns false if the file can't be read or
+    // a surface failed to deswizzle.
+    static bool ReadTextures(const char* filePath, std::vector<FTEX>& textures);
+
+    // ReadTextures with every level in one place: a BotW .Tex1 gets the mips from the .Tex2 next to it,
+    // when there is one
+    static bool ReadTexturesWithMips(const char* filePath, std::vector<FTEX>& textures);
+
+    // The file being read, mapped or inside a mapped archive, and decompressed into memory when it is a
+    // Yaz0 compressed .sbfres
+    struct FileData
+    {
+        MappedFile              mappedFile;
+        SARC::Archive           archive;
+        std::unique_ptr<char[]> pDecompressed;
+        const char*             pData;
+        size_t                  uiSize;
+    };
+
+    static bool OpenFile(const char* filePath, FileData& file);
+
+private:
+    static void ParseFMDL(const ResView& view, uint32 uiModel, FMDL& fmdl, ParseProfile eProfile);
+    static void ParseFSKL(const ResView& view, uint32 uiSkeleton, FSKL& fskl);
+    static void ParseFMAT(const ResView& view, uint32 uiMaterial, FMAT& fmat);
+    static void ParseFSHP(const ResView& view, uint32 uiShape, uint32 uiVertexBuffers, const FSKL& fskl, const std::vector<Math::matrix4F>& boneTransforms, FSHP& fshp, ParseProfile eProfile);
+    static void ParseVertices(const ResView& view, uint32 uiVertexBuffer, FSHP& fshp, ParseProfile eProfile);
+    static void ParseAnim(const ResView& view, uint32 uiAnim, Anim& anim);
+    static void ParseBoneAnim(const ResView& view, uint32 uiBoneAnim, bool bEulerRotation, BoneAnim& boneAnim);
+    static void ParseAnimCurve(const ResView& view, uint32 uiCurve, AnimTrack* tracks[]);
+};
+
+}
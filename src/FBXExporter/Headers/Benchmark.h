@@ -0,0 +1,15 @@
+#pragma once
+
+// -----------------------------------------------------------------------
+// Throughput benchmarks over real game files, run instead of an export:
+//   FBXExporter.exe -bench <name> <file or directory>...
+// Directories are searched recursively. Every benchmark prints its throughput and
+// checks its results against the plain implementation it replaces.
+// -----------------------------------------------------------------------
+namespace Benchmark
+{
+
+// argv starts at the benchmark name, returns the process exit code
+int Run(int argc, char** argv);
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "BFRES.h"
+#include "Primitives.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// DDS output of deswizzled textures, the data written as the GPU reads it:
+// BCn levels stay blocks, nothing is decoded or re-encoded. BC1-BC3 UNorm
+// and BC4/BC5 UNorm get the legacy DXT1/DXT3/DXT5/ATI1/ATI2 headers most
+// tools read. sRGB, SNorm and the plain 8 bit formats get a DX10 header
+// with their DXGI format.
+// -----------------------------------------------------------------------
+namespace DDS
+{
+
+// Whether a GX2SurfaceFormat has a DDS equivalent
+bool IsSupported(uint32 uiFormat);
+
+// Writes every slice with its levels, from level 0 up to the first level the texture lacks. 2D textures,
+// 2D arrays and cube maps are written. Returns false for other formats and dimensions, a missing level 0 or
+// a file that can't be written.
+bool Write(const char* filePath, const FTEX& texture);
+
+}
@@ -1,8 +1,12 @@
 #pragma once
 #include <fbxsdk.h>
 #include "BFRES.h"
+#include "SkinBuilder.h"
 #include <map>
+#include <set>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 using namespace BFRESStructs;
 
@@ -13,16 +17,11 @@ public:
     ~FBXWriter();
 
     static bool g_bWriteTextures;
+    static bool g_bDDSTextures; // materials point at the .dds files -dds writes instead of the importer's .tga
+    static std::set<std::string> g_RejectedDDSTextures; // the ones -dds couldn't write keep the .tga
 	static std::map<std::string, FbxSurfacePhong*> g_MaterialMap;
 	static std::map<std::string, FbxFileTexture*> g_TextureMap;
 
-    struct SkinCluster 
-    {
-        std::string         m_szName;
-        std::vector<uint32> m_vControlPointIndices;
-        std::vector<float>  m_vControlPointWeights;
-    };
-
 	enum class SkinningType
 	{
 		eSmooth,
@@ -36,6 +35,17 @@ public:
 		SkinningType eSkinningType;
 	};
 
+    // The nodes WriteSkeleton made for a skeleton's bones by bone index, and the bone indices by name. The
+    // names are the nodes' own, they live as long as the scene. The bind pose globals and the parents are
+    // by bone index too, worked out once for every cluster and pose entry.
+    struct SkeletonNodes
+    {
+        std::vector<FbxNode*>                        boneNodes;
+        std::unordered_map<std::string_view, uint32> boneIndices;
+        std::vector<FbxAMatrix>                      boneGlobals;
+        std::vector<int32>                           boneParents; // -1 for roots
+    };
+
     enum class AnimTrackType
     {
         eTranslation,
@@ -48,24 +58,36 @@ public:
 
     // Animation shit
     void WriteAnimations( FbxScene*& pScene, const Anim& anim );
+    FbxNode* FindBoneNode( const BoneAnim& boneAnim );
     void CreateTranslationAnimCurveNode( FbxAnimLayer*& pAnimLayer, FbxNode*& pBone, const BoneAnim& boneAnim );
     void CreateScaleAnimCurveNode( FbxAnimLayer*& pAnimLayer, FbxNode*& pBone, const BoneAnim& boneAnim );
     void CreateRotationAnimCurveNode( FbxAnimLayer*& pAnimLayer, FbxNode*& pBone, const BoneAnim& boneAnim );
     void AddKeyFramesToAnimCurve( FbxAnimCurve*& pAnimCurve, const AnimTrack& animTrack, AnimTrackType animTrackType );
 
     // Model shit
-    void WriteModel( FbxScene*& pScene, const FMDL& fmdl, uint32 fmdlIndex, bool onlySkeleton );
-    void WriteSkeleton(FbxScene*& pScene, const FSKL& fskl, std::vector<BoneMetadata>& boneListInfos);
-    void WriteShape(FbxScene*& pScene, const FMDL& mdl,  const FSHP& fshp, std::vector<BoneMetadata>& boneListInfos, uint32 fmdlIndex);
-    void WriteMesh(FbxSurfacePhong* lMaterial, FbxScene*& pScene, FbxNode*& pLodGroup, const FSHP& fshp, const LODMesh& lodMesh, std::vector<BoneMetadata>& boneListInfos, uint32 fmdlIndex);
-    void SetTexturesToMaterial(FbxScene*& pScene, FMAT* fmat, FbxSurfacePhong* lMaterial);
+    void WriteModel( FbxScene*& pScene, const FMDL& fmdl, bool onlySkeleton );
+    SkeletonNodes WriteSkeleton(FbxScene*& pScene, const FSKL& fskl, std::vector<BoneMetadata>& boneListInfos);
+    void WriteShape(FbxScene*& pScene, const FMDL& mdl,  const FSHP& fshp, std::vector<BoneMetadata>& boneListInfos, const SkeletonNodes& skeleton);
+    void WriteMesh(FbxSurfacePhong* lMaterial, FbxScene*& pScene, FbxNode*& pLodGroup, const FSHP& fshp, const LODMesh& lodMesh, std::vector<BoneMetadata>& boneListInfos, const SkeletonNodes& skeleton);
+    void SetTexturesToMaterial(FbxScene*& pScene, const FMAT* fmat, FbxSurfacePhong* lMaterial);
 
-    void MapFacesToVertices( const LODMesh& lodMesh, FbxMesh* lMesh );
+    void MapFacesToVertices( const FaceIndices& faces, FbxMesh* lMesh );
     void MapPolygonsToVertices(const LODMesh& lodMesh, FbxMesh* lMesh);
 
-    void WriteSkin(FbxScene*& pScene, FbxMesh*& pMesh, std::map<uint32, SkinCluster>& BoneIndexToSkinClusterMap, uint32 fmdlIndex);
-    void WriteBindPose(FbxScene*& pScene, FbxNode*& pMeshNode);
+    void WriteSkin(FbxScene*& pScene, FbxMesh*& pMesh, const SkinBuilder::Skin& skin, const SkeletonNodes& skeleton);
+    void WriteBindPose(FbxScene*& pScene, const char* szName, const SkeletonNodes& skeleton);
 
-    void CreateSkinClusterData(const FVTX& vert, uint32 uiVertIndex, std::map<uint32, SkinCluster>& BoneIndexToSkinClusterMap, std::vector<BoneMetadata>& boneListInfos, const FSHP& fshp);
     void CreateBone(FbxScene*& pScene, const Bone& bone, FbxNode*& lBoneNode, std::vector<BoneMetadata>& boneListInfos);
+
+private:
+    // Every skeleton written to the scene, the animations bind to their bones
+    std::vector<SkeletonNodes>                     m_skeletons;
+
+    // The nodes bone anims were bound to by name, shared by all the anims of a file. The names are the nodes'.
+    std::unordered_map<std::string_view, FbxNode*> m_boneAnimBindings;
+
+    // What the model being written binds, by bone index, and its skinned mesh nodes. WriteBindPose puts them
+    // in the model's one bind pose.
+    std::vector<bool>                              m_boundBones;
+    std::vector<FbxNode*>                          m_boundMeshNodes;
 };
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "Primitives.h"
+
+// -----------------------------------------------------------------------
+// GX2 surfaces, the Wii U's texture memory layout. Texels are stored in
+// 8x8 micro tiles, and the macro tiled modes group those into macro tiles
+// spread over the GPU's 2 pipes and 4 banks, so neighbouring texels land in
+// different memory channels. This is a port of the parts of AMD's address
+// library (addrlib, R600 family) GX2 relies on: the padded size of every mip
+// level and the address of every element, for all tile modes from linear to
+// 3D macro tiled.
+//
+// Block compressed formats (BC1-BC5) are addressed per 4x4 block, so a
+// deswizzled BCn level is its blocks row by row, ready for a DDS or a block
+// decoder.
+// -----------------------------------------------------------------------
+namespace GX2
+{
+
+enum TileMode
+{
+    eLinearGeneral = 0,
+    eLinearAligned = 1,
+    e1DTiledThin1  = 2,
+    e1DTiledThick  = 3,
+    e2DTiledThin1  = 4,
+    e2DTiledThin2  = 5,
+    e2DTiledThin4  = 6,
+    e2DTiledThick  = 7,
+    e2BTiledThin1  = 8,
+    e2BTiledThin2  = 9,
+    e2BTiledThin4  = 10,
+    e2BTiledThick  = 11,
+    e3DTiledThin1  = 12,
+    e3DTiledThick  = 13,
+    e3BTiledThin1  = 14,
+    e3BTiledThick  = 15,
+    eLinearSpecial = 16
+};
+
+enum SurfaceDim
+{
+    eDim1D          = 0,
+    eDim2D          = 1,
+    eDim3D          = 2,
+    eDimCube        = 3,
+    eDim1DArray     = 4,
+    eDim2DArray     = 5,
+    eDim2DMSAA      = 6,
+    eDim2DMSAAArray = 7
+};
+
+// Number of mip offsets a GX2Surface stores, levels 1 to 13
+static const uint32 s_uiMaxMipOffsets = 13;
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// GX2Surface as stored in an FTEX, with its data pointers resolved. Level 0 of every slice is in the image
+// data; levels 1 and up are in the mip data, level 1 at its start and level n at mipOffsets[n - 1].
+struct Surface
+{
+    uint32      dim;
+    uint32      width;
+    uint32      height;
+    uint32      depth;
+    uint32      numMips;
+    uint32      format;
+    uint32      aa;
+    uint32      use;
+    uint32      tileMode;
+    uint32      swizzle;
+    uint32      pitch;
+    uint32      mipOffsets[s_uiMaxMipOffsets];
+    const char* pImage;
+    size_t      uiImageSize;
+    const char* pMips;        // null when the mips live in another file, like BotW's .Tex2
+    size_t      uiMipSize;
+};
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Layout of one mip level as addrlib computes it. Sizes are in elements: texels, or 4x4 blocks for BCn.
+struct LevelInfo
+{
+    uint32 tileMode;         // small levels of macro tiled surfaces fall back to micro tiling
+    uint32 bpp;              // bits per element
+    uint32 width;            // elements in use
+    uint32 height;
+    uint32 slices;
+    uint32 pitch;            // padded dimensions the addresses are computed from
+    uint32 paddedHeight;
+    uint32 paddedSlices;
+    size_t uiSize;           // bytes, all slices
+};
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// One deswizzled slice of one mip level, its elements row by row
+struct Image
+{
+    uint32            uiLevel;
+    uint32            uiSlice;
+    uint32            uiWidth;
+    uint32            uiHeight;
+    uint32            uiBytesPerElement;
+    std::vector<char> data;
+};
+
+// Bits per element of a GX2SurfaceFormat, 0 for the formats that aren't supported (packed and 96 bit ones)
+uint32 GetBitsPerElement(uint32 uiFormat);
+bool   IsBlockCompressed(uint32 uiFormat);
+
+bool   ComputeLevelInfo(const Surface& surface, uint32 uiLevel, LevelInfo& info);
+
+// Swizzled data of a level, all its slices; null when the level isn't in this file
+const char* GetLevelData(const Surface& surface, uint32 uiLevel, size_t& uiSize);
+
+// Deswizzles one slice of one level into pDst, info.width * info.height elements. Addresses come from per
+// tile tables built once for the slice; false when the level's data is missing or too small.
+bool Deswizzle(const Surface& surface, uint32 uiLevel, uint32 uiSlice, char* pDst);
+
+// Same result, asking addrlib for the address of every element. Slow, it's what Deswizzle is checked against.
+bool DeswizzleReference(const Surface& surface, uint32 uiLevel, uint32 uiSlice, char* pDst);
+
+// Deswizzles every level the surfaces have data for, all slices of each. Every level and slice is a job of its
+// own on the thread pool. images[i] gets surface i's images, level by level and slice by slice within a level;
+// returns false if any of them failed.
+bool DeswizzleSurfaces(const std::vector<const Surface*>& surfaces, std::vector<std::vector<Image>>& images);
+
+}
@@ -5,6 +5,7 @@
 #define OUTPUT_FILE_DIR "../../FBXExports/"
 #define PRINT_DEBUG_INFO false
 #define FLIP_UV_VERTICAL true
+#define TRACK_ALLOCATIONS false // counts global operator new calls for the parse report, see AllocationStats.h
 
 static std::string medianFilePath;
 static std::string fbxExportPath;
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include "BFRES.h"
+#include "Primitives.h"
+#include "SIMD.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// GX2 index buffer decoding into triangle lists. Indices are byte swapped
+// (big endian formats, the Wii U is big endian) and get the mesh's first
+// vertex added 8 or 16 at a time. Triangle lists are stored straight
+// away, strips, fans, quads and quad strips are expanded to triangles out
+// of the same pass. The result is 16 bit whenever every vertex fits.
+//
+// Strip triangles alternate their winding like the GPU draws them and
+// degenerate ones, the joints between stitched strips, are dropped.
+// -----------------------------------------------------------------------
+namespace IndexBuffer
+{
+
+// Bytes of one index, 0 for unknown formats
+uint32 GetIndexSize(LODMesh::GX2IndexFormat eFormat);
+
+// Whether primitives of the type are made of triangles: lists, strips, fans, quads and quad strips
+bool IsSupported(LODMesh::GX2PrimitiveType ePrimitiveType);
+
+// Decodes uiCount indices of eFormat at pSrc, drawn as ePrimitiveType, into the triangle list faces. Returns
+// false, leaving faces empty, for unknown formats and primitives that aren't triangles.
+bool Decode(const char* pSrc, size_t uiCount, LODMesh::GX2IndexFormat eFormat, LODMesh::GX2PrimitiveType ePrimitiveType,
+            uint32 uiFirstVertex, FaceIndices& faces, SIMD::Path ePath);
+bool Decode(const char* pSrc, size_t uiCount, LODMesh::GX2IndexFormat eFormat, LODMesh::GX2PrimitiveType ePrimitiveType,
+            uint32 uiFirstVertex, FaceIndices& faces);
+
+// Index by index decoder, what the other paths are checked against
+bool DecodeReference(const char* pSrc, size_t uiCount, LODMesh::GX2IndexFormat eFormat, LODMesh::GX2PrimitiveType ePrimitiveType,
+                     uint32 uiFirstVertex, FaceIndices& faces);
+
+// Triangle list indices that are already decoded, like the ones of the median dumps, in the narrowest type
+void Assign(const int32* pIndices, size_t uiCount, FaceIndices& faces);
+
+}
@@ -37,6 +37,18 @@ namespace Math
 		float X, Y, Z, W;
 	};
 
+	// Row vector convention, points transform as v * M and the translation sits in the last row
+	struct matrix4F
+	{
+		float M[4][4];
+	};
+
+	// Same convention in double, as the FBX SDK keeps its matrices
+	struct matrix4D
+	{
+		double M[4][4];
+	};
+
 	static double pi() { return atan(1) * 4; }
 
 	static double ConvertRadiansToDegrees(float rad)
@@ -0,0 +1,35 @@
+#pragma once
+#include <stddef.h>
+#include "Primitives.h"
+#include "SIMD.h"
+
+// -----------------------------------------------------------------------
+// Filling of FBX layer arrays out of vertex attribute streams, without
+// the SDK. An FBX vector or color is a run of 2 to 4 doubles, the streams
+// hold floats, so every attribute of a mesh is widened in one pass
+// straight into the locked array: an element at a time, picked through
+// the mesh's vertex list, with components the stream doesn't have set
+// to 1 like FbxVector4(x, y, z) does.
+//
+// UVs can be flipped vertically, v becoming 1 - v. The flip is done in
+// float before widening, which is what the writer always did.
+// -----------------------------------------------------------------------
+namespace LayerArray
+{
+
+// Whether uiSrcComponents floats can widen to uiDstComponents doubles: 2 to 4 of each, never fewer doubles
+bool IsSupported(uint32 uiSrcComponents, uint32 uiDstComponents);
+
+// Widens uiCount elements of pSrc into pDst, uiDstComponents doubles each. Element i is element pElements[i] of
+// the stream, or element i without pElements. bFlipV replaces the second component v by 1 - v. Returns false
+// for component counts that aren't supported.
+bool Widen(const float* pSrc, uint32 uiSrcComponents, const uint32* pElements, size_t uiCount, uint32 uiDstComponents,
+           bool bFlipV, double* pDst, SIMD::Path ePath);
+bool Widen(const float* pSrc, uint32 uiSrcComponents, const uint32* pElements, size_t uiCount, uint32 uiDstComponents,
+           bool bFlipV, double* pDst);
+
+// Component by component widening, what the other paths are checked against
+bool WidenReference(const float* pSrc, uint32 uiSrcComponents, const uint32* pElements, size_t uiCount, uint32 uiDstComponents,
+                    bool bFlipV, double* pDst);
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stddef.h>
+
+// -----------------------------------------------------------------------
+// Maps a whole file into memory. With bCopyOnWrite the view is a private
+// copy-on-write mapping, so in-situ parsers (RapidXML) may write into it
+// without touching the file on disk; only the pages they dirty get copied.
+// -----------------------------------------------------------------------
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const char* filePath, bool bCopyOnWrite);
+    void Close();
+
+    const char* GetData() const { return m_pData; }
+    char*       GetWritableData() { return m_bCopyOnWrite ? m_pData : nullptr; }
+    size_t      GetSize() const { return m_uiSize; }
+    bool        IsOpen() const { return m_pData != nullptr; }
+
+    // True when at least one zero byte is readable right after the data. The OS zero fills
+    // the rest of the last page, so this only fails when the size is a multiple of the page size.
+    bool        HasZeroTerminator() const;
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    char*  m_pData;
+    size_t m_uiSize;
+    bool   m_bCopyOnWrite;
+#ifdef _WIN32
+    void*  m_hFile;
+    void*  m_hMapping;
+#else
+    int    m_iFile;
+#endif
+};
@@ -0,0 +1,357 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <functional>
+#include <stdio.h>
+#include <unordered_map>
+#include "BFRES.h"
+#include "Primitives.h"
+#include "MappedFile.h"
+#include "ParseProfile.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// Binary median dump (.mbin), written by MedianBinaryWriter.cs in the
+// importer. Everything is little endian and 4 byte aligned; arrays start on
+// 16 bytes. Records reference arrays through absolute file offsets and
+// strings through offsets into the string table, so the whole file is read
+// in place from a read-only mapping.
+// -----------------------------------------------------------------------
+namespace MedianBinary
+{
+
+static const uint32 s_uiMagic   = 0x4E49424D; // "MBIN"
+static const uint32 s_uiVersion = 1;
+
+struct ArrayRef
+{
+    uint32 offset;
+    uint32 count;
+};
+
+struct StringRef
+{
+    uint32 offset; // into the string table, which also zero terminates every string
+    uint32 length;
+};
+
+struct Header
+{
+    uint32   magic;
+    uint32   version;
+    uint32   fileSize;
+    ArrayRef models;      // ModelRecord
+    ArrayRef anims;       // AnimRecord
+    ArrayRef stringTable; // count is the size in bytes
+    uint32   sourceHash[2]; // low, high word of the hash of the dump this file was built from, zero from the importer
+    uint32   parseProfile;  // ParseProfile the contents were parsed with, Full from the importer
+};
+
+struct BoneRecord
+{
+    StringRef      name;
+    uint32         index;
+    int32          rigidMatrixIndex;
+    int32          smoothMatrixIndex;
+    int32          billboardIndex;
+    int32          parentIndex;
+    uint32         rotationType;
+    uint8_t        isVisible;
+    uint8_t        useRigidMatrix;
+    uint8_t        useSmoothMatrix;
+    uint8_t        padding;
+    Math::vector3F scale;
+    Math::vector4F rotation;
+    Math::vector3F position;
+};
+
+struct TextureRecord
+{
+    StringRef name;
+    StringRef samplerName;
+    StringRef useSampler;
+    uint32    clampX;
+    uint32    clampY;
+    uint32    clampZ;
+    uint32    minFilter;
+    uint32    magFilter;
+    uint32    zFilter;
+    uint32    mipFilter;
+    uint32    maxAnisotropicRatio;
+    uint32    borderType;
+    uint32    depthCompareFunc;
+    uint32    type;
+    float     minLod;
+    float     maxLod;
+    float     lodBias;
+    uint32    depthCompareEnabled;
+    uint32    textureUnit;
+};
+
+struct MaterialRecord
+{
+    StringRef name;
+    uint32    isVisible;
+    ArrayRef  textures; // TextureRecord
+};
+
+struct LODMeshRecord
+{
+    uint32   primitiveType;
+    uint32   indexFormat;
+    uint32   indexCount;
+    uint32   firstVertex;
+    ArrayRef faceVertices; // int32
+    int32    subMeshCount;
+    int32    subMeshOffset;
+};
+
+// Vertex attribute streams of a shape, each one either empty or vertexCount elements long
+enum VertexStream
+{
+    eStreamPosition0,    // vector3F
+    eStreamPosition1,    // vector3F
+    eStreamPosition2,    // vector3F
+    eStreamNormal,       // vector3F
+    eStreamUV0,          // vector2F
+    eStreamUV1,          // vector2F
+    eStreamUV2,          // vector2F
+    eStreamColor0,       // vector4F
+    eStreamColor1,       // vector4F
+    eStreamTangent,      // vector4F
+    eStreamBinormal,     // vector4F
+    eStreamBlendWeights, // vector4F
+    eStreamBlendIndex,   // vector4
+    eStreamCount
+};
+
+struct ShapeRecord
+{
+    StringRef name;
+    uint32    materialIndex;
+    uint32    boneIndex;
+    uint32    vertexBufferIndex;
+    uint32    vertexSkinCount;
+    uint32    targetAttributeCount;
+    uint32    vertexCount;
+    ArrayRef  radiusArray;     // float
+    ArrayRef  skinBoneIndices; // uint32
+    ArrayRef  lodMeshes;       // LODMeshRecord
+    ArrayRef  streams[eStreamCount];
+};
+
+struct ModelRecord
+{
+    StringRef name;
+    uint32    boneCount;
+    uint32    totalVertices;
+    ArrayRef  boneList;  // uint32
+    ArrayRef  bones;     // BoneRecord
+    ArrayRef  materials; // MaterialRecord
+    ArrayRef  shapes;    // ShapeRecord
+};
+
+struct KeyFrameRecord
+{
+    float   frame;
+    float   value;
+    float   slope1;
+    float   slope2;
+    uint8_t isDegrees;
+    uint8_t isWeighted;
+    uint16  padding;
+};
+
+struct TrackRecord
+{
+    StringRef name;
+    uint32    interpolationType;
+    uint32    constant;
+    float     frameCount;
+    float     startFrame;
+    float     endFrame;
+    float     delta;
+    ArrayRef  keys; // KeyFrameRecord
+};
+
+// Tracks in the order XSCA, YSCA, ZSCA, XROT, YROT, ZROT, WROT, XPOS, YPOS, ZPOS
+static const uint32 s_uiTrackCount = 10;
+
+struct BoneAnimRecord
+{
+    StringRef   name;
+    int32       hash;
+    uint32      rotType;
+    uint32      useSegmentScaleCompensate;
+    TrackRecord tracks[s_uiTrackCount];
+};
+
+struct UserDataRecord
+{
+    StringRef name;
+    uint32    type;
+    ArrayRef  values; // float
+};
+
+struct AnimRecord
+{
+    StringRef name;
+    uint8_t   isBaked;
+    uint8_t   isLooping;
+    uint16    padding;
+    uint32    scalingType;
+    uint32    frameCount;
+    ArrayRef  boneAnims; // BoneAnimRecord
+    ArrayRef  userData;  // UserDataRecord
+};
+
+static_assert(sizeof(Header)         == 48 , "Header layout changed");
+static_assert(sizeof(BoneRecord)     == 76 , "BoneRecord layout changed");
+static_assert(sizeof(TextureRecord)  == 88 , "TextureRecord layout changed");
+static_assert(sizeof(MaterialRecord) == 20 , "MaterialRecord layout changed");
+static_assert(sizeof(LODMeshRecord)  == 32 , "LODMeshRecord layout changed");
+static_assert(sizeof(ShapeRecord)    == 160, "ShapeRecord layout changed");
+static_assert(sizeof(ModelRecord)    == 48 , "ModelRecord layout changed");
+static_assert(sizeof(KeyFrameRecord) == 20 , "KeyFrameRecord layout changed");
+static_assert(sizeof(TrackRecord)    == 40 , "TrackRecord layout changed");
+static_assert(sizeof(BoneAnimRecord) == 420, "BoneAnimRecord layout changed");
+static_assert(sizeof(UserDataRecord) == 20 , "UserDataRecord layout changed");
+static_assert(sizeof(AnimRecord)     == 36 , "AnimRecord layout changed");
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Read-only view of an array inside the mapping
+template<typename T>
+struct ArrayView
+{
+    const T* pData  = nullptr;
+    uint32   uiCount = 0;
+
+    const T* begin() const { return pData; }
+    const T* end() const { return pData + uiCount; }
+    uint32   size() const { return uiCount; }
+    bool     empty() const { return uiCount == 0; }
+    const T& operator[](uint32 i) const { return pData[i]; }
+};
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Maps a .mbin file and hands out views into it. Open checks every record and
+// array once, so the accessors never have to bounds check again.
+class MedianFile
+{
+public:
+    bool Open(const char* filePath);
+
+    const Header& GetHeader() const { return *reinterpret_cast<const Header*>(m_mappedFile.GetData()); }
+
+    ArrayView<ModelRecord> GetModels() const { return GetArray<ModelRecord>(GetHeader().models); }
+    ArrayView<AnimRecord>  GetAnims() const { return GetArray<AnimRecord>(GetHeader().anims); }
+
+    template<typename T>
+    ArrayView<T> GetArray(const ArrayRef& arrayRef) const
+    {
+        ArrayView<T> view;
+        view.pData = reinterpret_cast<const T*>(m_mappedFile.GetData() + arrayRef.offset);
+        view.uiCount = arrayRef.count;
+        return view;
+    }
+
+    // Points into the mapped file, copied by whatever keeps it
+    std::string_view GetString(const StringRef& stringRef) const
+    {
+        return std::string_view(m_pStrings + stringRef.offset, stringRef.length);
+    }
+
+    ArrayView<Math::vector3F> GetStream3F(const ShapeRecord& shape, VertexStream eStream) const { return GetArray<Math::vector3F>(shape.streams[eStream]); }
+    ArrayView<Math::vector2F> GetStream2F(const ShapeRecord& shape, VertexStream eStream) const { return GetArray<Math::vector2F>(shape.streams[eStream]); }
+    ArrayView<Math::vector4F> GetStream4F(const ShapeRecord& shape, VertexStream eStream) const { return GetArray<Math::vector4F>(shape.streams[eStream]); }
+    ArrayView<Math::vector4>  GetStream4(const ShapeRecord& shape, VertexStream eStream) const { return GetArray<Math::vector4>(shape.streams[eStream]); }
+
+private:
+    bool ValidateArray(const ArrayRef& arrayRef, size_t uiStride) const;
+    bool ValidateString(const StringRef& stringRef) const;
+    bool ValidateModel(const ModelRecord& model) const;
+    bool ValidateAnim(const AnimRecord& anim) const;
+
+    MappedFile  m_mappedFile;
+    const char* m_pStrings = nullptr;
+};
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Fills BFRESStructs from a .mbin file, the binary counterpart of XML::XmlParser
+class BinaryParser
+{
+public:
+    typedef std::function<void(FMDL&)> ModelCallback;
+    typedef std::function<void(Anim&)> AnimCallback;
+
+    static bool IsBinaryMedian(const char* filePath);
+
+    static void Parse(const char* filePath, BFRES& bfres, ParseProfile eProfile = ParseProfile::Full);
+    static void ParseStreaming(const char* filePath, const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile = ParseProfile::Full);
+
+    // Same as above for a file that is already open
+    static void Parse(const MedianFile& file, BFRES& bfres, ParseProfile eProfile = ParseProfile::Full);
+    static void ParseStreaming(const MedianFile& file, const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile = ParseProfile::Full);
+
+private:
+    static void ParseFMDL(const MedianFile& file, const ModelRecord& record, FMDL& fmdl, ParseProfile eProfile);
+    static void ParseFSHP(const MedianFile& file, const ShapeRecord& record, FSHP& fshp, ParseProfile eProfile);
+    static void ParseAnim(const MedianFile& file, const AnimRecord& record, Anim& anim);
+    static void ParseAnimTrack(const MedianFile& file, const TrackRecord& record, AnimTrack& animTrack);
+};
+
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Writes BFRESStructs back out as a .mbin file, the same layout the importer produces. Models and anims
+// are added one at a time: their arrays go straight to disk and only the small top level records are kept
+// until Close, so a streamed parse can be written without ever holding the whole tree.
+class BinaryWriter
+{
+public:
+    BinaryWriter();
+    ~BinaryWriter();
+
+    bool Open(const char* filePath);
+    void AddModel(const FMDL& fmdl);
+    void AddAnim(const Anim& anim);
+
+    // Writes the records and the header. Returns false, and removes the file, if anything failed to write.
+    // eProfile records what the added models were parsed with.
+    bool Close(uint64_t uiSourceHash, ParseProfile eProfile = ParseProfile::Full);
+
+    uint32 GetSize() const { return m_uiPosition; }
+
+private:
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+    template<typename T>
+    ArrayRef WriteArray(const T* pData, size_t uiCount);
+    template<typename T, typename Allocator>
+    ArrayRef WriteArray(const std::vector<T, Allocator>& data) { return WriteArray(data.data(), data.size()); }
+
+    void      WriteShape(const FSHP& fshp, ShapeRecord& record);
+    StringRef AddString(const std::pmr::string& str);
+    void      Write(const void* pData, size_t uiSize);
+    void      Align();
+
+    FILE*                                   m_pFile;
+    std::string                             m_filePath;
+    uint32                                  m_uiPosition;
+    bool                                    m_bFailed;
+    std::string                             m_strings;
+    std::unordered_map<std::string, uint32> m_stringOffsets;
+    std::vector<ModelRecord>                m_models;
+    std::vector<AnimRecord>                 m_anims;
+};
+
+}
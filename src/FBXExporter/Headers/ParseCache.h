@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include "BFRES.h"
+#include "MedianBinary.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// On-disk cache of a parsed median dump. The parsed BFRES tree is stored as
+// a .mbin file tagged with a hash of the dump's contents; as long as the
+// dump doesn't change, later runs load the cache instead of parsing again.
+// -----------------------------------------------------------------------
+struct ParseCacheStats
+{
+    bool     bHit            = false;
+    bool     bStored         = false;
+    uint64_t uiSourceBytes   = 0;
+    uint64_t uiCacheBytes    = 0;
+    double   fHashSeconds    = 0.0;
+    double   fLoadSeconds    = 0.0; // cache load on a hit
+    double   fStoreSeconds   = 0.0; // cache write on a miss, the parse itself is not included
+};
+
+class ParseCache
+{
+public:
+    typedef MedianBinary::BinaryParser::ModelCallback ModelCallback;
+    typedef MedianBinary::BinaryParser::AnimCallback  AnimCallback;
+
+    ParseCache(const std::string& sourcePath, const std::string& cachePath);
+
+    // Both return false on a miss, the caller then parses the dump itself and hands the result to the store functions.
+    // A cache parsed with a larger profile than eProfile is a hit too, it is loaded with eProfile.
+    bool Load(BFRES& bfres, ParseProfile eProfile = ParseProfile::Full);
+    bool LoadStreaming(const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile = ParseProfile::Full);
+
+    // eProfile is the profile bfres was parsed with
+    bool Store(const BFRES& bfres, ParseProfile eProfile = ParseProfile::Full);
+
+    // Incremental store for the streaming parse; models and anims have to be added before the callbacks move from them
+    bool BeginStore(ParseProfile eProfile = ParseProfile::Full);
+    void StoreModel(const FMDL& fmdl);
+    void StoreAnim(const Anim& anim);
+    bool EndStore();
+
+    const ParseCacheStats& GetStats() const { return m_stats; }
+    void PrintStats() const;
+
+    // 64 bit hash of a whole file, 0 if it can't be read
+    static uint64_t HashFile(const char* filePath, uint64_t& uiSize);
+
+private:
+    bool OpenCache(MedianBinary::MedianFile& file, ParseProfile eProfile);
+
+    std::string                  m_sourcePath;
+    std::string                  m_cachePath;
+    uint64_t                     m_uiSourceHash;
+    MedianBinary::BinaryWriter   m_writer;
+    bool                         m_bStoring;
+    ParseProfile                 m_eStoreProfile;
+    ParseCacheStats              m_stats;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+// -----------------------------------------------------------------------
+// How much of every FMDL a parser fills in. Each profile is a subset of
+// the one before it; anims are always parsed in full.
+// -----------------------------------------------------------------------
+enum class ParseProfile
+{
+    Full,            // everything the dump carries
+    GeometryMinimal, // everything FBXWriter reads, no position1/position2 streams
+    SkeletonOnly     // name, index and FSKL, no materials or shapes
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Primitives.h"
+
+// -----------------------------------------------------------------------
+// SARC archives (.pack, .sarc and their Yaz0 compressed variants). A 0x14
+// byte header with a byte order mark is followed by the SFAT node table
+// (name hash, name offset, data range per file) and the SFNT name table.
+// Entries are read in place: their data points into the mapped archive, so
+// nothing gets extracted to disk.
+//
+// Files inside an archive are addressed as if the archive were a directory:
+//   Pack\TitleBG.pack\Model\Npc_Gerudo_Queen.sbfres
+// -----------------------------------------------------------------------
+namespace SARC
+{
+
+static const uint32 s_uiMagic = 0x53415243; // "SARC"
+
+// Splits a path into the archive file and the entry name inside it, with '/' separators like SARC names.
+// Returns false when no leading part of the path is a file, i.e. the path isn't inside an archive.
+bool SplitPath(const std::string& path, std::string& archivePath, std::string& entryName);
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+class Archive
+{
+public:
+    struct Entry
+    {
+        std::string name;
+        const char* pData;
+        size_t      uiSize;
+    };
+
+    Archive() {}
+
+    // Maps the archive, a Yaz0 compressed one is decompressed into memory first
+    bool Open(const char* filePath);
+
+    const std::vector<Entry>& GetEntries() const { return m_entries; }
+    const Entry*              Find(const std::string& name) const;
+
+private:
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    bool ReadEntries(const char* pData, size_t uiSize);
+
+    MappedFile              m_mappedFile;
+    std::unique_ptr<char[]> m_pDecompressed;
+    std::vector<Entry>      m_entries;
+};
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Opens the archives in parallel on the thread pool and returns the path of every entry whose name ends
+// with szExtension, archive by archive in the given order. Archives that fail to open are skipped.
+std::vector<std::string> FindEntries(const std::vector<std::string>& archivePaths, const char* szExtension);
+
+}
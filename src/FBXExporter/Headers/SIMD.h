@@ -0,0 +1,33 @@
+#pragma once
+
+// -----------------------------------------------------------------------
+// Instruction set selection for the SIMD decoders. Each of them has a
+// scalar, an SSE2 and an AVX2 path: SSE2 is always there on x64 and
+// assumed on Win32, AVX2 is checked for at run time. AVX2 code is built
+// per function, so the exporter itself doesn't need /arch:AVX2.
+// -----------------------------------------------------------------------
+
+// MSVC compiles AVX2 intrinsics in any function, GCC and Clang only in functions built for AVX2
+#ifdef _MSC_VER
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace SIMD
+{
+
+enum class Path
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+Path        GetFastestPath();
+const char* GetPathName(Path ePath);
+
+// ePath, or SSE2 when it is AVX2 and the CPU doesn't have it
+Path        Resolve(Path ePath);
+
+}
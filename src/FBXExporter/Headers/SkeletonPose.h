@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include "BFRES.h"
+#include "JPMath.h"
+#include "Primitives.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// Bind pose of a skeleton, without the SDK. Every bone's global matrix is
+// worked out once from its local scale, rotation and translation, parents
+// before children, the way the scene will evaluate the node WriteSkeleton
+// makes of it. The cluster link matrices and the bind pose then read them
+// instead of asking the scene node by node.
+//
+// Nodes inherit their parent's transform FBX's default way (eInheritRrSs):
+// the parent's rotation and scale are split apart, its scale applies to
+// the child's rotation and scale but never shears them, the translation
+// goes through the parent's whole matrix. This is not the bone transform
+// of the reader's skeleton dump, which compensates segment scale instead.
+//
+// Rotations are the euler angles CreateBone writes in degrees, X applied
+// first. Quaternion bones have no rotation on their node, so none here.
+// -----------------------------------------------------------------------
+namespace SkeletonPose
+{
+
+// Global matrices of fskl.bones, in the same order. Bones whose parents never lead to a root are left at identity.
+void ComputeGlobalTransforms(const FSKL& fskl, std::vector<Math::matrix4D>& globals);
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "BFRES.h"
+#include "Primitives.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// Skin clusters of a mesh, without the SDK. The vertices name their bones
+// through blend indices into the skeleton's matrix palette, FBX wants the
+// control points of every bone instead. Two passes over the vertices turn
+// one into the other: the first counts the influences of every bone, so
+// the arrays are allocated once at their exact size, the second writes
+// them. The result is laid out CSR style, a row of control points and
+// weights per bone.
+//
+// Big meshes run both passes over ranges of vertices in parallel. Every
+// range writes from an offset into each row that the ranges before it
+// have counted, so rows still list their control points in order.
+// -----------------------------------------------------------------------
+namespace SkinBuilder
+{
+
+// What a blend index points at: the bone it moves the vertex with, by a rigid or a smooth skinning matrix
+struct PaletteEntry
+{
+    uint32 uiBoneIndex;
+    bool   bRigid;
+};
+
+// Bone bones[r] moves control points controlPoints[offsets[r]] up to controlPoints[offsets[r + 1]], each by the
+// matching weight, in control point order
+struct Skin
+{
+    std::vector<uint32> bones;         // the bones with influences, ascending
+    std::vector<uint32> offsets;       // one more than bones
+    std::vector<uint32> controlPoints;
+    std::vector<float>  weights;
+};
+
+// Builds the skin of uiCount control points, control point i being vertex pVertices[i] of the shape. Rigid
+// vertices go to the bone of their first blend index with a weight of 1, smooth ones to the bones of their first
+// uiSkinCount blend indices that have a weight. Vertices without blend indices go to palette entry 0 and blend
+// indices past the palette are skipped.
+void Build(const VertexStreams& vertices, const uint32* pVertices, uint32 uiCount, uint32 uiSkinCount,
+           const std::vector<PaletteEntry>& palette, Skin& skin);
+
+}
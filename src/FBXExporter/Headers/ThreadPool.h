@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// -----------------------------------------------------------------------
+// Fixed set of worker threads for data-parallel loops. ParallelFor hands
+// out indices through a shared counter and the calling thread works on the
+// loop too, so a ParallelFor issued from inside another one cannot stall
+// waiting for a worker that is busy with the outer loop.
+// -----------------------------------------------------------------------
+class ThreadPool
+{
+public:
+    // uiThreadCount is the number of extra workers; the calling thread always takes part as well
+    explicit ThreadPool(unsigned int uiThreadCount);
+    ~ThreadPool();
+
+    // Calls func(i) for every i in [0, uiCount) and returns once all calls are done. The order the
+    // calls run in is unspecified, so func should only write to slot i of a pre-sized destination.
+    void ParallelFor(size_t uiCount, const std::function<void(size_t)>& func);
+
+    unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_threads.size()); }
+
+    // Shared pool with one worker per hardware thread besides the main one
+    static ThreadPool& Get();
+
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void WorkerLoop();
+
+    std::vector<std::thread>          m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_taskReady;
+    bool                              m_bStopping;
+};
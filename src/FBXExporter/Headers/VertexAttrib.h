@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include "Primitives.h"
+#include "SIMD.h"
+
+// -----------------------------------------------------------------------
+// GX2 vertex attribute decoding, whole streams at a time. The elements of
+// an attribute are gathered out of their interleaved buffer into one run
+// of components. That run is then converted by a kernel per component
+// type, 16 or 32 bytes at a time: byte swapped (the Wii U is big endian),
+// widened, normalized and, for half floats, rebuilt as floats.
+//
+// Components are converted as the importer did: UNorm divides by
+// 2^bits - 1 and SNorm by 2^(bits - 1) - 1 without clamping. The 2 bit
+// w of a signed 10_10_10_2 is a plain integer.
+// -----------------------------------------------------------------------
+namespace VertexAttrib
+{
+
+// The low byte of a GX2AttribFormat picks the component layout, the next nibble how the components are
+// interpreted
+enum Type
+{
+    eTypeUNorm        = 0x0,
+    eTypeUInt         = 0x1,
+    eTypeSNorm        = 0x2,
+    eTypeSInt         = 0x3,
+    eTypeUIntToSingle = 0x8, // also the float formats
+    eTypeSIntToSingle = 0xA
+};
+
+// Bytes of one element and floats it decodes to, 0 for formats that can't be decoded
+uint32 GetElementSize(uint32 uiFormat);
+uint32 GetComponentCount(uint32 uiFormat);
+
+// Decodes uiCount elements, the first at pSrc and each uiStride bytes after the one before, into
+// GetComponentCount() floats per element. Returns false for formats that can't be decoded.
+bool Decode(const char* pSrc, size_t uiStride, size_t uiCount, uint32 uiFormat, float* pDst, SIMD::Path ePath);
+bool Decode(const char* pSrc, size_t uiStride, size_t uiCount, uint32 uiFormat, float* pDst);
+
+// Element by element decoder, what the other paths are checked against
+bool DecodeReference(const char* pSrc, size_t uiStride, size_t uiCount, uint32 uiFormat, float* pDst);
+
+}
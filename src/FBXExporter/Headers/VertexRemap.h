@@ -0,0 +1,33 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "BFRES.h"
+#include "Primitives.h"
+
+using namespace BFRESStructs;
+
+// -----------------------------------------------------------------------
+// Per LOD vertex compaction. An LOD's faces index into the vertices of
+// the whole shape, of which the lower LODs only use a fraction. The
+// vertices an LOD references are gathered into a compact set, kept in
+// the shape's order so the writer still walks the attribute streams
+// forwards, and its faces are rewritten to index into that set.
+//
+// Faces that reference a vertex past the end of the shape are dropped
+// whole, they would index past the control points of the mesh.
+// -----------------------------------------------------------------------
+namespace VertexRemap
+{
+
+// The vertices one LOD references and its faces over them
+struct LODVertices
+{
+    std::vector<uint32> vertices; // shape vertex of every compact vertex, ascending
+    FaceIndices         faces;    // triangle list indexing vertices, in the narrowest type
+};
+
+// Gathers the vertices faces reference out of the uiVertexCount of the shape and rewrites faces to index
+// them. Returns the number of triangles dropped for referencing a vertex the shape doesn't have.
+size_t Build(const FaceIndices& faces, uint32 uiVertexCount, LODVertices& lod);
+
+}
@@ -3,12 +3,17 @@
 #include <algorithm>
 #include <iostream>
 #include <assert.h>
-#include <sstream>
+#include <stdint.h>
+#include <charconv>
+#include <cctype>
+#include <functional>
 #include "JPMath.h"
 #include "rapidxml.hpp"
 #include "rapidxml_utils.hpp"
 #include "BFRES.h"
 #include "Primitives.h"
+#include "MappedFile.h"
+#include "ParseProfile.h"
 
 using namespace BFRESStructs;
 
@@ -26,15 +31,28 @@ typedef rapidxml::xml_attribute<>   Attribute;
 class XmlParser
 {
 public:
-    static void Parse(const char* filePath, BFRES &bfres);
+    // Our dumps never contain data nodes and never need entities translated. Names and values are only
+    // ever read through their sizes, so RapidXML doesn't have to write terminators into the mapped pages either,
+    // which keeps them clean and shared with the file cache.
+    static const int s_iParseFlags = rapidxml::parse_no_data_nodes | rapidxml::parse_no_entity_translation | rapidxml::parse_no_string_terminators;
 
-    static void ParseDocument(File &file, Document &doc);
+    typedef std::function<void(FMDL&)> ModelCallback;
+    typedef std::function<void(Anim&)>  AnimCallback;
+
+    static void Parse(const char* filePath, BFRES &bfres, ParseProfile eProfile = ParseProfile::Full);
+
+    // Streaming mode: parses the dump one FMDL, then one Anim, at a time and hands each to its callback,
+    // which may move from it. The DOM and struct tree of an element are freed before the next one is read,
+    // so memory is bounded by the largest model instead of the whole archive.
+    static void ParseStreaming(const char* filePath, const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile = ParseProfile::Full);
+
+    static void ParseDocument(char* pText, Document &doc);
 
 
 
     // General type parsers
-    template<uint32 uiLen>
-    static bool ParseAttributeString(std::string& token, Element* pElement, const char(&attrName)[uiLen])
+    template<typename Allocator, uint32 uiLen>
+    static bool ParseAttributeString(std::basic_string<char, std::char_traits<char>, Allocator>& token, Element* pElement, const char(&attrName)[uiLen])
     {
         token.clear();
         Attribute* pAttribute;
@@ -48,17 +66,31 @@ public:
     }
 
     template<uint32 uiLen>
-    static bool ParseAttributeBool(bool& bToken, Element* pElement, const char(&attrName)[uiLen])
+    static bool ParseAttributeRange(const char*& pBegin, const char*& pEnd, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::string token = "";
-        if (!ParseAttributeString(token, pElement, attrName))
+        Attribute* pAttribute;
+        pAttribute = pElement->first_attribute(attrName, uiLen - 1, false);
+
+        if (!pAttribute || pAttribute->value_size() == 0)
             return false;
 
-        std::transform(token.begin(), token.end(), token.begin(), ::tolower);
+        // Point straight into the RapidXML buffer, nothing is copied
+        pBegin = pAttribute->value();
+        pEnd = pBegin + pAttribute->value_size();
+        return true;
+    }
+
+    template<uint32 uiLen>
+    static bool ParseAttributeBool(bool& bToken, Element* pElement, const char(&attrName)[uiLen])
+    {
+        const char* pBegin;
+        const char* pEnd;
+        if (!ParseAttributeRange(pBegin, pEnd, pElement, attrName))
+            return false;
 
-        if (token == "true")
+        if (EqualsNoCase(pBegin, pEnd, "true"))
             bToken = true;
-        else if (token == "false")
+        else if (EqualsNoCase(pBegin, pEnd, "false"))
             bToken = false;
         else
         {
@@ -71,150 +103,45 @@ public:
     template<uint32 uiLen>
     static bool ParseAttributeUInt(uint32& num, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::string token = "";
-        if (!ParseAttributeString(token, pElement, attrName))
-            return false;
-
-        try
-        {
-            num = static_cast<uint32>(std::stoi(token));
-            return true;
-        }
-        catch (...)
-        {
-            assert(0 && "Invalid argument");
-        }
-
-        return false;
+        return ParseAttributeTuple<uint32, 1>(&num, pElement, attrName);
     }
 
     template<uint32 uiLen>
     static bool ParseAttributeInt(int32& num, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::string token = "";
-        if (!ParseAttributeString(token, pElement, attrName))
-            return false;
-
-        try
-        {
-            num = static_cast<int32>(std::stoi(token));
-            return true;
-        }
-        catch (...)
-        {
-            assert(0 && "Invalid argument");
-        }
-
-        return false;
+        return ParseAttributeTuple<int32, 1>(&num, pElement, attrName);
     }
 
     template<uint32 uiLen>
     static bool ParseAttributeFloat(float& value, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::string token = "";
-        if (!ParseAttributeString(token, pElement, attrName))
-            return false;
-
-        try
-        {
-            value = static_cast<float>(std::stof(token));
-            return true;
-        }
-        catch (...)
-        {
-            assert(0 && "Invalid argument");
-        }
-
-        return false;
+        return ParseAttributeTuple<float, 1>(&value, pElement, attrName);
     }
 
-    template<uint32 uiLen>
-    static bool ParseAttributeIntArray(std::vector<int32>& arr, Element* pElement, const char(&attrName)[uiLen])
+    template<typename Allocator, uint32 uiLen>
+    static bool ParseAttributeIntArray(std::vector<int32, Allocator>& arr, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::string token = "";
-        if (!ParseAttributeString(token, pElement, attrName))
-            return false;
-
-        // tokenize the string
-        std::istringstream iss(token);
-        std::string subStr;
-        while (getline(iss, subStr, ','))
-        {
-            try
-            {
-                int32 number = std::stoi(subStr);
-                arr.push_back(number);
-            }
-            catch (...)
-            {
-                assert(0 && "Invalid argument");
-                return false;
-            }
-
-        }
-        return true;
+        return ParseAttributeArray(arr, pElement, attrName);
     }
 
-    template<uint32 uiLen>
-    static bool ParseAttributeUIntArray(std::vector<uint32>& arr, Element* pElement, const char(&attrName)[uiLen])
+    template<typename Allocator, uint32 uiLen>
+    static bool ParseAttributeUIntArray(std::vector<uint32, Allocator>& arr, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::string token = "";
-        if (!ParseAttributeString(token, pElement, attrName))
-            return false;
-
-        // tokenise the string
-        std::istringstream iss(token);
-        std::string subStr;
-        while (getline(iss, subStr, ','))
-        {
-            try
-            {
-                uint32 number = static_cast<uint32>(std::stoi(subStr));
-                arr.push_back(number);
-            }
-            catch (...)
-            {
-                assert(0 && "Invalid argument");
-                return false;
-            }
-
-        }
-        return true;
+        return ParseAttributeArray(arr, pElement, attrName);
     }
 
-    template<uint32 uiLen>
-    static bool ParseAttributeFloatArray(std::vector<float>& arr, Element* pElement, const char(&attrName)[uiLen])
+    template<typename Allocator, uint32 uiLen>
+    static bool ParseAttributeFloatArray(std::vector<float, Allocator>& arr, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::string token = "";
-        if (!ParseAttributeString(token, pElement, attrName))
-            return false;
-
-        // tokenise the string
-        std::istringstream iss(token);
-        std::string subStr;
-        while (getline(iss, subStr, ','))
-        {
-            try
-            {
-                float value = static_cast<float>(std::stof(subStr));
-                arr.push_back(value);
-            }
-            catch (...)
-            {
-                assert(0 && "Invalid argument");
-                return false;
-            }
-
-        }
-        return true;
+        return ParseAttributeArray(arr, pElement, attrName);
     }
 
     // Custom type parsers
     template<uint32 uiLen>
     static bool ParseAttributeVector2F(Math::vector2F& vec, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::vector<float> vals;
-        if (!ParseAttributeFloatArray(vals, pElement, attrName))
+        float vals[2];
+        if (!ParseAttributeTuple<float, 2>(vals, pElement, attrName))
             return false;
 
         vec.X = vals[0];
@@ -226,8 +153,8 @@ public:
     template<uint32 uiLen>
     static bool ParseAttributeVector3F(Math::vector3F& vec, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::vector<float> vals;
-        if (!ParseAttributeFloatArray(vals, pElement, attrName))
+        float vals[3];
+        if (!ParseAttributeTuple<float, 3>(vals, pElement, attrName))
             return false;
 
         vec.X = vals[0];
@@ -240,8 +167,8 @@ public:
     template<uint32 uiLen>
     static bool ParseAttributeVector4F(Math::vector4F& vec, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::vector<float> vals;
-        if (!ParseAttributeFloatArray(vals, pElement, attrName))
+        float vals[4];
+        if (!ParseAttributeTuple<float, 4>(vals, pElement, attrName))
 			return false;
 
         vec.X = vals[0];
@@ -255,8 +182,8 @@ public:
     template<uint32 uiLen>
     static bool ParseAttributeVector2(Math::vector2& vec, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::vector<uint32> vals;
-        if (!ParseAttributeUIntArray(vals, pElement, attrName))
+        uint32 vals[2];
+        if (!ParseAttributeTuple<uint32, 2>(vals, pElement, attrName))
             return false;
 
         vec.X = vals[0];
@@ -268,8 +195,8 @@ public:
     template<uint32 uiLen>
     static bool ParseAttributeVector3(Math::vector3& vec, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::vector<uint32> vals;
-        if (!ParseAttributeUIntArray(vals, pElement, attrName))
+        uint32 vals[3];
+        if (!ParseAttributeTuple<uint32, 3>(vals, pElement, attrName))
             return false;
 
         vec.X = vals[0];
@@ -282,8 +209,8 @@ public:
     template<uint32 uiLen>
     static bool ParseAttributeVector4(Math::vector4& vec, Element* pElement, const char(&attrName)[uiLen])
     {
-        std::vector<uint32> vals;
-        if (!ParseAttributeUIntArray(vals, pElement, attrName))
+        uint32 vals[4];
+        if (!ParseAttributeTuple<uint32, 4>(vals, pElement, attrName))
             return false;
 
         vec.X = vals[0];
@@ -294,6 +221,151 @@ public:
         return true;
     }
 
+    // Parses exactly uiCount comma separated numbers into pValues. pValues is left untouched on failure.
+    template<typename T, uint32 uiCount, uint32 uiLen>
+    static bool ParseAttributeTuple(T* pValues, Element* pElement, const char(&attrName)[uiLen])
+    {
+        const char* pCursor;
+        const char* pEnd;
+        if (!ParseAttributeRange(pCursor, pEnd, pElement, attrName))
+            return false;
+
+        T vals[uiCount];
+        for (uint32 i = 0; i < uiCount; i++)
+        {
+            if (pCursor >= pEnd || !ParseNumber(pCursor, pEnd, vals[i]))
+            {
+                assert(0 && "Invalid argument");
+                return false;
+            }
+        }
+
+        for (uint32 i = 0; i < uiCount; i++)
+            pValues[i] = vals[i];
+        return true;
+    }
+
+    // Appends every comma separated number of the attribute to arr, growing it at most once
+    template<typename T, typename Allocator, uint32 uiLen>
+    static bool ParseAttributeArray(std::vector<T, Allocator>& arr, Element* pElement, const char(&attrName)[uiLen])
+    {
+        const char* pCursor;
+        const char* pEnd;
+        if (!ParseAttributeRange(pCursor, pEnd, pElement, attrName))
+            return false;
+
+        arr.reserve(arr.size() + std::count(pCursor, pEnd, ',') + 1);
+        while (pCursor < pEnd)
+        {
+            T value;
+            if (!ParseNumber(pCursor, pEnd, value))
+            {
+                assert(0 && "Invalid argument");
+                return false;
+            }
+            arr.push_back(value);
+        }
+        return true;
+    }
+
+    // Parses the comma separated triangle list indices of the attribute straight into faces, uiExpectedCount of
+    // them. They go into the 16 bit array until an index doesn't fit, then everything moves to the 32 bit one.
+    template<uint32 uiLen>
+    static bool ParseAttributeFaceIndices(FaceIndices& faces, size_t uiExpectedCount, Element* pElement, const char(&attrName)[uiLen])
+    {
+        faces.indices16.clear();
+        faces.indices32.clear();
+
+        const char* pCursor;
+        const char* pEnd;
+        if (!ParseAttributeRange(pCursor, pEnd, pElement, attrName))
+            return false;
+
+        faces.indices16.reserve(uiExpectedCount);
+        while (pCursor < pEnd)
+        {
+            int32 iIndex;
+            if (!ParseNumber(pCursor, pEnd, iIndex))
+            {
+                assert(0 && "Invalid argument");
+                return false;
+            }
+
+            if (!faces.indices32.empty() || iIndex < 0 || iIndex > 0xFFFF)
+            {
+                if (faces.indices32.empty())
+                {
+                    faces.indices32.reserve(std::max(uiExpectedCount, faces.indices16.size() + 1));
+                    faces.indices32.assign(faces.indices16.begin(), faces.indices16.end());
+                    faces.indices16.clear();
+                    faces.indices16.shrink_to_fit();
+                }
+                faces.indices32.push_back(static_cast<uint32>(iIndex));
+            }
+            else
+                faces.indices16.push_back(static_cast<uint16>(iIndex));
+        }
+        return true;
+    }
+
+    // Number tokenizer. Parses the element at pCursor and moves pCursor past the following separator.
+    // Like stoi/stof only the numeric prefix of an element is used, e.g. an int read from "1.5" gives 1.
+    template<typename T>
+    static bool ParseNumber(const char*& pCursor, const char* pEnd, T& value)
+    {
+        while (pCursor < pEnd && (*pCursor == ' ' || *pCursor == '+'))
+            pCursor++;
+
+        const char* pElementEnd = pCursor;
+        if (!ParseNumberPrefix(pCursor, pEnd, value, pElementEnd))
+            return false;
+
+        pCursor = std::find(pElementEnd, pEnd, ',');
+        if (pCursor < pEnd)
+            pCursor++;
+        return true;
+    }
+
+    static bool ParseNumberPrefix(const char* pBegin, const char* pEnd, float& value, const char*& pParsedEnd)
+    {
+        std::from_chars_result result = std::from_chars(pBegin, pEnd, value);
+        pParsedEnd = result.ptr;
+        return result.ec == std::errc();
+    }
+
+    static bool ParseNumberPrefix(const char* pBegin, const char* pEnd, int32& value, const char*& pParsedEnd)
+    {
+        long long number = 0;
+        std::from_chars_result result = std::from_chars(pBegin, pEnd, number);
+        pParsedEnd = result.ptr;
+        if (result.ec != std::errc() || number < INT32_MIN || number > INT32_MAX)
+            return false;
+        value = static_cast<int32>(number);
+        return true;
+    }
+
+    static bool ParseNumberPrefix(const char* pBegin, const char* pEnd, uint32& value, const char*& pParsedEnd)
+    {
+        // Parsed signed so "-1" keeps wrapping the way static_cast<uint32>(stoi()) did
+        long long number = 0;
+        std::from_chars_result result = std::from_chars(pBegin, pEnd, number);
+        pParsedEnd = result.ptr;
+        if (result.ec != std::errc() || number < INT32_MIN || number > UINT32_MAX)
+            return false;
+        value = static_cast<uint32>(number);
+        return true;
+    }
+
+    static bool EqualsNoCase(const char* pBegin, const char* pEnd, const char* szLower)
+    {
+        for (; pBegin < pEnd; pBegin++, szLower++)
+        {
+            if (*szLower == '\0' || ::tolower(static_cast<unsigned char>(*pBegin)) != *szLower)
+                return false;
+        }
+        return *szLower == '\0';
+    }
+
     // Enum parser templates
     template<uint32 uiLen>
     static bool ParseAttributeRotationType(Bone::RotationType& eType, Element* pElement, const char(&attrName)[uiLen])
@@ -574,17 +646,26 @@ public:
 	}
 
 private:
-	static void ParseFMDL(FMDL& fmdl, Element* pElement);
+	static void ParseSkeletonsAndAnims(const char* filePath, BFRES& bfres);
+	static char* ParseModelChunks(char* pText, char* pEnd, ParseProfile eProfile, const ModelCallback& onModel);
+	static bool ParseStartTagAttribute(std::pmr::string& value, const char* pBegin, const char* pEnd, const char* szName);
+	static Element* ParseChunk(Document& doc, char* pBegin, char* pEnd);
+	static char* FindElementStart(char* pBegin, char* pEnd, const char* szName);
+	static char* FindElementEnd(char* pBegin, char* pEnd, const char* szName);
+	static void CollectChildren(std::vector<Element*>& nodes, Element* pParent, const char* szName, size_t uiExpectedCount = 0);
+
+	static void ParseFMDL(FMDL& fmdl, Element* pElement, ParseProfile eProfile);
 	static void ParseFSKL(FSKL& fskl, Element* pElement);
 	static void ParseBone(Bone& bone, Element* pElement);
 
 	static void ParseTextureRefs(TextureRefs& textureRefs, Element* pElement);
-	static void ParseMaterials(std::vector <FMAT>& fmats, Element* pElement);
+	static void ParseMaterials(std::pmr::vector<FMAT>& fmats, Element* pElement);
 	static void ParseFMAT(FMAT& fmat, Element* pElement);
-	static void ParseShapes(uint32 modelIndex, std::vector<FSHP>& fshps, Element* pElement);
-	static void ParseFSHP(FSHP& fshp, Element* pElement);
+	static void ParseShapes(uint32 modelIndex, std::pmr::vector<FSHP>& fshps, Element* pElement, ParseProfile eProfile);
+	static void ParseFSHP(FSHP& fshp, Element* pElement, ParseProfile eProfile);
 	static void ParseLODMesh(LODMesh& lodMesh, Element* pElement);
-	static void ParseFVTX(FVTX& fvtx, Element* pElement);
+	static void AddVertexStreams(VertexStreams& vertices, Element* pElement, ParseProfile eProfile);
+	static void ParseVertex(VertexStreams& vertices, size_t i, Element* pElement);
 
 	static void ParseFSKA(FSKA& fska, Element* pElement);
 	static void ParseAnim(Anim& anim, Element* pElement);
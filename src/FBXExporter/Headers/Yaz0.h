@@ -0,0 +1,70 @@
+#pragma once
+#include <stddef.h>
+#include <memory>
+#include "Primitives.h"
+
+// -----------------------------------------------------------------------
+// Yaz0, the LZ77 variant .sbfres and .szs files are compressed with. A 16
+// byte header (magic, big endian decompressed size, alignment, padding) is
+// followed by groups of one flag byte and eight chunks, flags MSB first: a
+// set bit copies one literal byte, a clear bit is a back reference of two
+// bytes (length 3-17) or three bytes (length 18-273) into the output.
+// -----------------------------------------------------------------------
+namespace Yaz0
+{
+
+static const uint32 s_uiMagic = 0x59617A30; // "Yaz0"
+static const size_t s_uiHeaderSize = 16;
+
+bool   IsYaz0(const char* pData, size_t uiSize);
+
+// Decompressed size stored in the header, 0 when the data isn't Yaz0
+uint32 GetDecompressedSize(const char* pData, size_t uiSize);
+
+// Decompresses a whole file, header included, into pDst. pDst has to hold GetDecompressedSize() bytes.
+// Returns false for corrupt data, pDst is partially written then.
+bool   Decompress(const char* pData, size_t uiSize, char* pDst, size_t uiDstSize);
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Incremental decompression for data that arrives in pieces, e.g. read from disk chunk by chunk. The
+// output buffer is allocated once the header is in, and everything below GetDecodedSize() is final
+// from then on, so a consumer can start on the front of the file while the rest is still coming in.
+class Decoder
+{
+public:
+    Decoder();
+
+    // Decodes as much of pData as possible. A chunk cut off at the end of pData is finished by the next
+    // call. Returns false once the data turned out to be corrupt.
+    bool   Feed(const char* pData, size_t uiSize);
+
+    bool   HasHeader() const { return m_pOutput != nullptr; }
+    bool   IsDone() const { return HasHeader() && m_uiDecoded == m_uiSize; }
+    bool   HasFailed() const { return m_bFailed; }
+
+    const char* GetData() const { return m_pOutput.get(); }
+    size_t GetSize() const { return m_uiSize; }
+    size_t GetDecodedSize() const { return m_uiDecoded; }
+
+    // Hands the output buffer over, the decoder is empty afterwards
+    std::unique_ptr<char[]> Release();
+
+private:
+    bool   FeedHeader(const uint8_t*& pSrc, const uint8_t* pSrcEnd);
+    bool   FeedChunk(const uint8_t*& pSrc, const uint8_t* pSrcEnd);
+
+    std::unique_ptr<char[]> m_pOutput;
+    size_t  m_uiSize;
+    size_t  m_uiDecoded;
+    uint8_t m_header[s_uiHeaderSize];
+    uint8_t m_uiHeaderBytes;
+    uint8_t m_pending[3];   // bytes of a back reference cut off by the end of the last Feed
+    uint8_t m_uiPending;
+    uint8_t m_uiFlags;      // remaining flags of the current group, next one in the top bit
+    uint8_t m_uiFlagCount;
+    bool    m_bFailed;
+};
+
+}
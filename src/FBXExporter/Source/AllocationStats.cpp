@@ -0,0 +1,92 @@
+#include "AllocationStats.h"
+#include "Globals.h"
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if TRACK_ALLOCATIONS
+namespace
+{
+    std::atomic<uint64_t> s_uiAllocations(0);
+    std::atomic<uint64_t> s_uiBytes(0);
+    std::atomic<uint64_t> s_uiLiveBytes(0);
+    std::atomic<uint64_t> s_uiPeakBytes(0);
+
+    // Every block starts with its size so delete can take it off the live bytes, padded to keep the
+    // alignment malloc gives
+    const size_t s_uiHeaderSize = alignof(max_align_t);
+}
+
+// The array and nothrow forms end up in these by default
+void* operator new(size_t uiSize)
+{
+    s_uiAllocations.fetch_add(1, std::memory_order_relaxed);
+    s_uiBytes.fetch_add(uiSize, std::memory_order_relaxed);
+
+    char* pBlock = static_cast<char*>(malloc(s_uiHeaderSize + uiSize));
+    if (!pBlock)
+        throw std::bad_alloc();
+
+    *reinterpret_cast<size_t*>(pBlock) = uiSize;
+    uint64_t uiLiveBytes = s_uiLiveBytes.fetch_add(uiSize, std::memory_order_relaxed) + uiSize;
+    uint64_t uiPeakBytes = s_uiPeakBytes.load(std::memory_order_relaxed);
+    while (uiLiveBytes > uiPeakBytes && !s_uiPeakBytes.compare_exchange_weak(uiPeakBytes, uiLiveBytes, std::memory_order_relaxed))
+    {
+    }
+    return pBlock + s_uiHeaderSize;
+}
+
+void operator delete(void* pMemory) noexcept
+{
+    if (!pMemory)
+        return;
+
+    char* pBlock = static_cast<char*>(pMemory) - s_uiHeaderSize;
+    s_uiLiveBytes.fetch_sub(*reinterpret_cast<size_t*>(pBlock), std::memory_order_relaxed);
+    free(pBlock);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+    operator delete(pMemory);
+}
+#endif
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool AllocationStats::IsEnabled()
+{
+    return TRACK_ALLOCATIONS;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+AllocationStats::Counters AllocationStats::Get()
+{
+    Counters counters = {};
+#if TRACK_ALLOCATIONS
+    counters.uiAllocations = s_uiAllocations.load(std::memory_order_relaxed);
+    counters.uiBytes = s_uiBytes.load(std::memory_order_relaxed);
+    counters.uiPeakBytes = s_uiPeakBytes.load(std::memory_order_relaxed);
+#endif
+    return counters;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void AllocationStats::Print(const char* szLabel, const Counters& start, size_t uiShapeCount)
+{
+    Counters now = Get();
+    unsigned long long uiAllocations = now.uiAllocations - start.uiAllocations;
+    unsigned long long uiBytes = now.uiBytes - start.uiBytes;
+
+    printf("[Allocations] %s: %llu allocations, %llu bytes, peak %llu bytes live", szLabel, uiAllocations, uiBytes,
+           static_cast<unsigned long long>(now.uiPeakBytes));
+    if (uiShapeCount > 0)
+        printf(", %zu shapes, %.1f allocations per shape", uiShapeCount, static_cast<double>(uiAllocations) / uiShapeCount);
+    printf("\n");
+}
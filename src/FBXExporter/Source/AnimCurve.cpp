@@ -0,0 +1,160 @@
+#include "AnimCurve.h"
+#include "VertexAttrib.h"
+#include <string.h>
+#include <algorithm>
+
+namespace AnimCurve
+{
+
+    // Keys converted per pass, 4 coefficients at most each
+    static const size_t s_uiChunkKeys = 256;
+    static const size_t s_uiMaxElementsPerKey = 4;
+
+    // Per frame and key type: the bytes of a value and the GX2 attribute format it converts as
+    static const uint32 s_typeSizes[]    = { 4, 2, 1 };
+    static const uint32 s_frameFormats[] = { 0x806, 0x302, 0x100 }; // single, 16 bit int, unsigned byte
+    static const uint32 s_keyFormats[]   = { 0x806, 0x302, 0x300 }; // single, 16 bit int, signed byte
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 GetFrameType(const Curve& curve)
+    {
+        return curve.uiFlags & 0x3;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 GetKeyType(const Curve& curve)
+    {
+        return (curve.uiFlags >> 2) & 0x3;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 GetCurveType(const Curve& curve)
+    {
+        return curve.uiFlags & 0x70;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Values stored per key, 0 for the curve types that aren't decoded
+    static uint32 GetElementsPerKey(const Curve& curve)
+    {
+        switch (GetCurveType(curve))
+        {
+        case eCurveCubic:   return 4;
+        case eCurveLinear:  return 2;
+        case eCurveStepInt: return 1;
+        default:            return 0;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool IsSupported(const Curve& curve)
+    {
+        return GetElementsPerKey(curve) != 0 && GetFrameType(curve) <= eFrameByte && GetKeyType(curve) <= eKeySByte;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    size_t GetFramesSize(const Curve& curve)
+    {
+        return static_cast<size_t>(curve.uiKeyCount) * s_typeSizes[GetFrameType(curve)];
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    size_t GetKeysSize(const Curve& curve)
+    {
+        return static_cast<size_t>(curve.uiKeyCount) * GetElementsPerKey(curve) * s_typeSizes[GetKeyType(curve)];
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decode(const Curve& curve, std::pmr::vector<KeyFrame>& keyFrames)
+    {
+        if (!IsSupported(curve))
+            return false;
+
+        uint32 uiFrameType = GetFrameType(curve);
+        uint32 uiKeyType = GetKeyType(curve);
+        uint32 uiCurveType = GetCurveType(curve);
+        uint32 uiElementsPerKey = GetElementsPerKey(curve);
+        uint32 uiFrameSize = s_typeSizes[uiFrameType];
+        uint32 uiKeySize = s_typeSizes[uiKeyType];
+
+        float fFrameScale = uiFrameType == eFrameFixed16 ? 1.0f / 32.0f : 1.0f;
+        float fScale = curve.fScale != 0.0f ? curve.fScale : 1.0f;
+        float fOffset;
+        memcpy(&fOffset, &curve.uiOffsetBits, sizeof(fOffset));
+        float fStepOffset = static_cast<float>(static_cast<int32>(curve.uiOffsetBits));
+
+        size_t uiFirstKey = keyFrames.size();
+        keyFrames.resize(uiFirstKey + curve.uiKeyCount);
+        KeyFrame* pKey = keyFrames.data() + uiFirstKey;
+
+        // Every chunk also converts the frame after its last key, where that key's segment ends
+        float frames[s_uiChunkKeys + 1];
+        float keys[s_uiChunkKeys * s_uiMaxElementsPerKey];
+        float fSlopeIn = 0.0f;
+        for (size_t uiFirst = 0; uiFirst < curve.uiKeyCount; uiFirst += s_uiChunkKeys)
+        {
+            size_t uiKeys = std::min(s_uiChunkKeys, curve.uiKeyCount - uiFirst);
+            size_t uiFrames = std::min(uiKeys + 1, curve.uiKeyCount - uiFirst);
+            size_t uiValues = uiElementsPerKey * uiKeys;
+            VertexAttrib::Decode(curve.pFrames + uiFrameSize * uiFirst, uiFrameSize, uiFrames, s_frameFormats[uiFrameType], frames);
+            VertexAttrib::Decode(curve.pKeys + uiKeySize * uiElementsPerKey * uiFirst, uiKeySize, uiValues, s_keyFormats[uiKeyType], keys);
+            for (size_t i = 0; i < uiFrames; i++)
+                frames[i] *= fFrameScale;
+            if (uiFrames == uiKeys)
+                frames[uiKeys] = curve.fEndFrame;
+
+            // Step keys are whole numbers, the offset an int
+            if (uiCurveType == eCurveStepInt)
+            {
+                for (size_t i = 0; i < uiKeys; i++, pKey++)
+                {
+                    pKey->m_uiFrame = static_cast<uint32>(static_cast<int32>(frames[i]));
+                    pKey->m_fValue  = fStepOffset + static_cast<float>(static_cast<int32>(keys[i])) * fScale;
+                    pKey->m_fSlope1 = 0;
+                    pKey->m_fSlope2 = 0;
+                }
+                continue;
+            }
+
+            for (size_t i = 0; i < uiValues; i++)
+                keys[i] *= fScale;
+
+            for (size_t i = 0; i < uiKeys; i++, pKey++)
+            {
+                const float* pCoefficients = keys + uiElementsPerKey * i;
+                float fSpan = frames[i + 1] - frames[i];
+                float fSlopeOut = 0.0f;
+                float fSlopeEnd = 0.0f;
+                if (fSpan > 0.0f)
+                {
+                    fSlopeOut = pCoefficients[1] / fSpan;
+                    fSlopeEnd = uiCurveType == eCurveCubic ? (pCoefficients[1] + 2.0f * pCoefficients[2] + 3.0f * pCoefficients[3]) / fSpan : fSlopeOut;
+                }
+
+                pKey->m_uiFrame = static_cast<uint32>(static_cast<int32>(frames[i]));
+                pKey->m_fValue  = fOffset + pCoefficients[0];
+                pKey->m_fSlope1 = uiFirst + i == 0 ? fSlopeOut : fSlopeIn;
+                pKey->m_fSlope2 = fSlopeOut;
+                fSlopeIn = fSlopeEnd;
+            }
+        }
+        return true;
+    }
+
+}
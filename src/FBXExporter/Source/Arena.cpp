@@ -0,0 +1,173 @@
+#include "Arena.h"
+#include "Globals.h"
+#include <new>
+#include <stdio.h>
+
+namespace
+{
+    // Blocks threads cut small allocations from, bigger ones get a block of their own
+    const size_t s_uiBlockSize = 64 * 1024;
+    const size_t s_uiLargeAllocation = s_uiBlockSize / 4;
+
+    // Generations are never reused, not even by another arena at the same address
+    std::atomic<uint64_t> s_uiNextGeneration(1);
+
+    // The block this thread is cutting from and the arena generation it belongs to
+    struct ThreadBlock
+    {
+        uint64_t uiGeneration;
+        char*    pCursor;
+        char*    pEnd;
+    };
+    thread_local ThreadBlock t_block = { 0, nullptr, nullptr };
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    char* AlignUp(char* p, size_t uiAlignment)
+    {
+        uintptr_t uiAddress = reinterpret_cast<uintptr_t>(p);
+        return p + ((uiAlignment - uiAddress % uiAlignment) % uiAlignment);
+    }
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+Arena::Scope::Scope(Arena& arena)
+{
+    m_pPrevious = std::pmr::set_default_resource(&arena);
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+Arena::Scope::~Scope()
+{
+    std::pmr::set_default_resource(m_pPrevious);
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+Arena::Arena()
+    : m_uiGeneration(s_uiNextGeneration.fetch_add(1))
+    , m_uiReservedBytes(0)
+    , m_uiAllocations(0)
+    , m_uiBytes(0)
+{
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+Arena::~Arena()
+{
+    Release();
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void Arena::Release()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (char* pBlock : m_blocks)
+        ::operator delete(pBlock);
+    m_blocks.clear();
+    m_blocks.shrink_to_fit();
+    m_uiGeneration = s_uiNextGeneration.fetch_add(1);
+    m_uiReservedBytes = 0;
+    m_uiAllocations.store(0, std::memory_order_relaxed);
+    m_uiBytes.store(0, std::memory_order_relaxed);
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+Arena::Stats Arena::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats;
+    stats.uiAllocations = m_uiAllocations.load(std::memory_order_relaxed);
+    stats.uiBytes = m_uiBytes.load(std::memory_order_relaxed);
+    stats.uiReservedBytes = m_uiReservedBytes;
+    stats.uiBlocks = m_blocks.size();
+    return stats;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void Arena::Print(const char* szLabel) const
+{
+    Stats stats = GetStats();
+    printf("[Arena] %s: %llu allocations, %llu bytes, peak %llu bytes in %llu blocks\n", szLabel,
+           static_cast<unsigned long long>(stats.uiAllocations), static_cast<unsigned long long>(stats.uiBytes),
+           static_cast<unsigned long long>(stats.uiReservedBytes), static_cast<unsigned long long>(stats.uiBlocks));
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+char* Arena::AllocateBlock(size_t uiBytes)
+{
+    char* pBlock = static_cast<char*>(::operator new(uiBytes));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_blocks.push_back(pBlock);
+    m_uiReservedBytes += uiBytes;
+    return pBlock;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void* Arena::do_allocate(size_t uiBytes, size_t uiAlignment)
+{
+#if TRACK_ALLOCATIONS
+    m_uiAllocations.fetch_add(1, std::memory_order_relaxed);
+    m_uiBytes.fetch_add(uiBytes, std::memory_order_relaxed);
+#endif
+
+    ThreadBlock& block = t_block;
+    if (block.uiGeneration == m_uiGeneration)
+    {
+        char* pMemory = AlignUp(block.pCursor, uiAlignment);
+        if (pMemory <= block.pEnd && uiBytes <= static_cast<size_t>(block.pEnd - pMemory))
+        {
+            block.pCursor = pMemory + uiBytes;
+            return pMemory;
+        }
+    }
+
+    // Big allocations would mostly waste the thread's block, they get one of their own and the thread
+    // keeps cutting from the one it has
+    if (uiBytes > s_uiLargeAllocation)
+        return AlignUp(AllocateBlock(uiBytes + uiAlignment - 1), uiAlignment);
+
+    char* pBlock = AllocateBlock(s_uiBlockSize);
+    char* pMemory = AlignUp(pBlock, uiAlignment);
+    block.uiGeneration = m_uiGeneration;
+    block.pCursor = pMemory + uiBytes;
+    block.pEnd = pBlock + s_uiBlockSize;
+    return pMemory;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void Arena::do_deallocate(void* pMemory, size_t uiBytes, size_t)
+{
+    // Only the thread's latest allocation can be taken back, the rest goes with the arena
+    ThreadBlock& block = t_block;
+    if (block.uiGeneration == m_uiGeneration && static_cast<char*>(pMemory) + uiBytes == block.pCursor)
+        block.pCursor = static_cast<char*>(pMemory);
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
@@ -0,0 +1,626 @@
+#include "BCn.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+namespace BCn
+{
+
+    enum BlockFormat
+    {
+        eBC1,
+        eBC2,
+        eBC3,
+        eBC4,
+        eBC5
+    };
+
+    enum FormatLayout
+    {
+        eFormatMask   = 0x3F,  // the hardware format
+        eFormatSigned = 0x200, // GX2's SNorm flag
+        eFormatBC1    = 0x31,
+        eFormatBC5    = 0x35
+    };
+
+    struct FormatInfo
+    {
+        BlockFormat eFormat;
+        bool        bSigned;
+        size_t      uiBlockSize;
+    };
+
+    static const uint32 s_uiBlockTexels = 16;
+
+    // Z reconstruction maps bytes to [-1, 1], and Z in [0, 1] back to [128, 255]
+    static const float s_fToSigned = 2.0f / 255.0f;
+    static const float s_fZScale   = 127.5f;
+    static const float s_fZBias    = 128.0f;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool GetFormatInfo(uint32 uiFormat, FormatInfo& info)
+    {
+        uint32 uiHwFormat = uiFormat & eFormatMask;
+        if (uiHwFormat < eFormatBC1 || uiHwFormat > eFormatBC5)
+            return false;
+
+        info.eFormat = static_cast<BlockFormat>(uiHwFormat - eFormatBC1);
+        info.bSigned = (info.eFormat == eBC4 || info.eFormat == eBC5) && (uiFormat & eFormatSigned) != 0;
+        info.uiBlockSize = info.eFormat == eBC1 || info.eFormat == eBC4 ? 8 : 16;
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool IsSupported(uint32 uiFormat)
+    {
+        FormatInfo info;
+        return GetFormatInfo(uiFormat, info);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ExpandColor(uint32 uiColor, int rgb[3])
+    {
+        int r = uiColor >> 11;
+        int g = (uiColor >> 5) & 0x3F;
+        int b = uiColor & 0x1F;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint8_t ReconstructZ(uint8_t uiX, uint8_t uiY)
+    {
+        // Same operations in the same order as the SIMD paths, so every path rounds alike
+        float x = static_cast<float>(uiX) * s_fToSigned - 1.0f;
+        float y = static_cast<float>(uiY) * s_fToSigned - 1.0f;
+        float z = sqrtf(std::max(1.0f - x * x - y * y, 0.0f));
+        return static_cast<uint8_t>(std::min(static_cast<int>(z * s_fZScale + s_fZBias), 255));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // One block ready for lookups: the palette index of every texel in two sets (color or first channel, alpha
+    // or second channel), and a 16 entry palette per source channel. Channels the format doesn't store, and
+    // BC1's alpha outside of its three color mode, are constant: every entry holds the value.
+    struct BlockSource
+    {
+        alignas(16) uint8_t indices[2][s_uiBlockTexels];
+        alignas(16) uint8_t palettes[4][16];
+        uint8_t             indexSet[4];
+        uint8_t             entryCount[4]; // 0 for constant channels
+    };
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void SetConstant(BlockSource& source, uint32 uiChannel, uint8_t uiValue)
+    {
+        memset(source.palettes[uiChannel], uiValue, sizeof(source.palettes[uiChannel]));
+        source.indexSet[uiChannel] = 0;
+        source.entryCount[uiChannel] = 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // The color half of BC1-BC3: two RGB565 endpoints and 2 bit indices. Only BC1 has the three color mode.
+    static bool PrepareColor(const uint8_t* pBlock, bool bBC1, BlockSource& source)
+    {
+        uint32 uiColor0 = pBlock[0] | (pBlock[1] << 8);
+        uint32 uiColor1 = pBlock[2] | (pBlock[3] << 8);
+        bool bFourColors = !bBC1 || uiColor0 > uiColor1;
+
+        int color0[3], color1[3];
+        ExpandColor(uiColor0, color0);
+        ExpandColor(uiColor1, color1);
+        for (uint32 c = 0; c < 3; c++)
+        {
+            uint8_t* pPalette = source.palettes[c];
+            pPalette[0] = static_cast<uint8_t>(color0[c]);
+            pPalette[1] = static_cast<uint8_t>(color1[c]);
+            pPalette[2] = static_cast<uint8_t>(bFourColors ? (2 * color0[c] + color1[c]) / 3 : (color0[c] + color1[c]) / 2);
+            pPalette[3] = static_cast<uint8_t>(bFourColors ? (color0[c] + 2 * color1[c]) / 3 : 0);
+            source.indexSet[c] = 0;
+            source.entryCount[c] = 4;
+        }
+
+        uint32 uiIndices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | (static_cast<uint32>(pBlock[7]) << 24);
+        for (uint32 i = 0; i < s_uiBlockTexels; i++)
+            source.indices[0][i] = (uiIndices >> (2 * i)) & 3;
+        return bFourColors;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // An interpolated channel (BC3's alpha, BC4, BC5): two endpoints and 3 bit indices. Signed values are
+    // biased by 128.
+    static void PrepareChannel(const uint8_t* pBlock, bool bSigned, uint8_t* pPalette, uint8_t* pIndices)
+    {
+        int a0 = bSigned ? std::max(-127, static_cast<int>(static_cast<int8_t>(pBlock[0]))) : pBlock[0];
+        int a1 = bSigned ? std::max(-127, static_cast<int>(static_cast<int8_t>(pBlock[1]))) : pBlock[1];
+        int values[8] = { a0, a1 };
+        if (a0 > a1)
+        {
+            for (int i = 1; i <= 6; i++)
+                values[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+        else
+        {
+            for (int i = 1; i <= 4; i++)
+                values[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+            values[6] = bSigned ? -127 : 0;
+            values[7] = bSigned ? 127 : 255;
+        }
+
+        int iBias = bSigned ? 128 : 0;
+        for (uint32 i = 0; i < 8; i++)
+            pPalette[i] = static_cast<uint8_t>(values[i] + iBias);
+
+        uint64_t uiIndices = 0;
+        for (uint32 b = 0; b < 6; b++)
+            uiIndices |= static_cast<uint64_t>(pBlock[2 + b]) << (8 * b);
+        for (uint32 i = 0; i < s_uiBlockTexels; i++)
+            pIndices[i] = (uiIndices >> (3 * i)) & 7;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void PrepareBlock(const uint8_t* pBlock, const FormatInfo& format, BlockSource& source)
+    {
+        memset(source.palettes, 0, sizeof(source.palettes));
+        uint8_t uiZero = format.bSigned ? 128 : 0;
+
+        switch (format.eFormat)
+        {
+        case eBC1:
+            if (PrepareColor(pBlock, true, source))
+                SetConstant(source, 3, 255);
+            else
+            {
+                // Index 3 is transparent black
+                memset(source.palettes[3], 255, 3);
+                source.indexSet[3] = 0;
+                source.entryCount[3] = 4;
+            }
+            break;
+
+        case eBC2:
+            PrepareColor(pBlock + 8, false, source);
+            for (uint32 i = 0; i < s_uiBlockTexels; i++)
+                source.indices[1][i] = (pBlock[i / 2] >> (4 * (i & 1))) & 0xF;
+            for (uint32 n = 0; n < 16; n++)
+                source.palettes[3][n] = static_cast<uint8_t>(n * 17);
+            source.indexSet[3] = 1;
+            source.entryCount[3] = 16;
+            break;
+
+        case eBC3:
+            PrepareColor(pBlock + 8, false, source);
+            PrepareChannel(pBlock, false, source.palettes[3], source.indices[1]);
+            source.indexSet[3] = 1;
+            source.entryCount[3] = 8;
+            break;
+
+        case eBC4:
+            PrepareChannel(pBlock, format.bSigned, source.palettes[0], source.indices[0]);
+            source.indexSet[0] = 0;
+            source.entryCount[0] = 8;
+            SetConstant(source, 1, uiZero);
+            SetConstant(source, 2, uiZero);
+            SetConstant(source, 3, 255);
+            break;
+
+        case eBC5:
+            PrepareChannel(pBlock, format.bSigned, source.palettes[0], source.indices[0]);
+            PrepareChannel(pBlock + 8, format.bSigned, source.palettes[1], source.indices[1]);
+            source.indexSet[0] = 0;
+            source.entryCount[0] = 8;
+            source.indexSet[1] = 1;
+            source.entryCount[1] = 8;
+            SetConstant(source, 2, uiZero);
+            SetConstant(source, 3, 255);
+            break;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void DecodeBlockScalar(const BlockSource& source, const DecodeParams& params, bool bReconstructZ, uint8_t* pOut, size_t uiStride)
+    {
+        for (uint32 i = 0; i < s_uiBlockTexels; i++)
+        {
+            uint8_t values[6];
+            for (uint32 c = 0; c < 4; c++)
+                values[c] = source.palettes[c][source.indices[source.indexSet[c]][i]];
+            if (bReconstructZ)
+                values[2] = ReconstructZ(values[0], values[1]);
+            values[eCompSel0] = 0;
+            values[eCompSel1] = 255;
+
+            uint8_t* pTexel = pOut + (i >> 2) * uiStride + (i & 3) * 4;
+            for (uint32 c = 0; c < 4; c++)
+                pTexel[c] = values[params.compSel[c]];
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // A channel of the 16 texels as one byte plane, selecting palette entries by comparing the indices
+    static __m128i LookupSSE2(const BlockSource& source, uint32 uiChannel)
+    {
+        const uint8_t* pPalette = source.palettes[uiChannel];
+        if (source.entryCount[uiChannel] == 0)
+            return _mm_set1_epi8(static_cast<char>(pPalette[0]));
+
+        __m128i indices = _mm_load_si128(reinterpret_cast<const __m128i*>(source.indices[source.indexSet[uiChannel]]));
+        __m128i result = _mm_setzero_si128();
+        for (uint32 k = 0; k < source.entryCount[uiChannel]; k++)
+        {
+            __m128i mask = _mm_cmpeq_epi8(indices, _mm_set1_epi8(static_cast<char>(k)));
+            result = _mm_or_si128(result, _mm_and_si128(mask, _mm_set1_epi8(static_cast<char>(pPalette[k]))));
+        }
+        return result;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Z of 4 texels from their X and Y in the low 32 bits of each lane
+    static __m128i ReconstructZ4(__m128i x32, __m128i y32)
+    {
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 x = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(x32), _mm_set1_ps(s_fToSigned)), one);
+        __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(y32), _mm_set1_ps(s_fToSigned)), one);
+        __m128 z = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_setzero_ps()));
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(s_fZScale)), _mm_set1_ps(s_fZBias)));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Z plane of 16 texels from their X and Y planes
+    static __m128i ReconstructZSSE2(__m128i x, __m128i y)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i z16[2];
+        for (uint32 h = 0; h < 2; h++)
+        {
+            __m128i x16 = h ? _mm_unpackhi_epi8(x, zero) : _mm_unpacklo_epi8(x, zero);
+            __m128i y16 = h ? _mm_unpackhi_epi8(y, zero) : _mm_unpacklo_epi8(y, zero);
+            __m128i zLow = ReconstructZ4(_mm_unpacklo_epi16(x16, zero), _mm_unpacklo_epi16(y16, zero));
+            __m128i zHigh = ReconstructZ4(_mm_unpackhi_epi16(x16, zero), _mm_unpackhi_epi16(y16, zero));
+            z16[h] = _mm_packs_epi32(zLow, zHigh);
+        }
+        return _mm_packus_epi16(z16[0], z16[1]);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Interleaves the four output planes into RGBA rows
+    static void StoreSSE2(__m128i r, __m128i g, __m128i b, __m128i a, uint8_t* pOut, size_t uiStride)
+    {
+        __m128i rgLow = _mm_unpacklo_epi8(r, g);
+        __m128i rgHigh = _mm_unpackhi_epi8(r, g);
+        __m128i baLow = _mm_unpacklo_epi8(b, a);
+        __m128i baHigh = _mm_unpackhi_epi8(b, a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), _mm_unpacklo_epi16(rgLow, baLow));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + uiStride), _mm_unpackhi_epi16(rgLow, baLow));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 2 * uiStride), _mm_unpacklo_epi16(rgHigh, baHigh));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 3 * uiStride), _mm_unpackhi_epi16(rgHigh, baHigh));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void DecodeBlockSSE2(const BlockSource& source, const DecodeParams& params, bool bReconstructZ, uint8_t* pOut, size_t uiStride)
+    {
+        __m128i planes[6];
+        for (uint32 c = 0; c < 4; c++)
+            planes[c] = LookupSSE2(source, c);
+        if (bReconstructZ)
+            planes[2] = ReconstructZSSE2(planes[0], planes[1]);
+        planes[eCompSel0] = _mm_setzero_si128();
+        planes[eCompSel1] = _mm_set1_epi8(-1);
+
+        const uint8_t* pSel = params.compSel;
+        StoreSSE2(planes[pSel[0]], planes[pSel[1]], planes[pSel[2]], planes[pSel[3]], pOut, uiStride);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static __m256i Combine(__m128i low, __m128i high)
+    {
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // A channel of two blocks, one per 128 bit lane, with one byte shuffle through the palettes
+    SIMD_TARGET_AVX2 static __m256i LookupAVX2(const BlockSource& left, const BlockSource& right, uint32 uiChannel)
+    {
+        __m256i palettes = Combine(_mm_load_si128(reinterpret_cast<const __m128i*>(left.palettes[uiChannel])),
+            _mm_load_si128(reinterpret_cast<const __m128i*>(right.palettes[uiChannel])));
+        __m256i indices = Combine(_mm_load_si128(reinterpret_cast<const __m128i*>(left.indices[left.indexSet[uiChannel]])),
+            _mm_load_si128(reinterpret_cast<const __m128i*>(right.indices[right.indexSet[uiChannel]])));
+        return _mm256_shuffle_epi8(palettes, indices);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static __m256i ReconstructZ8(__m128i x8, __m128i y8)
+    {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        __m256 x = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(x8)), _mm256_set1_ps(s_fToSigned)), one);
+        __m256 y = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(y8)), _mm256_set1_ps(s_fToSigned)), one);
+        __m256 z = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(one, _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)), _mm256_setzero_ps()));
+        return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(s_fZScale)), _mm256_set1_ps(s_fZBias)));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Z planes of two blocks; the packs work within lanes, the permutes put the texels back in order
+    SIMD_TARGET_AVX2 static __m256i ReconstructZAVX2(__m256i x, __m256i y)
+    {
+        __m256i z16[2];
+        for (uint32 h = 0; h < 2; h++)
+        {
+            __m128i xBlock = h ? _mm256_extracti128_si256(x, 1) : _mm256_castsi256_si128(x);
+            __m128i yBlock = h ? _mm256_extracti128_si256(y, 1) : _mm256_castsi256_si128(y);
+            __m256i zLow = ReconstructZ8(xBlock, yBlock);
+            __m256i zHigh = ReconstructZ8(_mm_srli_si128(xBlock, 8), _mm_srli_si128(yBlock, 8));
+            z16[h] = _mm256_permute4x64_epi64(_mm256_packs_epi32(zLow, zHigh), 0xD8);
+        }
+        return _mm256_permute4x64_epi64(_mm256_packus_epi16(z16[0], z16[1]), 0xD8);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Decodes pairs of full blocks along a row of blocks, each pair's rows stored with one write. Returns the
+    // number of blocks decoded.
+    SIMD_TARGET_AVX2 static uint32 DecodeBlockPairsAVX2(const uint8_t* pBlocks, uint32 uiBlockCount, const FormatInfo& format, const DecodeParams& params,
+        bool bReconstructZ, uint8_t* pOut, size_t uiStride)
+    {
+        BlockSource left, right;
+        uint32 uiBlock = 0;
+        for (; uiBlock + 2 <= uiBlockCount; uiBlock += 2)
+        {
+            PrepareBlock(pBlocks + uiBlock * format.uiBlockSize, format, left);
+            PrepareBlock(pBlocks + (uiBlock + 1) * format.uiBlockSize, format, right);
+
+            __m256i planes[6];
+            for (uint32 c = 0; c < 4; c++)
+                planes[c] = LookupAVX2(left, right, c);
+            if (bReconstructZ)
+                planes[2] = ReconstructZAVX2(planes[0], planes[1]);
+            planes[eCompSel0] = _mm256_setzero_si256();
+            planes[eCompSel1] = _mm256_set1_epi8(-1);
+
+            const uint8_t* pSel = params.compSel;
+            __m256i rgLow = _mm256_unpacklo_epi8(planes[pSel[0]], planes[pSel[1]]);
+            __m256i rgHigh = _mm256_unpackhi_epi8(planes[pSel[0]], planes[pSel[1]]);
+            __m256i baLow = _mm256_unpacklo_epi8(planes[pSel[2]], planes[pSel[3]]);
+            __m256i baHigh = _mm256_unpackhi_epi8(planes[pSel[2]], planes[pSel[3]]);
+
+            uint8_t* pPair = pOut + uiBlock * 16;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pPair), _mm256_unpacklo_epi16(rgLow, baLow));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pPair + uiStride), _mm256_unpackhi_epi16(rgLow, baLow));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pPair + 2 * uiStride), _mm256_unpacklo_epi16(rgHigh, baHigh));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pPair + 3 * uiStride), _mm256_unpackhi_epi16(rgHigh, baHigh));
+
+            // PrepareBlock is SSE code, running it with dirty upper halves costs a state transition per block
+            _mm256_zeroupper();
+        }
+        return uiBlock;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool CheckParams(size_t uiSize, uint32 uiWidth, uint32 uiHeight, const DecodeParams& params, FormatInfo& format)
+    {
+        if (!GetFormatInfo(params.uiFormat, format))
+            return false;
+        for (uint32 c = 0; c < 4; c++)
+        {
+            if (params.compSel[c] > eCompSel1)
+                return false;
+        }
+
+        size_t uiBlocks = static_cast<size_t>((uiWidth + 3) / 4) * ((uiHeight + 3) / 4);
+        return uiSize >= uiBlocks * format.uiBlockSize;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decode(const char* pBlocks, size_t uiSize, uint32 uiWidth, uint32 uiHeight, const DecodeParams& params, uint8_t* pRGBA, SIMD::Path ePath)
+    {
+        FormatInfo format;
+        if (!CheckParams(uiSize, uiWidth, uiHeight, params, format))
+            return false;
+        ePath = SIMD::Resolve(ePath);
+
+        bool bReconstructZ = params.bReconstructZ && format.eFormat == eBC5;
+        uint32 uiBlocksX = (uiWidth + 3) / 4;
+        uint32 uiBlocksY = (uiHeight + 3) / 4;
+        size_t uiStride = static_cast<size_t>(uiWidth) * 4;
+
+        // Blocks over the image's edge are decoded here, then cropped
+        uint8_t edgeBlock[4 * 16];
+
+        for (uint32 by = 0; by < uiBlocksY; by++)
+        {
+            const uint8_t* pRowBlocks = reinterpret_cast<const uint8_t*>(pBlocks) + static_cast<size_t>(by) * uiBlocksX * format.uiBlockSize;
+            uint8_t* pRowOut = pRGBA + static_cast<size_t>(by) * 4 * uiStride;
+            uint32 uiRows = std::min(4u, uiHeight - by * 4);
+
+            uint32 bx = 0;
+            if (ePath == SIMD::Path::AVX2 && uiRows == 4)
+                bx = DecodeBlockPairsAVX2(pRowBlocks, uiWidth / 4, format, params, bReconstructZ, pRowOut, uiStride);
+
+            for (; bx < uiBlocksX; bx++)
+            {
+                BlockSource source;
+                PrepareBlock(pRowBlocks + bx * format.uiBlockSize, format, source);
+
+                uint32 uiColumns = std::min(4u, uiWidth - bx * 4);
+                bool bFullBlock = uiRows == 4 && uiColumns == 4;
+                uint8_t* pOut = bFullBlock ? pRowOut + bx * 16 : edgeBlock;
+                size_t uiOutStride = bFullBlock ? uiStride : 16;
+                if (ePath == SIMD::Path::Scalar)
+                    DecodeBlockScalar(source, params, bReconstructZ, pOut, uiOutStride);
+                else
+                    DecodeBlockSSE2(source, params, bReconstructZ, pOut, uiOutStride);
+
+                if (!bFullBlock)
+                {
+                    for (uint32 r = 0; r < uiRows; r++)
+                        memcpy(pRowOut + r * uiStride + bx * 16, edgeBlock + r * 16, uiColumns * 4);
+                }
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decode(const char* pBlocks, size_t uiSize, uint32 uiWidth, uint32 uiHeight, const DecodeParams& params, uint8_t* pRGBA)
+    {
+        return Decode(pBlocks, uiSize, uiWidth, uiHeight, params, pRGBA, SIMD::GetFastestPath());
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ReferenceColorTexel(const uint8_t* pBlock, uint32 uiTexel, bool bBC1, int rgba[4])
+    {
+        uint32 uiColor0 = pBlock[0] | (pBlock[1] << 8);
+        uint32 uiColor1 = pBlock[2] | (pBlock[3] << 8);
+        uint32 uiIndex = (pBlock[4 + uiTexel / 4] >> (2 * (uiTexel % 4))) & 3;
+
+        int color0[3], color1[3];
+        ExpandColor(uiColor0, color0);
+        ExpandColor(uiColor1, color1);
+        bool bFourColors = !bBC1 || uiColor0 > uiColor1;
+        for (uint32 c = 0; c < 3; c++)
+        {
+            switch (uiIndex)
+            {
+            case 0:  rgba[c] = color0[c]; break;
+            case 1:  rgba[c] = color1[c]; break;
+            case 2:  rgba[c] = bFourColors ? (2 * color0[c] + color1[c]) / 3 : (color0[c] + color1[c]) / 2; break;
+            default: rgba[c] = bFourColors ? (color0[c] + 2 * color1[c]) / 3 : 0; break;
+            }
+        }
+        rgba[3] = !bFourColors && uiIndex == 3 ? 0 : 255;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static int ReferenceChannelTexel(const uint8_t* pBlock, uint32 uiTexel, bool bSigned)
+    {
+        int a0 = bSigned ? static_cast<int8_t>(pBlock[0]) : pBlock[0];
+        int a1 = bSigned ? static_cast<int8_t>(pBlock[1]) : pBlock[1];
+        if (bSigned)
+        {
+            a0 = std::max(a0, -127);
+            a1 = std::max(a1, -127);
+        }
+
+        uint32 uiBit = 3 * uiTexel;
+        uint32 uiPair = pBlock[2 + uiBit / 8] | (uiBit / 8 + 3 < 8 ? pBlock[3 + uiBit / 8] << 8 : 0);
+        int iIndex = (uiPair >> (uiBit % 8)) & 7;
+
+        int iValue;
+        if (iIndex == 0)
+            iValue = a0;
+        else if (iIndex == 1)
+            iValue = a1;
+        else if (a0 > a1)
+            iValue = ((8 - iIndex) * a0 + (iIndex - 1) * a1) / 7;
+        else if (iIndex < 6)
+            iValue = ((6 - iIndex) * a0 + (iIndex - 1) * a1) / 5;
+        else if (iIndex == 6)
+            iValue = bSigned ? -127 : 0;
+        else
+            iValue = bSigned ? 127 : 255;
+        return bSigned ? iValue + 128 : iValue;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool DecodeReference(const char* pBlocks, size_t uiSize, uint32 uiWidth, uint32 uiHeight, const DecodeParams& params, uint8_t* pRGBA)
+    {
+        FormatInfo format;
+        if (!CheckParams(uiSize, uiWidth, uiHeight, params, format))
+            return false;
+
+        uint32 uiBlocksX = (uiWidth + 3) / 4;
+        int iZero = format.bSigned ? 128 : 0;
+        for (uint32 y = 0; y < uiHeight; y++)
+        {
+            for (uint32 x = 0; x < uiWidth; x++)
+            {
+                const uint8_t* pBlock = reinterpret_cast<const uint8_t*>(pBlocks) + (static_cast<size_t>(y / 4) * uiBlocksX + x / 4) * format.uiBlockSize;
+                uint32 uiTexel = (y % 4) * 4 + x % 4;
+
+                int rgba[4] = { iZero, iZero, iZero, 255 };
+                switch (format.eFormat)
+                {
+                case eBC1:
+                    ReferenceColorTexel(pBlock, uiTexel, true, rgba);
+                    break;
+                case eBC2:
+                    ReferenceColorTexel(pBlock + 8, uiTexel, false, rgba);
+                    rgba[3] = ((pBlock[uiTexel / 2] >> (4 * (uiTexel % 2))) & 0xF) * 17;
+                    break;
+                case eBC3:
+                    ReferenceColorTexel(pBlock + 8, uiTexel, false, rgba);
+                    rgba[3] = ReferenceChannelTexel(pBlock, uiTexel, false);
+                    break;
+                case eBC4:
+                    rgba[0] = ReferenceChannelTexel(pBlock, uiTexel, format.bSigned);
+                    break;
+                case eBC5:
+                    rgba[0] = ReferenceChannelTexel(pBlock, uiTexel, format.bSigned);
+                    rgba[1] = ReferenceChannelTexel(pBlock + 8, uiTexel, format.bSigned);
+                    if (params.bReconstructZ)
+                        rgba[2] = ReconstructZ(static_cast<uint8_t>(rgba[0]), static_cast<uint8_t>(rgba[1]));
+                    break;
+                }
+
+                int values[6] = { rgba[0], rgba[1], rgba[2], rgba[3], 0, 255 };
+                uint8_t* pTexel = pRGBA + (static_cast<size_t>(y) * uiWidth + x) * 4;
+                for (uint32 c = 0; c < 4; c++)
+                    pTexel[c] = static_cast<uint8_t>(values[params.compSel[c]]);
+            }
+        }
+        return true;
+    }
+
+}
@@ -3,6 +3,13 @@
 #include "MyFBXCube.h"
 #include "FBXWriter.h"
 #include "XmlParser.h"
+#include "MedianBinary.h"
+#include "BFRESReader.h"
+#include "ParseCache.h"
+#include "AllocationStats.h"
+#include "Benchmark.h"
+#include "SARC.h"
+#include "DDS.h"
 #include "BFRES.h"
 #include <windows.h>
 #include "Globals.h"
@@ -82,6 +89,26 @@ bool SaveDocument(FbxManager* pManager, FbxDocument* pDocument, const char* pFil
 
 
 
+// Parse the dump one model at a time instead of building the whole BFRES tree first
+static bool g_bStreamingExport = false;
+
+// Keep the parsed dump next to the exports and reuse it while the dump doesn't change
+static bool g_bUseParseCache = false;
+
+// Only write the animation fbx, the models are neither exported nor parsed past their skeletons
+static bool g_bAnimationOnly = false;
+
+// Convert the scene to meters using the defined options.
+static const FbxSystemUnit::ConversionOptions s_ConversionOptions = {
+    false, /* mConvertRrsNodes */
+    true, /* mConvertLimits */
+    true, /* mConvertClusters */
+    true, /* mConvertLightIntensity */
+    true, /* mConvertPhotometricLProperties */
+    true  /* mConvertCameraClipPlanes */
+  };
+
+
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
 // Parse any flags after the initial mandatory arguments
@@ -89,6 +116,89 @@ void ParseArguments( int argc, char**& argv )
 {
     FBXWriter::g_bWriteTextures = true;
     medianFilePath.assign( argv[ 1 ] );
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0)
+            g_bStreamingExport = true;
+        else if (strcmp(argv[i], "-c") == 0)
+            g_bUseParseCache = true;
+        else if (strcmp(argv[i], "-a") == 0)
+            g_bAnimationOnly = true;
+        else if (strcmp(argv[i], "-dds") == 0)
+            FBXWriter::g_bDDSTextures = true;
+    }
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+FbxScene* BeginScene(FbxManager* pManager)
+{
+    FbxScene* pScene = FbxScene::Create(pManager, "Scene lame");
+    FbxSystemUnit::m.ConvertScene( pScene, s_ConversionOptions );
+
+    FBXWriter::g_MaterialMap.clear();
+    FBXWriter::g_TextureMap.clear();
+    return pScene;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void EndScene(FbxManager* pManager, FbxScene* pScene, const std::string& filePath)
+{
+    FbxSystemUnit::cm.ConvertScene( pScene, s_ConversionOptions );
+    SaveDocument(pManager, pScene, filePath.c_str());
+
+    // The scene is written, free it before the next model is read
+    pScene->Destroy();
+    FBXWriter::g_MaterialMap.clear();
+    FBXWriter::g_TextureMap.clear();
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// gameknife, we should export one fbx per model
+void ExportModel(FbxManager* pManager, const FMDL& fmdl)
+{
+    FbxScene* pScene = BeginScene(pManager);
+
+    FBXWriter fbx;
+    fbx.WriteModel(pScene, fmdl, false);
+
+    EndScene(pManager, pScene, fbxExportPath + fmdl.name.c_str() + ".fbx");
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Writes the textures of a .bfres as .dds into Textures/, deswizzled but otherwise as the file holds them
+void ExportTextures(const std::string& filePath)
+{
+    // A .Tex2 only has the mips, they are written with the .Tex1
+    if (WiiU::GetTexturePart(filePath.c_str()) == WiiU::TexturePart::Tex2)
+        return;
+
+    std::vector<FTEX> textures;
+    if (!WiiU::BFRESReader::ReadTexturesWithMips(filePath.c_str(), textures))
+        printf("[DDS] %s: not every texture could be read\n", filePath.c_str());
+    if (textures.empty())
+        return;
+
+    std::string textureDir = fbxExportPath + "Textures/";
+    if (!CreateDirectoryA(textureDir.c_str(), NULL) && ERROR_ALREADY_EXISTS != GetLastError())
+        assert(0 && "Failed to create directory.");
+
+    for (const FTEX& texture : textures)
+    {
+        if (!DDS::Write((textureDir + texture.name + ".dds").c_str(), texture))
+        {
+            printf("[DDS] %s: format 0x%X or dimension %u can't be written\n", texture.name.c_str(), texture.format, texture.dim);
+            FBXWriter::g_RejectedDDSTextures.insert(texture.name);
+        }
+    }
 }
 
 
@@ -96,15 +206,25 @@ void ParseArguments( int argc, char**& argv )
 // -----------------------------------------------------------------------
 int main( int argc, char* argv[] )
 {
+    // FBXExporter.exe -bench <name> <files>... measures instead of exporting, see Benchmark.h
+    if (argc > 1 && strcmp(argv[1], "-bench") == 0)
+        return Benchmark::Run(argc - 2, argv + 2);
+
+    // FBXExporter.exe -list <archives>... prints the .sbfres inside them as paths the exporter reads directly
+    if (argc > 1 && strcmp(argv[1], "-list") == 0)
+    {
+        std::vector<std::string> archivePaths(argv + 2, argv + argc);
+        for (const std::string& entryPath : SARC::FindEntries(archivePaths, ".sbfres"))
+            printf("%s\n", entryPath.c_str());
+        return 0;
+    }
+
     // If there are no arguments, assume this is debugging and use the debugging filepath
     ParseArguments( argc, argv );
 
 	uint32 lastIndex = medianFilePath.find_last_of(".");
     uint32 lastSlashIndex = medianFilePath.find_last_of("\\");
     std::string fileName = medianFilePath.substr(lastSlashIndex + 1, lastIndex - lastSlashIndex - 1);
-    
-    BFRESStructs::BFRES* bfres = g_BFRESManager.GetBFRES();
-    XML::XmlParser::Parse(medianFilePath.c_str(), *bfres);
 
     FbxManager* lSdkManager = FbxManager::Create();
     
@@ -123,71 +243,143 @@ int main( int argc, char* argv[] )
             assert(0 && "Failed to create directory.");
     }
 
-    // gameknife, we should export one fbx per model
-    
-    //fbx->CreateFBX( pScene, *bfres );
+    // this name will import as asset name prefix to ue, so we should care about it
+    // some animation may comes from mdl file, filename without Animation, add it
+    std::string animationFbxPath = fileName;
+    if( animationFbxPath.find("_Animation") == std::string::npos )
+    {
+        animationFbxPath += "_Mdl_Animation";
+    }
+    animationFbxPath = fbxExportPath + animationFbxPath;
 
-    // Convert the scene to meters using the defined options.
-    const FbxSystemUnit::ConversionOptions lConversionOptions = {
-        false, /* mConvertRrsNodes */
-        true, /* mConvertLimits */
-        true, /* mConvertClusters */
-        true, /* mConvertLightIntensity */
-        true, /* mConvertPhotometricLProperties */
-        true  /* mConvertCameraClipPlanes */
-      };
-    
-    for (uint32 i = 0; i < bfres->fmdl.size(); i++)
+    // A binary dump already loads in place and a .bfres is read directly, caching either would only copy it
+    bool bBFRES = WiiU::BFRESReader::IsBFRES(medianFilePath.c_str());
+    bool bBinaryMedian = MedianBinary::BinaryParser::IsBinaryMedian(medianFilePath.c_str());
+    bool bUseParseCache = g_bUseParseCache && !bBinaryMedian && !bBFRES;
+    ParseCache parseCache(medianFilePath, fbxExportPath + fileName + ".cache.mbin");
+
+    // Parse no more than the exports below read
+    ParseProfile eProfile = g_bAnimationOnly ? ParseProfile::SkeletonOnly : ParseProfile::GeometryMinimal;
+
+    // Textures are written apart from the scenes, a BotW .Tex1 has nothing else in it. Only a .bfres has them, the
+    // materials of a median dump keep pointing at the importer's .tga.
+    if (FBXWriter::g_bDDSTextures && !bBFRES)
     {
-        FbxScene* pScene = FbxScene::Create(lSdkManager, "Scene lame");
-        FbxSystemUnit::m.ConvertScene( pScene, lConversionOptions );
+        printf("[DDS] -dds ignored, %s is not a .bfres\n", medianFilePath.c_str());
+        FBXWriter::g_bDDSTextures = false;
+    }
+    if (FBXWriter::g_bDDSTextures)
+        ExportTextures(medianFilePath);
 
-        FBXWriter::g_MaterialMap.clear();
-        FBXWriter::g_TextureMap.clear();
-        
-        FBXWriter* fbx = new FBXWriter();
-        fbx->WriteModel(pScene, bfres->fmdl[i], i, false);
-        
-        FbxSystemUnit::cm.ConvertScene( pScene, lConversionOptions );
-        string SingleFbxPath = fbxExportPath + bfres->fmdl[i].name + ".fbx";
-        SaveDocument(lSdkManager, pScene, SingleFbxPath.c_str());
+    if (g_bStreamingExport)
+    {
+        // Only the skeletons are kept around, the animation scene needs them once the anims start
+        std::vector<FMDL> skeletons;
+        FbxScene* pAnimScene = NULL;
+        FBXWriter animFbx;
+
+        auto onModel = [&](FMDL& fmdl)
+        {
+            if (!g_bAnimationOnly)
+                ExportModel(lSdkManager, fmdl);
+
+            FMDL skeleton;
+            skeleton.name = fmdl.name;
+            skeleton.index = fmdl.index;
+            skeleton.fskl = std::move(fmdl.fskl);
+            skeletons.push_back(std::move(skeleton));
+        };
+        auto onAnim = [&](Anim& anim)
+        {
+            if (!pAnimScene)
+            {
+                pAnimScene = BeginScene(lSdkManager);
+
+                // skeleton should write
+                for (const FMDL& skeleton : skeletons)
+                    animFbx.WriteModel(pAnimScene, skeleton, true);
+            }
+            animFbx.WriteAnimations(pAnimScene, anim);
+        };
+
+        if (bBFRES)
+            WiiU::BFRESReader::ParseStreaming(medianFilePath.c_str(), onModel, onAnim, eProfile);
+        else if (bBinaryMedian)
+            MedianBinary::BinaryParser::ParseStreaming(medianFilePath.c_str(), onModel, onAnim, eProfile);
+        else if (!bUseParseCache)
+            XML::XmlParser::ParseStreaming(medianFilePath.c_str(), onModel, onAnim, eProfile);
+        else if (!parseCache.LoadStreaming(onModel, onAnim, eProfile))
+        {
+            // Stored before the callbacks get to move from them
+            parseCache.BeginStore(eProfile);
+            XML::XmlParser::ParseStreaming(medianFilePath.c_str(),
+                [&](FMDL& fmdl) { parseCache.StoreModel(fmdl); onModel(fmdl); },
+                [&](Anim& anim) { parseCache.StoreAnim(anim); onAnim(anim); },
+                eProfile);
+            parseCache.EndStore();
+        }
+
+        if (bUseParseCache)
+            parseCache.PrintStats();
+
+        if (pAnimScene)
+            EndScene(lSdkManager, pAnimScene, animationFbxPath);
+
+        return 0;
     }
 
-    if(bfres->fska.anims.size() > 0)
+    BFRESStructs::BFRES* bfres = g_BFRESManager.GetBFRES();
+    AllocationStats::Counters parseAllocations = AllocationStats::Get();
+    if (bBFRES)
+        WiiU::BFRESReader::Parse(medianFilePath.c_str(), *bfres, eProfile);
+    else if (bBinaryMedian)
+        MedianBinary::BinaryParser::Parse(medianFilePath.c_str(), *bfres, eProfile);
+    else if (!bUseParseCache)
+        XML::XmlParser::Parse(medianFilePath.c_str(), *bfres, eProfile);
+    else if (!parseCache.Load(*bfres, eProfile))
     {
-        FbxScene* pScene = FbxScene::Create(lSdkManager, "Scene lame");
-        FbxSystemUnit::m.ConvertScene( pScene, lConversionOptions );
+        XML::XmlParser::Parse(medianFilePath.c_str(), *bfres, eProfile);
+        parseCache.Store(*bfres, eProfile);
+    }
 
-        FBXWriter::g_MaterialMap.clear();
-        FBXWriter::g_TextureMap.clear();
-        
-        FBXWriter* fbx = new FBXWriter();
+    if (bUseParseCache)
+        parseCache.PrintStats();
+
+    if (AllocationStats::IsEnabled())
+    {
+        size_t uiShapeCount = 0;
+        for (const FMDL& fmdl : bfres->fmdl)
+            uiShapeCount += fmdl.fshps.size();
+        AllocationStats::Print("Parse", parseAllocations, uiShapeCount);
+        bfres->arena.Print("Parse");
+    }
+
+    //fbx->CreateFBX( pScene, *bfres );
+
+    for (uint32 i = 0; i < bfres->fmdl.size() && !g_bAnimationOnly; i++)
+    {
+        ExportModel(lSdkManager, bfres->fmdl[i]);
+    }
+
+    if(bfres->fska.anims.size() > 0)
+    {
+        FbxScene* pScene = BeginScene(lSdkManager);
+        FBXWriter fbx;
 
         // skeleton should write
         for (uint32 i = 0; i < bfres->fmdl.size(); i++)
         {
-            fbx->WriteModel(pScene, bfres->fmdl[i], i, true);
+            fbx.WriteModel(pScene, bfres->fmdl[i], true);
         }
         
         for (const Anim& anim : bfres->fska.anims)
         {
-            fbx->WriteAnimations(pScene, anim);
+            fbx.WriteAnimations(pScene, anim);
         }
 
-        FbxSystemUnit::cm.ConvertScene( pScene, lConversionOptions );
-        // this name will import as asset name prefix to ue, so we should care about it
-
-        // some animation may comes from mdl file, filename without Animation, add it
-        
-        if( fileName.find("_Animation") == std::string::npos )
-        {
-            fileName += "_Mdl_Animation";
-        }
         //string SingleFbxPath = fbxExportPath + bfres->fska.anims[0].m_szName + "_Animation";
-        string SingleFbxPath = fbxExportPath + fileName;
-        SaveDocument(lSdkManager, pScene, SingleFbxPath.c_str());
+        EndScene(lSdkManager, pScene, animationFbxPath);
     }
 
     return 0;
 }
-
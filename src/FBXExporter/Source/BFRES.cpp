@@ -1,6 +1,67 @@
 #include "BFRES.h"
+#include <string.h>
 
 namespace BFRESStructs
 {
     BFRESManager g_BFRESManager;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void VertexStreams::Add(Stream eStream)
+    {
+        presence |= 1u << eStream;
+        switch (eStream)
+        {
+        case ePosition0:    position0.assign(count, { 0, 0, 0 }); break;
+        case ePosition1:    position1.assign(count, { 0, 0, 0 }); break;
+        case ePosition2:    position2.assign(count, { 0, 0, 0 }); break;
+        case eNormal:       normal.assign(count, { 0, 0, 0 }); break;
+        case eUV0:          uv0.assign(count, { 0, 0 }); break;
+        case eUV1:          uv1.assign(count, { 0, 0 }); break;
+        case eUV2:          uv2.assign(count, { 0, 0 }); break;
+        case eColor0:       color0.assign(count, Math::vector4F(1, 1, 1, 1)); break;
+        case eColor1:       color1.assign(count, Math::vector4F(1, 1, 1, 1)); break;
+        case eTangent:      tangent.assign(count, Math::vector4F(0, 0, 0, 0)); break;
+        case eBinormal:     binormal.assign(count, Math::vector4F(0, 0, 0, 0)); break;
+        case eBlendWeights: blendWeights.assign(count, Math::vector4F(1, 0, 0, 0)); break;
+        case eBlendIndex:   blendIndex.assign(count, { 0, 0, 0, 0 }); break;
+        default:            break;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <typename T>
+    static void DropIfDefault(VertexStreams& vertices, VertexStreams::Stream eStream, pmr::vector<T>& stream, const T& defaultValue)
+    {
+        for (const T& value : stream)
+        {
+            if (memcmp(&value, &defaultValue, sizeof(T)) != 0)
+                return;
+        }
+        stream.clear();
+        stream.shrink_to_fit();
+        vertices.presence &= ~(1u << eStream);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void VertexStreams::DropDefaultStreams()
+    {
+        DropIfDefault(*this, ePosition1,    position1,    Math::vector3F{ 0, 0, 0 });
+        DropIfDefault(*this, ePosition2,    position2,    Math::vector3F{ 0, 0, 0 });
+        DropIfDefault(*this, eNormal,       normal,       Math::vector3F{ 0, 0, 0 });
+        DropIfDefault(*this, eUV0,          uv0,          Math::vector2F{ 0, 0 });
+        DropIfDefault(*this, eUV1,          uv1,          Math::vector2F{ 0, 0 });
+        DropIfDefault(*this, eUV2,          uv2,          Math::vector2F{ 0, 0 });
+        DropIfDefault(*this, eColor0,       color0,       Math::vector4F(1, 1, 1, 1));
+        DropIfDefault(*this, eColor1,       color1,       Math::vector4F(1, 1, 1, 1));
+        DropIfDefault(*this, eTangent,      tangent,      Math::vector4F(0, 0, 0, 0));
+        DropIfDefault(*this, eBinormal,     binormal,     Math::vector4F(0, 0, 0, 0));
+        DropIfDefault(*this, eBlendWeights, blendWeights, Math::vector4F(1, 0, 0, 0));
+        DropIfDefault(*this, eBlendIndex,   blendIndex,   Math::vector4{ 0, 0, 0, 0 });
+    }
 }
\ No newline at end of file
@@ -0,0 +1,1403 @@
+#include "BFRESReader.h"
+#include "ThreadPool.h"
+#include "Yaz0.h"
+#include "SARC.h"
+#include "AnimCurve.h"
+#include "IndexBuffer.h"
+#include "VertexAttrib.h"
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+#include <unordered_map>
+#include <algorithm>
+
+namespace WiiU
+{
+
+    // Offsets of the fields read from each section, relative to the start of the section
+    enum FRESLayout
+    {
+        eFRESMagic            = 0x00,
+        eFRESModelDict        = 0x20,
+        eFRESTextureDict      = 0x24,
+        eFRESSkeletalAnimDict = 0x28,
+        eFRESHeaderSize       = 0x6C
+    };
+
+    enum FMDLLayout
+    {
+        eFMDLName              = 4,
+        eFMDLSkeleton          = 12,
+        eFMDLVertexBuffers     = 16, // FVTX array
+        eFMDLShapeDict         = 20,
+        eFMDLMaterialDict      = 24,
+        eFMDLVertexBufferCount = 32, // uint16
+        eFMDLTotalVertexCount  = 40
+    };
+
+    enum FSKLLayout
+    {
+        eFSKLSmoothCount      = 10, // uint16
+        eFSKLRigidCount       = 12, // uint16
+        eFSKLBoneDict         = 16,
+        eFSKLMatrixToBoneList = 24  // uint16 per smooth, then rigid matrix
+    };
+
+    enum BoneLayout
+    {
+        eBoneName        = 0,
+        eBoneParent      = 6,  // uint16, 0xFFFF for roots
+        eBoneSmooth      = 8,  // int16
+        eBoneRigid       = 10, // int16
+        eBoneBillboard   = 12, // uint16
+        eBoneFlags       = 16,
+        eBoneScale       = 20,
+        eBoneRotation    = 32,
+        eBonePosition    = 48
+    };
+
+    enum FVTXLayout
+    {
+        eFVTXSize           = 32,
+        eFVTXAttribCount    = 4,  // uint8
+        eFVTXBufferCount    = 5,  // uint8
+        eFVTXVertexCount    = 8,
+        eFVTXAttribs        = 16, // VertexAttrib array
+        eFVTXBuffers        = 24  // Buffer array
+    };
+
+    enum VertexAttribLayout
+    {
+        eAttribSize        = 12,
+        eAttribName        = 0,
+        eAttribBufferIndex = 4, // uint8
+        eAttribOffset      = 6, // uint16
+        eAttribFormat      = 8
+    };
+
+    enum BufferLayout
+    {
+        eBufferSize     = 24,
+        eBufferDataSize = 4,
+        eBufferStride   = 12, // uint16
+        eBufferData     = 20
+    };
+
+    enum FSHPLayout
+    {
+        eFSHPName              = 4,
+        eFSHPFlags             = 8,
+        eFSHPMaterialIndex     = 14, // uint16
+        eFSHPBoneIndex         = 16, // uint16
+        eFSHPVertexBufferIndex = 18, // uint16
+        eFSHPSkinBoneCount     = 20, // uint16
+        eFSHPVertexSkinCount   = 22, // uint8
+        eFSHPMeshCount         = 23, // uint8
+        eFSHPTargetAttribCount = 25, // uint8
+        eFSHPRadius            = 28, // float per mesh
+        eFSHPMeshes            = 36, // Mesh array
+        eFSHPSkinBoneIndices   = 40  // uint16 array
+    };
+
+    enum MeshLayout
+    {
+        eMeshSize          = 28,
+        eMeshPrimitiveType = 0,
+        eMeshIndexFormat   = 4,
+        eMeshIndexCount    = 8,
+        eMeshSubMeshCount  = 12, // uint16
+        eMeshSubMeshes     = 16, // offset, count pairs
+        eMeshIndexBuffer   = 20, // Buffer
+        eMeshFirstVertex   = 24
+    };
+
+    enum FMATLayout
+    {
+        eFMATName          = 4,
+        eFMATFlags         = 8,
+        eFMATSamplerCount  = 16, // uint8
+        eFMATTextureCount  = 17, // uint8
+        eFMATShaderAssign  = 36,
+        eFMATTextureRefs   = 40, // name, texture offset pairs
+        eFMATSamplerDict   = 48
+    };
+
+    enum ShaderAssignLayout
+    {
+        eShaderAssignSamplerDict = 20 // string values
+    };
+
+    enum FTEXLayout
+    {
+        eFTEXHeaderSize    = 0xBC,
+        eFTEXDim           = 0x04,
+        eFTEXWidth         = 0x08,
+        eFTEXHeight        = 0x0C,
+        eFTEXDepth         = 0x10,
+        eFTEXMipCount      = 0x14,
+        eFTEXFormat        = 0x18,
+        eFTEXAA            = 0x1C,
+        eFTEXUse           = 0x20,
+        eFTEXImageSize     = 0x24,
+        eFTEXMipSize       = 0x2C,
+        eFTEXTileMode      = 0x34,
+        eFTEXSwizzle       = 0x38,
+        eFTEXPitch         = 0x40,
+        eFTEXMipOffsets    = 0x44, // uint32 per level from 1
+        eFTEXCompSel       = 0x88, // uint8 per channel
+        eFTEXName          = 0xA8,
+        eFTEXData          = 0xB0,
+        eFTEXMipData       = 0xB4
+    };
+
+    enum FSKALayout
+    {
+        eFSKAName           = 4,
+        eFSKAFlags          = 12,
+        eFSKAFrameCount     = 16,
+        eFSKABoneAnimCount  = 20, // uint16
+        eFSKABoneAnims      = 32, // BoneAnim array
+        eFSKAUserDataDict   = 44
+    };
+
+    enum BoneAnimLayout
+    {
+        eBoneAnimSize       = 24,
+        eBoneAnimFlags      = 0,
+        eBoneAnimName       = 4,
+        eBoneAnimCurveCount = 10, // uint8
+        eBoneAnimCurves     = 16, // AnimCurve array
+        eBoneAnimBaseData   = 20
+    };
+
+    enum AnimCurveLayout
+    {
+        eCurveSize       = 36,
+        eCurveFlags      = 0, // uint16
+        eCurveKeyCount   = 2, // uint16
+        eCurveDataOffset = 4,
+        eCurveEndFrame   = 12,
+        eCurveScale      = 16,
+        eCurveOffset     = 20,
+        eCurveFrames     = 28,
+        eCurveKeys       = 32
+    };
+
+    enum UserDataLayout
+    {
+        eUserDataCount  = 4, // uint16
+        eUserDataType   = 6, // uint8
+        eUserDataValues = 8
+    };
+
+    // Flags
+    static const uint32 s_uiBoneFlagsVisible        = 1 << 0;
+    static const uint32 s_uiBoneFlagsRotationMask   = 0x7000;
+    static const uint32 s_uiBoneFlagsRotationEuler  = 0x1000;
+    static const uint32 s_uiAnimFlagsBaked          = 1 << 0;
+    static const uint32 s_uiAnimFlagsLooping        = 1 << 2;
+    static const uint32 s_uiAnimFlagsScaleMask      = 0x0300;
+    static const uint32 s_uiAnimFlagsRotateMask     = 0x7000;
+    static const uint32 s_uiAnimFlagsRotateEuler    = 0x1000;
+    static const uint32 s_uiBoneAnimBaseScale       = 1 << 3;
+    static const uint32 s_uiBoneAnimBaseRotate      = 1 << 4;
+    static const uint32 s_uiBoneAnimBaseTranslate   = 1 << 5;
+    static const uint32 s_uiBoneAnimSegmentScale    = 1 << 23;
+    static const uint32 s_uiMaterialFlagsVisible    = 1;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint8_t ResView::ReadU8(uint32 uiOffset) const
+    {
+        if (!IsInRange(uiOffset, 1))
+        {
+            Fail();
+            return 0;
+        }
+        return m_pData[uiOffset];
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint16 ResView::ReadU16(uint32 uiOffset) const
+    {
+        if (!IsInRange(uiOffset, 2))
+        {
+            Fail();
+            return 0;
+        }
+        const uint8_t* p = m_pData + uiOffset;
+        return static_cast<uint16>((p[0] << 8) | p[1]);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint32 ResView::ReadU32(uint32 uiOffset) const
+    {
+        if (!IsInRange(uiOffset, 4))
+        {
+            Fail();
+            return 0;
+        }
+        const uint8_t* p = m_pData + uiOffset;
+        return (static_cast<uint32>(p[0]) << 24) | (static_cast<uint32>(p[1]) << 16) | (static_cast<uint32>(p[2]) << 8) | p[3];
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    float ResView::ReadF32(uint32 uiOffset) const
+    {
+        uint32 uiBits = ReadU32(uiOffset);
+        float fValue;
+        memcpy(&fValue, &uiBits, sizeof(fValue));
+        return fValue;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint32 ResView::ReadOffset(uint32 uiOffset) const
+    {
+        int32 iRelative = ReadS32(uiOffset);
+        if (iRelative == 0)
+            return 0;
+
+        int64_t iTarget = static_cast<int64_t>(uiOffset) + iRelative;
+        if (iTarget <= 0 || iTarget >= static_cast<int64_t>(m_uiSize))
+        {
+            Fail();
+            return 0;
+        }
+        return static_cast<uint32>(iTarget);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    std::string_view ResView::ReadString(uint32 uiOffset) const
+    {
+        return ReadStringAt(ReadOffset(uiOffset));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    std::string_view ResView::ReadStringAt(uint32 uiChars) const
+    {
+        if (uiChars == 0)
+            return std::string_view();
+
+        // Strings are zero terminated, the terminator has to be inside the file as well
+        const uint8_t* pEnd = IsInRange(uiChars, 1) ? static_cast<const uint8_t*>(memchr(m_pData + uiChars, 0, m_uiSize - uiChars)) : nullptr;
+        if (!pEnd)
+        {
+            Fail();
+            return std::string_view();
+        }
+        return std::string_view(reinterpret_cast<const char*>(m_pData + uiChars), pEnd - (m_pData + uiChars));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void ResView::Fail() const
+    {
+        m_bFailed = true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    std::vector<DictEntry> ReadDict(const ResView& view, uint32 uiDict)
+    {
+        std::vector<DictEntry> entries;
+        if (uiDict == 0)
+            return entries;
+
+        // size, node count, then the root node and one 16 byte node per entry
+        int32 iCount = view.ReadS32(uiDict + 4);
+        if (iCount < 0 || !view.IsInRange(uiDict + 8, (static_cast<size_t>(iCount) + 1) * 16))
+        {
+            view.Fail();
+            return entries;
+        }
+
+        entries.resize(iCount);
+        for (int32 i = 0; i < iCount; i++)
+        {
+            uint32 uiNode = uiDict + 8 + (i + 1) * 16;
+            entries[i].name   = view.ReadString(uiNode + 8);
+            entries[i].uiData = view.ReadOffset(uiNode + 12);
+        }
+        return entries;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    TexturePart GetTexturePart(const char* filePath)
+    {
+        if (strstr(filePath, ".Tex1."))
+            return TexturePart::Tex1;
+        if (strstr(filePath, ".Tex2."))
+            return TexturePart::Tex2;
+        return TexturePart::Whole;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    std::vector<TextureSurface> ReadTextureSurfaces(const ResView& view, TexturePart ePart)
+    {
+        std::vector<DictEntry> textures = ReadDict(view, view.ReadOffset(eFRESTextureDict));
+        std::vector<TextureSurface> surfaces(textures.size());
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            uint32 uiTexture = textures[i].uiData;
+            TextureSurface& texture = surfaces[i];
+            GX2::Surface& surface = texture.surface;
+            if (!view.IsInRange(uiTexture, eFTEXHeaderSize))
+            {
+                view.Fail();
+                return std::vector<TextureSurface>();
+            }
+
+            texture.name = view.ReadString(uiTexture + eFTEXName);
+            for (uint32 c = 0; c < 4; c++)
+                texture.compSel[c] = view.ReadU8(uiTexture + eFTEXCompSel + c);
+
+            surface.dim = view.ReadU32(uiTexture + eFTEXDim);
+            surface.width = view.ReadU32(uiTexture + eFTEXWidth);
+            surface.height = view.ReadU32(uiTexture + eFTEXHeight);
+            surface.depth = view.ReadU32(uiTexture + eFTEXDepth);
+            surface.numMips = view.ReadU32(uiTexture + eFTEXMipCount);
+            surface.format = view.ReadU32(uiTexture + eFTEXFormat);
+            surface.aa = view.ReadU32(uiTexture + eFTEXAA);
+            surface.use = view.ReadU32(uiTexture + eFTEXUse);
+            surface.tileMode = view.ReadU32(uiTexture + eFTEXTileMode);
+            surface.swizzle = view.ReadU32(uiTexture + eFTEXSwizzle);
+            surface.pitch = view.ReadU32(uiTexture + eFTEXPitch);
+            for (uint32 m = 0; m < GX2::s_uiMaxMipOffsets; m++)
+                surface.mipOffsets[m] = view.ReadU32(uiTexture + eFTEXMipOffsets + m * 4);
+
+            // A .Tex1 keeps the mip offset, pointing at whatever follows the image; a .Tex2 stores its mips where
+            // the image would be. Data outside of the file is left out, as if the texture had none.
+            uint32 uiImage = ePart != TexturePart::Tex2 ? view.ReadOffset(uiTexture + eFTEXData) : 0;
+            uint32 uiMips = ePart == TexturePart::Tex2 ? view.ReadOffset(uiTexture + eFTEXData) : ePart == TexturePart::Tex1 ? 0 : view.ReadOffset(uiTexture + eFTEXMipData);
+            surface.uiImageSize = view.ReadU32(uiTexture + eFTEXImageSize);
+            surface.uiMipSize = view.ReadU32(uiTexture + eFTEXMipSize);
+            surface.pImage = uiImage && view.IsInRange(uiImage, surface.uiImageSize) ? view.GetData(uiImage) : nullptr;
+            surface.pMips = uiMips && view.IsInRange(uiMips, surface.uiMipSize) ? view.GetData(uiMips) : nullptr;
+        }
+        return surfaces;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Matrix helpers, following the OpenTK conventions the importer transforms with
+    struct Quaternion
+    {
+        float X, Y, Z, W;
+    };
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Math::matrix4F IdentityMatrix()
+    {
+        Math::matrix4F result = {};
+        result.M[0][0] = result.M[1][1] = result.M[2][2] = result.M[3][3] = 1.0f;
+        return result;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Math::matrix4F Multiply(const Math::matrix4F& lhs, const Math::matrix4F& rhs)
+    {
+        Math::matrix4F result;
+        for (int i = 0; i < 4; i++)
+        {
+            for (int j = 0; j < 4; j++)
+                result.M[i][j] = lhs.M[i][0] * rhs.M[0][j] + lhs.M[i][1] * rhs.M[1][j] + lhs.M[i][2] * rhs.M[2][j] + lhs.M[i][3] * rhs.M[3][j];
+        }
+        return result;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Math::matrix4F ScaleMatrix(float fX, float fY, float fZ)
+    {
+        Math::matrix4F result = IdentityMatrix();
+        result.M[0][0] = fX;
+        result.M[1][1] = fY;
+        result.M[2][2] = fZ;
+        return result;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Math::matrix4F TranslationMatrix(const Math::vector3F& position)
+    {
+        Math::matrix4F result = IdentityMatrix();
+        result.M[3][0] = position.X;
+        result.M[3][1] = position.Y;
+        result.M[3][2] = position.Z;
+        return result;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Rotation of the normalized quaternion
+    static Math::matrix4F RotationMatrix(const Quaternion& q)
+    {
+        float fLengthSquared = q.X * q.X + q.Y * q.Y + q.Z * q.Z + q.W * q.W;
+        if (fLengthSquared == 0.0f)
+            return IdentityMatrix();
+
+        float s = 2.0f / fLengthSquared;
+        float xx = q.X * q.X * s, yy = q.Y * q.Y * s, zz = q.Z * q.Z * s;
+        float xy = q.X * q.Y * s, xz = q.X * q.Z * s, yz = q.Y * q.Z * s;
+        float wx = q.W * q.X * s, wy = q.W * q.Y * s, wz = q.W * q.Z * s;
+
+        Math::matrix4F result = IdentityMatrix();
+        result.M[0][0] = 1.0f - (yy + zz); result.M[0][1] = xy + wz;          result.M[0][2] = xz - wy;
+        result.M[1][0] = xy - wz;          result.M[1][1] = 1.0f - (xx + zz); result.M[1][2] = yz + wx;
+        result.M[2][0] = xz + wy;          result.M[2][1] = yz - wx;          result.M[2][2] = 1.0f - (xx + yy);
+        return result;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Quaternion Multiply(const Quaternion& lhs, const Quaternion& rhs)
+    {
+        return
+        {
+            rhs.W * lhs.X + lhs.W * rhs.X + (lhs.Y * rhs.Z - lhs.Z * rhs.Y),
+            rhs.W * lhs.Y + lhs.W * rhs.Y + (lhs.Z * rhs.X - lhs.X * rhs.Z),
+            rhs.W * lhs.Z + lhs.W * rhs.Z + (lhs.X * rhs.Y - lhs.Y * rhs.X),
+            lhs.W * rhs.W - (lhs.X * rhs.X + lhs.Y * rhs.Y + lhs.Z * rhs.Z)
+        };
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Bone rotation as JPSkeleton builds it: Z * Y * X of the single axis rotations
+    static Quaternion BoneRotation(const Bone& bone)
+    {
+        if (bone.rotationType != Bone::RotationType::EulerXYZ)
+            return { bone.rotation.X, bone.rotation.Y, bone.rotation.Z, bone.rotation.W };
+
+        Quaternion x = { sinf(bone.rotation.X * 0.5f), 0, 0, cosf(bone.rotation.X * 0.5f) };
+        Quaternion y = { 0, sinf(bone.rotation.Y * 0.5f), 0, cosf(bone.rotation.Y * 0.5f) };
+        Quaternion z = { 0, 0, sinf(bone.rotation.Z * 0.5f), cosf(bone.rotation.Z * 0.5f) };
+        return Multiply(Multiply(z, y), x);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Bone rotation as the unskinned shapes build it, OpenTK's euler angle quaternion constructor
+    static Quaternion ShapeBoneRotation(const Bone& bone)
+    {
+        if (bone.rotationType != Bone::RotationType::EulerXYZ)
+            return { bone.rotation.X, bone.rotation.Y, bone.rotation.Z, bone.rotation.W };
+
+        float c1 = cosf(bone.rotation.X * 0.5f), s1 = sinf(bone.rotation.X * 0.5f);
+        float c2 = cosf(bone.rotation.Y * 0.5f), s2 = sinf(bone.rotation.Y * 0.5f);
+        float c3 = cosf(bone.rotation.Z * 0.5f), s3 = sinf(bone.rotation.Z * 0.5f);
+        return
+        {
+            s1 * c2 * c3 + c1 * s2 * s3,
+            c1 * s2 * c3 - s1 * c2 * s3,
+            c1 * c2 * s3 + s1 * s2 * c3,
+            c1 * c2 * c3 - s1 * s2 * s3
+        };
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Math::matrix4F LocalMatrix(const Bone& bone, const Quaternion& rotation)
+    {
+        return Multiply(Multiply(ScaleMatrix(bone.scale.X, bone.scale.Y, bone.scale.Z), RotationMatrix(rotation)), TranslationMatrix(bone.position));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Model space transform of every bone. Parents are resolved before their children, and the parent's scale
+    // is taken out again the way JPSkeleton always does (segment scale compensation). Bones that can't be
+    // reached from a root stay zero, same as there.
+    static std::vector<Math::matrix4F> ComputeBoneTransforms(const FSKL& fskl)
+    {
+        const std::pmr::vector<Bone>& bones = fskl.bones;
+        std::vector<Math::matrix4F> transforms(bones.size(), Math::matrix4F());
+
+        std::vector<uint32> pending;
+        for (uint32 i = 0; i < bones.size(); i++)
+        {
+            if (bones[i].parentIndex == -1)
+            {
+                transforms[i] = LocalMatrix(bones[i], BoneRotation(bones[i]));
+                pending.push_back(i);
+            }
+        }
+
+        for (size_t uiNext = 0; uiNext < pending.size(); uiNext++)
+        {
+            uint32 uiParent = pending[uiNext];
+            const Bone& parent = bones[uiParent];
+            for (uint32 i = 0; i < bones.size(); i++)
+            {
+                if (bones[i].parentIndex != static_cast<int32>(uiParent) || i == uiParent)
+                    continue;
+
+                Math::matrix4F transform = LocalMatrix(bones[i], BoneRotation(bones[i]));
+                transform = Multiply(transform, ScaleMatrix(1.0f / parent.scale.X, 1.0f / parent.scale.Y, 1.0f / parent.scale.Z));
+                transforms[i] = Multiply(transform, transforms[uiParent]);
+                pending.push_back(i);
+            }
+        }
+        return transforms;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Math::vector3F TransformPosition(const Math::vector3F& v, const Math::matrix4F& m)
+    {
+        return
+        {
+            v.X * m.M[0][0] + v.Y * m.M[1][0] + v.Z * m.M[2][0] + m.M[3][0],
+            v.X * m.M[0][1] + v.Y * m.M[1][1] + v.Z * m.M[2][1] + m.M[3][1],
+            v.X * m.M[0][2] + v.Y * m.M[1][2] + v.Z * m.M[2][2] + m.M[3][2]
+        };
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Transforms by the inverse transpose. Returns false, leaving the normal alone, for a singular matrix.
+    static bool TransformNormal(Math::vector3F& n, const Math::matrix4F& m)
+    {
+        float c00 = m.M[1][1] * m.M[2][2] - m.M[1][2] * m.M[2][1];
+        float c01 = m.M[1][2] * m.M[2][0] - m.M[1][0] * m.M[2][2];
+        float c02 = m.M[1][0] * m.M[2][1] - m.M[1][1] * m.M[2][0];
+        float fDeterminant = m.M[0][0] * c00 + m.M[0][1] * c01 + m.M[0][2] * c02;
+        if (fDeterminant == 0.0f)
+            return false;
+
+        // Rows of the inverse
+        float fInv = 1.0f / fDeterminant;
+        float i00 = c00 * fInv;
+        float i01 = (m.M[0][2] * m.M[2][1] - m.M[0][1] * m.M[2][2]) * fInv;
+        float i02 = (m.M[0][1] * m.M[1][2] - m.M[0][2] * m.M[1][1]) * fInv;
+        float i10 = c01 * fInv;
+        float i11 = (m.M[0][0] * m.M[2][2] - m.M[0][2] * m.M[2][0]) * fInv;
+        float i12 = (m.M[0][2] * m.M[1][0] - m.M[0][0] * m.M[1][2]) * fInv;
+        float i20 = c02 * fInv;
+        float i21 = (m.M[0][1] * m.M[2][0] - m.M[0][0] * m.M[2][1]) * fInv;
+        float i22 = (m.M[0][0] * m.M[1][1] - m.M[0][1] * m.M[1][0]) * fInv;
+
+        Math::vector3F result =
+        {
+            n.X * i00 + n.Y * i01 + n.Z * i02,
+            n.X * i10 + n.Y * i11 + n.Z * i12,
+            n.X * i20 + n.Y * i21 + n.Z * i22
+        };
+        n = result;
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Copies decoded values, uiComponents per vertex, into an attribute stream. Components the format doesn't
+    // have are zero, ones the stream doesn't have are dropped.
+    template <typename T>
+    static void CopyStream(const float* pValues, uint32 uiComponents, std::pmr::vector<T>& stream)
+    {
+        const uint32 uiStreamComponents = sizeof(T) / sizeof(float);
+        uint32 uiCopied = std::min(uiComponents, uiStreamComponents);
+        for (size_t i = 0; i < stream.size(); i++)
+        {
+            float element[4] = { 0, 0, 0, 0 };
+            memcpy(element, pValues + i * uiComponents, uiCopied * sizeof(float));
+            memcpy(&stream[i], element, sizeof(T));
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Moves shape vertices into model space like the importer does before dumping them. Rigid skinned
+    // vertices take the model space transform of their bone, unskinned shapes the local transform of theirs.
+    static void TransformVertices(const FSKL& fskl, const std::vector<Math::matrix4F>& boneTransforms, FSHP& fshp)
+    {
+        VertexStreams& vertices = fshp.vertices;
+        bool bHasNormals = vertices.Has(VertexStreams::eNormal);
+        if (fshp.vertexSkinCount == 1)
+        {
+            bool bHasBlendIndex = vertices.Has(VertexStreams::eBlendIndex);
+            for (uint32 i = 0; i < vertices.count; i++)
+            {
+                uint32 uiBone = fshp.boneIndex;
+                if (bHasBlendIndex)
+                    uiBone = vertices.blendIndex[i].X < fskl.boneList.size() ? fskl.boneList[vertices.blendIndex[i].X] : ~0u;
+
+                if (uiBone >= fskl.bones.size())
+                {
+                    assert(0 && "Rigid vertex bone out of range");
+                    continue;
+                }
+
+                // In game it seems to not transform if the bone is not rigid
+                if (fskl.bones[uiBone].rigidMatrixIndex != -1)
+                {
+                    vertices.position0[i] = TransformPosition(vertices.position0[i], boneTransforms[uiBone]);
+                    if (bHasNormals)
+                        TransformNormal(vertices.normal[i], boneTransforms[uiBone]);
+                }
+            }
+        }
+        else if (fshp.vertexSkinCount == 0 && !fskl.bones.empty() && fshp.boneIndex < fskl.bones.size())
+        {
+            const Bone& bone = fskl.bones[fshp.boneIndex];
+            Math::matrix4F transform = LocalMatrix(bone, ShapeBoneRotation(bone));
+            for (uint32 i = 0; i < vertices.count; i++)
+            {
+                vertices.position0[i] = TransformPosition(vertices.position0[i], transform);
+                if (bHasNormals)
+                    TransformNormal(vertices.normal[i], transform);
+            }
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool BFRESReader::IsBFRES(const char* filePath)
+    {
+        const char* szExtension = strrchr(filePath, '.');
+        return szExtension && (strcmp(szExtension, ".bfres") == 0 || strcmp(szExtension, ".sbfres") == 0);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool BFRESReader::OpenFile(const char* filePath, FileData& file)
+    {
+        // A file inside an archive is read in place from the archive
+        std::string archivePath, entryName;
+        if (SARC::SplitPath(filePath, archivePath, entryName))
+        {
+            const SARC::Archive::Entry* pEntry = file.archive.Open(archivePath.c_str()) ? file.archive.Find(entryName) : nullptr;
+            if (!pEntry)
+                return false;
+
+            file.pData = pEntry->pData;
+            file.uiSize = pEntry->uiSize;
+        }
+        else
+        {
+            if (!file.mappedFile.Open(filePath, false))
+                return false;
+
+            file.pData = file.mappedFile.GetData();
+            file.uiSize = file.mappedFile.GetSize();
+        }
+
+        // .sbfres is Yaz0 compressed, decompress it in one go into a buffer sized from its header
+        if (Yaz0::IsYaz0(file.pData, file.uiSize))
+        {
+            size_t uiSize = Yaz0::GetDecompressedSize(file.pData, file.uiSize);
+            file.pDecompressed.reset(new char[uiSize]);
+            if (!Yaz0::Decompress(file.pData, file.uiSize, file.pDecompressed.get(), uiSize))
+                return false;
+
+            file.mappedFile.Close();
+            file.pData = file.pDecompressed.get();
+            file.uiSize = uiSize;
+        }
+
+        ResView view(file.pData, file.uiSize);
+        return view.IsInRange(0, eFRESHeaderSize) && view.ReadU32(eFRESMagic) == s_uiFRESMagic;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::Parse(const char* filePath, BFRES& bfres, ParseProfile eProfile)
+    {
+        FileData file;
+        if (!OpenFile(filePath, file))
+        {
+            assert(0 && "Invalid Wii U BFRES file");
+            return;
+        }
+        ResView view(file.pData, file.uiSize);
+        Arena::Scope arenaScope(bfres.arena);
+
+        std::vector<DictEntry> models = ReadDict(view, view.ReadOffset(eFRESModelDict));
+        bfres.fmdl.resize(models.size());
+        ThreadPool::Get().ParallelFor(models.size(), [&](size_t i)
+        {
+            bfres.fmdl[i].index = static_cast<uint32>(i);
+            ParseFMDL(view, models[i].uiData, bfres.fmdl[i], eProfile);
+        });
+
+        std::vector<DictEntry> anims = ReadDict(view, view.ReadOffset(eFRESSkeletalAnimDict));
+        bfres.fska.anims.resize(anims.size());
+        ThreadPool::Get().ParallelFor(anims.size(), [&](size_t i)
+        {
+            ParseAnim(view, anims[i].uiData, bfres.fska.anims[i]);
+        });
+
+        if (view.HasFailed())
+            assert(0 && "Wii U BFRES file references data outside of it");
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::ParseStreaming(const char* filePath, const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile)
+    {
+        FileData file;
+        if (!OpenFile(filePath, file))
+        {
+            assert(0 && "Invalid Wii U BFRES file");
+            return;
+        }
+        ResView view(file.pData, file.uiSize);
+
+        uint32 fmdlIndex = 0;
+        for (const DictEntry& entry : ReadDict(view, view.ReadOffset(eFRESModelDict)))
+        {
+            FMDL fmdl = FMDL();
+            fmdl.index = fmdlIndex++;
+            ParseFMDL(view, entry.uiData, fmdl, eProfile);
+            onModel(fmdl);
+        }
+
+        for (const DictEntry& entry : ReadDict(view, view.ReadOffset(eFRESSkeletalAnimDict)))
+        {
+            Anim anim = Anim();
+            ParseAnim(view, entry.uiData, anim);
+            onAnim(anim);
+        }
+
+        if (view.HasFailed())
+            assert(0 && "Wii U BFRES file references data outside of it");
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool BFRESReader::ReadTextures(const char* filePath, std::vector<FTEX>& textures)
+    {
+        FileData file;
+        if (!OpenFile(filePath, file))
+            return false;
+        ResView view(file.pData, file.uiSize);
+
+        std::vector<TextureSurface> surfaces = ReadTextureSurfaces(view, GetTexturePart(filePath));
+        std::vector<const GX2::Surface*> pSurfaces(surfaces.size());
+        for (size_t i = 0; i < surfaces.size(); i++)
+            pSurfaces[i] = &surfaces[i].surface;
+
+        std::vector<std::vector<GX2::Image>> images;
+        bool bDeswizzled = GX2::DeswizzleSurfaces(pSurfaces, images);
+
+        textures.resize(surfaces.size());
+        for (size_t i = 0; i < surfaces.size(); i++)
+        {
+            const GX2::Surface& surface = surfaces[i].surface;
+            FTEX& ftex = textures[i];
+            ftex.name = surfaces[i].name;
+            ftex.format = surface.format;
+            ftex.dim = surface.dim;
+            ftex.width = surface.width;
+            ftex.height = surface.height;
+            ftex.depth = surface.depth;
+            ftex.mipCount = surface.numMips;
+            memcpy(ftex.compSel, surfaces[i].compSel, sizeof(ftex.compSel));
+            ftex.images = std::move(images[i]);
+        }
+        return bDeswizzled && !view.HasFailed();
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool BFRESReader::ReadTexturesWithMips(const char* filePath, std::vector<FTEX>& textures)
+    {
+        if (!ReadTextures(filePath, textures))
+            return false;
+        if (GetTexturePart(filePath) != TexturePart::Tex1)
+            return true;
+
+        std::string mipsPath = filePath;
+        mipsPath.replace(mipsPath.rfind(".Tex1."), 6, ".Tex2.");
+        std::vector<FTEX> mipTextures;
+        if (!ReadTextures(mipsPath.c_str(), mipTextures))
+            return true;
+
+        // Both parts hold the same textures, matched by name in case the order differs
+        std::unordered_map<std::string, FTEX*> texturesByName;
+        for (FTEX& texture : textures)
+            texturesByName[texture.name] = &texture;
+        for (FTEX& mipTexture : mipTextures)
+        {
+            auto it = texturesByName.find(mipTexture.name);
+            if (it == texturesByName.end())
+                continue;
+            for (GX2::Image& image : mipTexture.images)
+            {
+                if (image.uiLevel > 0)
+                    it->second->images.push_back(std::move(image));
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::ParseFMDL(const ResView& view, uint32 uiModel, FMDL& fmdl, ParseProfile eProfile)
+    {
+        fmdl.name = view.ReadString(uiModel + eFMDLName);
+        fmdl.totalVertices = static_cast<int>(view.ReadU32(uiModel + eFMDLTotalVertexCount));
+        fmdl.fvtxCount = view.ReadU16(uiModel + eFMDLVertexBufferCount);
+
+        ParseFSKL(view, view.ReadOffset(uiModel + eFMDLSkeleton), fmdl.fskl);
+
+        if (eProfile == ParseProfile::SkeletonOnly)
+            return;
+
+        // Parse Materials
+        std::vector<DictEntry> materials = ReadDict(view, view.ReadOffset(uiModel + eFMDLMaterialDict));
+        fmdl.fmatCount = static_cast<int>(materials.size());
+        fmdl.fmats.resize(materials.size());
+        for (uint32 i = 0; i < materials.size(); i++)
+            ParseFMAT(view, materials[i].uiData, fmdl.fmats[i]);
+
+        // Parse Shapes, every shape is independent
+        std::vector<Math::matrix4F> boneTransforms = ComputeBoneTransforms(fmdl.fskl);
+        uint32 uiVertexBuffers = view.ReadOffset(uiModel + eFMDLVertexBuffers);
+        if (!view.IsInRange(uiVertexBuffers, static_cast<size_t>(fmdl.fvtxCount) * eFVTXSize))
+            view.Fail();
+
+        std::vector<DictEntry> shapes = ReadDict(view, view.ReadOffset(uiModel + eFMDLShapeDict));
+        fmdl.fshpCount = static_cast<int>(shapes.size());
+        fmdl.fshps.resize(shapes.size());
+        ThreadPool::Get().ParallelFor(shapes.size(), [&](size_t i)
+        {
+            FSHP& fshp = fmdl.fshps[i];
+            fshp.modelIndex = fmdl.index;
+            ParseFSHP(view, shapes[i].uiData, uiVertexBuffers, fmdl.fskl, boneTransforms, fshp, eProfile);
+            if (fshp.vertexBufferIndex >= static_cast<uint32>(fmdl.fvtxCount))
+                view.Fail();
+        });
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::ParseFSKL(const ResView& view, uint32 uiSkeleton, FSKL& fskl)
+    {
+        if (uiSkeleton == 0)
+            return;
+
+        // Bone list, smooth matrices first, then rigid ones
+        uint32 uiMatrixCount = view.ReadU16(uiSkeleton + eFSKLSmoothCount) + view.ReadU16(uiSkeleton + eFSKLRigidCount);
+        uint32 uiBoneList = view.ReadOffset(uiSkeleton + eFSKLMatrixToBoneList);
+        if (uiBoneList == 0)
+            uiMatrixCount = 0;
+        fskl.boneCount = uiMatrixCount;
+        fskl.boneList.resize(uiMatrixCount);
+        for (uint32 i = 0; i < uiMatrixCount; i++)
+            fskl.boneList[i] = view.ReadU16(uiBoneList + 2 * i);
+
+        std::vector<DictEntry> bones = ReadDict(view, view.ReadOffset(uiSkeleton + eFSKLBoneDict));
+        fskl.bones.resize(bones.size());
+        for (uint32 i = 0; i < bones.size(); i++)
+        {
+            uint32 uiBone = bones[i].uiData;
+            Bone& bone = fskl.bones[i];
+            uint32 uiFlags = view.ReadU32(uiBone + eBoneFlags);
+            bone.name              = view.ReadString(uiBone + eBoneName);
+            bone.index             = i;
+            bone.isVisible         = (uiFlags & s_uiBoneFlagsVisible) != 0;
+            bone.rigidMatrixIndex  = view.ReadS16(uiBone + eBoneRigid);
+            bone.smoothMatrixIndex = view.ReadS16(uiBone + eBoneSmooth);
+            bone.billboardIndex    = view.ReadU16(uiBone + eBoneBillboard);
+            bone.useRigidMatrix    = bone.rigidMatrixIndex != -1;
+            bone.useSmoothMatrix   = bone.smoothMatrixIndex != -1;
+            bone.parentIndex       = view.ReadS16(uiBone + eBoneParent);
+            bone.rotationType      = (uiFlags & s_uiBoneFlagsRotationMask) == s_uiBoneFlagsRotationEuler ? Bone::RotationType::EulerXYZ : Bone::RotationType::Quaternion;
+            bone.scale             = view.ReadVector3F(uiBone + eBoneScale);
+            bone.rotation          = view.ReadVector4F(uiBone + eBoneRotation);
+            bone.position          = view.ReadVector3F(uiBone + eBonePosition);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Same lookup as FMAT.GetTextureType in the importer, first match wins
+    static GX2TextureMapType GetTextureType(const std::pmr::string& useSampler, const std::pmr::string& samplerName, const std::pmr::string& name)
+    {
+        auto contains = [&](const char* szPart) { return name.find(szPart) != std::string::npos; };
+
+        if (useSampler == "s_diffuse")               return GX2TextureMapType::Albedo;
+        if (useSampler == "s_normal")                return GX2TextureMapType::Normal;
+        if (useSampler == "s_specmask")              return GX2TextureMapType::Specular;
+        if (useSampler == "_a0")                     return GX2TextureMapType::Albedo;
+        if (useSampler == "_a1")                     return GX2TextureMapType::eMAX; // DiffuseLayer2
+        if (useSampler == "_a2")                     return GX2TextureMapType::eMAX; // DiffuseLayer3
+        if (useSampler == "_n0")                     return GX2TextureMapType::Normal;
+        if (contains("_Nrm"))                        return GX2TextureMapType::Normal;
+        if (useSampler == "_s0")                     return GX2TextureMapType::Specular;
+        if (useSampler == "_ao0")                    return GX2TextureMapType::AmbientOcclusion;
+        if (useSampler == "_e0")                     return GX2TextureMapType::Emission;
+        if (useSampler == "_b0")                     return GX2TextureMapType::Shadow;
+        if (useSampler == "_b1")                     return GX2TextureMapType::Light;
+        if (contains("Emm"))                         return GX2TextureMapType::Emission;
+        if (contains("Spm"))                         return GX2TextureMapType::Specular;
+        if (contains("b00"))                         return GX2TextureMapType::Shadow;
+        if (samplerName == "bake0")                  return GX2TextureMapType::Shadow;
+        if (contains("Moc") || contains("AO"))       return GX2TextureMapType::AmbientOcclusion;
+        if (contains("b01"))                         return GX2TextureMapType::Light;
+        if (contains("MRA"))                         return GX2TextureMapType::MRA;
+        if (contains("mtl"))                         return GX2TextureMapType::Metalness;
+        if (contains("rgh"))                         return GX2TextureMapType::Roughness;
+        if (contains("sss"))                         return GX2TextureMapType::SubSurfaceScattering;
+        if (samplerName == "_ao0")                   return GX2TextureMapType::AmbientOcclusion;
+        if (contains("Alb"))                         return GX2TextureMapType::Albedo;
+        if (samplerName == "_sd0")                   return GX2TextureMapType::Shadow;
+        if (samplerName == "_ms0")                   return GX2TextureMapType::Mask;
+        return GX2TextureMapType::eMAX;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Enum fields of the sampler registers, out of range values read as the first entry like the importer's EnumIndex
+    template<typename T>
+    static T SamplerField(uint32 uiWord, uint32 uiShift, uint32 uiMask, uint32 uiCount)
+    {
+        uint32 uiValue = (uiWord >> uiShift) & uiMask;
+        return static_cast<T>(uiValue < uiCount ? uiValue : 0);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::ParseFMAT(const ResView& view, uint32 uiMaterial, FMAT& fmat)
+    {
+        fmat.name = view.ReadString(uiMaterial + eFMATName);
+        fmat.isVisible = view.ReadU32(uiMaterial + eFMATFlags) == s_uiMaterialFlagsVisible;
+
+        std::vector<DictEntry> samplers = ReadDict(view, view.ReadOffset(uiMaterial + eFMATSamplerDict));
+        uint32 uiShaderAssign = view.ReadOffset(uiMaterial + eFMATShaderAssign);
+        std::vector<DictEntry> samplerAssigns;
+        if (uiShaderAssign != 0)
+            samplerAssigns = ReadDict(view, view.ReadOffset(uiShaderAssign + eShaderAssignSamplerDict));
+
+        // Texture i is sampled by sampler i
+        uint32 uiTextureRefs = view.ReadOffset(uiMaterial + eFMATTextureRefs);
+        uint32 uiTextureCount = uiTextureRefs != 0 ? view.ReadU8(uiMaterial + eFMATTextureCount) : 0;
+        if (uiTextureCount > samplers.size())
+        {
+            view.Fail();
+            uiTextureCount = static_cast<uint32>(samplers.size());
+        }
+
+        fmat.textureRefs.textureCount = uiTextureCount;
+        fmat.textureRefs.textures.resize(uiTextureCount);
+        for (uint32 i = 0; i < uiTextureCount; i++)
+        {
+            TextureRef& texture = fmat.textureRefs.textures[i];
+            texture.name        = view.ReadString(uiTextureRefs + 8 * i);
+            texture.samplerName = samplers[i].name;
+            texture.useSampler  = samplers[i].name;
+            for (const DictEntry& samplerAssign : samplerAssigns)
+            {
+                if (texture.samplerName == samplerAssign.name.c_str())
+                {
+                    texture.useSampler = view.ReadStringAt(samplerAssign.uiData);
+                    break;
+                }
+            }
+
+            // GX2 sampler registers at the start of the sampler
+            uint32 uiSampler = samplers[i].uiData;
+            uint32 uiWord0 = view.ReadU32(uiSampler);
+            uint32 uiWord1 = view.ReadU32(uiSampler + 4);
+            uint32 uiWord2 = view.ReadU32(uiSampler + 8);
+            texture.clampX              = SamplerField<TextureRef::GX2TexClamp>(uiWord0, 0, 0x7, 8);
+            texture.clampY              = SamplerField<TextureRef::GX2TexClamp>(uiWord0, 3, 0x7, 8);
+            texture.clampZ              = SamplerField<TextureRef::GX2TexClamp>(uiWord0, 6, 0x7, 8);
+            texture.magFilter           = SamplerField<GX2TexXYFilterType>(uiWord0, 9, 0x1, 2);
+            texture.minFilter           = SamplerField<GX2TexXYFilterType>(uiWord0, 12, 0x1, 2);
+            texture.zFilter             = SamplerField<GX2TexZFilterType>(uiWord0, 15, 0x3, 3);
+            texture.mipFilter           = SamplerField<GX2TexMipFilterType>(uiWord0, 17, 0x3, 3);
+            texture.maxAnisotropicRatio = SamplerField<GX2TexAnisoRatio>(uiWord0, 19, 0x7, 5);
+            texture.borderType          = SamplerField<GX2TexBorderType>(uiWord0, 22, 0x3, 4);
+            texture.depthCompareFunc    = SamplerField<GX2CompareFunction>(uiWord0, 26, 0x7, 8);
+            texture.depthCompareEnabled = ((uiWord0 >> 30) & 0x1) != 0;
+            texture.minLod              = (uiWord1 & 0x3FF) / 64.0f;
+            texture.maxLod              = ((uiWord1 >> 10) & 0x3FF) / 64.0f;
+            texture.lodBias             = (uiWord2 & 0xFFF) / 64.0f;
+            texture.type                = GetTextureType(texture.useSampler, texture.samplerName, texture.name);
+            texture.textureUnit         = i + 1;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::ParseFSHP(const ResView& view, uint32 uiShape, uint32 uiVertexBuffers, const FSKL& fskl, const std::vector<Math::matrix4F>& boneTransforms, FSHP& fshp, ParseProfile eProfile)
+    {
+        fshp.name                 = view.ReadString(uiShape + eFSHPName);
+        fshp.flags                = static_cast<FSHP::ShapeFlags>(view.ReadU32(uiShape + eFSHPFlags));
+        fshp.materialIndex        = view.ReadU16(uiShape + eFSHPMaterialIndex);
+        fshp.boneIndex            = view.ReadU16(uiShape + eFSHPBoneIndex);
+        fshp.vertexBufferIndex    = view.ReadU16(uiShape + eFSHPVertexBufferIndex);
+        fshp.vertexSkinCount      = view.ReadU8(uiShape + eFSHPVertexSkinCount);
+        fshp.targetAttributeCount = view.ReadU8(uiShape + eFSHPTargetAttribCount);
+
+        uint32 uiMeshCount = view.ReadU8(uiShape + eFSHPMeshCount);
+        uint32 uiRadius = view.ReadOffset(uiShape + eFSHPRadius);
+        fshp.radiusArray.resize(uiRadius != 0 ? uiMeshCount : 0);
+        for (uint32 i = 0; i < fshp.radiusArray.size(); i++)
+            fshp.radiusArray[i] = view.ReadF32(uiRadius + 4 * i);
+
+        uint32 uiSkinBoneIndices = view.ReadOffset(uiShape + eFSHPSkinBoneIndices);
+        fshp.skinBoneIndices.resize(uiSkinBoneIndices != 0 ? view.ReadU16(uiShape + eFSHPSkinBoneCount) : 0);
+        for (uint32 i = 0; i < fshp.skinBoneIndices.size(); i++)
+            fshp.skinBoneIndices[i] = view.ReadU16(uiSkinBoneIndices + 2 * i);
+
+        // Parse Meshes
+        uint32 uiMeshes = view.ReadOffset(uiShape + eFSHPMeshes);
+        fshp.lodMeshes.resize(uiMeshes != 0 ? uiMeshCount : 0);
+        for (uint32 i = 0; i < fshp.lodMeshes.size(); i++)
+        {
+            uint32 uiMesh = uiMeshes + eMeshSize * i;
+            LODMesh& lodMesh = fshp.lodMeshes[i];
+            lodMesh.primitiveType = static_cast<LODMesh::GX2PrimitiveType>(view.ReadU32(uiMesh + eMeshPrimitiveType));
+            lodMesh.indexFormat   = static_cast<LODMesh::GX2IndexFormat>(view.ReadU32(uiMesh + eMeshIndexFormat));
+            lodMesh.indexCount    = view.ReadU32(uiMesh + eMeshIndexCount);
+            lodMesh.firstVertex   = view.ReadU32(uiMesh + eMeshFirstVertex);
+
+            uint32 uiSubMeshes = view.ReadOffset(uiMesh + eMeshSubMeshes);
+            bool bHasSubMesh = uiSubMeshes != 0 && view.ReadU16(uiMesh + eMeshSubMeshCount) > 0;
+            lodMesh.subMesh.offset = bHasSubMesh ? static_cast<int>(view.ReadU32(uiSubMeshes)) : 0;
+            lodMesh.subMesh.count  = bHasSubMesh ? static_cast<int>(view.ReadU32(uiSubMeshes + 4)) : 0;
+
+            // Indices with the first vertex added, expanded to a triangle list. Primitives that aren't triangles
+            // are left without faces.
+            uint32 uiIndexBuffer = view.ReadOffset(uiMesh + eMeshIndexBuffer);
+            uint32 uiIndexData = view.ReadOffset(uiIndexBuffer + eBufferData);
+            uint32 uiIndexSize = IndexBuffer::GetIndexSize(lodMesh.indexFormat);
+            if (uiIndexSize == 0 || static_cast<uint64_t>(lodMesh.indexCount) * uiIndexSize > view.ReadU32(uiIndexBuffer + eBufferDataSize)
+                || !view.IsInRange(uiIndexData, static_cast<size_t>(lodMesh.indexCount) * uiIndexSize))
+            {
+                view.Fail();
+                continue;
+            }
+
+            IndexBuffer::Decode(view.GetData(uiIndexData), lodMesh.indexCount, lodMesh.indexFormat, lodMesh.primitiveType, lodMesh.firstVertex, lodMesh.faceVertices);
+        }
+
+        // Parse Vertices
+        ParseVertices(view, uiVertexBuffers + eFVTXSize * fshp.vertexBufferIndex, fshp, eProfile);
+        TransformVertices(fskl, boneTransforms, fshp);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::ParseVertices(const ResView& view, uint32 uiVertexBuffer, FSHP& fshp, ParseProfile eProfile)
+    {
+        uint32 uiVertexCount = view.ReadU32(uiVertexBuffer + eFVTXVertexCount);
+        uint32 uiAttribCount = view.ReadU8(uiVertexBuffer + eFVTXAttribCount);
+        uint32 uiBufferCount = view.ReadU8(uiVertexBuffer + eFVTXBufferCount);
+        uint32 uiAttribs = view.ReadOffset(uiVertexBuffer + eFVTXAttribs);
+        uint32 uiBuffers = view.ReadOffset(uiVertexBuffer + eFVTXBuffers);
+
+        // The vertex count comes from the positions, a buffer without them has no vertices
+        bool bHasPositions = false;
+        for (uint32 i = 0; i < uiAttribCount; i++)
+            bHasPositions |= view.ReadString(uiAttribs + eAttribSize * i + eAttribName) == "_p0";
+        if (!bHasPositions)
+            uiVertexCount = 0;
+
+        // Attributes the buffer doesn't have get no stream at all
+        VertexStreams& vertices = fshp.vertices;
+        vertices = VertexStreams();
+        vertices.count = uiVertexCount;
+
+        std::vector<float> values;
+        for (uint32 i = 0; i < uiAttribCount; i++)
+        {
+            uint32 uiAttrib = uiAttribs + eAttribSize * i;
+            std::string_view name = view.ReadString(uiAttrib + eAttribName);
+            if ((name == "_p1" || name == "_p2") && eProfile != ParseProfile::Full)
+                continue;
+
+            // The attributes the dump carries, in the order of the streams
+            static const char* const s_attribNames[] = { "_p0", "_p1", "_p2", "_n0", "_u0", "_u1", "_u2", "_c0", "_c1", "_t0", "_b0", "_w0", "_i0" };
+            static_assert(sizeof(s_attribNames) / sizeof(s_attribNames[0]) == VertexStreams::eStreamCount, "An attribute name per stream");
+            uint32 uiTarget = 0;
+            while (uiTarget < VertexStreams::eStreamCount && name != s_attribNames[uiTarget])
+                uiTarget++;
+            if (uiTarget == VertexStreams::eStreamCount)
+                continue;
+
+            uint32 uiFormat = view.ReadU32(uiAttrib + eAttribFormat);
+            uint32 uiElementSize = VertexAttrib::GetElementSize(uiFormat);
+            uint32 uiBufferIndex = view.ReadU8(uiAttrib + eAttribBufferIndex);
+            if (uiElementSize == 0 || uiBufferIndex >= uiBufferCount)
+            {
+                assert(0 && "Unsupported vertex attribute");
+                continue;
+            }
+
+            uint32 uiBuffer = uiBuffers + eBufferSize * uiBufferIndex;
+            uint32 uiData = view.ReadOffset(uiBuffer + eBufferData);
+            uint32 uiStride = view.ReadU16(uiBuffer + eBufferStride);
+            uint32 uiFirst = uiData + view.ReadU16(uiAttrib + eAttribOffset);
+            uint64_t uiSpan = uiVertexCount > 0 ? static_cast<uint64_t>(uiVertexCount - 1) * uiStride + uiElementSize : 0;
+            if (uiVertexCount > 0 && (static_cast<uint64_t>(uiFirst - uiData) + uiSpan > view.ReadU32(uiBuffer + eBufferDataSize) || !view.IsInRange(uiFirst, uiSpan)))
+            {
+                view.Fail();
+                continue;
+            }
+
+            // The whole stream is decoded at once, then copied into the attribute's own array
+            uint32 uiComponents = VertexAttrib::GetComponentCount(uiFormat);
+            values.resize(static_cast<size_t>(uiVertexCount) * uiComponents);
+            VertexAttrib::Decode(view.GetData(uiFirst), uiStride, uiVertexCount, uiFormat, values.data());
+
+            VertexStreams::Stream eStream = static_cast<VertexStreams::Stream>(uiTarget);
+            vertices.Add(eStream);
+            switch (eStream)
+            {
+            case VertexStreams::ePosition0:    CopyStream(values.data(), uiComponents, vertices.position0);    break;
+            case VertexStreams::ePosition1:    CopyStream(values.data(), uiComponents, vertices.position1);    break;
+            case VertexStreams::ePosition2:    CopyStream(values.data(), uiComponents, vertices.position2);    break;
+            case VertexStreams::eNormal:       CopyStream(values.data(), uiComponents, vertices.normal);       break;
+            case VertexStreams::eUV0:          CopyStream(values.data(), uiComponents, vertices.uv0);          break;
+            case VertexStreams::eUV1:          CopyStream(values.data(), uiComponents, vertices.uv1);          break;
+            case VertexStreams::eUV2:          CopyStream(values.data(), uiComponents, vertices.uv2);          break;
+            case VertexStreams::eColor0:       CopyStream(values.data(), uiComponents, vertices.color0);       break;
+            case VertexStreams::eColor1:       CopyStream(values.data(), uiComponents, vertices.color1);       break;
+            case VertexStreams::eTangent:      CopyStream(values.data(), uiComponents, vertices.tangent);      break;
+            case VertexStreams::eBinormal:     CopyStream(values.data(), uiComponents, vertices.binormal);     break;
+            case VertexStreams::eBlendWeights: CopyStream(values.data(), uiComponents, vertices.blendWeights); break;
+            default:
+                // bone ids went through an int in the importer
+                for (uint32 j = 0; j < uiVertexCount; j++)
+                {
+                    float element[4] = { 0, 0, 0, 0 };
+                    memcpy(element, &values[static_cast<size_t>(j) * uiComponents], std::min(uiComponents, 4u) * sizeof(float));
+                    vertices.blendIndex[j] = { static_cast<uint32>(static_cast<int32>(element[0])), static_cast<uint32>(static_cast<int32>(element[1])),
+                                               static_cast<uint32>(static_cast<int32>(element[2])), static_cast<uint32>(static_cast<int32>(element[3])) };
+                }
+                break;
+            }
+        }
+
+        // Positions that couldn't be read leave the shape without vertices, and so without faces to index them
+        if (!vertices.Has(VertexStreams::ePosition0))
+        {
+            vertices = VertexStreams();
+            fshp.lodMeshes.clear();
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::ParseAnim(const ResView& view, uint32 uiAnim, Anim& anim)
+    {
+        uint32 uiFlags = view.ReadU32(uiAnim + eFSKAFlags);
+        anim.m_szName       = view.ReadString(uiAnim + eFSKAName);
+        anim.m_bIsBaked     = (uiFlags & s_uiAnimFlagsBaked) != 0;
+        anim.m_bIsLooping   = (uiFlags & s_uiAnimFlagsLooping) != 0;
+        anim.m_eScalingType = static_cast<Anim::SkeletalAnimFlagsScale>((uiFlags & s_uiAnimFlagsScaleMask) >> 8);
+        anim.m_cFrames      = static_cast<uint32>(view.ReadS32(uiAnim + eFSKAFrameCount));
+
+        // parse bone anims, each one only touches its own tracks
+        bool bEulerRotation = (uiFlags & s_uiAnimFlagsRotateMask) == s_uiAnimFlagsRotateEuler;
+        uint32 uiBoneAnims = view.ReadOffset(uiAnim + eFSKABoneAnims);
+        anim.m_cBoneAnims = uiBoneAnims != 0 ? view.ReadU16(uiAnim + eFSKABoneAnimCount) : 0;
+        anim.m_vBoneAnims.resize(anim.m_cBoneAnims);
+        ThreadPool::Get().ParallelFor(anim.m_cBoneAnims, [&](size_t i)
+        {
+            ParseBoneAnim(view, uiBoneAnims + eBoneAnimSize * static_cast<uint32>(i), bEulerRotation, anim.m_vBoneAnims[i]);
+        });
+
+        // parse user data, only number arrays carry values
+        std::vector<DictEntry> userDatas = ReadDict(view, view.ReadOffset(uiAnim + eFSKAUserDataDict));
+        anim.m_cUserData = static_cast<uint32>(userDatas.size());
+        anim.m_vUserData.resize(userDatas.size());
+        for (uint32 i = 0; i < userDatas.size(); i++)
+        {
+            uint32 uiUserData = userDatas[i].uiData;
+            UserData& userData = anim.m_vUserData[i];
+            userData.m_szName = userDatas[i].name;
+            userData.m_eType  = static_cast<UserData::UserDataType>(view.ReadU8(uiUserData + eUserDataType));
+
+            uint32 uiCount = view.ReadU16(uiUserData + eUserDataCount);
+            uint32 uiValues = uiUserData + eUserDataValues;
+            switch (userData.m_eType)
+            {
+            case UserData::UserDataType::Int32:
+                for (uint32 j = 0; j < uiCount; j++)
+                    userData.m_vfValues.push_back(static_cast<float>(view.ReadS32(uiValues + 4 * j)));
+                break;
+            case UserData::UserDataType::Single:
+                for (uint32 j = 0; j < uiCount; j++)
+                    userData.m_vfValues.push_back(view.ReadF32(uiValues + 4 * j));
+                break;
+            case UserData::UserDataType::Byte:
+                for (uint32 j = 0; j < uiCount; j++)
+                    userData.m_vfValues.push_back(static_cast<float>(view.ReadU8(uiValues + j)));
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BFRESReader::ParseBoneAnim(const ResView& view, uint32 uiBoneAnim, bool bEulerRotation, BoneAnim& boneAnim)
+    {
+        uint32 uiFlags = view.ReadU32(uiBoneAnim + eBoneAnimFlags);
+        boneAnim.m_szName                     = view.ReadString(uiBoneAnim + eBoneAnimName);
+        boneAnim.m_iHash                      = -1;
+        boneAnim.m_eRotType                   = bEulerRotation ? BoneAnim::AnimRotationType::EULER : BoneAnim::AnimRotationType::QUATERNION;
+        boneAnim.m_bUseSegmentScaleCompensate = (uiFlags & s_uiBoneAnimSegmentScale) != 0;
+
+        // Tracks in the order XSCA, YSCA, ZSCA, XROT, YROT, ZROT, WROT, XPOS, YPOS, ZPOS
+        AnimTrack* tracks[] =
+        {
+            &boneAnim.m_XSCA, &boneAnim.m_YSCA, &boneAnim.m_ZSCA,
+            &boneAnim.m_XROT, &boneAnim.m_YROT, &boneAnim.m_ZROT, &boneAnim.m_WROT,
+            &boneAnim.m_XPOS, &boneAnim.m_YPOS, &boneAnim.m_ZPOS
+        };
+        static const char* s_trackNames[] = { "XSCA", "YSCA", "ZSCA", "XROT", "YROT", "ZROT", "WROT", "XPOS", "YPOS", "ZPOS" };
+        for (uint32 i = 0; i < 10; i++)
+        {
+            tracks[i]->m_szName             = s_trackNames[i];
+            tracks[i]->m_eInterpolationType = AnimTrack::CurveInterpolationType::HERMITE;
+            tracks[i]->m_bConstant          = false;
+            tracks[i]->m_uiStartFrame       = 0;
+            tracks[i]->m_uiEndFrame         = 0;
+            tracks[i]->m_fDelta             = 0;
+        }
+
+        // The base values are the keys at frame 0, stored scale, rotate, translate for whatever is present
+        uint32 uiBase = view.ReadOffset(uiBoneAnim + eBoneAnimBaseData);
+        uint32 baseMasks[] = { s_uiBoneAnimBaseScale, s_uiBoneAnimBaseRotate, s_uiBoneAnimBaseTranslate };
+        uint32 baseFirstTrack[] = { 0, 3, 7 };
+        uint32 baseTrackCount[] = { 3, 4, 3 };
+        for (uint32 i = 0; i < 3; i++)
+        {
+            if ((uiFlags & baseMasks[i]) == 0)
+                continue;
+            for (uint32 j = 0; j < baseTrackCount[i]; j++)
+            {
+                KeyFrame key;
+                key.m_uiFrame = 0;
+                key.m_fValue  = view.ReadF32(uiBase);
+                key.m_fSlope1 = 0;
+                key.m_fSlope2 = 0;
+                tracks[baseFirstTrack[i] + j]->m_vKeyFrames.push_back(key);
+                uiBase += 4;
+            }
+        }
+
+        uint32 uiCurves = view.ReadOffset(uiBoneAnim + eBoneAnimCurves);
+        uint32 uiCurveCount = uiCurves != 0 ? view.ReadU8(uiBoneAnim + eBoneAnimCurveCount) : 0;
+        for (uint32 i = 0; i < uiCurveCount; i++)
+            ParseAnimCurve(view, uiCurves + eCurveSize * i, tracks);
+
+        // The frame count of a track is its last keyed frame
+        for (AnimTrack* pTrack : tracks)
+        {
+            pTrack->m_cKeys = static_cast<uint32>(pTrack->m_vKeyFrames.size());
+            pTrack->m_cFrames = 0;
+            for (const KeyFrame& key : pTrack->m_vKeyFrames)
+            {
+                if (static_cast<int32>(key.m_uiFrame) > static_cast<int32>(pTrack->m_cFrames))
+                    pTrack->m_cFrames = key.m_uiFrame;
+            }
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Appends the keys of one curve to the track it animates
+    void BFRESReader::ParseAnimCurve(const ResView& view, uint32 uiCurve, AnimTrack* tracks[])
+    {
+        // animDataOffset is the byte offset of the value inside the bone's scale, rotate, translate block
+        int iTrack = -1;
+        switch (view.ReadU32(uiCurve + eCurveDataOffset))
+        {
+        case 0x04: iTrack = 0; break;
+        case 0x08: iTrack = 1; break;
+        case 0x0C: iTrack = 2; break;
+        case 0x20: iTrack = 3; break;
+        case 0x24: iTrack = 4; break;
+        case 0x28: iTrack = 5; break;
+        case 0x2C: iTrack = 6; break;
+        case 0x10: iTrack = 7; break;
+        case 0x14: iTrack = 8; break;
+        case 0x18: iTrack = 9; break;
+        default:
+            assert(0 && "Unknown anim curve offset");
+            return;
+        }
+
+        AnimCurve::Curve curve;
+        curve.uiFlags      = view.ReadU16(uiCurve + eCurveFlags);
+        curve.uiKeyCount   = view.ReadU16(uiCurve + eCurveKeyCount);
+        curve.fEndFrame    = view.ReadF32(uiCurve + eCurveEndFrame);
+        curve.fScale       = view.ReadF32(uiCurve + eCurveScale);
+        curve.uiOffsetBits = view.ReadU32(uiCurve + eCurveOffset);
+        if (!AnimCurve::IsSupported(curve))
+        {
+            assert(0 && "Unsupported anim curve type");
+            return;
+        }
+
+        uint32 uiFrames = view.ReadOffset(uiCurve + eCurveFrames);
+        uint32 uiKeys = view.ReadOffset(uiCurve + eCurveKeys);
+        if (!view.IsInRange(uiFrames, AnimCurve::GetFramesSize(curve)) || !view.IsInRange(uiKeys, AnimCurve::GetKeysSize(curve)))
+        {
+            view.Fail();
+            return;
+        }
+        curve.pFrames = view.GetData(uiFrames);
+        curve.pKeys   = view.GetData(uiKeys);
+        AnimCurve::Decode(curve, tracks[iTrack]->m_vKeyFrames);
+    }
+
+}
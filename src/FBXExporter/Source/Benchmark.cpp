@@ -0,0 +1,948 @@
+#include "Benchmark.h"
+#include "BCn.h"
+#include "BFRESReader.h"
+#include "GX2.h"
+#include "IndexBuffer.h"
+#include "LayerArray.h"
+#include "MappedFile.h"
+#include "SkeletonPose.h"
+#include "VertexAttrib.h"
+#include "Yaz0.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Benchmark
+{
+
+    // Every file is run this many times after a warm up run, the fastest run counts
+    static const int s_iRepetitions = 5;
+
+    // Chunk size the streaming decoder is fed with, about what a buffered file read hands out
+    static const size_t s_uiStreamChunkSize = 64 * 1024;
+
+    // Random blocks decoded on top of the files' textures, so every format is measured
+    static const uint32 s_uiSyntheticSize = 1024;
+
+    // Elements per vertex attribute format, and the bytes of other attributes interleaved between them
+    static const size_t s_uiAttribElements = 256 * 1024;
+    static const size_t s_uiAttribInterleave = 8;
+
+    // Indices per index format and primitive type, of vertices below s_uiIndexVertices. Every s_uiIndexRepeat-th
+    // index repeats the one before it, so strips have degenerate triangles to drop.
+    static const size_t s_uiIndexCount = 1024 * 1024;
+    static const uint32 s_uiIndexVertices = 50000;
+    static const uint32 s_uiIndexRepeat = 32;
+
+    // Vertices per layer stream, an LOD picking every s_uiLayerStep-th of them on average when gathered
+    static const size_t s_uiLayerElements = 256 * 1024;
+    static const uint32 s_uiLayerStep = 2;
+
+    // Bones of the generated skeleton, and how far a reference matrix element may be off relative to its size
+    static const uint32 s_uiPoseBones = 4096;
+    static const double s_fPoseTolerance = 1e-9;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static double Seconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static double MegaBytesPerSecond(uint64_t uiBytes, double fSeconds)
+    {
+        return fSeconds > 0.0 ? uiBytes / (1024.0 * 1024.0) / fSeconds : 0.0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Regular files given directly or found below the given directories
+    static std::vector<std::string> CollectFiles(int argc, char** argv)
+    {
+        std::vector<std::string> files;
+        for (int i = 0; i < argc; i++)
+        {
+            std::error_code error;
+            if (std::filesystem::is_directory(argv[i], error))
+            {
+                for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[i], error))
+                {
+                    if (entry.is_regular_file(error))
+                        files.push_back(entry.path().string());
+                }
+            }
+            else
+                files.push_back(argv[i]);
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Yaz0 decompression, once straight into a buffer sized from the header and once through the
+    // streaming decoder fed in chunks. Files that aren't Yaz0 are skipped.
+    static int RunYaz0(const std::vector<std::string>& files)
+    {
+        uint64_t uiCompressedBytes = 0;
+        uint64_t uiDecompressedBytes = 0;
+        double fDecompressSeconds = 0.0;
+        double fStreamSeconds = 0.0;
+        size_t uiFileCount = 0;
+        bool bFailed = false;
+
+        for (const std::string& filePath : files)
+        {
+            MappedFile mappedFile;
+            if (!mappedFile.Open(filePath.c_str(), false) || !Yaz0::IsYaz0(mappedFile.GetData(), mappedFile.GetSize()))
+                continue;
+
+            const char* pData = mappedFile.GetData();
+            size_t uiSize = mappedFile.GetSize();
+            size_t uiDecompressedSize = Yaz0::GetDecompressedSize(pData, uiSize);
+            std::unique_ptr<char[]> pOutput(new char[uiDecompressedSize]);
+
+            // The warm up run also pages the file in
+            double fBestDecompress = 0.0;
+            for (int i = 0; i <= s_iRepetitions; i++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                bool bValid = Yaz0::Decompress(pData, uiSize, pOutput.get(), uiDecompressedSize);
+                double fSeconds = Seconds(start);
+                if (!bValid)
+                {
+                    printf("[Yaz0] %s: corrupt\n", filePath.c_str());
+                    bFailed = true;
+                    break;
+                }
+                if (i == 1 || (i > 1 && fSeconds < fBestDecompress))
+                    fBestDecompress = fSeconds;
+            }
+
+            double fBestStream = 0.0;
+            for (int i = 0; i <= s_iRepetitions && !bFailed; i++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                Yaz0::Decoder decoder;
+                for (size_t uiOffset = 0; uiOffset < uiSize && !decoder.HasFailed(); uiOffset += s_uiStreamChunkSize)
+                    decoder.Feed(pData + uiOffset, std::min(s_uiStreamChunkSize, uiSize - uiOffset));
+                double fSeconds = Seconds(start);
+
+                if (!decoder.IsDone() || memcmp(decoder.GetData(), pOutput.get(), uiDecompressedSize) != 0)
+                {
+                    printf("[Yaz0] %s: streaming result differs\n", filePath.c_str());
+                    bFailed = true;
+                    break;
+                }
+                if (i == 1 || (i > 1 && fSeconds < fBestStream))
+                    fBestStream = fSeconds;
+            }
+
+            uiFileCount++;
+            uiCompressedBytes += uiSize;
+            uiDecompressedBytes += uiDecompressedSize;
+            fDecompressSeconds += fBestDecompress;
+            fStreamSeconds += fBestStream;
+        }
+
+        printf("[Yaz0] %zu files, %llu bytes compressed, %llu bytes decompressed\n", uiFileCount,
+            static_cast<unsigned long long>(uiCompressedBytes), static_cast<unsigned long long>(uiDecompressedBytes));
+        printf("[Yaz0] decompress: %.3fs, %.1f MB/s out, %.1f MB/s in\n", fDecompressSeconds,
+            MegaBytesPerSecond(uiDecompressedBytes, fDecompressSeconds), MegaBytesPerSecond(uiCompressedBytes, fDecompressSeconds));
+        printf("[Yaz0] streaming, %zu KB chunks: %.3fs, %.1f MB/s out, %.1f MB/s in\n", s_uiStreamChunkSize / 1024, fStreamSeconds,
+            MegaBytesPerSecond(uiDecompressedBytes, fStreamSeconds), MegaBytesPerSecond(uiCompressedBytes, fStreamSeconds));
+        return bFailed ? 1 : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // GX2 deswizzling of every texture level and slice in the BFRES files: addrlib's per element addresses,
+    // the table driven deswizzler on one thread, and the table driven one with every level and slice a job on
+    // the thread pool. Both table driven results are checked against addrlib's.
+    static int RunGX2(const std::vector<std::string>& files)
+    {
+        struct TextureFile
+        {
+            WiiU::BFRESReader::FileData          file;
+            std::vector<WiiU::TextureSurface>    textures;
+        };
+
+        // Every file stays open so the timed runs only deswizzle
+        std::vector<std::unique_ptr<TextureFile>> textureFiles;
+        std::vector<const GX2::Surface*> surfaces;
+        for (const std::string& filePath : files)
+        {
+            std::unique_ptr<TextureFile> pTextureFile(new TextureFile());
+            if (!WiiU::BFRESReader::IsBFRES(filePath.c_str()) || !WiiU::BFRESReader::OpenFile(filePath.c_str(), pTextureFile->file))
+                continue;
+
+            WiiU::ResView view(pTextureFile->file.pData, pTextureFile->file.uiSize);
+            pTextureFile->textures = WiiU::ReadTextureSurfaces(view, WiiU::GetTexturePart(filePath.c_str()));
+            for (const WiiU::TextureSurface& texture : pTextureFile->textures)
+                surfaces.push_back(&texture.surface);
+            textureFiles.push_back(std::move(pTextureFile));
+        }
+
+        // The reference run also sizes the images the other runs compare against
+        std::vector<std::vector<GX2::Image>> reference;
+        GX2::DeswizzleSurfaces(surfaces, reference);
+        uint64_t uiBytes = 0;
+        size_t uiImageCount = 0;
+        bool bFailed = false;
+        auto referenceStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < surfaces.size(); i++)
+        {
+            for (GX2::Image& image : reference[i])
+            {
+                if (!GX2::DeswizzleReference(*surfaces[i], image.uiLevel, image.uiSlice, image.data.data()))
+                {
+                    printf("[GX2] surface %zu level %u slice %u: data too small\n", i, image.uiLevel, image.uiSlice);
+                    bFailed = true;
+                }
+                uiBytes += image.data.size();
+                uiImageCount++;
+            }
+        }
+        double fReferenceSeconds = Seconds(referenceStart);
+
+        std::vector<std::vector<GX2::Image>> images;
+        GX2::DeswizzleSurfaces(surfaces, images);
+        double fBestSingle = 0.0;
+        for (int r = 0; r <= s_iRepetitions; r++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < surfaces.size(); i++)
+            {
+                for (GX2::Image& image : images[i])
+                    GX2::Deswizzle(*surfaces[i], image.uiLevel, image.uiSlice, image.data.data());
+            }
+            double fSeconds = Seconds(start);
+            if (r == 1 || (r > 1 && fSeconds < fBestSingle))
+                fBestSingle = fSeconds;
+        }
+
+        double fBestParallel = 0.0;
+        for (int r = 0; r <= s_iRepetitions; r++)
+        {
+            std::vector<std::vector<GX2::Image>> parallelImages;
+            auto start = std::chrono::steady_clock::now();
+            GX2::DeswizzleSurfaces(surfaces, parallelImages);
+            double fSeconds = Seconds(start);
+            if (r == 1 || (r > 1 && fSeconds < fBestParallel))
+                fBestParallel = fSeconds;
+            if (r == s_iRepetitions)
+                images.swap(parallelImages);
+        }
+
+        for (size_t i = 0; i < surfaces.size(); i++)
+        {
+            for (size_t j = 0; j < reference[i].size(); j++)
+            {
+                if (images[i][j].data != reference[i][j].data)
+                {
+                    printf("[GX2] surface %zu level %u slice %u: differs from addrlib\n", i, reference[i][j].uiLevel, reference[i][j].uiSlice);
+                    bFailed = true;
+                }
+            }
+        }
+
+        printf("[GX2] %zu files, %zu textures, %zu levels and slices, %llu bytes\n", textureFiles.size(), surfaces.size(), uiImageCount,
+            static_cast<unsigned long long>(uiBytes));
+        printf("[GX2] addrlib per element: %.3fs, %.1f MB/s\n", fReferenceSeconds, MegaBytesPerSecond(uiBytes, fReferenceSeconds));
+        printf("[GX2] tables, one thread: %.3fs, %.1f MB/s\n", fBestSingle, MegaBytesPerSecond(uiBytes, fBestSingle));
+        printf("[GX2] tables, thread pool: %.3fs, %.1f MB/s\n", fBestParallel, MegaBytesPerSecond(uiBytes, fBestParallel));
+        return bFailed ? 1 : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static double MegaPixelsPerSecond(uint64_t uiPixels, double fSeconds)
+    {
+        return fSeconds > 0.0 ? uiPixels / 1e6 / fSeconds : 0.0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // BC1-BC5 decoding per format: the texture levels of the BFRES files in that format plus random blocks, a
+    // full size image and one with partial edge blocks. Every path is timed and checked to be bit exact
+    // against the reference decoder.
+    static int RunBCn(const std::vector<std::string>& files)
+    {
+        struct Input
+        {
+            const char*       pData;
+            size_t            uiSize;
+            uint32            uiWidth;
+            uint32            uiHeight;
+            BCn::DecodeParams params;
+        };
+
+        struct FormatCase
+        {
+            const char* szName;
+            uint32      uiFormat;
+            bool        bReconstructZ;
+        };
+
+        static const FormatCase s_cases[] =
+        {
+            { "BC1",       0x031, false },
+            { "BC2",       0x032, false },
+            { "BC3",       0x033, false },
+            { "BC4",       0x034, false },
+            { "BC4 SNorm", 0x234, false },
+            { "BC5",       0x035, false },
+            { "BC5 SNorm", 0x235, false },
+            { "BC5 Z",     0x035, true  },
+        };
+
+        std::vector<FTEX> textures;
+        for (const std::string& filePath : files)
+        {
+            std::vector<FTEX> fileTextures;
+            if (!WiiU::BFRESReader::IsBFRES(filePath.c_str()) || !WiiU::BFRESReader::ReadTextures(filePath.c_str(), fileTextures))
+                continue;
+            for (FTEX& texture : fileTextures)
+                textures.push_back(std::move(texture));
+        }
+
+        std::mt19937 random(1234);
+        const uint32 syntheticSizes[2][2] = { { s_uiSyntheticSize, s_uiSyntheticSize }, { s_uiSyntheticSize - 3, s_uiSyntheticSize / 2 + 1 } };
+        std::vector<std::vector<char>> syntheticData(2);
+        for (size_t i = 0; i < syntheticData.size(); i++)
+        {
+            // Room for 16 byte blocks, the 8 byte formats use the first half
+            syntheticData[i].resize(static_cast<size_t>((syntheticSizes[i][0] + 3) / 4) * ((syntheticSizes[i][1] + 3) / 4) * 16);
+            for (char& c : syntheticData[i])
+                c = static_cast<char>(random());
+        }
+
+        bool bFailed = false;
+        for (const FormatCase& formatCase : s_cases)
+        {
+            uint32 uiFormat = formatCase.uiFormat;
+            std::vector<Input> inputs;
+            for (const FTEX& texture : textures)
+            {
+                if ((texture.format & 0x23F) != uiFormat)
+                    continue;
+                for (const GX2::Image& image : texture.images)
+                {
+                    Input input = { image.data.data(), image.data.size(), std::max(1u, texture.width >> image.uiLevel),
+                        std::max(1u, texture.height >> image.uiLevel), { uiFormat, {}, formatCase.bReconstructZ } };
+                    memcpy(input.params.compSel, texture.compSel, sizeof(input.params.compSel));
+                    if (formatCase.bReconstructZ)
+                        input.params.compSel[2] = BCn::eCompSelB;
+                    inputs.push_back(input);
+                }
+            }
+            size_t uiFileInputs = inputs.size();
+
+            // A swizzle that moves every channel around, keeping B where Z is reconstructed
+            const uint8_t syntheticCompSel[4] = { BCn::eCompSelG, BCn::eCompSelA, BCn::eCompSelB, BCn::eCompSelR };
+            for (size_t i = 0; i < syntheticData.size(); i++)
+            {
+                Input input = { syntheticData[i].data(), syntheticData[i].size(), syntheticSizes[i][0], syntheticSizes[i][1],
+                    { uiFormat, {}, formatCase.bReconstructZ } };
+                memcpy(input.params.compSel, syntheticCompSel, sizeof(input.params.compSel));
+                inputs.push_back(input);
+            }
+
+            uint64_t uiPixels = 0;
+            std::vector<std::vector<uint8_t>> reference(inputs.size());
+            for (size_t i = 0; i < inputs.size(); i++)
+            {
+                reference[i].resize(static_cast<size_t>(inputs[i].uiWidth) * inputs[i].uiHeight * 4);
+                uiPixels += static_cast<uint64_t>(inputs[i].uiWidth) * inputs[i].uiHeight;
+            }
+
+            auto referenceStart = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < inputs.size(); i++)
+            {
+                const Input& input = inputs[i];
+                if (!BCn::DecodeReference(input.pData, input.uiSize, input.uiWidth, input.uiHeight, input.params, reference[i].data()))
+                {
+                    printf("[BCn] %s input %zu: can't be decoded\n", formatCase.szName, i);
+                    bFailed = true;
+                }
+            }
+            double fReferenceSeconds = Seconds(referenceStart);
+
+            printf("[BCn] %s: %zu levels from files and %zu random images, %.2f MP\n", formatCase.szName, uiFileInputs,
+                inputs.size() - uiFileInputs, uiPixels / 1e6);
+            printf("[BCn]   reference: %.3fs, %.1f MP/s\n", fReferenceSeconds, MegaPixelsPerSecond(uiPixels, fReferenceSeconds));
+
+            const SIMD::Path paths[] = { SIMD::Path::Scalar, SIMD::Path::SSE2, SIMD::Path::AVX2 };
+            for (SIMD::Path ePath : paths)
+            {
+                if (ePath == SIMD::Path::AVX2 && SIMD::GetFastestPath() != SIMD::Path::AVX2)
+                {
+                    printf("[BCn]   %s: not supported by this CPU\n", SIMD::GetPathName(ePath));
+                    continue;
+                }
+
+                std::vector<std::vector<uint8_t>> decoded(inputs.size());
+                for (size_t i = 0; i < inputs.size(); i++)
+                    decoded[i].resize(reference[i].size());
+
+                double fBest = 0.0;
+                for (int r = 0; r <= s_iRepetitions; r++)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    for (size_t i = 0; i < inputs.size(); i++)
+                    {
+                        const Input& input = inputs[i];
+                        BCn::Decode(input.pData, input.uiSize, input.uiWidth, input.uiHeight, input.params, decoded[i].data(), ePath);
+                    }
+                    double fSeconds = Seconds(start);
+                    if (r == 1 || (r > 1 && fSeconds < fBest))
+                        fBest = fSeconds;
+                }
+
+                size_t uiMismatches = 0;
+                for (size_t i = 0; i < inputs.size(); i++)
+                {
+                    if (decoded[i] != reference[i])
+                        uiMismatches++;
+                }
+                if (uiMismatches)
+                    bFailed = true;
+
+                printf("[BCn]   %s: %.3fs, %.1f MP/s, %s\n", SIMD::GetPathName(ePath), fBest, MegaPixelsPerSecond(uiPixels, fBest),
+                    uiMismatches ? "DIFFERS from reference" : "bit exact");
+            }
+        }
+        return bFailed ? 1 : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Elements of known value per format, decoded by the reference and every path. Each element is repeated so
+    // the SIMD kernels convert it in their loops as well as in their tails.
+    static bool CheckAttribValues(const SIMD::Path* pPaths, size_t uiPaths)
+    {
+        struct KnownValue
+        {
+            uint32        uiFormat;
+            unsigned char bytes[16]; // big endian, as in the buffer
+            float         values[4];
+        };
+
+        const float fInfinity = std::numeric_limits<float>::infinity();
+        const KnownValue s_values[] =
+        {
+            { 0x000, { 0xFF },                   { 1.0f } },
+            { 0x000, { 0x80 },                   { 128.0f / 255.0f } },
+            { 0x100, { 0xC8 },                   { 200.0f } },
+            { 0x200, { 0x80 },                   { -1.0f } },
+            { 0x200, { 0x81 },                   { -1.0f } },
+            { 0x200, { 0x7F },                   { 1.0f } },
+            { 0x300, { 0xFF },                   { -1.0f } },
+            { 0x800, { 0xFF },                   { 255.0f } },
+            { 0xA00, { 0x80 },                   { -128.0f } },
+            { 0x001, { 0x0F },                   { 1.0f, 0.0f } },
+            { 0x002, { 0xFF, 0xFF },             { 1.0f } },
+            { 0x202, { 0x80, 0x00 },             { -1.0f } },
+            { 0x202, { 0x7F, 0xFF },             { 1.0f } },
+            { 0x302, { 0xFF, 0xFE },             { -2.0f } },
+            { 0x803, { 0x3C, 0x00 },             { 1.0f } },
+            { 0x803, { 0x00, 0x01 },             { 1.0f / 16777216.0f } },  // smallest denormal
+            { 0x803, { 0x03, 0xFF },             { 1023.0f / 16777216.0f } }, // largest denormal
+            { 0x803, { 0x7C, 0x00 },             { fInfinity } },
+            { 0x803, { 0xFC, 0x00 },             { -fInfinity } },
+            { 0x803, { 0x80, 0x00 },             { -0.0f } },
+            { 0x105, { 0xFF, 0xFF, 0xFF, 0xFF }, { 4294967296.0f } },
+            { 0x305, { 0xFF, 0xFF, 0xFF, 0xFF }, { -1.0f } },
+            { 0x806, { 0x3F, 0x80, 0x00, 0x00 }, { 1.0f } },
+            { 0x20A, { 0x80, 0x7F, 0x00, 0xC0 }, { -1.0f, 1.0f, 0.0f, -64.0f / 127.0f } },
+            // x in the low bits: x 0x3FF, y 0, z 0x200, w 3
+            { 0x00B, { 0xE0, 0x00, 0x03, 0xFF }, { 1.0f, 0.0f, 512.0f / 1023.0f, 1.0f } },
+            // snorm x 511, y -512, z -511 and a w that stays a signed int, -2
+            { 0x20B, { 0xA0, 0x18, 0x01, 0xFF }, { 1.0f, -1.0f, -1.0f, -2.0f } },
+            { 0x20B, { 0x40, 0x00, 0x00, 0x00 }, { 0.0f, 0.0f, 0.0f, 1.0f } },
+            { 0x30B, { 0xC0, 0x00, 0x03, 0xFF }, { -1.0f, 0.0f, 0.0f, -1.0f } },
+        };
+
+        const size_t uiRepeat = 37;
+        bool bFailed = false;
+        for (const KnownValue& known : s_values)
+        {
+            size_t uiSize = VertexAttrib::GetElementSize(known.uiFormat);
+            size_t uiComponents = VertexAttrib::GetComponentCount(known.uiFormat);
+            std::vector<char> data(uiSize * uiRepeat);
+            std::vector<float> expected(uiComponents * uiRepeat), decoded(uiComponents * uiRepeat);
+            for (size_t i = 0; i < uiRepeat; i++)
+            {
+                memcpy(&data[uiSize * i], known.bytes, uiSize);
+                memcpy(&expected[uiComponents * i], known.values, uiComponents * sizeof(float));
+            }
+
+            VertexAttrib::DecodeReference(data.data(), uiSize, uiRepeat, known.uiFormat, decoded.data());
+            std::string failures;
+            if (memcmp(decoded.data(), expected.data(), expected.size() * sizeof(float)) != 0)
+                failures += " reference";
+            for (size_t p = 0; p < uiPaths; p++)
+            {
+                std::fill(decoded.begin(), decoded.end(), 0.0f);
+                VertexAttrib::Decode(data.data(), uiSize, uiRepeat, known.uiFormat, decoded.data(), pPaths[p]);
+                if (memcmp(decoded.data(), expected.data(), expected.size() * sizeof(float)) != 0)
+                    failures += std::string(" ") + SIMD::GetPathName(pPaths[p]);
+            }
+
+            if (!failures.empty())
+            {
+                printf("[Attrib] 0x%03X %02X %02X %02X %02X decodes wrong:%s\n", known.uiFormat, known.bytes[0], known.bytes[1], known.bytes[2],
+                    known.bytes[3], failures.c_str());
+                bFailed = true;
+            }
+        }
+        printf("[Attrib] %s\n", bFailed ? "some known values decode wrong" : "every known value decodes right");
+        return !bFailed;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Vertex attribute decoding of every GX2 attribute format over random elements, interleaved with other
+    // data like in a vertex buffer. Each path is timed and checked to be bit exact against the reference
+    // decoder, interleaved and tightly packed.
+    static int RunVertexAttrib()
+    {
+        struct AttribFormat
+        {
+            uint32      uiFormat;
+            const char* szName;
+        };
+
+        static const AttribFormat s_formats[] =
+        {
+            { 0x000, "8 UNorm" },           { 0x100, "8 UInt" },            { 0x200, "8 SNorm" },
+            { 0x300, "8 SInt" },            { 0x800, "8 UIntToFloat" },     { 0xA00, "8 SIntToFloat" },
+            { 0x001, "4_4 UNorm" },
+            { 0x002, "16 UNorm" },          { 0x102, "16 UInt" },           { 0x202, "16 SNorm" },
+            { 0x302, "16 SInt" },           { 0x802, "16 UIntToFloat" },    { 0xA02, "16 SIntToFloat" },
+            { 0x803, "16 Float" },
+            { 0x004, "8_8 UNorm" },         { 0x104, "8_8 UInt" },          { 0x204, "8_8 SNorm" },
+            { 0x304, "8_8 SInt" },          { 0x804, "8_8 UIntToFloat" },   { 0xA04, "8_8 SIntToFloat" },
+            { 0x105, "32 UInt" },           { 0x305, "32 SInt" },           { 0x806, "32 Float" },
+            { 0x007, "16_16 UNorm" },       { 0x107, "16_16 UInt" },        { 0x207, "16_16 SNorm" },
+            { 0x307, "16_16 SInt" },        { 0x807, "16_16 UIntToFloat" }, { 0xA07, "16_16 SIntToFloat" },
+            { 0x808, "16_16 Float" },
+            { 0x00A, "8_8_8_8 UNorm" },     { 0x10A, "8_8_8_8 UInt" },      { 0x20A, "8_8_8_8 SNorm" },
+            { 0x30A, "8_8_8_8 SInt" },      { 0x80A, "8_8_8_8 UIntToFloat" }, { 0xA0A, "8_8_8_8 SIntToFloat" },
+            { 0x00B, "10_10_10_2 UNorm" },  { 0x10B, "10_10_10_2 UInt" },   { 0x20B, "10_10_10_2 SNorm" },
+            { 0x30B, "10_10_10_2 SInt" },
+            { 0x10C, "32_32 UInt" },        { 0x30C, "32_32 SInt" },        { 0x80D, "32_32 Float" },
+            { 0x00E, "16x4 UNorm" },        { 0x10E, "16x4 UInt" },         { 0x20E, "16x4 SNorm" },
+            { 0x30E, "16x4 SInt" },         { 0x80E, "16x4 UIntToFloat" },  { 0xA0E, "16x4 SIntToFloat" },
+            { 0x80F, "16x4 Float" },
+            { 0x110, "32x3 UInt" },         { 0x310, "32x3 SInt" },         { 0x811, "32x3 Float" },
+            { 0x112, "32x4 UInt" },         { 0x312, "32x4 SInt" },         { 0x813, "32x4 Float" },
+        };
+
+        std::mt19937 random(1234);
+        std::vector<char> data(s_uiAttribElements * (16 + s_uiAttribInterleave));
+        for (char& c : data)
+            c = static_cast<char>(random());
+
+        const SIMD::Path paths[] = { SIMD::Path::Scalar, SIMD::Path::SSE2, SIMD::Path::AVX2 };
+        bool bFailed = false;
+        printf("[Attrib] %zu elements per format, %zu bytes interleaved, MB/s of elements\n", s_uiAttribElements, s_uiAttribInterleave);
+        for (const AttribFormat& format : s_formats)
+        {
+            size_t uiSize = VertexAttrib::GetElementSize(format.uiFormat);
+            size_t uiValues = s_uiAttribElements * VertexAttrib::GetComponentCount(format.uiFormat);
+            size_t uiStride = uiSize + s_uiAttribInterleave;
+            std::vector<float> reference(uiValues), tightReference(uiValues), decoded(uiValues);
+            VertexAttrib::DecodeReference(data.data(), uiStride, s_uiAttribElements, format.uiFormat, reference.data());
+            VertexAttrib::DecodeReference(data.data(), uiSize, s_uiAttribElements, format.uiFormat, tightReference.data());
+
+            std::string line;
+            for (SIMD::Path ePath : paths)
+            {
+                if (SIMD::Resolve(ePath) != ePath)
+                    continue;
+
+                double fBest = 0.0;
+                for (int r = 0; r <= s_iRepetitions; r++)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    VertexAttrib::Decode(data.data(), uiStride, s_uiAttribElements, format.uiFormat, decoded.data(), ePath);
+                    double fSeconds = Seconds(start);
+                    if (r == 1 || (r > 1 && fSeconds < fBest))
+                        fBest = fSeconds;
+                }
+                bool bExact = memcmp(decoded.data(), reference.data(), uiValues * sizeof(float)) == 0;
+                VertexAttrib::Decode(data.data(), uiSize, s_uiAttribElements, format.uiFormat, decoded.data(), ePath);
+                bExact &= memcmp(decoded.data(), tightReference.data(), uiValues * sizeof(float)) == 0;
+                bFailed |= !bExact;
+
+                char szResult[64];
+                snprintf(szResult, sizeof(szResult), ", %s %.0f%s", SIMD::GetPathName(ePath), MegaBytesPerSecond(s_uiAttribElements * uiSize, fBest),
+                    bExact ? "" : " DIFFERS");
+                line += szResult;
+            }
+            printf("[Attrib] 0x%03X %s%s\n", format.uiFormat, format.szName, line.c_str());
+        }
+        printf("[Attrib] %s\n", bFailed ? "some paths differ from the reference" : "every path is bit exact");
+
+        // The paths that run here, the random data can't tell a conversion wrong on every path apart
+        std::vector<SIMD::Path> runPaths;
+        for (SIMD::Path ePath : paths)
+        {
+            if (SIMD::Resolve(ePath) == ePath)
+                runPaths.push_back(ePath);
+        }
+        bFailed |= !CheckAttribValues(runPaths.data(), runPaths.size());
+        return bFailed ? 1 : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Index buffer decoding of every index format and triangle primitive, once with a first vertex that keeps the
+    // faces 16 bit and once with one that takes them to 32 bit. Each path is timed and checked to match the reference
+    // decoder index for index.
+    static int RunIndexBuffer()
+    {
+        struct IndexFormat
+        {
+            LODMesh::GX2IndexFormat eFormat;
+            const char*             szName;
+        };
+
+        struct PrimitiveType
+        {
+            LODMesh::GX2PrimitiveType eType;
+            const char*               szName;
+        };
+
+        static const IndexFormat s_formats[] =
+        {
+            { LODMesh::GX2IndexFormat::UInt16,             "UInt16"   },
+            { LODMesh::GX2IndexFormat::UInt16LittleEndian, "UInt16LE" },
+            { LODMesh::GX2IndexFormat::UInt32,             "UInt32"   },
+            { LODMesh::GX2IndexFormat::UInt32LittleEndian, "UInt32LE" },
+        };
+
+        static const PrimitiveType s_primitiveTypes[] =
+        {
+            { LODMesh::GX2PrimitiveType::Triangles,     "Triangles"     },
+            { LODMesh::GX2PrimitiveType::TriangleStrip, "TriangleStrip" },
+            { LODMesh::GX2PrimitiveType::TriangleFan,   "TriangleFan"   },
+            { LODMesh::GX2PrimitiveType::Quads,         "Quads"         },
+            { LODMesh::GX2PrimitiveType::QuadStrip,     "QuadStrip"     },
+        };
+
+        static const uint32 s_firstVertices[] = { 1000, 70000 };
+
+        std::mt19937 random(1234);
+        std::vector<uint32> indices(s_uiIndexCount);
+        for (size_t i = 0; i < indices.size(); i++)
+            indices[i] = i % s_uiIndexRepeat == s_uiIndexRepeat - 1 ? indices[i - 1] : random() % s_uiIndexVertices;
+
+        const SIMD::Path paths[] = { SIMD::Path::Scalar, SIMD::Path::SSE2, SIMD::Path::AVX2 };
+        bool bFailed = false;
+        printf("[Index] %zu indices per format and primitive, M indices/s\n", s_uiIndexCount);
+        for (const IndexFormat& format : s_formats)
+        {
+            // The indices as the format stores them
+            uint32 uiSize = IndexBuffer::GetIndexSize(format.eFormat);
+            bool bBigEndian = format.eFormat == LODMesh::GX2IndexFormat::UInt16 || format.eFormat == LODMesh::GX2IndexFormat::UInt32;
+            std::vector<char> data(s_uiIndexCount * uiSize);
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                for (uint32 b = 0; b < uiSize; b++)
+                    data[uiSize * i + b] = static_cast<char>(indices[i] >> (8 * (bBigEndian ? uiSize - 1 - b : b)));
+            }
+
+            for (const PrimitiveType& primitiveType : s_primitiveTypes)
+            {
+                for (uint32 uiFirstVertex : s_firstVertices)
+                {
+                    FaceIndices reference, decoded;
+                    IndexBuffer::DecodeReference(data.data(), s_uiIndexCount, format.eFormat, primitiveType.eType, uiFirstVertex, reference);
+
+                    std::string line;
+                    for (SIMD::Path ePath : paths)
+                    {
+                        if (SIMD::Resolve(ePath) != ePath)
+                            continue;
+
+                        double fBest = 0.0;
+                        for (int r = 0; r <= s_iRepetitions; r++)
+                        {
+                            auto start = std::chrono::steady_clock::now();
+                            IndexBuffer::Decode(data.data(), s_uiIndexCount, format.eFormat, primitiveType.eType, uiFirstVertex, decoded, ePath);
+                            double fSeconds = Seconds(start);
+                            if (r == 1 || (r > 1 && fSeconds < fBest))
+                                fBest = fSeconds;
+                        }
+                        bool bExact = decoded.indices16 == reference.indices16 && decoded.indices32 == reference.indices32;
+                        bFailed |= !bExact;
+
+                        char szResult[64];
+                        snprintf(szResult, sizeof(szResult), ", %s %.0f%s", SIMD::GetPathName(ePath), s_uiIndexCount / fBest / 1e6,
+                            bExact ? "" : " DIFFERS");
+                        line += szResult;
+                    }
+                    printf("[Index] %s %s +%u, %zu %s bit%s\n", format.szName, primitiveType.szName, uiFirstVertex, reference.size(),
+                        reference.indices32.empty() ? "16" : "32", line.c_str());
+                }
+            }
+        }
+        printf("[Index] %s\n", bFailed ? "some paths differ from the reference" : "every path matches the reference");
+        return bFailed ? 1 : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Layer array widening of the attribute layouts the writer fills, over a whole stream and gathered through the
+    // vertex list of an LOD. Each path is timed and checked to be bit exact against the reference.
+    static int RunLayerArray()
+    {
+        struct LayerCase
+        {
+            uint32      uiSrcComponents;
+            uint32      uiDstComponents;
+            bool        bFlipV;
+            const char* szName;
+        };
+
+        static const LayerCase s_cases[] =
+        {
+            { 3, 4, false, "3 -> 4 position, normal" },
+            { 2, 2, false, "2 -> 2 UV" },
+            { 2, 2, true,  "2 -> 2 UV flipped" },
+            { 4, 4, false, "4 -> 4 tangent, color" },
+        };
+
+        // Random components, zeros of both signs included, and an ascending vertex list
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+        std::vector<float> data(s_uiLayerElements * 4);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = i % 61 == 0 ? (i % 2 ? -0.0f : 0.0f) : distribution(random);
+        std::vector<uint32> elements;
+        for (uint32 i = 0; i < s_uiLayerElements; i++)
+        {
+            if (random() % s_uiLayerStep == 0)
+                elements.push_back(i);
+        }
+
+        const SIMD::Path paths[] = { SIMD::Path::Scalar, SIMD::Path::SSE2, SIMD::Path::AVX2 };
+        bool bFailed = false;
+        printf("[Layer] %zu elements per stream, %zu gathered, MB/s of doubles\n", s_uiLayerElements, elements.size());
+        for (const LayerCase& layerCase : s_cases)
+        {
+            for (int iGathered = 0; iGathered < 2; iGathered++)
+            {
+                const uint32* pElements = iGathered ? elements.data() : nullptr;
+                size_t uiCount = iGathered ? elements.size() : s_uiLayerElements;
+                size_t uiValues = uiCount * layerCase.uiDstComponents;
+                std::vector<double> reference(uiValues), widened(uiValues);
+                LayerArray::WidenReference(data.data(), layerCase.uiSrcComponents, pElements, uiCount, layerCase.uiDstComponents,
+                    layerCase.bFlipV, reference.data());
+
+                std::string line;
+                for (SIMD::Path ePath : paths)
+                {
+                    if (SIMD::Resolve(ePath) != ePath)
+                        continue;
+
+                    double fBest = 0.0;
+                    for (int r = 0; r <= s_iRepetitions; r++)
+                    {
+                        auto start = std::chrono::steady_clock::now();
+                        LayerArray::Widen(data.data(), layerCase.uiSrcComponents, pElements, uiCount, layerCase.uiDstComponents,
+                            layerCase.bFlipV, widened.data(), ePath);
+                        double fSeconds = Seconds(start);
+                        if (r == 1 || (r > 1 && fSeconds < fBest))
+                            fBest = fSeconds;
+                    }
+                    bool bExact = memcmp(widened.data(), reference.data(), uiValues * sizeof(double)) == 0;
+                    bFailed |= !bExact;
+
+                    char szResult[64];
+                    snprintf(szResult, sizeof(szResult), ", %s %.0f%s", SIMD::GetPathName(ePath), MegaBytesPerSecond(uiValues * sizeof(double), fBest),
+                        bExact ? "" : " DIFFERS");
+                    line += szResult;
+                }
+                printf("[Layer] %s%s%s\n", layerCase.szName, iGathered ? " gathered" : "", line.c_str());
+            }
+        }
+        printf("[Layer] %s\n", bFailed ? "some paths differ from the reference" : "every path is bit exact");
+        return bFailed ? 1 : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Row vector product a * b of the 3x3 parts
+    static void Multiply3x3(const double a[3][3], const double b[3][3], double result[3][3])
+    {
+        double product[3][3];
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                product[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+        memcpy(result, product, sizeof(product));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // A bone's global matrix the plain way, its parent's worked out again up the whole chain:
+    // LS * PS * LR * PR, the translation through the parent's matrix
+    static Math::matrix4D PoseReference(const FSKL& fskl, uint32 uiBone)
+    {
+        const Bone& bone = fskl.bones[uiBone];
+        Math::matrix4D parent = {};
+        for (int i = 0; i < 4; i++)
+            parent.M[i][i] = 1.0;
+        if (bone.parentIndex >= 0)
+            parent = PoseReference(fskl, bone.parentIndex);
+
+        double fX = bone.rotation.X, fY = bone.rotation.Y, fZ = bone.rotation.Z;
+        const double rotationX[3][3] = { { 1, 0, 0 }, { 0, cos(fX), sin(fX) }, { 0, -sin(fX), cos(fX) } };
+        const double rotationY[3][3] = { { cos(fY), 0, -sin(fY) }, { 0, 1, 0 }, { sin(fY), 0, cos(fY) } };
+        const double rotationZ[3][3] = { { cos(fZ), sin(fZ), 0 }, { -sin(fZ), cos(fZ), 0 }, { 0, 0, 1 } };
+        double localRotation[3][3];
+        Multiply3x3(rotationX, rotationY, localRotation);
+        Multiply3x3(localRotation, rotationZ, localRotation);
+
+        double localScale[3][3] = {}, parentScale[3][3] = {}, parentRotation[3][3];
+        localScale[0][0] = bone.scale.X;
+        localScale[1][1] = bone.scale.Y;
+        localScale[2][2] = bone.scale.Z;
+        for (int i = 0; i < 3; i++)
+        {
+            parentScale[i][i] = sqrt(parent.M[i][0] * parent.M[i][0] + parent.M[i][1] * parent.M[i][1] + parent.M[i][2] * parent.M[i][2]);
+            for (int j = 0; j < 3; j++)
+                parentRotation[i][j] = parent.M[i][j] / parentScale[i][i];
+        }
+
+        double rotationScale[3][3];
+        Multiply3x3(localScale, parentScale, rotationScale);
+        Multiply3x3(rotationScale, localRotation, rotationScale);
+        Multiply3x3(rotationScale, parentRotation, rotationScale);
+
+        Math::matrix4D global = {};
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                global.M[i][j] = rotationScale[i][j];
+        const double translation[3] = { bone.position.X, bone.position.Y, bone.position.Z };
+        for (int j = 0; j < 3; j++)
+            global.M[3][j] = translation[0] * parent.M[0][j] + translation[1] * parent.M[1][j] + translation[2] * parent.M[2][j] + parent.M[3][j];
+        global.M[3][3] = 1.0;
+        return global;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Bind pose matrices of a generated skeleton: bones stored in shuffled order so children often come before
+    // their parents, several roots, non-uniform scales and rotations about every axis. Timed and checked against
+    // the plain parent chain reference.
+    static int RunSkeletonPose()
+    {
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> angle(-3.0f, 3.0f), scale(0.5f, 2.0f), position(-10.0f, 10.0f);
+
+        // Bones are made in tree order, each under one made before it, then stored at a shuffled place
+        std::vector<uint32> places(s_uiPoseBones);
+        for (uint32 i = 0; i < s_uiPoseBones; i++)
+            places[i] = i;
+        std::shuffle(places.begin(), places.end(), random);
+
+        FSKL fskl;
+        fskl.bones.resize(s_uiPoseBones);
+        for (uint32 i = 0; i < s_uiPoseBones; i++)
+        {
+            Bone& bone = fskl.bones[places[i]];
+            bone.index = places[i];
+            bone.parentIndex = i % 1000 == 0 ? -1 : static_cast<int32>(places[random() % i]);
+            bone.rotationType = Bone::RotationType::EulerXYZ;
+            bone.scale = { scale(random), scale(random), scale(random) };
+            bone.rotation = Math::vector4F(angle(random), angle(random), angle(random), 1.0f);
+            bone.position = { position(random), position(random), position(random) };
+        }
+
+        std::vector<Math::matrix4D> globals;
+        double fBest = 0.0;
+        for (int r = 0; r <= s_iRepetitions; r++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            SkeletonPose::ComputeGlobalTransforms(fskl, globals);
+            double fSeconds = Seconds(start);
+            if (r == 1 || (r > 1 && fSeconds < fBest))
+                fBest = fSeconds;
+        }
+
+        double fMaxError = 0.0;
+        for (uint32 i = 0; i < s_uiPoseBones; i++)
+        {
+            Math::matrix4D reference = PoseReference(fskl, i);
+            for (int j = 0; j < 4; j++)
+                for (int k = 0; k < 4; k++)
+                    fMaxError = std::max(fMaxError, fabs(globals[i].M[j][k] - reference.M[j][k]) / std::max(1.0, fabs(reference.M[j][k])));
+        }
+
+        bool bFailed = fMaxError > s_fPoseTolerance;
+        printf("[Pose] %u bones in %.3f ms, largest relative error %g\n", s_uiPoseBones, fBest * 1000.0, fMaxError);
+        printf("[Pose] %s\n", bFailed ? "some bones differ from the reference" : "every bone matches the reference");
+        return bFailed ? 1 : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    int Run(int argc, char** argv)
+    {
+        // The attribute and index formats, the layer arrays and the bind pose are measured on generated data
+        if (argc > 0 && strcmp(argv[0], "attrib") == 0)
+            return RunVertexAttrib();
+        if (argc > 0 && strcmp(argv[0], "index") == 0)
+            return RunIndexBuffer();
+        if (argc > 0 && strcmp(argv[0], "layer") == 0)
+            return RunLayerArray();
+        if (argc > 0 && strcmp(argv[0], "pose") == 0)
+            return RunSkeletonPose();
+
+        if (argc < 2)
+        {
+            printf("usage: -bench yaz0|gx2|bcn <file or directory>... or -bench attrib|index|layer|pose\n");
+            return 1;
+        }
+
+        std::vector<std::string> files = CollectFiles(argc - 1, argv + 1);
+        if (strcmp(argv[0], "yaz0") == 0)
+            return RunYaz0(files);
+        if (strcmp(argv[0], "gx2") == 0)
+            return RunGX2(files);
+        if (strcmp(argv[0], "bcn") == 0)
+            return RunBCn(files);
+
+        printf("unknown benchmark %s\n", argv[0]);
+        return 1;
+    }
+
+}
@@ -0,0 +1,251 @@
+#include "DDS.h"
+#include "GX2.h"
+#include <stdio.h>
+#include <algorithm>
+
+namespace DDS
+{
+
+    static const uint32 s_uiMagic = 0x20534444; // "DDS "
+
+    enum HeaderFlags
+    {
+        eFlagCaps        = 0x1,
+        eFlagHeight      = 0x2,
+        eFlagWidth       = 0x4,
+        eFlagPitch       = 0x8,
+        eFlagPixelFormat = 0x1000,
+        eFlagMipMapCount = 0x20000,
+        eFlagLinearSize  = 0x80000
+    };
+
+    enum PixelFormatFlags
+    {
+        eFlagFourCC = 0x4
+    };
+
+    enum CapsFlags
+    {
+        eCapsComplex      = 0x8,
+        eCapsTexture      = 0x1000,
+        eCapsMipMap       = 0x400000,
+        eCaps2CubeMap     = 0x200,
+        eCaps2CubeFaces   = 0xFC00  // all six faces
+    };
+
+    enum DX10Layout
+    {
+        eDimensionTexture2D = 3,
+        eMiscTextureCube    = 0x4
+    };
+
+    struct PixelFormat
+    {
+        uint32 size;
+        uint32 flags;
+        uint32 fourCC;
+        uint32 rgbBitCount;
+        uint32 rBitMask;
+        uint32 gBitMask;
+        uint32 bBitMask;
+        uint32 aBitMask;
+    };
+
+    struct Header
+    {
+        uint32      size;
+        uint32      flags;
+        uint32      height;
+        uint32      width;
+        uint32      pitchOrLinearSize;
+        uint32      depth;
+        uint32      mipMapCount;
+        uint32      reserved1[11];
+        PixelFormat pixelFormat;
+        uint32      caps;
+        uint32      caps2;
+        uint32      caps3;
+        uint32      caps4;
+        uint32      reserved2;
+    };
+
+    struct HeaderDX10
+    {
+        uint32 dxgiFormat;
+        uint32 resourceDimension;
+        uint32 miscFlag;
+        uint32 arraySize;
+        uint32 miscFlags2;
+    };
+
+    static const uint32 s_uiFourCCDX10 = 0x30315844; // "DX10"
+
+    // GX2SurfaceFormat to DDS, a fourCC of 0 takes a DX10 header
+    struct FormatMapping
+    {
+        uint32 uiGX2Format;
+        uint32 uiFourCC;
+        uint32 uiDXGIFormat;
+    };
+
+    static const FormatMapping s_formats[] =
+    {
+        { 0x031, 0x31545844, 71 }, // BC1 UNorm, "DXT1"
+        { 0x431, 0,          72 }, // BC1 SRGB
+        { 0x032, 0x33545844, 74 }, // BC2 UNorm, "DXT3"
+        { 0x432, 0,          75 }, // BC2 SRGB
+        { 0x033, 0x35545844, 77 }, // BC3 UNorm, "DXT5"
+        { 0x433, 0,          78 }, // BC3 SRGB
+        { 0x034, 0x31495441, 80 }, // BC4 UNorm, "ATI1"
+        { 0x234, 0,          81 }, // BC4 SNorm
+        { 0x035, 0x32495441, 83 }, // BC5 UNorm, "ATI2"
+        { 0x235, 0,          84 }, // BC5 SNorm
+        { 0x001, 0,          61 }, // R8 UNorm
+        { 0x007, 0,          49 }, // R8G8 UNorm
+        { 0x207, 0,          51 }, // R8G8 SNorm
+        { 0x01A, 0,          28 }, // R8G8B8A8 UNorm
+        { 0x41A, 0,          29 }, // R8G8B8A8 SRGB
+        { 0x21A, 0,          31 }, // R8G8B8A8 SNorm
+    };
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static const FormatMapping* FindFormat(uint32 uiFormat)
+    {
+        for (const FormatMapping& mapping : s_formats)
+        {
+            if (mapping.uiGX2Format == uiFormat)
+                return &mapping;
+        }
+        return nullptr;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool IsSupported(uint32 uiFormat)
+    {
+        return FindFormat(uiFormat) != nullptr;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static const GX2::Image* FindImage(const FTEX& texture, uint32 uiLevel, uint32 uiSlice)
+    {
+        for (const GX2::Image& image : texture.images)
+        {
+            if (image.uiLevel == uiLevel && image.uiSlice == uiSlice)
+                return &image;
+        }
+        return nullptr;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool HasLevel(const FTEX& texture, uint32 uiLevel, uint32 uiSlices)
+    {
+        for (uint32 uiSlice = 0; uiSlice < uiSlices; uiSlice++)
+        {
+            if (!FindImage(texture, uiLevel, uiSlice))
+                return false;
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Write(const char* filePath, const FTEX& texture)
+    {
+        const FormatMapping* pMapping = FindFormat(texture.format);
+        if (!pMapping)
+            return false;
+        if (texture.dim != GX2::eDim2D && texture.dim != GX2::eDim2DArray && texture.dim != GX2::eDimCube)
+            return false;
+
+        const GX2::Image* pBase = FindImage(texture, 0, 0);
+        if (!pBase)
+            return false;
+
+        // Slices of level 0, cube maps have six per cube
+        uint32 uiSlices = 0;
+        while (FindImage(texture, 0, uiSlices))
+            uiSlices++;
+        bool bCube = texture.dim == GX2::eDimCube;
+        if (bCube && (uiSlices == 0 || uiSlices % 6 != 0))
+            return false;
+        uint32 uiArraySize = bCube ? uiSlices / 6 : uiSlices;
+
+        // Levels present for every slice, the rest are dropped
+        uint32 uiLevels = 1;
+        while (uiLevels < std::max(1u, texture.mipCount) && HasLevel(texture, uiLevels, uiSlices))
+            uiLevels++;
+
+        // Legacy headers can't hold arrays
+        bool bDX10 = pMapping->uiFourCC == 0 || uiArraySize > 1;
+
+        Header header = {};
+        header.size = sizeof(Header);
+        header.flags = eFlagCaps | eFlagHeight | eFlagWidth | eFlagPixelFormat;
+        header.height = texture.height;
+        header.width = texture.width;
+        header.depth = 1;
+        header.mipMapCount = uiLevels;
+        header.pixelFormat.size = sizeof(PixelFormat);
+        header.pixelFormat.flags = eFlagFourCC;
+        header.pixelFormat.fourCC = bDX10 ? s_uiFourCCDX10 : pMapping->uiFourCC;
+        header.caps = eCapsTexture;
+
+        // Level 0 is one row of elements for uncompressed formats, all of its blocks for BCn
+        if (GX2::IsBlockCompressed(texture.format))
+        {
+            header.flags |= eFlagLinearSize;
+            header.pitchOrLinearSize = static_cast<uint32>(pBase->data.size());
+        }
+        else
+        {
+            header.flags |= eFlagPitch;
+            header.pitchOrLinearSize = pBase->uiWidth * pBase->uiBytesPerElement;
+        }
+        if (uiLevels > 1)
+        {
+            header.flags |= eFlagMipMapCount;
+            header.caps |= eCapsComplex | eCapsMipMap;
+        }
+        if (bCube)
+        {
+            header.caps |= eCapsComplex;
+            header.caps2 = eCaps2CubeMap | eCaps2CubeFaces;
+        }
+
+        HeaderDX10 headerDX10 = {};
+        headerDX10.dxgiFormat = pMapping->uiDXGIFormat;
+        headerDX10.resourceDimension = eDimensionTexture2D;
+        headerDX10.miscFlag = bCube ? eMiscTextureCube : 0;
+        headerDX10.arraySize = uiArraySize;
+
+        FILE* pFile = fopen(filePath, "wb");
+        if (!pFile)
+            return false;
+
+        bool bWritten = fwrite(&s_uiMagic, sizeof(s_uiMagic), 1, pFile) == 1 && fwrite(&header, sizeof(header), 1, pFile) == 1;
+        if (bDX10)
+            bWritten = bWritten && fwrite(&headerDX10, sizeof(headerDX10), 1, pFile) == 1;
+
+        // DDS stores every slice with its mip chain, one after the other
+        for (uint32 uiSlice = 0; uiSlice < uiSlices && bWritten; uiSlice++)
+        {
+            for (uint32 uiLevel = 0; uiLevel < uiLevels && bWritten; uiLevel++)
+            {
+                const GX2::Image* pImage = FindImage(texture, uiLevel, uiSlice);
+                bWritten = fwrite(pImage->data.data(), 1, pImage->data.size(), pFile) == pImage->data.size();
+            }
+        }
+
+        return fclose(pFile) == 0 && bWritten;
+    }
+
+}
@@ -1,9 +1,14 @@
 #include "FBXWriter.h"
+#include <algorithm>
 #include <iostream>
 #include "ConsoleColor.h"
 #include "Primitives.h"
 #include "assert.h"
 #include "Globals.h"
+#include "LayerArray.h"
+#include "SkeletonPose.h"
+#include "SkinBuilder.h"
+#include "VertexRemap.h"
 
 FBXWriter::FBXWriter()
 {
@@ -14,6 +19,8 @@ FBXWriter::~FBXWriter()
 }
 
 bool FBXWriter::g_bWriteTextures = false;
+bool FBXWriter::g_bDDSTextures = false;
+std::set<std::string> FBXWriter::g_RejectedDDSTextures;
 std::map<std::string, FbxSurfacePhong*> FBXWriter::g_MaterialMap;
 std::map<std::string, FbxFileTexture*> FBXWriter::g_TextureMap;
 // -----------------------------------------------------------------------
@@ -22,7 +29,7 @@ void FBXWriter::CreateFBX(FbxScene*& pScene, const BFRES& bfres)
 {
     for (uint32 i = 0; i < bfres.fmdl.size(); i++)
     {
-        WriteModel(pScene, bfres.fmdl[i], i, false);
+        WriteModel(pScene, bfres.fmdl[i], false);
     }
 
     for (const Anim& anim : bfres.fska.anims)
@@ -56,7 +63,7 @@ void FBXWriter::WriteAnimations(FbxScene*& pScene, const Anim& anim)
     for (const BoneAnim& boneAnim : anim.m_vBoneAnims)
     {
         // Get bone that matches boneAnim name
-        FbxNode* pBone = pScene->FindNodeByName(boneAnim.m_szName.c_str());
+        FbxNode* pBone = FindBoneNode(boneAnim);
         assert(pBone);
         if (pBone)
         {
@@ -73,6 +80,32 @@ void FBXWriter::WriteAnimations(FbxScene*& pScene, const Anim& anim)
 }
 
 
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// The bone of the skeletons written so far a bone anim animates, NULL if there is none. A name is bound to its
+// node the first time and taken from there for the other anims of the file.
+FbxNode* FBXWriter::FindBoneNode(const BoneAnim& boneAnim)
+{
+    std::string_view szName(boneAnim.m_szName);
+    std::unordered_map<std::string_view, FbxNode*>::const_iterator binding = m_boneAnimBindings.find(szName);
+    if (binding != m_boneAnimBindings.end())
+        return binding->second;
+
+    for (const SkeletonNodes& skeleton : m_skeletons)
+    {
+        std::unordered_map<std::string_view, uint32>::const_iterator iter = skeleton.boneIndices.find(szName);
+        if (iter == skeleton.boneIndices.end())
+            continue;
+
+        // Keyed by the node's own name, which outlives the anim's
+        FbxNode* pBone = skeleton.boneNodes[iter->second];
+        m_boneAnimBindings.emplace(pBone->GetName(), pBone);
+        return pBone;
+    }
+    return NULL;
+}
+
+
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
 void FBXWriter::CreateScaleAnimCurveNode(FbxAnimLayer*& pAnimLayer, FbxNode*& pBone, const BoneAnim& boneAnim)
@@ -157,31 +190,40 @@ void FBXWriter::AddKeyFramesToAnimCurve(FbxAnimCurve*& pAnimCurve, const AnimTra
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
-void FBXWriter::WriteModel(FbxScene*& pScene, const FMDL& fmdl, uint32 fmdlIndex, bool onlySkeleton)
+void FBXWriter::WriteModel(FbxScene*& pScene, const FMDL& fmdl, bool onlySkeleton)
 {
     // Create an array to store the smooth and rigid bone indices
     std::vector<BoneMetadata> boneInfoList(fmdl.fskl.boneList.size());
 
-    WriteSkeleton(pScene, fmdl.fskl, boneInfoList);
+    m_skeletons.push_back(WriteSkeleton(pScene, fmdl.fskl, boneInfoList));
+    const SkeletonNodes& skeleton = m_skeletons.back();
 
+    m_boundBones.assign(skeleton.boneNodes.size(), false);
+    m_boundMeshNodes.clear();
     if( !onlySkeleton )
     {
         for (uint32 i = 0; i < fmdl.fshps.size(); i++)
         {
-            WriteShape(pScene, fmdl, fmdl.fshps[i], boneInfoList, fmdlIndex);
+            WriteShape(pScene, fmdl, fmdl.fshps[i], boneInfoList, skeleton);
         }
     }
+
+    // One bind pose for all the model's meshes
+    WriteBindPose(pScene, fmdl.name.c_str(), skeleton);
 }
 
 bool g_RootBoneCreated = false;
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
-void FBXWriter::WriteSkeleton(FbxScene*& pScene, const FSKL& fskl, std::vector<BoneMetadata>& boneInfoList)
+// Returns the nodes of the bones, empty when the skeleton isn't written
+FBXWriter::SkeletonNodes FBXWriter::WriteSkeleton(FbxScene*& pScene, const FSKL& fskl, std::vector<BoneMetadata>& boneInfoList)
 {
+    SkeletonNodes skeleton;
+
     // two root bone, ue cannot handle
     if(fskl.bones.size() == 1 && !fskl.bones[0].useRigidMatrix && !fskl.bones[0].useSmoothMatrix)
     {
-        return;
+        return skeleton;
     }
 
     // gameknife mod, ue only support single root bone, so skip next root bone temp
@@ -197,6 +239,31 @@ void FBXWriter::WriteSkeleton(FbxScene*& pScene, const FSKL& fskl, std::vector<B
     for (uint32 i = 0; i < uiTotalBones; i++)
         CreateBone(pScene, fskl.bones[i], boneNodes[i], boneInfoList);
 
+    std::vector<Math::matrix4D> globals;
+    SkeletonPose::ComputeGlobalTransforms(fskl, globals);
+
+    // Skinning refers to bones by their index, which the median files state apart from the bone's place
+    skeleton.boneIndices.reserve(uiTotalBones);
+    for (uint32 i = 0; i < uiTotalBones; i++)
+    {
+        const Bone& bone = fskl.bones[i];
+        uint32 uiBoneIndex = bone.index;
+        if (uiBoneIndex >= skeleton.boneNodes.size())
+        {
+            skeleton.boneNodes.resize(uiBoneIndex + 1, NULL);
+            skeleton.boneGlobals.resize(uiBoneIndex + 1);
+            skeleton.boneParents.resize(uiBoneIndex + 1, -1);
+        }
+        skeleton.boneNodes[uiBoneIndex] = boneNodes[i];
+        skeleton.boneIndices.emplace(boneNodes[i]->GetName(), uiBoneIndex);
+        skeleton.boneParents[uiBoneIndex] = bone.parentIndex >= 0 ? static_cast<int32>(fskl.bones[bone.parentIndex].index) : -1;
+
+        FbxAMatrix& lGlobal = skeleton.boneGlobals[uiBoneIndex];
+        for (int r = 0; r < 4; r++)
+            for (int c = 0; c < 4; c++)
+                lGlobal.mData[r][c] = globals[i].M[r][c];
+    }
+
     for (uint32 i = 0; i < uiTotalBones; i++)
     {
         const Bone& bone = fskl.bones[i];
@@ -208,6 +275,8 @@ void FBXWriter::WriteSkeleton(FbxScene*& pScene, const FSKL& fskl, std::vector<B
             pScene->GetRootNode()->AddChild(boneNodes[i]);
         }
     }
+
+    return skeleton;
 }
 
 
@@ -269,15 +338,15 @@ void FBXWriter::CreateBone(FbxScene*& pScene, const Bone& bone, FbxNode*& lBoneN
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
-void FBXWriter::WriteShape(FbxScene*& pScene, const FMDL& mdl, const FSHP& fshp, std::vector<BoneMetadata>& boneListInfos, uint32 fmdlIndex)
+void FBXWriter::WriteShape(FbxScene*& pScene, const FMDL& mdl, const FSHP& fshp, std::vector<BoneMetadata>& boneListInfos, const SkeletonNodes& skeleton)
 {
-    std::string meshName = fshp.name + "_LODGroup";
+    std::string meshName = std::string(fshp.name) + "_LODGroup";
     FbxNode* lLodGroup = FbxNode::Create(pScene, meshName.c_str());
     FbxLODGroup* lLodGroupAttr = FbxLODGroup::Create(pScene, meshName.c_str());
     // Array lChildNodes contains geometries of all LOD levels
 
     // create the single material
-    FMAT* fmat = g_BFRESManager.GetMaterialByIndex(fshp.modelIndex, fshp.materialIndex);
+    const FMAT* fmat = &mdl.fmats[fshp.materialIndex];
 
     // currently we found fmat with same name but different value
     // so just add model index to name
@@ -305,7 +374,7 @@ void FBXWriter::WriteShape(FbxScene*& pScene, const FMDL& mdl, const FSHP& fshp,
 
     for (int j = 0; j < fshp.lodMeshes.size(); j++)
     {
-        WriteMesh(lMaterial, pScene, lLodGroup, fshp, fshp.lodMeshes[j], boneListInfos, fmdlIndex);
+        WriteMesh(lMaterial, pScene, lLodGroup, fshp, fshp.lodMeshes[j], boneListInfos, skeleton);
         //lLodGroupAttr->AddDisplayLevel( FbxLODGroup::EDisplayLevel::eUseLOD );
         //lLodGroupAttr->AddThreshold( 500 * j );
     }
@@ -316,12 +385,54 @@ void FBXWriter::WriteShape(FbxScene*& pScene, const FMDL& mdl, const FSHP& fshp,
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
-void FBXWriter::WriteMesh(FbxSurfacePhong* lMaterial, FbxScene*& pScene, FbxNode*& pLodGroup, const FSHP& fshp, const LODMesh& lodMesh, std::vector<BoneMetadata>& boneListInfos, uint32 fmdlIndex)
+// Vertex i of an attribute stream, the default when the shape doesn't have the attribute
+template <typename T>
+static const T& GetVertexValue(const std::pmr::vector<T>& stream, uint32 i, const T& defaultValue)
+{
+    return i < stream.size() ? stream[i] : defaultValue;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Layer element filled by control point, or null when the shape doesn't have the attribute
+template <typename T>
+static T* CreateLayerElement(FbxMesh* pMesh, const char* szName, bool bHasAttribute)
+{
+    if (!bHasAttribute)
+        return NULL;
+
+    T* pLayerElement = T::Create(pMesh, szName);
+    pLayerElement->SetMappingMode(FbxLayerElement::eByControlPoint);
+    pLayerElement->SetReferenceMode(FbxLayerElement::eDirect);
+    return pLayerElement;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Sizes the direct array of a layer element for the LOD's vertices once and widens the stream into it
+template <typename TArray, typename TValue>
+static void FillDirectArray(FbxLayerElementArrayTemplate<TArray>& directArray, const std::pmr::vector<TValue>& stream, const VertexRemap::LODVertices& lodVertices, bool bFlipV)
+{
+    static_assert(sizeof(TArray) % sizeof(double) == 0 && sizeof(TValue) % sizeof(float) == 0, "layer arrays hold doubles, streams floats");
+
+    directArray.Resize(static_cast<int>(lodVertices.vertices.size()));
+    void* pData = directArray.GetLocked();
+    LayerArray::Widen(reinterpret_cast<const float*>(stream.data()), sizeof(TValue) / sizeof(float), lodVertices.vertices.data(), lodVertices.vertices.size(),
+                      sizeof(TArray) / sizeof(double), bFlipV, static_cast<double*>(pData));
+    directArray.Release(&pData);
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void FBXWriter::WriteMesh(FbxSurfacePhong* lMaterial, FbxScene*& pScene, FbxNode*& pLodGroup, const FSHP& fshp, const LODMesh& lodMesh, std::vector<BoneMetadata>& boneListInfos, const SkeletonNodes& skeleton)
 {
     bool hasSkeleton = boneListInfos.size() > 0;
 
     uint32 uiLODIndex = pLodGroup->GetChildCount();
-    std::string meshName = fshp.name;
+    std::string meshName(fshp.name);
     meshName += "_LOD" + std::to_string(uiLODIndex);
 
     // Create a node for our mesh in the scene.
@@ -336,80 +447,77 @@ void FBXWriter::WriteMesh(FbxSurfacePhong* lMaterial, FbxScene*& pScene, FbxNode
     // Add the mesh node to the root node in the scene.
     pLodGroup->AddChild(lMeshNode);
 
+    // Only the vertices the LOD references become control points, the faces are rewritten to index them
+    const VertexStreams& vertices = fshp.vertices;
+    VertexRemap::LODVertices lodVertices;
+    size_t uiDroppedFaces = VertexRemap::Build(lodMesh.faceVertices, vertices.count, lodVertices);
+    if (uiDroppedFaces > 0)
+        std::cout << yellow << "Dropped " << uiDroppedFaces << " faces of " << meshName << " referencing missing vertices" << white << std::endl;
+
     // Initialize the control point array of the mesh.
-    uint32 uiNumControlPoints(fshp.vertices.size());
+    uint32 uiNumControlPoints(static_cast<uint32>(lodVertices.vertices.size()));
     lMesh->InitControlPoints(uiNumControlPoints);
     FbxVector4* lControlPoints = lMesh->GetControlPoints();
 
-    //Create layer elements and set mapping modes and reference modes
-    FbxLayerElementNormal* lLayerElementNormal = FbxLayerElementNormal::Create(lMesh, "_n0");
-    FbxLayerElementUV* lLayerElementUV0 = FbxLayerElementUV::Create(lMesh, "UVChannel_1");
-    FbxLayerElementUV* lLayerElementUV1 = FbxLayerElementUV::Create(lMesh, "UVChannel_2");
-    FbxLayerElementUV* lLayerElementUV2 = FbxLayerElementUV::Create(lMesh, "UVChannel_3");
-    FbxLayerElementTangent* lLayerElementTangent = FbxLayerElementTangent::Create(lMesh, "_t0");
-    FbxLayerElementBinormal* lLayerElementBinormal = FbxLayerElementBinormal::Create(lMesh, "_b0");
-    FbxLayerElementVertexColor* lLayerElementCol0 = FbxLayerElementVertexColor::Create(lMesh, "_c0");
-
-    lLayerElementNormal->SetMappingMode(FbxLayerElement::eByControlPoint);
-    lLayerElementUV0->SetMappingMode(FbxLayerElement::eByControlPoint);
-    lLayerElementUV1->SetMappingMode(FbxLayerElement::eByControlPoint);
-    lLayerElementUV2->SetMappingMode(FbxLayerElement::eByControlPoint);
-    lLayerElementTangent->SetMappingMode(FbxLayerElement::eByControlPoint);
-    lLayerElementBinormal->SetMappingMode(FbxLayerElement::eByControlPoint);
-    lLayerElementCol0->SetMappingMode(FbxLayerElement::eByControlPoint);
-
-    lLayerElementNormal->SetReferenceMode(FbxLayerElement::eDirect);
-    lLayerElementUV0->SetReferenceMode(FbxLayerElement::eDirect);
-    lLayerElementUV1->SetReferenceMode(FbxLayerElement::eDirect);
-    lLayerElementUV2->SetReferenceMode(FbxLayerElement::eDirect);
-    lLayerElementTangent->SetReferenceMode(FbxLayerElement::eDirect);
-    lLayerElementBinormal->SetReferenceMode(FbxLayerElement::eDirect);
-    lLayerElementCol0->SetReferenceMode(FbxLayerElement::eDirect);
-
-    std::map<uint32, SkinCluster> SkinClusterMap;
-
-    uint32 face = uiNumControlPoints / 3;
-    for (uint32 i = 0; i < uiNumControlPoints; i++)
+    // Create layer elements for the attributes the shape has, no layer is written for the others. The color
+    // layer carries color 1 alpha too, so either color makes it.
+    bool bHasColors = vertices.Has(VertexStreams::eColor0) || vertices.Has(VertexStreams::eColor1);
+    FbxLayerElementNormal* lLayerElementNormal = CreateLayerElement<FbxLayerElementNormal>(lMesh, "_n0", vertices.Has(VertexStreams::eNormal));
+    FbxLayerElementUV* lLayerElementUV0 = CreateLayerElement<FbxLayerElementUV>(lMesh, "UVChannel_1", vertices.Has(VertexStreams::eUV0));
+    FbxLayerElementUV* lLayerElementUV1 = CreateLayerElement<FbxLayerElementUV>(lMesh, "UVChannel_2", vertices.Has(VertexStreams::eUV1));
+    FbxLayerElementUV* lLayerElementUV2 = CreateLayerElement<FbxLayerElementUV>(lMesh, "UVChannel_3", vertices.Has(VertexStreams::eUV2));
+    FbxLayerElementTangent* lLayerElementTangent = CreateLayerElement<FbxLayerElementTangent>(lMesh, "_t0", vertices.Has(VertexStreams::eTangent));
+    FbxLayerElementBinormal* lLayerElementBinormal = CreateLayerElement<FbxLayerElementBinormal>(lMesh, "_b0", vertices.Has(VertexStreams::eBinormal));
+    FbxLayerElementVertexColor* lLayerElementCol0 = CreateLayerElement<FbxLayerElementVertexColor>(lMesh, "_c0", bHasColors);
+
+    // Default of the color missing from the color layer when only one is there
+    const Math::vector4F white = Math::vector4F{ 1, 1, 1, 1 };
+
+    // Every attribute is widened in one pass over its stream, straight into the control points or its layer's array
+    static_assert(sizeof(FbxVector4) == 4 * sizeof(double), "control points are 4 doubles");
+    LayerArray::Widen(reinterpret_cast<const float*>(vertices.position0.data()), 3, lodVertices.vertices.data(), uiNumControlPoints, 4, false,
+                      reinterpret_cast<double*>(lControlPoints));
+    if (lLayerElementNormal)
+        FillDirectArray(lLayerElementNormal->GetDirectArray(), vertices.normal, lodVertices, false);
+    if (lLayerElementUV0)
+        FillDirectArray(lLayerElementUV0->GetDirectArray(), vertices.uv0, lodVertices, FLIP_UV_VERTICAL);
+    if (lLayerElementUV1)
+        FillDirectArray(lLayerElementUV1->GetDirectArray(), vertices.uv1, lodVertices, FLIP_UV_VERTICAL);
+    if (lLayerElementUV2)
+        FillDirectArray(lLayerElementUV2->GetDirectArray(), vertices.uv2, lodVertices, FLIP_UV_VERTICAL);
+    if (lLayerElementTangent)
+        FillDirectArray(lLayerElementTangent->GetDirectArray(), vertices.tangent, lodVertices, false);
+    if (lLayerElementBinormal)
+        FillDirectArray(lLayerElementBinormal->GetDirectArray(), vertices.binormal, lodVertices, false);
+
+    // zelda use vertex color 0/1 alpha channel to blend textures, but ue only support 1 layer vcolor, so write color1 alpha to blue
+    if (lLayerElementCol0)
     {
-        const Math::vector3F& posVec = fshp.vertices[i].position0;
-        lControlPoints[i] = FbxVector4(posVec.X, posVec.Y, posVec.Z);
-
-        const Math::vector3F& normalVec = fshp.vertices[i].normal;
-        lLayerElementNormal->GetDirectArray().Add(FbxVector4(normalVec.X, normalVec.Y, normalVec.Z));
-
-#if FLIP_UV_VERTICAL
-        const Math::vector2F& uv0Vec = fshp.vertices[i].uv0;
-        lLayerElementUV0->GetDirectArray().Add(FbxVector2(uv0Vec.X, 1 - uv0Vec.Y));
-        const Math::vector2F& uv1Vec = fshp.vertices[i].uv1;
-        lLayerElementUV1->GetDirectArray().Add(FbxVector2(uv1Vec.X, 1 - uv1Vec.Y));
-        const Math::vector2F& uv2Vec = fshp.vertices[i].uv2;
-        lLayerElementUV2->GetDirectArray().Add(FbxVector2(uv2Vec.X, 1 - uv2Vec.Y));
-#else
-        const Math::vector2F& uv0Vec = fshp.vertices[ i ].uv0;
-        lLayerElementUV0->GetDirectArray().Add( FbxVector2( uv0Vec.X, uv0Vec.Y ) );
-        const Math::vector2F& uv1Vec = fshp.vertices[ i ].uv1;
-        lLayerElementUV1->GetDirectArray().Add( FbxVector2( uv1Vec.X, uv1Vec.Y ) );
-        const Math::vector2F& uv2Vec = fshp.vertices[ i ].uv2;
-        lLayerElementUV2->GetDirectArray().Add( FbxVector2( uv2Vec.X, uv2Vec.Y ) );
-#endif
-
-        const Math::vector4F& tangentVec = fshp.vertices[i].tangent;
-        lLayerElementTangent->GetDirectArray().Add(FbxVector4(tangentVec.X, tangentVec.Y, tangentVec.Z, tangentVec.W));
-
-        const Math::vector4F& binormalVec = fshp.vertices[i].binormal;
-        lLayerElementBinormal->GetDirectArray().Add(FbxVector4(binormalVec.X, binormalVec.Y, binormalVec.Z, binormalVec.W));
-
-        // zelda use vertex color 0/1 alpha channel to blend textures, but ue only support 1 layer vcolor, so write color1 alpha to 
-        const Math::vector4F& col0Vec = fshp.vertices[i].color0;
-        const Math::vector4F& col1Vec = fshp.vertices[i].color1;
-        lLayerElementCol0->GetDirectArray().Add(FbxVector4(col0Vec.X, col0Vec.Y, col1Vec.W, col0Vec.W));
-
-        if (hasSkeleton)
-            CreateSkinClusterData(fshp.vertices[i], i, SkinClusterMap, boneListInfos, fshp); // Convert the vertex-to-bone mapping to bone-to-vertex so it conforms with fbx cluster data
+        static_assert(sizeof(FbxColor) == 4 * sizeof(double), "colors are 4 doubles");
+        FbxLayerElementArrayTemplate<FbxColor>& colors = lLayerElementCol0->GetDirectArray();
+        colors.Resize(static_cast<int>(uiNumControlPoints));
+        void* pData = colors.GetLocked();
+        double* pColors = static_cast<double*>(pData);
+        if (vertices.Has(VertexStreams::eColor0))
+            LayerArray::Widen(reinterpret_cast<const float*>(vertices.color0.data()), 4, lodVertices.vertices.data(), uiNumControlPoints, 4, false, pColors);
+        else
+            std::fill(pColors, pColors + 4 * static_cast<size_t>(uiNumControlPoints), 1.0);
+        for (uint32 i = 0; i < uiNumControlPoints; i++)
+            pColors[4 * i + 2] = GetVertexValue(vertices.color1, lodVertices.vertices[i], white).W;
+        colors.Release(&pData);
     }
 
+    // Convert the vertex-to-bone mapping to bone-to-vertex so it conforms with fbx cluster data
     if (hasSkeleton)
-        WriteSkin(pScene, lMesh, SkinClusterMap, fmdlIndex);
+    {
+        std::vector<SkinBuilder::PaletteEntry> palette(boneListInfos.size());
+        for (size_t i = 0; i < boneListInfos.size(); i++)
+            palette[i] = { boneListInfos[i].uiBoneIndex, boneListInfos[i].eSkinningType == SkinningType::eRigid };
+
+        SkinBuilder::Skin skin;
+        SkinBuilder::Build(vertices, lodVertices.vertices.data(), uiNumControlPoints, fshp.vertexSkinCount, palette, skin);
+        WriteSkin(pScene, lMesh, skin, skeleton);
+    }
 
     // Create layer 0 for the mesh if it does not already exist.
     // This is where we will define our normals.
@@ -419,15 +527,22 @@ void FBXWriter::WriteMesh(FbxSurfacePhong* lMaterial, FbxScene*& pScene, FbxNode
         lMesh->CreateLayer();
         lLayer00 = lMesh->GetLayer(0);
     }
-    lLayer00->SetNormals(lLayerElementNormal);
-    lLayer00->SetUVs(lLayerElementUV0, FbxLayerElement::eTextureDiffuse);
-    lLayer00->SetUVs(lLayerElementUV1, FbxLayerElement::eTextureNormalMap);
-    lLayer00->SetUVs(lLayerElementUV2, FbxLayerElement::eTextureTransparency); // We dont know what this is used for
-    lLayer00->SetTangents(lLayerElementTangent);
-    lLayer00->SetBinormals(lLayerElementBinormal);
-    lLayer00->SetVertexColors(lLayerElementCol0);
-
-    MapFacesToVertices(lodMesh, lMesh);
+    if (lLayerElementNormal)
+        lLayer00->SetNormals(lLayerElementNormal);
+    if (lLayerElementUV0)
+        lLayer00->SetUVs(lLayerElementUV0, FbxLayerElement::eTextureDiffuse);
+    if (lLayerElementUV1)
+        lLayer00->SetUVs(lLayerElementUV1, FbxLayerElement::eTextureNormalMap);
+    if (lLayerElementUV2)
+        lLayer00->SetUVs(lLayerElementUV2, FbxLayerElement::eTextureTransparency); // We dont know what this is used for
+    if (lLayerElementTangent)
+        lLayer00->SetTangents(lLayerElementTangent);
+    if (lLayerElementBinormal)
+        lLayer00->SetBinormals(lLayerElementBinormal);
+    if (lLayerElementCol0)
+        lLayer00->SetVertexColors(lLayerElementCol0);
+
+    MapFacesToVertices(lodVertices.faces, lMesh);
 
     // TODO set materials to an LOD group, not the mesh - fix the hack
     // Set material mapping.
@@ -444,9 +559,6 @@ void FBXWriter::WriteMesh(FbxSurfacePhong* lMaterial, FbxScene*& pScene, FbxNode
     
     lMeshNode->AddMaterial(lMaterial);
     lMeshNode->SetShadingMode(FbxNode::eTextureShading);
-
-    // TODO move this function call into write animations
-    WriteBindPose(pScene, lMeshNode);
 }
 
 
@@ -454,18 +566,18 @@ void FBXWriter::WriteMesh(FbxSurfacePhong* lMaterial, FbxScene*& pScene, FbxNode
 // -----------------------------------------------------------------------
 // Currently as far as it will get. Certain things, like AO maps, are not
 // supported by FBX's Phong material as far as I can tell.
-void FBXWriter::SetTexturesToMaterial(FbxScene*& pScene, FMAT* fmat, FbxSurfacePhong* lMaterial)
+void FBXWriter::SetTexturesToMaterial(FbxScene*& pScene, const FMAT* fmat, FbxSurfacePhong* lMaterial)
 {
     for (uint32 i = 0; i < fmat->textureRefs.textureCount; i++)
     {
-        TextureRef& tex = fmat->textureRefs.textures[i];
+        const TextureRef& tex = fmat->textureRefs.textures[i];
         GX2TextureMapType type = tex.type;
         FbxTexture::ETextureUse textureUse;
         FbxString uvLayerName;
         FbxTexture::EWrapMode wrapModeX;
         FbxTexture::EWrapMode wrapModeY;
 
-        std::string& textureName = g_BFRESManager.GetTextureFromMaterialByType(fmat, type)->name;
+        const std::string textureName(g_BFRESManager.GetTextureFromMaterialByType(fmat, type)->name);
 
         // add or get texture from texturemap
         if (g_TextureMap.find(textureName) == g_TextureMap.end())
@@ -519,7 +631,8 @@ void FBXWriter::SetTexturesToMaterial(FbxScene*& pScene, FMAT* fmat, FbxSurfaceP
                 break;
             }
 
-            std::string filePath = (fbxExportPath + (std::string)"Textures/" + textureName + ".tga");
+            bool bDDS = g_bDDSTextures && g_RejectedDDSTextures.find(textureName) == g_RejectedDDSTextures.end();
+            std::string filePath = (fbxExportPath + (std::string)"Textures/" + textureName + (bDDS ? ".dds" : ".tga"));
             lTexture->SetFileName(filePath.c_str());
             lTexture->SetMappingType(FbxTexture::eUV);
             lTexture->SetMaterialUse(FbxFileTexture::eModelMaterial);
@@ -585,12 +698,12 @@ void FBXWriter::SetTexturesToMaterial(FbxScene*& pScene, FMAT* fmat, FbxSurfaceP
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
-void FBXWriter::MapFacesToVertices(const LODMesh& lodMesh, FbxMesh* lMesh)
+void FBXWriter::MapFacesToVertices(const FaceIndices& faces, FbxMesh* lMesh)
 {
     // Define which control points belong to a poly
     uint32 uiPolySize(3);
     // TODO make this iterative
-    for (uint32 i = 0; i < lodMesh.faceVertices.size(); ++i)
+    for (uint32 i = 0; i < faces.size(); ++i)
     {
         // first index
         if ((i % uiPolySize) == 0)
@@ -599,7 +712,7 @@ void FBXWriter::MapFacesToVertices(const LODMesh& lodMesh, FbxMesh* lMesh)
         }
 
         // TODO make this iterative
-        lMesh->AddPolygon(lodMesh.faceVertices[i]);
+        lMesh->AddPolygon(static_cast<int>(faces[i]));
 
         // last index
         if ((i + 1) % uiPolySize == 0)
@@ -610,189 +723,92 @@ void FBXWriter::MapFacesToVertices(const LODMesh& lodMesh, FbxMesh* lMesh)
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
-void FBXWriter::WriteSkin(FbxScene*& pScene, FbxMesh*& pMesh, std::map<uint32, SkinCluster>& BoneIndexToSkinClusterMap, uint32 fmdlIndex)
+void FBXWriter::WriteSkin(FbxScene*& pScene, FbxMesh*& pMesh, const SkinBuilder::Skin& skin, const SkeletonNodes& skeleton)
 {
     FbxSkin* pSkin = FbxSkin::Create(pScene, pMesh->GetNode()->GetName());
-    FbxAMatrix& lXMatrix = pMesh->GetNode()->EvaluateGlobalTransform();
-    const FSKL& fskl = *g_BFRESManager.GetSkeletonByModelIndex(fmdlIndex);
-
-    std::map<uint32, SkinCluster>::iterator iter = BoneIndexToSkinClusterMap.begin();
-    std::map<uint32, SkinCluster>::iterator end = BoneIndexToSkinClusterMap.end();
 
+    // Mesh nodes are never moved, they bind where the scene root is
+    FbxAMatrix lXMatrix;
+    bool bBound = false;
 
-    for (; iter != end; ++iter)
+    for (size_t r = 0; r < skin.bones.size(); r++)
     {
-        SkinCluster& skinCluster = iter->second;
-        if (skinCluster.m_vControlPointIndices.size() == 0)
-            std::string boneName = fskl.bones[iter->first].name;
-
-        FbxNode* pBoneNode = pScene->FindNodeByName(FbxString(skinCluster.m_szName.c_str()));
+        FbxNode* pBoneNode = skin.bones[r] < skeleton.boneNodes.size() ? skeleton.boneNodes[skin.bones[r]] : NULL;
         assert(pBoneNode != NULL);
+        if (pBoneNode == NULL)
+            continue;
 
-        FbxCluster* pCluster = FbxCluster::Create(pScene, skinCluster.m_szName.c_str());
+        // Clusters are named after their bone
+        const char* szBoneName = pBoneNode->GetName();
+        FbxCluster* pCluster = FbxCluster::Create(pScene, szBoneName);
         pCluster->SetLink(pBoneNode);
         // eTotalOne means Mode eTotalOne is identical to mode eNormalize except that the sum of the weights assigned to a control point is not normalized and must equal 1.0.
         // https://help.autodesk.com/view/FBX/2017/ENU/?guid=__cpp_ref_class_fbx_cluster_html
         pCluster->SetLinkMode(FbxCluster::eTotalOne);
 
-        for (uint32 uiControlPoint = 0; uiControlPoint < skinCluster.m_vControlPointIndices.size(); ++uiControlPoint)
+        // The bone's row of the skin, sized once and filled in place
+        uint32 uiFirst = skin.offsets[r];
+        uint32 uiInfluences = skin.offsets[r + 1] - uiFirst;
+        pCluster->SetControlPointIWCount(static_cast<int>(uiInfluences));
+        int* pControlPointIndices = pCluster->GetControlPointIndices();
+        double* pControlPointWeights = pCluster->GetControlPointWeights();
+        for (uint32 i = 0; i < uiInfluences; i++)
         {
-            pCluster->AddControlPointIndex(skinCluster.m_vControlPointIndices[uiControlPoint],
-                                           skinCluster.m_vControlPointWeights[uiControlPoint]);
+            pControlPointIndices[i] = static_cast<int>(skin.controlPoints[uiFirst + i]);
+            pControlPointWeights[i] = skin.weights[uiFirst + i];
         }
 
         // Now we have the mesh and the skeleton correctly positioned,
         // set the Transform and TransformLink matrix accordingly.
         pCluster->SetTransformMatrix(lXMatrix);
-        pCluster->SetTransformLinkMatrix(pBoneNode->EvaluateGlobalTransform());
+        pCluster->SetTransformLinkMatrix(skeleton.boneGlobals[skin.bones[r]]);
 
         // Add the clusters to the skin
         pSkin->AddCluster(pCluster);
+        m_boundBones[skin.bones[r]] = true;
+        bBound = true;
     }
 
     pMesh->AddDeformer(pSkin);
+    if (bBound)
+        m_boundMeshNodes.push_back(pMesh->GetNode());
 }
 
 
 // -----------------------------------------------------------------------
 // -----------------------------------------------------------------------
-// Add the specified node to the node array. Also, add recursively
-// all the parent node of the specified node to the array.
-void AddNodeRecursively(FbxArray<FbxNode*>& pNodeArray, FbxNode* pNode)
+// The bind pose of the model: every bone a cluster links to, their parents even where they deform nothing, and
+// the skinned meshes, at the matrices the clusters were bound with
+void FBXWriter::WriteBindPose(FbxScene*& pScene, const char* szName, const SkeletonNodes& skeleton)
 {
-    if (pNode)
-    {
-        AddNodeRecursively(pNodeArray, pNode->GetParent());
-
-        if (pNodeArray.Find(pNode) == -1)
-        {
-            // Node not in the list, add it
-            pNodeArray.Add(pNode);
-        }
-    }
-}
-
-// -----------------------------------------------------------------------
-// -----------------------------------------------------------------------
-void FBXWriter::WriteBindPose(FbxScene*& pScene, FbxNode*& pMeshNode)
-{
-    // In the bind pose, we must store all the link's global matrix at the time of the bind.
-    // Plus, we must store all the parent(s) global matrix of a link, even if they are not
-    // themselves deforming any model.
-
-    // In this example, since there is only one model deformed, we don't need walk through 
-    // the scene
-    //
-
-    // Now list the all the link involve in the patch deformation
-    FbxArray<FbxNode*> lClusteredFbxNodes;
-    int i, j;
-
-    if (pMeshNode && pMeshNode->GetNodeAttribute())
-    {
-        int lSkinCount = 0;
-        int lClusterCount = 0;
-
-
-        lSkinCount = ((FbxGeometry*)pMeshNode->GetNodeAttribute())->GetDeformerCount(FbxDeformer::eSkin);
-        //Go through all the skins and count them
-        //then go through each skin and get their cluster count
-        for (i = 0; i < lSkinCount; ++i)
-        {
-            FbxSkin* lSkin = (FbxSkin*)((FbxGeometry*)pMeshNode->GetNodeAttribute())->GetDeformer(i, FbxDeformer::eSkin);
-            lClusterCount += lSkin->GetClusterCount();
-        }
-
-        //if we found some clusters we must add the node
-        if (lClusterCount)
-        {
-            //Again, go through all the skins get each cluster link and add them
-            for (i = 0; i < lSkinCount; ++i)
-            {
-                FbxSkin* lSkin = (FbxSkin*)((FbxGeometry*)pMeshNode->GetNodeAttribute())->GetDeformer(i, FbxDeformer::eSkin);
-                lClusterCount = lSkin->GetClusterCount();
-                for (j = 0; j < lClusterCount; ++j)
-                {
-                    FbxNode* lClusterNode = lSkin->GetCluster(j)->GetLink();
-                    AddNodeRecursively(lClusteredFbxNodes, lClusterNode);
-                }
-            }
-
-            // Add the patch to the pose
-            lClusteredFbxNodes.Add(pMeshNode);
-        }
-    }
+    if (m_boundMeshNodes.empty())
+        return;
 
-    // Now create a bind pose with the link list
-    if (lClusteredFbxNodes.GetCount())
+    // Bound bones pull their parents in, a walk up stops at the first bone another walk already took
+    std::vector<bool> inPose(skeleton.boneNodes.size(), false);
+    for (size_t i = 0; i < m_boundBones.size(); i++)
     {
-        // A pose must be named. Arbitrarily use the name of the patch node.
-        FbxPose* lPose = FbxPose::Create(pScene, pMeshNode->GetName());
-
-        // default pose type is rest pose, so we need to set the type as bind pose
-        lPose->SetIsBindPose(true);
-
-        for (i = 0; i < lClusteredFbxNodes.GetCount(); i++)
-        {
-            FbxNode* lKFbxNode = lClusteredFbxNodes.GetAt(i);
-            FbxMatrix lBindMatrix = lKFbxNode->EvaluateGlobalTransform();
-
-            lPose->Add(lKFbxNode, lBindMatrix);
-        }
-
-        // Add the pose to the scene
-        pScene->AddPose(lPose);
+        if (!m_boundBones[i])
+            continue;
+        for (int32 iBone = static_cast<int32>(i); iBone >= 0 && !inPose[iBone]; iBone = skeleton.boneParents[iBone])
+            inPose[iBone] = true;
     }
-}
 
+    FbxPose* lPose = FbxPose::Create(pScene, szName);
 
-// -----------------------------------------------------------------------
-// -----------------------------------------------------------------------
-void FBXWriter::CreateSkinClusterData(const FVTX& vert, uint32 uiVertIndex, std::map<uint32, SkinCluster>& BoneIndexToSkinClusterMap, std::vector<BoneMetadata>& boneListInfos, const FSHP& fshp)
-{
-    uint32 uiBlendIndices[4] = {vert.blendIndex.X, vert.blendIndex.Y, vert.blendIndex.Z, vert.blendIndex.W};
-    float fBlendWeights[4] = {vert.blendWeights.X, vert.blendWeights.Y, vert.blendWeights.Z, vert.blendWeights.W};
-
-    if (boneListInfos[uiBlendIndices[0]].eSkinningType == SkinningType::eRigid)
-    {
-        std::map<uint32, SkinCluster>::iterator iter = BoneIndexToSkinClusterMap.find(boneListInfos[uiBlendIndices[0]].uiBoneIndex); // Try to find a skin cluster with the given bone index
+    // default pose type is rest pose, so we need to set the type as bind pose
+    lPose->SetIsBindPose(true);
 
-        if (iter != BoneIndexToSkinClusterMap.end()) // If found a skin cluster with the given bone index
-        {
-            iter->second.m_vControlPointIndices.push_back(uiVertIndex);
-            iter->second.m_vControlPointWeights.push_back(1);
-        }
-        else // Create new cluster with data
-        {
-            SkinCluster skinCluster;
-            skinCluster.m_szName = boneListInfos[uiBlendIndices[0]].szName;
-            skinCluster.m_vControlPointIndices.push_back(uiVertIndex);
-            skinCluster.m_vControlPointWeights.push_back(1);
-            BoneIndexToSkinClusterMap.insert(std::pair<uint32, SkinCluster>(boneListInfos[uiBlendIndices[0]].uiBoneIndex, skinCluster));
-        }
-    }
-    else if (boneListInfos[uiBlendIndices[0]].eSkinningType == SkinningType::eSmooth)
+    // The scene root and the meshes under it sit at the origin
+    FbxMatrix lIdentity;
+    lPose->Add(pScene->GetRootNode(), lIdentity);
+    for (size_t i = 0; i < inPose.size(); i++)
     {
-        for (uint32 uiBlendEntry = 0; uiBlendEntry < fshp.vertexSkinCount; ++uiBlendEntry)
-        {
-            if (fBlendWeights[uiBlendEntry] > 0) // Only write blend weights that are non-zero and that have not already had weights written for this bone index
-            {
-                std::map<uint32, SkinCluster>::iterator iter = BoneIndexToSkinClusterMap.find(boneListInfos[uiBlendIndices[uiBlendEntry]].uiBoneIndex); // Try to find a skin cluster with the given bone index
-
-                if (iter != BoneIndexToSkinClusterMap.end()) // If found a skin cluster with the given bone index
-                {
-                    iter->second.m_vControlPointIndices.push_back(uiVertIndex);
-                    iter->second.m_vControlPointWeights.push_back(fBlendWeights[uiBlendEntry]);
-                }
-                else // Create new cluster with data
-                {
-                    SkinCluster skinCluster;
-                    skinCluster.m_szName = boneListInfos[uiBlendIndices[uiBlendEntry]].szName;
-                    skinCluster.m_vControlPointIndices.push_back(uiVertIndex);
-                    skinCluster.m_vControlPointWeights.push_back(fBlendWeights[uiBlendEntry]);
-                    BoneIndexToSkinClusterMap.insert(std::pair<uint32, SkinCluster>(boneListInfos[uiBlendIndices[uiBlendEntry]].uiBoneIndex, skinCluster));
-                }
-            }
-        }
+        if (inPose[i] && skeleton.boneNodes[i] != NULL)
+            lPose->Add(skeleton.boneNodes[i], FbxMatrix(skeleton.boneGlobals[i]));
     }
+    for (FbxNode* pMeshNode : m_boundMeshNodes)
+        lPose->Add(pMeshNode, lIdentity);
+
+    pScene->AddPose(lPose);
 }
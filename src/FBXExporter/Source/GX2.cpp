@@ -0,0 +1,949 @@
+#include "GX2.h"
+#include "ThreadPool.h"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+namespace GX2
+{
+
+    // Latte's memory configuration, as GX2 sets addrlib up
+    static const uint32 s_uiBanks               = 4;
+    static const uint32 s_uiBankBits            = 2;
+    static const uint32 s_uiPipes               = 2;
+    static const uint32 s_uiPipeBits            = 1;
+    static const uint32 s_uiPipeInterleaveBytes = 256;
+    static const uint32 s_uiPipeInterleaveBits  = 8;
+    static const uint32 s_uiRowSize             = 2048;
+    static const uint32 s_uiSwapSize            = 256;
+    static const uint32 s_uiSplitSize           = 2048;
+
+    static const uint32 s_uiMicroTilePixels     = 64;
+    static const uint32 s_uiMicroTileWidth      = 8;
+    static const uint32 s_uiMicroTileHeight     = 8;
+
+    // Bank and pipe of an element repeat every 32 columns and 64 rows, the period of the tables below
+    static const uint32 s_uiTablePitch          = 32;
+    static const uint32 s_uiTableHeight         = 64;
+
+    static const uint32 s_uiBankSwapOrder[] = { 0, 1, 3, 2 };
+
+    // GX2SurfaceUse bit that selects the depth buffer layout within micro tiles
+    static const uint32 s_uiUseDepthBuffer = 4;
+
+    enum FormatLayout
+    {
+        eFormatMask = 0x3F, // the hardware format, the rest of GX2SurfaceFormat selects the number type
+        eFormatBC1  = 0x31,
+        eFormatBC5  = 0x35
+    };
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint32 GetBitsPerElement(uint32 uiFormat)
+    {
+        uint32 uiHwFormat = uiFormat & eFormatMask;
+        if (uiHwFormat >= 0x01 && uiHwFormat <= 0x03) return 8;   // 8, 4_4, 3_3_2
+        if (uiHwFormat >= 0x05 && uiHwFormat <= 0x0C) return 16;  // 16 to 5_5_5_1
+        if (uiHwFormat >= 0x0D && uiHwFormat <= 0x1B) return 32;  // 32 to 10_10_10_2
+        if (uiHwFormat >= 0x1C && uiHwFormat <= 0x20) return 64;  // X24_8_32 to 16_16_16_16
+        if (uiHwFormat == 0x22 || uiHwFormat == 0x23) return 128; // 32_32_32_32
+        if (uiHwFormat == 0x31 || uiHwFormat == 0x34) return 64;  // BC1, BC4
+        if (uiHwFormat == 0x32 || uiHwFormat == 0x33 || uiHwFormat == 0x35) return 128; // BC2, BC3, BC5
+        return 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool IsBlockCompressed(uint32 uiFormat)
+    {
+        uint32 uiHwFormat = uiFormat & eFormatMask;
+        return uiHwFormat >= eFormatBC1 && uiHwFormat <= eFormatBC5;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 NextPow2(uint32 uiValue)
+    {
+        uint32 uiPow2 = 1;
+        while (uiPow2 < uiValue)
+            uiPow2 <<= 1;
+        return uiPow2;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 AlignUp(uint32 uiValue, uint32 uiAlignment)
+    {
+        return (uiValue + uiAlignment - 1) / uiAlignment * uiAlignment;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 GetThickness(uint32 uiTileMode)
+    {
+        switch (uiTileMode)
+        {
+        case e1DTiledThick:
+        case e2DTiledThick:
+        case e2BTiledThick:
+        case e3DTiledThick:
+        case e3BTiledThick:
+            return 4;
+        default:
+            return 1;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool IsThickMacroTiled(uint32 uiTileMode)
+    {
+        return uiTileMode == e2DTiledThick || uiTileMode == e2BTiledThick || uiTileMode == e3DTiledThick || uiTileMode == e3BTiledThick;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool IsBankSwapped(uint32 uiTileMode)
+    {
+        return (uiTileMode >= e2BTiledThin1 && uiTileMode <= e2BTiledThick) || uiTileMode == e3BTiledThin1 || uiTileMode == e3BTiledThick;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 ToNonBankSwapped(uint32 uiTileMode)
+    {
+        switch (uiTileMode)
+        {
+        case e2BTiledThin1: return e2DTiledThin1;
+        case e2BTiledThin2: return e2DTiledThin2;
+        case e2BTiledThin4: return e2DTiledThin4;
+        case e2BTiledThick: return e2DTiledThick;
+        case e3BTiledThin1: return e3DTiledThin1;
+        case e3BTiledThick: return e3DTiledThick;
+        default:            return uiTileMode;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Macro tiles of the THIN2 and THIN4 modes are 2 and 4 times taller than wide, relative to THIN1
+    static uint32 GetMacroTileAspectRatio(uint32 uiTileMode)
+    {
+        switch (uiTileMode)
+        {
+        case e2DTiledThin2:
+        case e2BTiledThin2:
+            return 2;
+        case e2DTiledThin4:
+        case e2BTiledThin4:
+            return 4;
+        default:
+            return 1;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // How far bank and pipe rotate from one slice to the next
+    static uint32 GetRotation(uint32 uiTileMode)
+    {
+        if (uiTileMode >= e2DTiledThin1 && uiTileMode <= e2BTiledThick)
+            return s_uiPipes * ((s_uiBanks >> 1) - 1);
+        if (uiTileMode >= e3DTiledThin1 && uiTileMode <= e3BTiledThick)
+            return 1;
+        return 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Position of a texel within its micro tile; the bit order depends on the element size
+    static uint32 GetPixelIndexWithinMicroTile(uint32 uiX, uint32 uiY, uint32 uiZ, uint32 uiBpp, uint32 uiTileMode, bool bIsDepth)
+    {
+        uint32 uiBits[9] = {};
+        uint32 x0 = uiX & 1, x1 = (uiX >> 1) & 1, x2 = (uiX >> 2) & 1;
+        uint32 y0 = uiY & 1, y1 = (uiY >> 1) & 1, y2 = (uiY >> 2) & 1;
+
+        if (bIsDepth)
+        {
+            uiBits[0] = x0; uiBits[1] = y0; uiBits[2] = x1; uiBits[3] = y1; uiBits[4] = x2; uiBits[5] = y2;
+        }
+        else if (uiBpp == 8)
+        {
+            uiBits[0] = x0; uiBits[1] = x1; uiBits[2] = x2; uiBits[3] = y1; uiBits[4] = y0; uiBits[5] = y2;
+        }
+        else if (uiBpp == 16)
+        {
+            uiBits[0] = x0; uiBits[1] = x1; uiBits[2] = x2; uiBits[3] = y0; uiBits[4] = y1; uiBits[5] = y2;
+        }
+        else if (uiBpp == 64)
+        {
+            uiBits[0] = x0; uiBits[1] = y0; uiBits[2] = x1; uiBits[3] = x2; uiBits[4] = y1; uiBits[5] = y2;
+        }
+        else if (uiBpp == 128)
+        {
+            uiBits[0] = y0; uiBits[1] = x0; uiBits[2] = x1; uiBits[3] = x2; uiBits[4] = y1; uiBits[5] = y2;
+        }
+        else
+        {
+            uiBits[0] = x0; uiBits[1] = x1; uiBits[2] = y0; uiBits[3] = x2; uiBits[4] = y1; uiBits[5] = y2;
+        }
+
+        uint32 uiThickness = GetThickness(uiTileMode);
+        if (uiThickness > 1)
+        {
+            uiBits[6] = uiZ & 1;
+            uiBits[7] = (uiZ >> 1) & 1;
+        }
+        if (uiThickness == 8)
+            uiBits[8] = (uiZ >> 2) & 1;
+
+        uint32 uiIndex = 0;
+        for (uint32 i = 0; i < 9; i++)
+            uiIndex |= uiBits[i] << i;
+        return uiIndex;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 GetPipeFromCoord(uint32 uiX, uint32 uiY)
+    {
+        return ((uiY >> 3) ^ (uiX >> 3)) & 1;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 GetBankFromCoord(uint32 uiX, uint32 uiY)
+    {
+        uint32 uiBankBit0 = ((uiY / (16 * s_uiPipes)) ^ (uiX >> 3)) & 1;
+        uint32 uiBankBit1 = ((uiY / (8 * s_uiPipes)) ^ (uiX >> 4)) & 1;
+        return uiBankBit0 | (uiBankBit1 << 1);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Width in elements after which the bank swapped modes swap banks
+    static uint32 GetBankSwappedWidth(uint32 uiTileMode, uint32 uiBpp, uint32 uiNumSamples, uint32 uiPitch)
+    {
+        if (!IsBankSwapped(uiTileMode))
+            return 0;
+
+        uint32 uiBytesPerSample = 8 * uiBpp;
+        uint32 uiSamplesPerTile = s_uiSplitSize / uiBytesPerSample;
+        uint32 uiSlicesPerTile = std::max(1u, uiSamplesPerTile ? uiNumSamples / uiSamplesPerTile : uiNumSamples);
+        if (IsThickMacroTiled(uiTileMode))
+            uiNumSamples = 4;
+
+        uint32 uiBytesPerTileSlice = uiNumSamples * uiBytesPerSample / uiSlicesPerTile;
+        uint32 uiSwapTiles = std::max(1u, (s_uiSwapSize >> 1) / uiBpp);
+        uint32 uiSwapWidth = uiSwapTiles * 8 * s_uiBanks;
+        uint32 uiHeightBytes = uiNumSamples * GetMacroTileAspectRatio(uiTileMode) * s_uiPipes * uiBpp / uiSlicesPerTile;
+        uint32 uiSwapMax = s_uiPipes * s_uiBanks * s_uiRowSize / uiHeightBytes;
+        uint32 uiSwapMin = s_uiPipeInterleaveBytes * 8 * s_uiBanks / uiBytesPerTileSlice;
+
+        uint32 uiBankSwapWidth = std::min(uiSwapMax, std::max(uiSwapMin, uiSwapWidth));
+        while (uiBankSwapWidth >= 2 * uiPitch)
+            uiBankSwapWidth >>= 1;
+        return uiBankSwapWidth;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Mip levels smaller than a macro tile fall back to micro tiling, and thick modes need 4 slices
+    static uint32 GetMipLevelTileMode(uint32 uiBaseTileMode, uint32 uiBpp, uint32 uiLevel, uint32 uiWidth, uint32 uiHeight, uint32 uiSlices, uint32 uiNumSamples, bool bIsDepth, bool bNoRecursion)
+    {
+        uint32 uiTileMode = uiBaseTileMode;
+        if (uiTileMode == e2DTiledThick && (uiNumSamples > 1 || bIsDepth))
+            uiTileMode = e2DTiledThin1;
+        else if (uiTileMode == e3DTiledThick && (uiNumSamples > 1 || bIsDepth))
+            uiTileMode = e3DTiledThin1;
+
+        if (bNoRecursion || uiLevel == 0)
+            return uiTileMode;
+
+        uiWidth = NextPow2(uiWidth);
+        uiHeight = NextPow2(uiHeight);
+        uiSlices = NextPow2(uiSlices);
+
+        uiTileMode = ToNonBankSwapped(uiTileMode);
+        uint32 uiMicroTileBytes = (uiNumSamples * uiBpp * (GetThickness(uiTileMode) << 6) + 7) >> 3;
+        uint32 uiWidthAlignFactor = uiMicroTileBytes < s_uiPipeInterleaveBytes ? s_uiPipeInterleaveBytes / uiMicroTileBytes : 1;
+        uint32 uiMacroTileWidth = 8 * s_uiBanks;
+        uint32 uiMacroTileHeight = 8 * s_uiPipes;
+
+        switch (uiTileMode)
+        {
+        case e2DTiledThin1:
+        case e3DTiledThin1:
+            if (uiWidthAlignFactor * uiMacroTileWidth > uiWidth || uiMacroTileHeight > uiHeight)
+                uiTileMode = e1DTiledThin1;
+            break;
+        case e2DTiledThin2:
+            if (uiWidthAlignFactor * (uiMacroTileWidth >> 1) > uiWidth || uiMacroTileHeight * 2 > uiHeight)
+                uiTileMode = e1DTiledThin1;
+            break;
+        case e2DTiledThin4:
+            if (uiWidthAlignFactor * (uiMacroTileWidth >> 2) > uiWidth || uiMacroTileHeight * 4 > uiHeight)
+                uiTileMode = e1DTiledThin1;
+            break;
+        case e2DTiledThick:
+        case e3DTiledThick:
+            if (uiWidthAlignFactor * uiMacroTileWidth > uiWidth || uiMacroTileHeight > uiHeight)
+                uiTileMode = e1DTiledThick;
+            break;
+        }
+
+        if (uiSlices < 4)
+        {
+            if (uiTileMode == e1DTiledThick)
+                uiTileMode = e1DTiledThin1;
+            else if (uiTileMode == e2DTiledThick)
+                uiTileMode = e2DTiledThin1;
+            else if (uiTileMode == e3DTiledThick)
+                uiTileMode = e3DTiledThin1;
+        }
+        return GetMipLevelTileMode(uiTileMode, uiBpp, uiLevel, uiWidth, uiHeight, uiSlices, uiNumSamples, bIsDepth, true);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void PadDimensions(uint32 uiTileMode, uint32 uiPadDims, bool bCube, uint32 uiPitchAlign, uint32 uiHeightAlign, uint32 uiSliceAlign, LevelInfo& info)
+    {
+        uint32 uiThickness = GetThickness(uiTileMode);
+        if (uiPadDims == 0)
+            uiPadDims = 3;
+
+        info.pitch = AlignUp(info.pitch, uiPitchAlign);
+        if (uiPadDims > 1)
+            info.paddedHeight = AlignUp(info.paddedHeight, uiHeightAlign);
+        if (uiPadDims > 2 || uiThickness > 1)
+        {
+            if (bCube)
+                info.paddedSlices = NextPow2(info.paddedSlices);
+            if (uiThickness > 1)
+                info.paddedSlices = AlignUp(info.paddedSlices, uiSliceAlign);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Mip levels are padded to powers of two, cube levels keep their 6 faces
+    static void PadMipLevel(uint32 uiLevel, bool bCube, uint32& uiPadDims, LevelInfo& info)
+    {
+        if (uiLevel == 0)
+            return;
+
+        info.pitch = NextPow2(info.pitch);
+        info.paddedHeight = NextPow2(info.paddedHeight);
+        if (bCube)
+            uiPadDims = info.paddedSlices <= 1 ? 2 : 0;
+        else
+            info.paddedSlices = NextPow2(info.paddedSlices);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ComputeLinearInfo(uint32 uiLevel, uint32 uiPadDims, bool bCube, LevelInfo& info)
+    {
+        PadMipLevel(uiLevel, bCube, uiPadDims, info);
+
+        // Linear aligned rows are whole pipe interleaves
+        uint32 uiPitchAlign = info.tileMode == eLinearAligned ? std::max(64u, s_uiPipeInterleaveBytes * 8 / info.bpp) : 1;
+        PadDimensions(info.tileMode, uiPadDims, bCube, uiPitchAlign, 1, 1, info);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ComputeMicroTiledInfo(uint32 uiNumSamples, uint32 uiLevel, uint32 uiPadDims, bool bCube, LevelInfo& info)
+    {
+        PadMipLevel(uiLevel, bCube, uiPadDims, info);
+        if (uiLevel != 0 && info.tileMode == e1DTiledThick && info.paddedSlices < 4)
+            info.tileMode = e1DTiledThin1;
+
+        // A row of micro tiles fills at least one pipe interleave
+        uint32 uiThickness = GetThickness(info.tileMode);
+        uint32 uiPitchAlign = std::max(8u, s_uiPipeInterleaveBytes / info.bpp / uiNumSamples / uiThickness);
+        PadDimensions(info.tileMode, uiPadDims, bCube, uiPitchAlign, s_uiMicroTileHeight, uiThickness, info);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void GetMacroTiledAlignments(uint32 uiTileMode, uint32 uiBpp, uint32 uiNumSamples, uint32& uiPitchAlign, uint32& uiHeightAlign)
+    {
+        uint32 uiAspectRatio = GetMacroTileAspectRatio(uiTileMode);
+        uint32 uiThickness = GetThickness(uiTileMode);
+        uint32 uiMacroTileWidth = 8 * s_uiBanks / uiAspectRatio;
+        uint32 uiMacroTileHeight = uiAspectRatio * 8 * s_uiPipes;
+
+        uiPitchAlign = std::max(uiMacroTileWidth, uiMacroTileWidth * (s_uiPipeInterleaveBytes / uiBpp / (8 * uiThickness) / uiNumSamples));
+        uiHeightAlign = uiMacroTileHeight;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ComputeMacroTiledInfo(uint32 uiBaseTileMode, uint32 uiNumSamples, uint32 uiLevel, uint32 uiPadDims, bool bCube, LevelInfo& info)
+    {
+        uint32 uiTileMode = info.tileMode;
+        uint32 uiUnpaddedPitch = info.pitch;
+        PadMipLevel(uiLevel, bCube, uiPadDims, info);
+
+        uint32 uiThickness = GetThickness(uiTileMode);
+        if (uiLevel != 0 && info.tileMode == e2DTiledThick && info.paddedSlices < 4)
+        {
+            info.tileMode = e2DTiledThin1;
+            uiThickness = 1;
+        }
+
+        uint32 uiPitchAlign, uiHeightAlign;
+        if (uiLevel != 0 && uiTileMode != uiBaseTileMode && IsThickMacroTiled(uiBaseTileMode) && !IsThickMacroTiled(uiTileMode))
+        {
+            // A thick surface whose level went thin still needs room for a thick macro tile, or it goes micro tiled
+            GetMacroTiledAlignments(uiBaseTileMode, info.bpp, uiNumSamples, uiPitchAlign, uiHeightAlign);
+            uint32 uiPitchAlignFactor = std::max(1u, (s_uiPipeInterleaveBytes >> 3) / info.bpp);
+            if (info.pitch < uiPitchAlign * uiPitchAlignFactor || info.paddedHeight < uiHeightAlign)
+            {
+                info.tileMode = e1DTiledThin1;
+                info.pitch = uiUnpaddedPitch;
+                info.paddedHeight = info.height;
+                info.paddedSlices = info.slices;
+                ComputeMicroTiledInfo(uiNumSamples, uiLevel, uiPadDims, bCube, info);
+                return;
+            }
+        }
+
+        GetMacroTiledAlignments(uiTileMode, info.bpp, uiNumSamples, uiPitchAlign, uiHeightAlign);
+        uiPitchAlign = std::max(uiPitchAlign, GetBankSwappedWidth(uiTileMode, info.bpp, uiNumSamples, uiUnpaddedPitch));
+        PadDimensions(uiTileMode, uiPadDims, bCube, uiPitchAlign, uiHeightAlign, uiThickness, info);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool ComputeLevelInfo(const Surface& surface, uint32 uiLevel, LevelInfo& info)
+    {
+        uint32 uiBpp = GetBitsPerElement(surface.format);
+        if (uiBpp == 0 || uiLevel >= std::max(1u, surface.numMips) || surface.width == 0 || surface.aa > 3)
+            return false;
+
+        // Texels of the level, rows and slices per surface dimension
+        uint32 uiWidth = std::max(1u, surface.width >> uiLevel);
+        uint32 uiHeight = std::max(1u, surface.height >> uiLevel);
+        uint32 uiSlices = 1;
+        switch (surface.dim)
+        {
+        case eDim1D:          uiHeight = 1; break;
+        case eDim2D:
+        case eDim2DMSAA:      break;
+        case eDim3D:          uiSlices = std::max(1u, surface.depth >> uiLevel); break;
+        case eDimCube:        uiSlices = std::max(6u, surface.depth); break;
+        case eDim1DArray:     uiHeight = 1; uiSlices = surface.depth; break;
+        case eDim2DArray:
+        case eDim2DMSAAArray: uiSlices = surface.depth; break;
+        default:              return false;
+        }
+        if (uiSlices == 0)
+            return false;
+
+        bool bBlockCompressed = IsBlockCompressed(surface.format);
+        uint32 uiBlockSize = bBlockCompressed ? 4 : 1;
+        uint32 uiNumSamples = 1u << surface.aa;
+        bool bCube = surface.dim == eDimCube;
+
+        info.bpp = uiBpp;
+        info.width = (uiWidth + uiBlockSize - 1) / uiBlockSize;
+        info.height = (uiHeight + uiBlockSize - 1) / uiBlockSize;
+        info.slices = uiSlices;
+
+        if (surface.tileMode == eLinearSpecial)
+        {
+            info.tileMode = eLinearSpecial;
+            info.pitch = info.width;
+            info.paddedHeight = info.height;
+            info.paddedSlices = uiSlices;
+        }
+        else
+        {
+            // Block compressed levels are padded to whole blocks on level 0 and to powers of two below it
+            if (bBlockCompressed)
+            {
+                uiWidth = uiLevel == 0 ? AlignUp(uiWidth, 4) : NextPow2(uiWidth);
+                uiHeight = uiLevel == 0 ? AlignUp(uiHeight, 4) : NextPow2(uiHeight);
+                uiWidth = std::max(1u, uiWidth / 4);
+                uiHeight = std::max(1u, uiHeight / 4);
+            }
+
+            uint32 uiBaseTileMode = surface.tileMode & 0xF;
+            bool bIsDepth = (surface.use & s_uiUseDepthBuffer) != 0;
+            info.tileMode = GetMipLevelTileMode(uiBaseTileMode, uiBpp, uiLevel, uiWidth, uiHeight, uiSlices, uiNumSamples, bIsDepth, false);
+            info.pitch = uiWidth;
+            info.paddedHeight = uiHeight;
+            info.paddedSlices = uiSlices;
+
+            uint32 uiPadDims = bCube && uiLevel == 0 ? 2 : 0;
+            if (info.tileMode <= eLinearAligned)
+                ComputeLinearInfo(uiLevel, uiPadDims, bCube, info);
+            else if (info.tileMode <= e1DTiledThick)
+                ComputeMicroTiledInfo(uiNumSamples, uiLevel, uiPadDims, bCube, info);
+            else
+                ComputeMacroTiledInfo(uiBaseTileMode, uiNumSamples, uiLevel, uiPadDims, bCube, info);
+        }
+
+        info.uiSize = (static_cast<size_t>(info.pitch) * info.paddedHeight * info.paddedSlices * uiBpp * uiNumSamples + 7) / 8;
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    const char* GetLevelData(const Surface& surface, uint32 uiLevel, size_t& uiSize)
+    {
+        uiSize = 0;
+        if (uiLevel == 0)
+        {
+            uiSize = surface.pImage ? surface.uiImageSize : 0;
+            return surface.pImage;
+        }
+        if (!surface.pMips || uiLevel >= surface.numMips || uiLevel > s_uiMaxMipOffsets)
+            return nullptr;
+
+        size_t uiBegin = uiLevel == 1 ? 0 : surface.mipOffsets[uiLevel - 1];
+        size_t uiEnd = uiLevel + 1 < surface.numMips && uiLevel < s_uiMaxMipOffsets ? surface.mipOffsets[uiLevel] : surface.uiMipSize;
+        if (uiBegin > uiEnd || uiEnd > surface.uiMipSize)
+            return nullptr;
+
+        uiSize = uiEnd - uiBegin;
+        return surface.pMips + uiBegin;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Everything the address of an element in one slice of one level depends on
+    struct AddressParams
+    {
+        LevelInfo info;
+        uint32    uiSlice;
+        uint32    uiNumSamples;
+        bool      bIsDepth;
+        uint32    uiPipeSwizzle;
+        uint32    uiBankSwizzle;
+    };
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static size_t ComputeLinearAddress(const AddressParams& params, uint32 uiX, uint32 uiY)
+    {
+        const LevelInfo& info = params.info;
+        size_t uiSliceOffset = static_cast<size_t>(info.pitch) * info.paddedHeight * params.uiSlice;
+        return (static_cast<size_t>(uiY) * info.pitch + uiX + uiSliceOffset) * (info.bpp / 8);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static size_t ComputeMicroTiledAddress(const AddressParams& params, uint32 uiX, uint32 uiY)
+    {
+        const LevelInfo& info = params.info;
+        uint32 uiThickness = GetThickness(info.tileMode);
+        size_t uiMicroTileBytes = (s_uiMicroTilePixels * uiThickness * info.bpp + 7) / 8;
+        size_t uiMicroTileOffset = uiMicroTileBytes * ((uiX >> 3) + (uiY >> 3) * static_cast<size_t>(info.pitch >> 3));
+        size_t uiSliceBytes = (static_cast<size_t>(info.pitch) * info.paddedHeight * uiThickness * info.bpp + 7) / 8;
+        size_t uiSliceOffset = (params.uiSlice / uiThickness) * uiSliceBytes;
+
+        uint32 uiPixelIndex = GetPixelIndexWithinMicroTile(uiX, uiY, params.uiSlice, info.bpp, info.tileMode, params.bIsDepth);
+        return ((info.bpp * uiPixelIndex) >> 3) + uiMicroTileOffset + uiSliceOffset;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void GetMacroTileSize(uint32 uiTileMode, uint32& uiMacroTilePitch, uint32& uiMacroTileHeight)
+    {
+        uint32 uiAspectRatio = GetMacroTileAspectRatio(uiTileMode);
+        uiMacroTilePitch = 8 * s_uiBanks / uiAspectRatio;
+        uiMacroTileHeight = 8 * s_uiPipes * uiAspectRatio;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Sample 0 of a multisampled surface, the only one textures use
+    static size_t ComputeMacroTiledAddress(const AddressParams& params, uint32 uiX, uint32 uiY)
+    {
+        const LevelInfo& info = params.info;
+        uint32 uiThickness = GetThickness(info.tileMode);
+        uint32 uiNumSamples = params.uiNumSamples;
+        size_t uiMicroTileBits = static_cast<size_t>(uiNumSamples) * info.bpp * uiThickness * s_uiMicroTilePixels;
+        size_t uiMicroTileBytes = uiMicroTileBits >> 3;
+
+        uint32 uiPixelIndex = GetPixelIndexWithinMicroTile(uiX, uiY, params.uiSlice, info.bpp, info.tileMode, params.bIsDepth);
+        size_t uiElemOffset = params.bIsDepth ? static_cast<size_t>(uiNumSamples) * info.bpp * uiPixelIndex : static_cast<size_t>(info.bpp) * uiPixelIndex;
+
+        size_t uiNumSampleSplits = 1;
+        size_t uiSampleSlice = 0;
+        if (uiNumSamples > 1 && uiMicroTileBytes > s_uiSplitSize)
+        {
+            size_t uiSamplesPerSlice = s_uiSplitSize / (uiMicroTileBytes / uiNumSamples);
+            uiNumSampleSplits = std::max<size_t>(1, uiNumSamples / uiSamplesPerSlice);
+            uiSampleSlice = uiElemOffset / (uiMicroTileBits / uiNumSampleSplits);
+            uiElemOffset %= uiMicroTileBits / uiNumSampleSplits;
+        }
+        uiElemOffset = (uiElemOffset + 7) / 8;
+
+        // Bank and pipe come from the position, rotated per slice and moved by the surface's swizzle
+        uint32 uiBankPipe = GetPipeFromCoord(uiX, uiY) + s_uiPipes * GetBankFromCoord(uiX, uiY);
+        uint32 uiSwizzle = params.uiPipeSwizzle + s_uiPipes * params.uiBankSwizzle;
+        uint32 uiSliceIn = IsThickMacroTiled(info.tileMode) ? params.uiSlice >> 2 : params.uiSlice;
+        uiBankPipe ^= static_cast<uint32>(s_uiPipes * uiSampleSlice * ((s_uiBanks >> 1) + 1)) ^ (uiSwizzle + uiSliceIn * GetRotation(info.tileMode));
+        uiBankPipe %= s_uiPipes * s_uiBanks;
+        uint32 uiPipe = uiBankPipe % s_uiPipes;
+        uint32 uiBank = uiBankPipe / s_uiPipes;
+
+        size_t uiSliceBytes = (static_cast<size_t>(info.paddedHeight) * info.pitch * uiThickness * info.bpp * uiNumSamples + 7) / 8;
+        size_t uiSliceOffset = uiSliceBytes * ((uiSampleSlice + uiNumSampleSplits * params.uiSlice) / uiThickness);
+
+        uint32 uiMacroTilePitch, uiMacroTileHeight;
+        GetMacroTileSize(info.tileMode, uiMacroTilePitch, uiMacroTileHeight);
+        size_t uiMacroTilesPerRow = info.pitch / uiMacroTilePitch;
+        size_t uiMacroTileBytes = (static_cast<size_t>(uiNumSamples) * uiThickness * info.bpp * uiMacroTileHeight * uiMacroTilePitch + 7) / 8;
+        size_t uiMacroTileIndexX = uiX / uiMacroTilePitch;
+        size_t uiMacroTileIndexY = uiY / uiMacroTileHeight;
+        size_t uiMacroTileOffset = (uiMacroTileIndexX + uiMacroTilesPerRow * uiMacroTileIndexY) * uiMacroTileBytes;
+
+        if (IsBankSwapped(info.tileMode))
+        {
+            uint32 uiBankSwapWidth = GetBankSwappedWidth(info.tileMode, info.bpp, uiNumSamples, info.pitch);
+            size_t uiSwapIndex = uiMacroTilePitch * uiMacroTileIndexX / uiBankSwapWidth;
+            uiBank ^= s_uiBankSwapOrder[uiSwapIndex & (s_uiBanks - 1)];
+        }
+
+        // The pipe and bank bits sit right above the pipe interleave
+        size_t uiGroupMask = (1 << s_uiPipeInterleaveBits) - 1;
+        uint32 uiSwizzleBits = s_uiBankBits + s_uiPipeBits;
+        size_t uiTotalOffset = uiElemOffset + ((uiMacroTileOffset + uiSliceOffset) >> uiSwizzleBits);
+        size_t uiOffsetHigh = (uiTotalOffset & ~uiGroupMask) << uiSwizzleBits;
+        size_t uiOffsetLow = uiTotalOffset & uiGroupMask;
+        return (static_cast<size_t>(uiBank) << (s_uiPipeBits + s_uiPipeInterleaveBits)) | (static_cast<size_t>(uiPipe) << s_uiPipeInterleaveBits) | uiOffsetLow | uiOffsetHigh;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool GetAddressParams(const Surface& surface, uint32 uiLevel, uint32 uiSlice, AddressParams& params)
+    {
+        if (!ComputeLevelInfo(surface, uiLevel, params.info) || uiSlice >= params.info.slices)
+            return false;
+
+        params.uiSlice = uiSlice;
+        params.uiNumSamples = 1u << surface.aa;
+        params.bIsDepth = (surface.use & s_uiUseDepthBuffer) != 0;
+        params.uiPipeSwizzle = (surface.swizzle >> 8) & 1;
+        params.uiBankSwizzle = (surface.swizzle >> 9) & 3;
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool DeswizzleReference(const Surface& surface, uint32 uiLevel, uint32 uiSlice, char* pDst)
+    {
+        AddressParams params;
+        size_t uiSrcSize;
+        const char* pSrc = GetLevelData(surface, uiLevel, uiSrcSize);
+        if (!pSrc || !GetAddressParams(surface, uiLevel, uiSlice, params))
+            return false;
+
+        const LevelInfo& info = params.info;
+        size_t uiBytesPerElement = info.bpp / 8;
+        for (uint32 y = 0; y < info.height; y++)
+        {
+            for (uint32 x = 0; x < info.width; x++)
+            {
+                size_t uiAddress;
+                if (info.tileMode <= eLinearAligned || info.tileMode == eLinearSpecial)
+                    uiAddress = ComputeLinearAddress(params, x, y);
+                else if (info.tileMode <= e1DTiledThick)
+                    uiAddress = ComputeMicroTiledAddress(params, x, y);
+                else
+                    uiAddress = ComputeMacroTiledAddress(params, x, y);
+
+                if (uiAddress + uiBytesPerElement > uiSrcSize)
+                    return false;
+                memcpy(pDst + (static_cast<size_t>(y) * info.width + x) * uiBytesPerElement, pSrc + uiAddress, uiBytesPerElement);
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Linear rows are contiguous, one copy per row
+    static bool DeswizzleLinear(const AddressParams& params, const char* pSrc, size_t uiSrcSize, char* pDst)
+    {
+        const LevelInfo& info = params.info;
+        size_t uiRowBytes = static_cast<size_t>(info.width) * (info.bpp / 8);
+        for (uint32 y = 0; y < info.height; y++)
+        {
+            size_t uiAddress = ComputeLinearAddress(params, 0, y);
+            if (uiAddress + uiRowBytes > uiSrcSize)
+                return false;
+            memcpy(pDst + y * uiRowBytes, pSrc + uiAddress, uiRowBytes);
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // The offset of a texel within its micro tile only depends on its position in the tile, so one 8x8 table
+    // covers the slice; the micro tile's offset is added per tile.
+    template <size_t N>
+    static bool DeswizzleMicroTiled(const AddressParams& params, const char* pSrc, size_t uiSrcSize, char* pDst)
+    {
+        const LevelInfo& info = params.info;
+        uint32 uiThickness = GetThickness(info.tileMode);
+        size_t uiMicroTileBytes = (s_uiMicroTilePixels * uiThickness * info.bpp + 7) / 8;
+        size_t uiMicroTileRowBytes = uiMicroTileBytes * (info.pitch >> 3);
+        size_t uiSliceBytes = (static_cast<size_t>(info.pitch) * info.paddedHeight * uiThickness * info.bpp + 7) / 8;
+        size_t uiSliceOffset = (params.uiSlice / uiThickness) * uiSliceBytes;
+
+        // Every micro tile touched lies below the end of the last one
+        size_t uiEnd = uiSliceOffset + ((info.height - 1) >> 3) * uiMicroTileRowBytes + (((info.width - 1) >> 3) + 1) * uiMicroTileBytes;
+        if (uiEnd > uiSrcSize)
+            return false;
+
+        uint32 table[s_uiMicroTilePixels];
+        for (uint32 y = 0; y < s_uiMicroTileHeight; y++)
+        {
+            for (uint32 x = 0; x < s_uiMicroTileWidth; x++)
+                table[y * s_uiMicroTileWidth + x] = (N * 8 * GetPixelIndexWithinMicroTile(x, y, params.uiSlice, info.bpp, info.tileMode, params.bIsDepth)) >> 3;
+        }
+
+        for (uint32 y = 0; y < info.height; y++)
+        {
+            const uint32* pTableRow = table + (y & 7) * s_uiMicroTileWidth;
+            const char* pTileRow = pSrc + uiSliceOffset + (y >> 3) * uiMicroTileRowBytes;
+            char* pOut = pDst + static_cast<size_t>(y) * info.width * N;
+            for (uint32 x = 0; x < info.width; x++)
+                memcpy(pOut + x * N, pTileRow + (x >> 3) * uiMicroTileBytes + pTableRow[x & 7], N);
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Macro tiled addresses split into a part that only depends on the position within the bank/pipe pattern,
+    // which repeats every 32x64 elements and goes into a table, and per macro tile constants: its offset and
+    // the bank/pipe flips from the slice rotation, the surface swizzle and bank swapping. An element's address
+    // is its table offset plus the tile offset, with the flipped bank and pipe bits put back above the pipe
+    // interleave.
+    template <size_t N>
+    static bool DeswizzleMacroTiled(const AddressParams& params, const char* pSrc, size_t uiSrcSize, char* pDst)
+    {
+        struct TableEntry
+        {
+            uint32 uiElemOffset;
+            uint32 uiBankPipe;
+        };
+
+        const LevelInfo& info = params.info;
+        uint32 uiThickness = GetThickness(info.tileMode);
+        uint32 uiNumSamples = params.uiNumSamples;
+        size_t uiMicroTileBytes = static_cast<size_t>(uiNumSamples) * info.bpp * uiThickness * s_uiMicroTilePixels / 8;
+        size_t uiNumSampleSplits = 1;
+        if (uiNumSamples > 1 && uiMicroTileBytes > s_uiSplitSize)
+            uiNumSampleSplits = std::max<size_t>(1, uiNumSamples / (s_uiSplitSize / (uiMicroTileBytes / uiNumSamples)));
+
+        size_t uiSliceBytes = (static_cast<size_t>(info.paddedHeight) * info.pitch * uiThickness * info.bpp * uiNumSamples + 7) / 8;
+        size_t uiSliceOffset = uiSliceBytes * ((uiNumSampleSplits * params.uiSlice) / uiThickness);
+
+        uint32 uiMacroTilePitch, uiMacroTileHeight;
+        GetMacroTileSize(info.tileMode, uiMacroTilePitch, uiMacroTileHeight);
+        size_t uiMacroTilesPerRow = info.pitch / uiMacroTilePitch;
+        size_t uiMacroTileBytes = (static_cast<size_t>(uiNumSamples) * uiThickness * info.bpp * uiMacroTileHeight * uiMacroTilePitch + 7) / 8;
+
+        // Small mip levels only fill part of the table
+        std::vector<TableEntry> table(s_uiTablePitch * s_uiTableHeight);
+        uint32 uiTableWidth = std::min(info.width, s_uiTablePitch);
+        uint32 uiTableHeight = std::min(info.height, s_uiTableHeight);
+        for (uint32 y = 0; y < uiTableHeight; y++)
+        {
+            for (uint32 x = 0; x < uiTableWidth; x++)
+            {
+                uint32 uiPixelIndex = GetPixelIndexWithinMicroTile(x, y, params.uiSlice, info.bpp, info.tileMode, params.bIsDepth);
+                uint32 uiElemOffset = params.bIsDepth ? uiNumSamples * info.bpp * uiPixelIndex : info.bpp * uiPixelIndex;
+                TableEntry& entry = table[y * s_uiTablePitch + x];
+                entry.uiElemOffset = (uiElemOffset + 7) / 8;
+                entry.uiBankPipe = (GetPipeFromCoord(x, y) + s_uiPipes * GetBankFromCoord(x, y)) << s_uiPipeInterleaveBits;
+            }
+        }
+
+        // Flips shared by every tile of the slice, and the bank swap of each tile column
+        uint32 uiSwizzle = params.uiPipeSwizzle + s_uiPipes * params.uiBankSwizzle;
+        uint32 uiSliceIn = IsThickMacroTiled(info.tileMode) ? params.uiSlice >> 2 : params.uiSlice;
+        uint32 uiSliceFlip = (uiSwizzle + uiSliceIn * GetRotation(info.tileMode)) & (s_uiPipes * s_uiBanks - 1);
+        uint32 uiBankSwapWidth = IsBankSwapped(info.tileMode) ? GetBankSwappedWidth(info.tileMode, info.bpp, uiNumSamples, info.pitch) : 0;
+
+        uint32 uiTileColumns = (info.width + uiMacroTilePitch - 1) / uiMacroTilePitch;
+        std::vector<uint32> columnFlips(uiTileColumns);
+        for (uint32 i = 0; i < uiTileColumns; i++)
+        {
+            uint32 uiBankSwap = uiBankSwapWidth ? s_uiBankSwapOrder[(uiMacroTilePitch * i / uiBankSwapWidth) & (s_uiBanks - 1)] : 0;
+            columnFlips[i] = (uiSliceFlip ^ (uiBankSwap * s_uiPipes)) << s_uiPipeInterleaveBits;
+        }
+
+        const size_t uiGroupMask = (1 << s_uiPipeInterleaveBits) - 1;
+        const uint32 uiSwizzleBits = s_uiBankBits + s_uiPipeBits;
+
+        // An element lies within the pipe/bank group of its offset, so when the group of the largest offset fits
+        // the data, no element needs checking
+        uint32 uiMaxElemOffset = 0;
+        for (const TableEntry& entry : table)
+            uiMaxElemOffset = std::max(uiMaxElemOffset, entry.uiElemOffset);
+        size_t uiLastTile = ((info.height - 1) / uiMacroTileHeight) * uiMacroTilesPerRow + (uiTileColumns - 1);
+        size_t uiMaxOffset = uiMaxElemOffset + ((uiLastTile * uiMacroTileBytes + uiSliceOffset) >> uiSwizzleBits);
+        bool bCheck = (((uiMaxOffset >> s_uiPipeInterleaveBits) + 1) << (s_uiPipeInterleaveBits + uiSwizzleBits)) > uiSrcSize;
+
+        for (uint32 y = 0; y < info.height; y++)
+        {
+            const TableEntry* pTableRow = table.data() + (y % s_uiTableHeight) * s_uiTablePitch;
+            size_t uiTileRowOffset = (y / uiMacroTileHeight) * uiMacroTilesPerRow * uiMacroTileBytes + uiSliceOffset;
+            char* pOut = pDst + static_cast<size_t>(y) * info.width * N;
+
+            for (uint32 uiColumn = 0; uiColumn < uiTileColumns; uiColumn++)
+            {
+                size_t uiTileOffset = (uiTileRowOffset + uiColumn * uiMacroTileBytes) >> uiSwizzleBits;
+                uint32 uiFlip = columnFlips[uiColumn];
+                uint32 uiX = uiColumn * uiMacroTilePitch;
+                uint32 uiXEnd = std::min(info.width, uiX + uiMacroTilePitch);
+                for (; uiX < uiXEnd; uiX++)
+                {
+                    const TableEntry& entry = pTableRow[uiX % s_uiTablePitch];
+                    size_t uiTotalOffset = entry.uiElemOffset + uiTileOffset;
+                    size_t uiAddress = (entry.uiBankPipe ^ uiFlip) | (uiTotalOffset & uiGroupMask) | ((uiTotalOffset & ~uiGroupMask) << uiSwizzleBits);
+                    if (bCheck && uiAddress + N > uiSrcSize)
+                        return false;
+                    memcpy(pOut + uiX * N, pSrc + uiAddress, N);
+                }
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <size_t N>
+    static bool DeswizzleElements(const AddressParams& params, const char* pSrc, size_t uiSrcSize, char* pDst)
+    {
+        uint32 uiTileMode = params.info.tileMode;
+        if (uiTileMode <= eLinearAligned || uiTileMode == eLinearSpecial)
+            return DeswizzleLinear(params, pSrc, uiSrcSize, pDst);
+        if (uiTileMode <= e1DTiledThick)
+            return DeswizzleMicroTiled<N>(params, pSrc, uiSrcSize, pDst);
+        return DeswizzleMacroTiled<N>(params, pSrc, uiSrcSize, pDst);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Deswizzle(const Surface& surface, uint32 uiLevel, uint32 uiSlice, char* pDst)
+    {
+        AddressParams params;
+        size_t uiSrcSize;
+        const char* pSrc = GetLevelData(surface, uiLevel, uiSrcSize);
+        if (!pSrc || !GetAddressParams(surface, uiLevel, uiSlice, params))
+            return false;
+
+        // Element sizes are fixed so the copies compile down to single moves
+        switch (params.info.bpp)
+        {
+        case 8:   return DeswizzleElements<1>(params, pSrc, uiSrcSize, pDst);
+        case 16:  return DeswizzleElements<2>(params, pSrc, uiSrcSize, pDst);
+        case 32:  return DeswizzleElements<4>(params, pSrc, uiSrcSize, pDst);
+        case 64:  return DeswizzleElements<8>(params, pSrc, uiSrcSize, pDst);
+        case 128: return DeswizzleElements<16>(params, pSrc, uiSrcSize, pDst);
+        default:  return false;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool DeswizzleSurfaces(const std::vector<const Surface*>& surfaces, std::vector<std::vector<Image>>& images)
+    {
+        struct Job
+        {
+            size_t uiSurface;
+            size_t uiImage;
+        };
+
+        // Every image is sized up front so the jobs only fill them in
+        bool bValid = true;
+        std::vector<Job> jobs;
+        images.assign(surfaces.size(), std::vector<Image>());
+        for (size_t i = 0; i < surfaces.size(); i++)
+        {
+            const Surface& surface = *surfaces[i];
+            for (uint32 uiLevel = 0; uiLevel < std::max(1u, surface.numMips); uiLevel++)
+            {
+                size_t uiSize;
+                LevelInfo info;
+                if (!GetLevelData(surface, uiLevel, uiSize))
+                    continue;
+                if (!ComputeLevelInfo(surface, uiLevel, info))
+                {
+                    bValid = false;
+                    break;
+                }
+
+                for (uint32 uiSlice = 0; uiSlice < info.slices; uiSlice++)
+                {
+                    Image image;
+                    image.uiLevel = uiLevel;
+                    image.uiSlice = uiSlice;
+                    image.uiWidth = info.width;
+                    image.uiHeight = info.height;
+                    image.uiBytesPerElement = info.bpp / 8;
+                    image.data.resize(static_cast<size_t>(info.width) * info.height * image.uiBytesPerElement);
+                    jobs.push_back({ i, images[i].size() });
+                    images[i].push_back(std::move(image));
+                }
+            }
+        }
+
+        std::atomic<bool> bFailed(false);
+        ThreadPool::Get().ParallelFor(jobs.size(), [&](size_t j)
+        {
+            Image& image = images[jobs[j].uiSurface][jobs[j].uiImage];
+            if (!Deswizzle(*surfaces[jobs[j].uiSurface], image.uiLevel, image.uiSlice, image.data.data()))
+                bFailed = true;
+        });
+        return bValid && !bFailed;
+    }
+
+}
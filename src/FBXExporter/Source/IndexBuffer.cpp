@@ -0,0 +1,682 @@
+#include "IndexBuffer.h"
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+namespace IndexBuffer
+{
+
+    // How the triangles of a primitive type are taken out of its indices
+    enum Expansion
+    {
+        eExpandList,
+        eExpandStrip,
+        eExpandFan,
+        eExpandQuads,
+        eExpandQuadStrip
+    };
+
+    // A primitive every uiStep indices, each reading uiWindow of them. Fans skip their first index, the hub.
+    struct PrimitiveInfo
+    {
+        Expansion eExpansion;
+        uint32    uiOffset;
+        uint32    uiStep;
+        uint32    uiWindow;
+        uint32    uiTriangles;
+    };
+
+    // Primitives decoded per pass, reading 4 indices at most each
+    static const size_t s_uiChunkPrimitives = 1024;
+    static const size_t s_uiMaxWindow = 4;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool GetPrimitiveInfo(LODMesh::GX2PrimitiveType ePrimitiveType, PrimitiveInfo& info)
+    {
+        switch (ePrimitiveType)
+        {
+        case LODMesh::GX2PrimitiveType::Triangles:
+        case LODMesh::GX2PrimitiveType::TessellateTriangles:
+            info = { eExpandList, 0, 3, 3, 1 };
+            return true;
+        case LODMesh::GX2PrimitiveType::TriangleStrip:
+        case LODMesh::GX2PrimitiveType::TessellateTriangleStrip:
+            info = { eExpandStrip, 0, 1, 3, 1 };
+            return true;
+        case LODMesh::GX2PrimitiveType::TriangleFan:
+            info = { eExpandFan, 1, 1, 2, 1 };
+            return true;
+        case LODMesh::GX2PrimitiveType::Quads:
+        case LODMesh::GX2PrimitiveType::TessellateQuads:
+            info = { eExpandQuads, 0, 4, 4, 2 };
+            return true;
+        case LODMesh::GX2PrimitiveType::QuadStrip:
+        case LODMesh::GX2PrimitiveType::TessellateQuadStrip:
+            info = { eExpandQuadStrip, 0, 2, 4, 2 };
+            return true;
+        default:
+            return false;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static size_t GetPrimitiveCount(const PrimitiveInfo& info, size_t uiCount)
+    {
+        if (uiCount < info.uiOffset + info.uiWindow)
+            return 0;
+        return (uiCount - info.uiOffset - info.uiWindow) / info.uiStep + 1;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint32 GetIndexSize(LODMesh::GX2IndexFormat eFormat)
+    {
+        switch (eFormat)
+        {
+        case LODMesh::GX2IndexFormat::UInt16:
+        case LODMesh::GX2IndexFormat::UInt16LittleEndian:
+            return 2;
+        case LODMesh::GX2IndexFormat::UInt32:
+        case LODMesh::GX2IndexFormat::UInt32LittleEndian:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool IsSupported(LODMesh::GX2PrimitiveType ePrimitiveType)
+    {
+        PrimitiveInfo info;
+        return GetPrimitiveInfo(ePrimitiveType, info);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool IsBigEndian(LODMesh::GX2IndexFormat eFormat)
+    {
+        return eFormat == LODMesh::GX2IndexFormat::UInt16 || eFormat == LODMesh::GX2IndexFormat::UInt32;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ClearFaces(FaceIndices& faces)
+    {
+        faces.indices16.clear();
+        faces.indices32.clear();
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool DecodeReference(const char* pSrc, size_t uiCount, LODMesh::GX2IndexFormat eFormat, LODMesh::GX2PrimitiveType ePrimitiveType,
+                         uint32 uiFirstVertex, FaceIndices& faces)
+    {
+        ClearFaces(faces);
+        uint32 uiSize = GetIndexSize(eFormat);
+        if (uiSize == 0 || !IsSupported(ePrimitiveType))
+            return false;
+
+        bool bBigEndian = IsBigEndian(eFormat);
+        std::vector<uint32> indices(uiCount);
+        uint64_t uiMax = 0;
+        for (size_t i = 0; i < uiCount; i++)
+        {
+            const uint8_t* pIndex = reinterpret_cast<const uint8_t*>(pSrc) + uiSize * i;
+            uint32 uiIndex = 0;
+            for (uint32 b = 0; b < uiSize; b++)
+                uiIndex |= static_cast<uint32>(pIndex[b]) << (8 * (bBigEndian ? uiSize - 1 - b : b));
+            uiMax = std::max(uiMax, static_cast<uint64_t>(uiIndex) + uiFirstVertex);
+            indices[i] = uiIndex + uiFirstVertex;
+        }
+
+        std::vector<uint32> triangles;
+        auto addTriangle = [&](size_t a, size_t b, size_t c)
+        {
+            triangles.push_back(indices[a]);
+            triangles.push_back(indices[b]);
+            triangles.push_back(indices[c]);
+        };
+
+        switch (ePrimitiveType)
+        {
+        case LODMesh::GX2PrimitiveType::TriangleStrip:
+        case LODMesh::GX2PrimitiveType::TessellateTriangleStrip:
+            for (size_t i = 0; i + 3 <= uiCount; i++)
+            {
+                if (indices[i] == indices[i + 1] || indices[i + 1] == indices[i + 2] || indices[i] == indices[i + 2])
+                    continue;
+                if (i % 2 == 0)
+                    addTriangle(i, i + 1, i + 2);
+                else
+                    addTriangle(i + 1, i, i + 2);
+            }
+            break;
+        case LODMesh::GX2PrimitiveType::TriangleFan:
+            for (size_t i = 1; i + 2 <= uiCount; i++)
+                addTriangle(0, i, i + 1);
+            break;
+        case LODMesh::GX2PrimitiveType::Quads:
+        case LODMesh::GX2PrimitiveType::TessellateQuads:
+            for (size_t i = 0; i + 4 <= uiCount; i += 4)
+            {
+                addTriangle(i, i + 1, i + 2);
+                addTriangle(i, i + 2, i + 3);
+            }
+            break;
+        case LODMesh::GX2PrimitiveType::QuadStrip:
+        case LODMesh::GX2PrimitiveType::TessellateQuadStrip:
+            for (size_t i = 0; i + 4 <= uiCount; i += 2)
+            {
+                addTriangle(i, i + 1, i + 3);
+                addTriangle(i, i + 3, i + 2);
+            }
+            break;
+        default:
+            for (size_t i = 0; i + 3 <= uiCount; i += 3)
+                addTriangle(i, i + 1, i + 2);
+            break;
+        }
+
+        if (uiMax <= 0xFFFF)
+        {
+            faces.indices16.resize(triangles.size());
+            for (size_t i = 0; i < triangles.size(); i++)
+                faces.indices16[i] = static_cast<uint16>(triangles[i]);
+        }
+        else
+        {
+            faces.indices32.assign(triangles.begin(), triangles.end());
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 ReadIndex(const uint8_t* pSrc, uint32 uiSize, bool bSwap)
+    {
+        if (uiSize == 2)
+        {
+            uint16 uiIndex;
+            memcpy(&uiIndex, pSrc, sizeof(uiIndex));
+            return bSwap ? static_cast<uint16>((uiIndex >> 8) | (uiIndex << 8)) : uiIndex;
+        }
+
+        uint32 uiIndex;
+        memcpy(&uiIndex, pSrc, sizeof(uiIndex));
+        return bSwap ? ((uiIndex >> 24) | ((uiIndex >> 8) & 0xFF00) | ((uiIndex << 8) & 0xFF0000) | (uiIndex << 24)) : uiIndex;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 FindMaxScalar(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap)
+    {
+        uint32 uiMax = 0;
+        for (size_t i = 0; i < uiCount; i++)
+            uiMax = std::max(uiMax, ReadIndex(pSrc + uiSize * i, uiSize, bSwap));
+        return uiMax;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Indices with the first vertex added, narrowed to T; 16 bit output is only asked for when every index fits
+    template <typename T>
+    static void ConvertScalar(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap, uint32 uiBase, T* pDst)
+    {
+        for (size_t i = 0; i < uiCount; i++)
+            pDst[i] = static_cast<T>(ReadIndex(pSrc + uiSize * i, uiSize, bSwap) + uiBase);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static __m128i ByteSwap16SSE2(__m128i values)
+    {
+        return _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static __m128i ByteSwap32SSE2(__m128i values)
+    {
+        values = ByteSwap16SSE2(values);
+        return _mm_or_si128(_mm_slli_epi32(values, 16), _mm_srli_epi32(values, 16));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // SSE2 only has signed maximums, the indices are biased to compare them unsigned
+    static uint32 FindMaxSSE2(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap)
+    {
+        size_t i = 0;
+        uint32 uiMax = 0;
+        if (uiSize == 2)
+        {
+            const __m128i bias = _mm_set1_epi16(SHRT_MIN);
+            __m128i max = bias;
+            for (; i + 8 <= uiCount; i += 8)
+            {
+                __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * i));
+                if (bSwap)
+                    indices = ByteSwap16SSE2(indices);
+                max = _mm_max_epi16(max, _mm_xor_si128(indices, bias));
+            }
+            alignas(16) uint16 lanes[8];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_xor_si128(max, bias));
+            uiMax = *std::max_element(lanes, lanes + 8);
+        }
+        else
+        {
+            const __m128i bias = _mm_set1_epi32(INT_MIN);
+            __m128i max = bias;
+            for (; i + 4 <= uiCount; i += 4)
+            {
+                __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i));
+                if (bSwap)
+                    indices = ByteSwap32SSE2(indices);
+                indices = _mm_xor_si128(indices, bias);
+                __m128i greater = _mm_cmpgt_epi32(indices, max);
+                max = _mm_or_si128(_mm_and_si128(greater, indices), _mm_andnot_si128(greater, max));
+            }
+            alignas(16) uint32 lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_xor_si128(max, bias));
+            uiMax = *std::max_element(lanes, lanes + 4);
+        }
+        return std::max(uiMax, FindMaxScalar(pSrc + uiSize * i, uiCount - i, uiSize, bSwap));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertSSE2(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap, uint32 uiBase, uint32* pDst)
+    {
+        const __m128i base = _mm_set1_epi32(static_cast<int>(uiBase));
+        size_t i = 0;
+        if (uiSize == 2)
+        {
+            for (; i + 8 <= uiCount; i += 8)
+            {
+                __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * i));
+                if (bSwap)
+                    indices = ByteSwap16SSE2(indices);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_add_epi32(_mm_unpacklo_epi16(indices, _mm_setzero_si128()), base));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i + 4), _mm_add_epi32(_mm_unpackhi_epi16(indices, _mm_setzero_si128()), base));
+            }
+        }
+        else
+        {
+            for (; i + 4 <= uiCount; i += 4)
+            {
+                __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i));
+                if (bSwap)
+                    indices = ByteSwap32SSE2(indices);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_add_epi32(indices, base));
+            }
+        }
+        ConvertScalar(pSrc + uiSize * i, uiCount - i, uiSize, bSwap, uiBase, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // 32 bit indices are narrowed through a signed pack, exact since they all fit in 16 bits
+    static void ConvertSSE2(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap, uint32 uiBase, uint16* pDst)
+    {
+        size_t i = 0;
+        if (uiSize == 2)
+        {
+            const __m128i base = _mm_set1_epi16(static_cast<short>(uiBase));
+            for (; i + 8 <= uiCount; i += 8)
+            {
+                __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * i));
+                if (bSwap)
+                    indices = ByteSwap16SSE2(indices);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_add_epi16(indices, base));
+            }
+        }
+        else
+        {
+            const __m128i base = _mm_set1_epi32(static_cast<int>(uiBase));
+            for (; i + 8 <= uiCount; i += 8)
+            {
+                __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i));
+                __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i + 16));
+                if (bSwap)
+                {
+                    low = ByteSwap32SSE2(low);
+                    high = ByteSwap32SSE2(high);
+                }
+                low = _mm_srai_epi32(_mm_slli_epi32(_mm_add_epi32(low, base), 16), 16);
+                high = _mm_srai_epi32(_mm_slli_epi32(_mm_add_epi32(high, base), 16), 16);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_packs_epi32(low, high));
+            }
+        }
+        ConvertScalar(pSrc + uiSize * i, uiCount - i, uiSize, bSwap, uiBase, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static __m256i ByteSwap16AVX2(__m256i values)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                                 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        return _mm256_shuffle_epi8(values, shuffle);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static __m256i ByteSwap32AVX2(__m256i values)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        return _mm256_shuffle_epi8(values, shuffle);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static uint32 FindMaxAVX2(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap)
+    {
+        size_t i = 0;
+        uint32 uiMax = 0;
+        if (uiSize == 2)
+        {
+            __m256i max = _mm256_setzero_si256();
+            for (; i + 16 <= uiCount; i += 16)
+            {
+                __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 2 * i));
+                max = _mm256_max_epu16(max, bSwap ? ByteSwap16AVX2(indices) : indices);
+            }
+            alignas(32) uint16 lanes[16];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), max);
+            uiMax = *std::max_element(lanes, lanes + 16);
+        }
+        else
+        {
+            __m256i max = _mm256_setzero_si256();
+            for (; i + 8 <= uiCount; i += 8)
+            {
+                __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 4 * i));
+                max = _mm256_max_epu32(max, bSwap ? ByteSwap32AVX2(indices) : indices);
+            }
+            alignas(32) uint32 lanes[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), max);
+            uiMax = *std::max_element(lanes, lanes + 8);
+        }
+        _mm256_zeroupper();
+        return std::max(uiMax, FindMaxScalar(pSrc + uiSize * i, uiCount - i, uiSize, bSwap));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static void ConvertAVX2(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap, uint32 uiBase, uint32* pDst)
+    {
+        const __m256i base = _mm256_set1_epi32(static_cast<int>(uiBase));
+        size_t i = 0;
+        if (uiSize == 2)
+        {
+            // Widened first, the swap then moves the high byte down and zeroes the top half
+            const __m256i shuffle = _mm256_setr_epi8(1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1, -1,
+                                                     1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1, -1);
+            for (; i + 8 <= uiCount; i += 8)
+            {
+                __m256i indices = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * i)));
+                if (bSwap)
+                    indices = _mm256_shuffle_epi8(indices, shuffle);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), _mm256_add_epi32(indices, base));
+            }
+        }
+        else
+        {
+            for (; i + 8 <= uiCount; i += 8)
+            {
+                __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 4 * i));
+                if (bSwap)
+                    indices = ByteSwap32AVX2(indices);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), _mm256_add_epi32(indices, base));
+            }
+        }
+        _mm256_zeroupper();
+        ConvertScalar(pSrc + uiSize * i, uiCount - i, uiSize, bSwap, uiBase, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static void ConvertAVX2(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap, uint32 uiBase, uint16* pDst)
+    {
+        size_t i = 0;
+        if (uiSize == 2)
+        {
+            const __m256i base = _mm256_set1_epi16(static_cast<short>(uiBase));
+            for (; i + 16 <= uiCount; i += 16)
+            {
+                __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 2 * i));
+                if (bSwap)
+                    indices = ByteSwap16AVX2(indices);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), _mm256_add_epi16(indices, base));
+            }
+        }
+        else
+        {
+            // The pack works per 128 bit lane, the permute puts the halves back in order
+            const __m256i base = _mm256_set1_epi32(static_cast<int>(uiBase));
+            for (; i + 16 <= uiCount; i += 16)
+            {
+                __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 4 * i));
+                __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 4 * i + 32));
+                if (bSwap)
+                {
+                    low = ByteSwap32AVX2(low);
+                    high = ByteSwap32AVX2(high);
+                }
+                __m256i packed = _mm256_packus_epi32(_mm256_add_epi32(low, base), _mm256_add_epi32(high, base));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+        }
+        _mm256_zeroupper();
+        ConvertScalar(pSrc + uiSize * i, uiCount - i, uiSize, bSwap, uiBase, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 FindMax(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap, SIMD::Path ePath)
+    {
+        switch (ePath)
+        {
+        case SIMD::Path::AVX2: return FindMaxAVX2(pSrc, uiCount, uiSize, bSwap);
+        case SIMD::Path::SSE2: return FindMaxSSE2(pSrc, uiCount, uiSize, bSwap);
+        default:               return FindMaxScalar(pSrc, uiCount, uiSize, bSwap);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <typename T>
+    static void Convert(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap, uint32 uiBase, T* pDst, SIMD::Path ePath)
+    {
+        switch (ePath)
+        {
+        case SIMD::Path::AVX2: ConvertAVX2(pSrc, uiCount, uiSize, bSwap, uiBase, pDst); break;
+        case SIMD::Path::SSE2: ConvertSSE2(pSrc, uiCount, uiSize, bSwap, uiBase, pDst); break;
+        default:               ConvertScalar(pSrc, uiCount, uiSize, bSwap, uiBase, pDst); break;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <typename T>
+    static T* EmitTriangle(T* pDst, uint32 a, uint32 b, uint32 c)
+    {
+        pDst[0] = static_cast<T>(a);
+        pDst[1] = static_cast<T>(b);
+        pDst[2] = static_cast<T>(c);
+        return pDst + 3;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Triangles of uiPrimitives primitives, the first one being primitive uiFirst of the mesh and reading its
+    // indices at pIndices
+    template <typename T>
+    static T* Expand(const uint32* pIndices, size_t uiFirst, size_t uiPrimitives, const PrimitiveInfo& info, uint32 uiHub, T* pDst)
+    {
+        switch (info.eExpansion)
+        {
+        case eExpandStrip:
+            for (size_t i = 0; i < uiPrimitives; i++, pIndices++)
+            {
+                uint32 a = pIndices[0], b = pIndices[1], c = pIndices[2];
+                if (a == b || b == c || a == c)
+                    continue;
+                pDst = (uiFirst + i) % 2 == 0 ? EmitTriangle(pDst, a, b, c) : EmitTriangle(pDst, b, a, c);
+            }
+            break;
+        case eExpandFan:
+            for (size_t i = 0; i < uiPrimitives; i++, pIndices++)
+                pDst = EmitTriangle(pDst, uiHub, pIndices[0], pIndices[1]);
+            break;
+        case eExpandQuads:
+            for (size_t i = 0; i < uiPrimitives; i++, pIndices += 4)
+            {
+                pDst = EmitTriangle(pDst, pIndices[0], pIndices[1], pIndices[2]);
+                pDst = EmitTriangle(pDst, pIndices[0], pIndices[2], pIndices[3]);
+            }
+            break;
+        case eExpandQuadStrip:
+            for (size_t i = 0; i < uiPrimitives; i++, pIndices += 2)
+            {
+                pDst = EmitTriangle(pDst, pIndices[0], pIndices[1], pIndices[3]);
+                pDst = EmitTriangle(pDst, pIndices[0], pIndices[3], pIndices[2]);
+            }
+            break;
+        default:
+            for (size_t i = 0; i < uiPrimitives; i++, pIndices += 3)
+                pDst = EmitTriangle(pDst, pIndices[0], pIndices[1], pIndices[2]);
+            break;
+        }
+        return pDst;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Writes the triangles to pDst, sized for every primitive, and returns how many indices they took
+    template <typename T>
+    static size_t DecodeTriangles(const uint8_t* pSrc, size_t uiCount, uint32 uiSize, bool bSwap, uint32 uiBase, const PrimitiveInfo& info,
+                                  T* pDst, SIMD::Path ePath)
+    {
+        size_t uiPrimitives = GetPrimitiveCount(info, uiCount);
+
+        // Lists are converted straight into the faces
+        if (info.eExpansion == eExpandList)
+        {
+            Convert(pSrc, 3 * uiPrimitives, uiSize, bSwap, uiBase, pDst, ePath);
+            return 3 * uiPrimitives;
+        }
+
+        uint32 uiHub = 0;
+        if (info.uiOffset != 0 && uiPrimitives != 0)
+            ConvertScalar(pSrc, 1, uiSize, bSwap, uiBase, &uiHub);
+
+        // The others are converted a chunk of primitives at a time, along with the indices they share with the next chunk
+        alignas(32) uint32 indices[s_uiChunkPrimitives * s_uiMaxWindow];
+        T* pFace = pDst;
+        for (size_t uiFirst = 0; uiFirst < uiPrimitives; uiFirst += s_uiChunkPrimitives)
+        {
+            size_t uiChunk = std::min(s_uiChunkPrimitives, uiPrimitives - uiFirst);
+            size_t uiStart = info.uiOffset + info.uiStep * uiFirst;
+            Convert(pSrc + uiSize * uiStart, info.uiStep * (uiChunk - 1) + info.uiWindow, uiSize, bSwap, uiBase, indices, ePath);
+            pFace = Expand(indices, uiFirst, uiChunk, info, uiHub, pFace);
+        }
+        return pFace - pDst;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decode(const char* pSrc, size_t uiCount, LODMesh::GX2IndexFormat eFormat, LODMesh::GX2PrimitiveType ePrimitiveType,
+                uint32 uiFirstVertex, FaceIndices& faces, SIMD::Path ePath)
+    {
+        ClearFaces(faces);
+        uint32 uiSize = GetIndexSize(eFormat);
+        PrimitiveInfo info;
+        if (uiSize == 0 || !GetPrimitiveInfo(ePrimitiveType, info))
+            return false;
+        ePath = SIMD::Resolve(ePath);
+
+        const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pSrc);
+        bool bSwap = IsBigEndian(eFormat);
+        size_t uiMaxIndices = 3 * info.uiTriangles * GetPrimitiveCount(info, uiCount);
+
+        // 16 bit indices without a first vertex always fit, the others are checked before anything is written
+        bool b16 = uiSize == 2 && uiFirstVertex == 0;
+        if (!b16)
+            b16 = static_cast<uint64_t>(FindMax(pBytes, uiCount, uiSize, bSwap, ePath)) + uiFirstVertex <= 0xFFFF;
+
+        if (b16)
+        {
+            faces.indices16.resize(uiMaxIndices);
+            faces.indices16.resize(DecodeTriangles(pBytes, uiCount, uiSize, bSwap, uiFirstVertex, info, faces.indices16.data(), ePath));
+        }
+        else
+        {
+            faces.indices32.resize(uiMaxIndices);
+            faces.indices32.resize(DecodeTriangles(pBytes, uiCount, uiSize, bSwap, uiFirstVertex, info, faces.indices32.data(), ePath));
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decode(const char* pSrc, size_t uiCount, LODMesh::GX2IndexFormat eFormat, LODMesh::GX2PrimitiveType ePrimitiveType,
+                uint32 uiFirstVertex, FaceIndices& faces)
+    {
+        return Decode(pSrc, uiCount, eFormat, ePrimitiveType, uiFirstVertex, faces, SIMD::GetFastestPath());
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void Assign(const int32* pIndices, size_t uiCount, FaceIndices& faces)
+    {
+        ClearFaces(faces);
+        if (std::all_of(pIndices, pIndices + uiCount, [](int32 iIndex) { return iIndex >= 0 && iIndex <= 0xFFFF; }))
+        {
+            faces.indices16.resize(uiCount);
+            for (size_t i = 0; i < uiCount; i++)
+                faces.indices16[i] = static_cast<uint16>(pIndices[i]);
+        }
+        else
+        {
+            faces.indices32.resize(uiCount);
+            for (size_t i = 0; i < uiCount; i++)
+                faces.indices32[i] = static_cast<uint32>(pIndices[i]);
+        }
+    }
+
+}
@@ -0,0 +1,214 @@
+#include "LayerArray.h"
+#include <emmintrin.h>
+#include <immintrin.h>
+
+namespace LayerArray
+{
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool IsSupported(uint32 uiSrcComponents, uint32 uiDstComponents)
+    {
+        return uiSrcComponents >= 2 && uiSrcComponents <= 4 && uiDstComponents >= uiSrcComponents && uiDstComponents <= 4;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static const float* GetElement(const float* pSrc, uint32 uiComponents, const uint32* pElements, size_t i)
+    {
+        return pSrc + static_cast<size_t>(uiComponents) * (pElements ? pElements[i] : i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool WidenReference(const float* pSrc, uint32 uiSrcComponents, const uint32* pElements, size_t uiCount, uint32 uiDstComponents,
+                        bool bFlipV, double* pDst)
+    {
+        if (!IsSupported(uiSrcComponents, uiDstComponents))
+            return false;
+
+        for (size_t i = 0; i < uiCount; i++)
+        {
+            const float* pElement = GetElement(pSrc, uiSrcComponents, pElements, i);
+            for (uint32 c = 0; c < uiDstComponents; c++)
+            {
+                float fValue = c < uiSrcComponents ? pElement[c] : 1.0f;
+                if (c == 1 && bFlipV)
+                    fValue = 1.0f - fValue;
+                pDst[uiDstComponents * i + c] = fValue;
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <uint32 Src, uint32 Dst>
+    static void WidenScalar(const float* pSrc, const uint32* pElements, size_t uiCount, bool bFlipV, double* pDst)
+    {
+        for (size_t i = 0; i < uiCount; i++, pDst += Dst)
+        {
+            const float* pElement = GetElement(pSrc, Src, pElements, i);
+            pDst[0] = pElement[0];
+            pDst[1] = bFlipV ? 1.0f - pElement[1] : pElement[1];
+            if (Dst > 2)
+                pDst[2] = Src > 2 ? pElement[2] : 1.0f;
+            if (Dst > 3)
+                pDst[3] = Src > 3 ? pElement[3] : 1.0f;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // The components of an element, 1 in the lanes past them. Never reads past the element.
+    template <uint32 Src>
+    static __m128 LoadElementSSE2(const float* p)
+    {
+        if (Src == 4)
+            return _mm_loadu_ps(p);
+        __m128 xy = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p));
+        if (Src == 3)
+            return _mm_movelh_ps(xy, _mm_setr_ps(p[2], 1.0f, 1.0f, 1.0f));
+        return _mm_movelh_ps(xy, _mm_set1_ps(1.0f));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Two 2 component elements side by side
+    static __m128 LoadPairSSE2(const float* p0, const float* p1)
+    {
+        return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p0)), reinterpret_cast<const __m64*>(p1));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // v * -1 + 1 in the second lane, and in the fourth for two elements side by side. The other lanes get * 1 + -0,
+    // which leaves every value as it is, -0 included.
+    static __m128 FlipVSSE2(__m128 values, bool bPair)
+    {
+        __m128 scale = bPair ? _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f) : _mm_setr_ps(1.0f, -1.0f, 1.0f, 1.0f);
+        __m128 offset = bPair ? _mm_setr_ps(-0.0f, 1.0f, -0.0f, 1.0f) : _mm_setr_ps(-0.0f, 1.0f, -0.0f, -0.0f);
+        return _mm_add_ps(_mm_mul_ps(values, scale), offset);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <uint32 Src, uint32 Dst>
+    static void WidenSSE2(const float* pSrc, const uint32* pElements, size_t uiCount, bool bFlipV, double* pDst)
+    {
+        size_t i = 0;
+
+        // UVs go two at a time
+        if (Src == 2 && Dst == 2)
+        {
+            for (; i + 2 <= uiCount; i += 2, pDst += 4)
+            {
+                __m128 values = LoadPairSSE2(GetElement(pSrc, 2, pElements, i), GetElement(pSrc, 2, pElements, i + 1));
+                if (bFlipV)
+                    values = FlipVSSE2(values, true);
+                _mm_storeu_pd(pDst, _mm_cvtps_pd(values));
+                _mm_storeu_pd(pDst + 2, _mm_cvtps_pd(_mm_movehl_ps(values, values)));
+            }
+        }
+
+        for (; i < uiCount; i++, pDst += Dst)
+        {
+            __m128 values = LoadElementSSE2<Src>(GetElement(pSrc, Src, pElements, i));
+            if (bFlipV)
+                values = FlipVSSE2(values, false);
+            _mm_storeu_pd(pDst, _mm_cvtps_pd(values));
+            if (Dst == 3)
+                _mm_store_sd(pDst + 2, _mm_cvtps_pd(_mm_movehl_ps(values, values)));
+            else if (Dst == 4)
+                _mm_storeu_pd(pDst + 2, _mm_cvtps_pd(_mm_movehl_ps(values, values)));
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <uint32 Src, uint32 Dst>
+    SIMD_TARGET_AVX2 static void WidenAVX2(const float* pSrc, const uint32* pElements, size_t uiCount, bool bFlipV, double* pDst)
+    {
+        size_t i = 0;
+
+        // UVs go two at a time
+        if (Src == 2 && Dst == 2)
+        {
+            for (; i + 2 <= uiCount; i += 2, pDst += 4)
+            {
+                __m128 values = LoadPairSSE2(GetElement(pSrc, 2, pElements, i), GetElement(pSrc, 2, pElements, i + 1));
+                if (bFlipV)
+                    values = FlipVSSE2(values, true);
+                _mm256_storeu_pd(pDst, _mm256_cvtps_pd(values));
+            }
+        }
+
+        for (; i < uiCount; i++, pDst += Dst)
+        {
+            __m128 values = LoadElementSSE2<Src>(GetElement(pSrc, Src, pElements, i));
+            if (bFlipV)
+                values = FlipVSSE2(values, false);
+            __m256d widened = _mm256_cvtps_pd(values);
+            if (Dst == 4)
+            {
+                _mm256_storeu_pd(pDst, widened);
+                continue;
+            }
+            _mm_storeu_pd(pDst, _mm256_castpd256_pd128(widened));
+            if (Dst == 3)
+                _mm_store_sd(pDst + 2, _mm256_extractf128_pd(widened, 1));
+        }
+        _mm256_zeroupper();
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <uint32 Src, uint32 Dst>
+    static void WidenElements(const float* pSrc, const uint32* pElements, size_t uiCount, bool bFlipV, double* pDst, SIMD::Path ePath)
+    {
+        if (ePath == SIMD::Path::AVX2)        WidenAVX2<Src, Dst>(pSrc, pElements, uiCount, bFlipV, pDst);
+        else if (ePath == SIMD::Path::SSE2)   WidenSSE2<Src, Dst>(pSrc, pElements, uiCount, bFlipV, pDst);
+        else                                  WidenScalar<Src, Dst>(pSrc, pElements, uiCount, bFlipV, pDst);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Widen(const float* pSrc, uint32 uiSrcComponents, const uint32* pElements, size_t uiCount, uint32 uiDstComponents,
+               bool bFlipV, double* pDst, SIMD::Path ePath)
+    {
+        if (!IsSupported(uiSrcComponents, uiDstComponents))
+            return false;
+        ePath = SIMD::Resolve(ePath);
+
+        switch ((uiSrcComponents << 4) | uiDstComponents)
+        {
+        case 0x22: WidenElements<2, 2>(pSrc, pElements, uiCount, bFlipV, pDst, ePath); break;
+        case 0x23: WidenElements<2, 3>(pSrc, pElements, uiCount, bFlipV, pDst, ePath); break;
+        case 0x24: WidenElements<2, 4>(pSrc, pElements, uiCount, bFlipV, pDst, ePath); break;
+        case 0x33: WidenElements<3, 3>(pSrc, pElements, uiCount, bFlipV, pDst, ePath); break;
+        case 0x34: WidenElements<3, 4>(pSrc, pElements, uiCount, bFlipV, pDst, ePath); break;
+        case 0x44: WidenElements<4, 4>(pSrc, pElements, uiCount, bFlipV, pDst, ePath); break;
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Widen(const float* pSrc, uint32 uiSrcComponents, const uint32* pElements, size_t uiCount, uint32 uiDstComponents,
+               bool bFlipV, double* pDst)
+    {
+        return Widen(pSrc, uiSrcComponents, pElements, uiCount, uiDstComponents, bFlipV, pDst, SIMD::GetFastestPath());
+    }
+
+}
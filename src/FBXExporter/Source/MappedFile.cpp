@@ -0,0 +1,136 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+static size_t GetPageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+MappedFile::MappedFile()
+    : m_pData(nullptr)
+    , m_uiSize(0)
+    , m_bCopyOnWrite(false)
+#ifdef _WIN32
+    , m_hFile(INVALID_HANDLE_VALUE)
+    , m_hMapping(NULL)
+#else
+    , m_iFile(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool MappedFile::Open(const char* filePath, bool bCopyOnWrite)
+{
+    Close();
+    m_bCopyOnWrite = bCopyOnWrite;
+
+#ifdef _WIN32
+    m_hFile = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_hFile, &fileSize) || fileSize.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+    m_uiSize = static_cast<size_t>(fileSize.QuadPart);
+
+    m_hMapping = CreateFileMappingA(m_hFile, NULL, bCopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    if (m_hMapping == NULL)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<char*>(MapViewOfFile(m_hMapping, bCopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+#else
+    m_iFile = open(filePath, O_RDONLY);
+    if (m_iFile < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(m_iFile, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        Close();
+        return false;
+    }
+    m_uiSize = static_cast<size_t>(fileStat.st_size);
+
+    void* pView = mmap(nullptr, m_uiSize, bCopyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, m_iFile, 0);
+    if (pView != MAP_FAILED)
+    {
+        m_pData = static_cast<char*>(pView);
+        madvise(pView, m_uiSize, MADV_SEQUENTIAL);
+    }
+#endif
+
+    if (!m_pData)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_pData)
+        UnmapViewOfFile(m_pData);
+    if (m_hMapping != NULL)
+        CloseHandle(m_hMapping);
+    if (m_hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(m_hFile);
+    m_hMapping = NULL;
+    m_hFile = INVALID_HANDLE_VALUE;
+#else
+    if (m_pData)
+        munmap(m_pData, m_uiSize);
+    if (m_iFile >= 0)
+        close(m_iFile);
+    m_iFile = -1;
+#endif
+    m_pData = nullptr;
+    m_uiSize = 0;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool MappedFile::HasZeroTerminator() const
+{
+    return m_pData && (m_uiSize % GetPageSize()) != 0;
+}
@@ -0,0 +1,827 @@
+#include "MedianBinary.h"
+#include "ThreadPool.h"
+#include "IndexBuffer.h"
+#include <assert.h>
+#include <string.h>
+
+namespace MedianBinary
+{
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Frames are floats in the dump. The xml path read them through the integer prefix of the text,
+    // which truncates towards zero and wraps negative values, so do the same here.
+    static uint32 FrameToUInt(float fFrame)
+    {
+        return static_cast<uint32>(static_cast<int32>(fFrame));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool MedianFile::Open(const char* filePath)
+    {
+        if (!m_mappedFile.Open(filePath, false))
+            return false;
+
+        if (m_mappedFile.GetSize() < sizeof(Header))
+            return false;
+
+        const Header& header = GetHeader();
+        if (header.magic != s_uiMagic || header.version != s_uiVersion || header.fileSize != m_mappedFile.GetSize())
+            return false;
+
+        // Every string is zero terminated, so the table has to end in one
+        if (!ValidateArray(header.stringTable, 1))
+            return false;
+        if (header.stringTable.count > 0 && m_mappedFile.GetData()[header.stringTable.offset + header.stringTable.count - 1] != '\0')
+            return false;
+        m_pStrings = m_mappedFile.GetData() + header.stringTable.offset;
+
+        if (!ValidateArray(header.models, sizeof(ModelRecord)) || !ValidateArray(header.anims, sizeof(AnimRecord)))
+            return false;
+
+        for (const ModelRecord& model : GetModels())
+        {
+            if (!ValidateModel(model))
+                return false;
+        }
+        for (const AnimRecord& anim : GetAnims())
+        {
+            if (!ValidateAnim(anim))
+                return false;
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool MedianFile::ValidateArray(const ArrayRef& arrayRef, size_t uiStride) const
+    {
+        if (arrayRef.count == 0)
+            return true;
+
+        // Records are read in place, so anything with 4 byte fields has to be 4 byte aligned
+        if (uiStride >= 4 && (arrayRef.offset & 3) != 0)
+            return false;
+
+        unsigned long long uiEnd = static_cast<unsigned long long>(arrayRef.offset) + static_cast<unsigned long long>(arrayRef.count) * uiStride;
+        return arrayRef.offset >= sizeof(Header) && uiEnd <= m_mappedFile.GetSize();
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool MedianFile::ValidateString(const StringRef& stringRef) const
+    {
+        unsigned long long uiEnd = static_cast<unsigned long long>(stringRef.offset) + stringRef.length;
+        return uiEnd < GetHeader().stringTable.count && m_pStrings[uiEnd] == '\0';
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool MedianFile::ValidateModel(const ModelRecord& model) const
+    {
+        if (!ValidateString(model.name)
+            || !ValidateArray(model.boneList, sizeof(uint32))
+            || !ValidateArray(model.bones, sizeof(BoneRecord))
+            || !ValidateArray(model.materials, sizeof(MaterialRecord))
+            || !ValidateArray(model.shapes, sizeof(ShapeRecord)))
+            return false;
+
+        for (const BoneRecord& bone : GetArray<BoneRecord>(model.bones))
+        {
+            if (!ValidateString(bone.name))
+                return false;
+        }
+
+        for (const MaterialRecord& material : GetArray<MaterialRecord>(model.materials))
+        {
+            if (!ValidateString(material.name) || !ValidateArray(material.textures, sizeof(TextureRecord)))
+                return false;
+
+            for (const TextureRecord& texture : GetArray<TextureRecord>(material.textures))
+            {
+                if (!ValidateString(texture.name) || !ValidateString(texture.samplerName) || !ValidateString(texture.useSampler))
+                    return false;
+            }
+        }
+
+        static const size_t s_uiStreamStrides[eStreamCount] =
+        {
+            sizeof(Math::vector3F), sizeof(Math::vector3F), sizeof(Math::vector3F), sizeof(Math::vector3F),
+            sizeof(Math::vector2F), sizeof(Math::vector2F), sizeof(Math::vector2F),
+            sizeof(Math::vector4F), sizeof(Math::vector4F), sizeof(Math::vector4F), sizeof(Math::vector4F), sizeof(Math::vector4F),
+            sizeof(Math::vector4)
+        };
+
+        for (const ShapeRecord& shape : GetArray<ShapeRecord>(model.shapes))
+        {
+            if (!ValidateString(shape.name)
+                || !ValidateArray(shape.radiusArray, sizeof(float))
+                || !ValidateArray(shape.skinBoneIndices, sizeof(uint32))
+                || !ValidateArray(shape.lodMeshes, sizeof(LODMeshRecord)))
+                return false;
+
+            for (const LODMeshRecord& lodMesh : GetArray<LODMeshRecord>(shape.lodMeshes))
+            {
+                if (!ValidateArray(lodMesh.faceVertices, sizeof(int32)))
+                    return false;
+            }
+
+            for (uint32 i = 0; i < eStreamCount; i++)
+            {
+                const ArrayRef& stream = shape.streams[i];
+                if ((stream.count != 0 && stream.count != shape.vertexCount) || !ValidateArray(stream, s_uiStreamStrides[i]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool MedianFile::ValidateAnim(const AnimRecord& anim) const
+    {
+        if (!ValidateString(anim.name)
+            || !ValidateArray(anim.boneAnims, sizeof(BoneAnimRecord))
+            || !ValidateArray(anim.userData, sizeof(UserDataRecord)))
+            return false;
+
+        for (const BoneAnimRecord& boneAnim : GetArray<BoneAnimRecord>(anim.boneAnims))
+        {
+            if (!ValidateString(boneAnim.name))
+                return false;
+
+            for (const TrackRecord& track : boneAnim.tracks)
+            {
+                if (!ValidateString(track.name) || !ValidateArray(track.keys, sizeof(KeyFrameRecord)))
+                    return false;
+            }
+        }
+
+        for (const UserDataRecord& userData : GetArray<UserDataRecord>(anim.userData))
+        {
+            if (!ValidateString(userData.name) || !ValidateArray(userData.values, sizeof(float)))
+                return false;
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool BinaryParser::IsBinaryMedian(const char* filePath)
+    {
+        const char* szExtension = strrchr(filePath, '.');
+        return szExtension && strcmp(szExtension, ".mbin") == 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryParser::Parse(const char* filePath, BFRES& bfres, ParseProfile eProfile)
+    {
+        MedianFile file;
+        if (!file.Open(filePath))
+        {
+            assert(0 && "Invalid binary median dump");
+            return;
+        }
+        Parse(file, bfres, eProfile);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryParser::ParseStreaming(const char* filePath, const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile)
+    {
+        MedianFile file;
+        if (!file.Open(filePath))
+        {
+            assert(0 && "Invalid binary median dump");
+            return;
+        }
+        ParseStreaming(file, onModel, onAnim, eProfile);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryParser::Parse(const MedianFile& file, BFRES& bfres, ParseProfile eProfile)
+    {
+        Arena::Scope arenaScope(bfres.arena);
+        ArrayView<ModelRecord> models = file.GetModels();
+        bfres.fmdl.resize(models.size());
+        ThreadPool::Get().ParallelFor(models.size(), [&](size_t i)
+        {
+            bfres.fmdl[i].index = static_cast<uint32>(i);
+            ParseFMDL(file, models[static_cast<uint32>(i)], bfres.fmdl[i], eProfile);
+        });
+
+        ArrayView<AnimRecord> anims = file.GetAnims();
+        bfres.fska.anims.resize(anims.size());
+        ThreadPool::Get().ParallelFor(anims.size(), [&](size_t i)
+        {
+            ParseAnim(file, anims[static_cast<uint32>(i)], bfres.fska.anims[i]);
+        });
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryParser::ParseStreaming(const MedianFile& file, const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile)
+    {
+        uint32 fmdlIndex = 0;
+        for (const ModelRecord& record : file.GetModels())
+        {
+            FMDL fmdl = FMDL();
+            fmdl.index = fmdlIndex++;
+            ParseFMDL(file, record, fmdl, eProfile);
+            onModel(fmdl);
+        }
+
+        for (const AnimRecord& record : file.GetAnims())
+        {
+            Anim anim = Anim();
+            ParseAnim(file, record, anim);
+            onAnim(anim);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryParser::ParseFMDL(const MedianFile& file, const ModelRecord& record, FMDL& fmdl, ParseProfile eProfile)
+    {
+        fmdl.name = file.GetString(record.name);
+        fmdl.totalVertices = static_cast<int>(record.totalVertices);
+
+        // Parse FSKL
+        ArrayView<uint32> boneList = file.GetArray<uint32>(record.boneList);
+        fmdl.fskl.boneCount = record.boneCount;
+        fmdl.fskl.boneList.assign(boneList.begin(), boneList.end());
+
+        ArrayView<BoneRecord> bones = file.GetArray<BoneRecord>(record.bones);
+        fmdl.fskl.bones.resize(bones.size());
+        for (uint32 i = 0; i < bones.size(); i++)
+        {
+            const BoneRecord& boneRecord = bones[i];
+            Bone& bone = fmdl.fskl.bones[i];
+            bone.name              = file.GetString(boneRecord.name);
+            bone.index             = boneRecord.index;
+            bone.isVisible         = boneRecord.isVisible != 0;
+            bone.rigidMatrixIndex  = boneRecord.rigidMatrixIndex;
+            bone.smoothMatrixIndex = boneRecord.smoothMatrixIndex;
+            bone.billboardIndex    = boneRecord.billboardIndex;
+            bone.useRigidMatrix    = boneRecord.useRigidMatrix != 0;
+            bone.useSmoothMatrix   = boneRecord.useSmoothMatrix != 0;
+            bone.parentIndex       = boneRecord.parentIndex;
+            bone.rotationType      = static_cast<Bone::RotationType>(boneRecord.rotationType);
+            bone.scale             = boneRecord.scale;
+            bone.rotation          = boneRecord.rotation;
+            bone.position          = boneRecord.position;
+        }
+
+        if (eProfile == ParseProfile::SkeletonOnly)
+            return;
+
+        // Parse Materials
+        ArrayView<MaterialRecord> materials = file.GetArray<MaterialRecord>(record.materials);
+        fmdl.fmatCount = static_cast<int>(materials.size());
+        fmdl.fmats.resize(materials.size());
+        for (uint32 i = 0; i < materials.size(); i++)
+        {
+            FMAT& fmat = fmdl.fmats[i];
+            fmat.name = file.GetString(materials[i].name);
+            fmat.isVisible = materials[i].isVisible != 0;
+
+            ArrayView<TextureRecord> textures = file.GetArray<TextureRecord>(materials[i].textures);
+            fmat.textureRefs.textureCount = textures.size();
+            fmat.textureRefs.textures.resize(textures.size());
+            for (uint32 j = 0; j < textures.size(); j++)
+            {
+                const TextureRecord& textureRecord = textures[j];
+                TextureRef& texture = fmat.textureRefs.textures[j];
+                texture.name                = file.GetString(textureRecord.name);
+                texture.samplerName         = file.GetString(textureRecord.samplerName);
+                texture.useSampler          = file.GetString(textureRecord.useSampler);
+                texture.clampX              = static_cast<TextureRef::GX2TexClamp>(textureRecord.clampX);
+                texture.clampY              = static_cast<TextureRef::GX2TexClamp>(textureRecord.clampY);
+                texture.clampZ              = static_cast<TextureRef::GX2TexClamp>(textureRecord.clampZ);
+                texture.minFilter           = static_cast<GX2TexXYFilterType>(textureRecord.minFilter);
+                texture.magFilter           = static_cast<GX2TexXYFilterType>(textureRecord.magFilter);
+                texture.zFilter             = static_cast<GX2TexZFilterType>(textureRecord.zFilter);
+                texture.mipFilter           = static_cast<GX2TexMipFilterType>(textureRecord.mipFilter);
+                texture.maxAnisotropicRatio = static_cast<GX2TexAnisoRatio>(textureRecord.maxAnisotropicRatio);
+                texture.borderType          = static_cast<GX2TexBorderType>(textureRecord.borderType);
+                texture.depthCompareFunc    = static_cast<GX2CompareFunction>(textureRecord.depthCompareFunc);
+                texture.minLod              = textureRecord.minLod;
+                texture.maxLod              = textureRecord.maxLod;
+                texture.lodBias             = textureRecord.lodBias;
+                texture.depthCompareEnabled = textureRecord.depthCompareEnabled != 0;
+                texture.type                = static_cast<GX2TextureMapType>(textureRecord.type);
+                texture.textureUnit         = textureRecord.textureUnit;
+            }
+        }
+
+        // Parse Shapes, every shape is independent
+        ArrayView<ShapeRecord> shapes = file.GetArray<ShapeRecord>(record.shapes);
+        fmdl.fshpCount = static_cast<int>(shapes.size());
+        fmdl.fshps.resize(shapes.size());
+        ThreadPool::Get().ParallelFor(shapes.size(), [&](size_t i)
+        {
+            fmdl.fshps[i].modelIndex = fmdl.index;
+            ParseFSHP(file, shapes[static_cast<uint32>(i)], fmdl.fshps[i], eProfile);
+        });
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryParser::ParseFSHP(const MedianFile& file, const ShapeRecord& record, FSHP& fshp, ParseProfile eProfile)
+    {
+        fshp.name                 = file.GetString(record.name);
+        fshp.materialIndex        = record.materialIndex;
+        fshp.boneIndex            = record.boneIndex;
+        fshp.vertexBufferIndex    = record.vertexBufferIndex;
+        fshp.vertexSkinCount      = record.vertexSkinCount;
+        fshp.targetAttributeCount = record.targetAttributeCount;
+
+        ArrayView<float> radiusArray = file.GetArray<float>(record.radiusArray);
+        fshp.radiusArray.assign(radiusArray.begin(), radiusArray.end());
+        ArrayView<uint32> skinBoneIndices = file.GetArray<uint32>(record.skinBoneIndices);
+        fshp.skinBoneIndices.assign(skinBoneIndices.begin(), skinBoneIndices.end());
+
+        // Parse Meshes
+        ArrayView<LODMeshRecord> lodMeshes = file.GetArray<LODMeshRecord>(record.lodMeshes);
+        fshp.lodMeshes.resize(lodMeshes.size());
+        for (uint32 i = 0; i < lodMeshes.size(); i++)
+        {
+            const LODMeshRecord& lodMeshRecord = lodMeshes[i];
+            LODMesh& lodMesh = fshp.lodMeshes[i];
+            lodMesh.primitiveType   = static_cast<LODMesh::GX2PrimitiveType>(lodMeshRecord.primitiveType);
+            lodMesh.indexFormat     = static_cast<LODMesh::GX2IndexFormat>(lodMeshRecord.indexFormat);
+            lodMesh.indexCount      = lodMeshRecord.indexCount;
+            lodMesh.firstVertex     = lodMeshRecord.firstVertex;
+            lodMesh.subMesh.count   = lodMeshRecord.subMeshCount;
+            lodMesh.subMesh.offset  = lodMeshRecord.subMeshOffset;
+
+            ArrayView<int32> faceVertices = file.GetArray<int32>(lodMeshRecord.faceVertices);
+            IndexBuffer::Assign(faceVertices.begin(), faceVertices.size(), lodMesh.faceVertices);
+        }
+
+        // Parse Vertices, a stream per attribute the file has. The file's streams are in the same order and
+        // the ones it leaves empty are missing, like attributes missing from the xml.
+        static_assert(static_cast<int>(eStreamCount) == static_cast<int>(VertexStreams::eStreamCount), "A file stream per vertex stream");
+        VertexStreams& vertices = fshp.vertices;
+        vertices = VertexStreams();
+        vertices.count = record.vertexCount;
+        auto readStream = [&](VertexStream eStream, auto view, auto& stream)
+        {
+            if (view.empty())
+                return;
+            stream.assign(view.begin(), view.end());
+            vertices.presence |= 1u << eStream;
+        };
+        readStream(eStreamPosition0,    file.GetStream3F(record, eStreamPosition0),    vertices.position0);
+        if (eProfile == ParseProfile::Full)
+        {
+            // Only the first position set is ever written out
+            readStream(eStreamPosition1, file.GetStream3F(record, eStreamPosition1), vertices.position1);
+            readStream(eStreamPosition2, file.GetStream3F(record, eStreamPosition2), vertices.position2);
+        }
+        readStream(eStreamNormal,       file.GetStream3F(record, eStreamNormal),       vertices.normal);
+        readStream(eStreamUV0,          file.GetStream2F(record, eStreamUV0),          vertices.uv0);
+        readStream(eStreamUV1,          file.GetStream2F(record, eStreamUV1),          vertices.uv1);
+        readStream(eStreamUV2,          file.GetStream2F(record, eStreamUV2),          vertices.uv2);
+        readStream(eStreamColor0,       file.GetStream4F(record, eStreamColor0),       vertices.color0);
+        readStream(eStreamColor1,       file.GetStream4F(record, eStreamColor1),       vertices.color1);
+        readStream(eStreamTangent,      file.GetStream4F(record, eStreamTangent),      vertices.tangent);
+        readStream(eStreamBinormal,     file.GetStream4F(record, eStreamBinormal),     vertices.binormal);
+        readStream(eStreamBlendWeights, file.GetStream4F(record, eStreamBlendWeights), vertices.blendWeights);
+        readStream(eStreamBlendIndex,   file.GetStream4(record, eStreamBlendIndex),    vertices.blendIndex);
+
+        // Positions make the vertices, they're there even when the file has none
+        if (vertices.count > 0 && !vertices.Has(VertexStreams::ePosition0))
+            vertices.Add(VertexStreams::ePosition0);
+        vertices.DropDefaultStreams();
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryParser::ParseAnim(const MedianFile& file, const AnimRecord& record, Anim& anim)
+    {
+        anim.m_szName       = file.GetString(record.name);
+        anim.m_bIsBaked     = record.isBaked != 0;
+        anim.m_bIsLooping   = record.isLooping != 0;
+        anim.m_eScalingType = static_cast<Anim::SkeletalAnimFlagsScale>(record.scalingType);
+        anim.m_cFrames      = record.frameCount;
+
+        // parse bone anims, each one only touches its own tracks
+        ArrayView<BoneAnimRecord> boneAnims = file.GetArray<BoneAnimRecord>(record.boneAnims);
+        anim.m_cBoneAnims = boneAnims.size();
+        anim.m_vBoneAnims.resize(boneAnims.size());
+        ThreadPool::Get().ParallelFor(boneAnims.size(), [&](size_t i)
+        {
+            const BoneAnimRecord& boneAnimRecord = boneAnims[static_cast<uint32>(i)];
+            BoneAnim& boneAnim = anim.m_vBoneAnims[i];
+            boneAnim.m_szName                     = file.GetString(boneAnimRecord.name);
+            boneAnim.m_iHash                      = boneAnimRecord.hash;
+            boneAnim.m_eRotType                   = static_cast<BoneAnim::AnimRotationType>(boneAnimRecord.rotType);
+            boneAnim.m_bUseSegmentScaleCompensate = boneAnimRecord.useSegmentScaleCompensate != 0;
+
+            AnimTrack* tracks[s_uiTrackCount] =
+            {
+                &boneAnim.m_XSCA, &boneAnim.m_YSCA, &boneAnim.m_ZSCA,
+                &boneAnim.m_XROT, &boneAnim.m_YROT, &boneAnim.m_ZROT, &boneAnim.m_WROT,
+                &boneAnim.m_XPOS, &boneAnim.m_YPOS, &boneAnim.m_ZPOS
+            };
+            for (uint32 j = 0; j < s_uiTrackCount; j++)
+                ParseAnimTrack(file, boneAnimRecord.tracks[j], *tracks[j]);
+        });
+
+        // parse user data
+        ArrayView<UserDataRecord> userDatas = file.GetArray<UserDataRecord>(record.userData);
+        anim.m_cUserData = userDatas.size();
+        anim.m_vUserData.resize(userDatas.size());
+        for (uint32 i = 0; i < userDatas.size(); i++)
+        {
+            UserData& userData = anim.m_vUserData[i];
+            userData.m_szName = file.GetString(userDatas[i].name);
+            userData.m_eType  = static_cast<UserData::UserDataType>(userDatas[i].type);
+
+            ArrayView<float> values = file.GetArray<float>(userDatas[i].values);
+            userData.m_vfValues.assign(values.begin(), values.end());
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryParser::ParseAnimTrack(const MedianFile& file, const TrackRecord& record, AnimTrack& animTrack)
+    {
+        animTrack.m_szName             = file.GetString(record.name);
+        animTrack.m_eInterpolationType = static_cast<AnimTrack::CurveInterpolationType>(record.interpolationType);
+        animTrack.m_bConstant          = record.constant != 0;
+        animTrack.m_cFrames            = FrameToUInt(record.frameCount);
+        animTrack.m_uiStartFrame       = FrameToUInt(record.startFrame);
+        animTrack.m_uiEndFrame         = FrameToUInt(record.endFrame);
+        animTrack.m_fDelta             = record.delta;
+
+        ArrayView<KeyFrameRecord> keys = file.GetArray<KeyFrameRecord>(record.keys);
+        animTrack.m_cKeys = keys.size();
+        animTrack.m_vKeyFrames.resize(keys.size());
+        for (uint32 i = 0; i < keys.size(); i++)
+        {
+            KeyFrame& keyFrame = animTrack.m_vKeyFrames[i];
+            keyFrame.m_uiFrame     = FrameToUInt(keys[i].frame);
+            keyFrame.m_fValue      = keys[i].value;
+            keyFrame.m_bIsDegrees  = keys[i].isDegrees != 0;
+            keyFrame.m_bIsWeighted = keys[i].isWeighted != 0;
+            keyFrame.m_fSlope1     = keys[i].slope1;
+            keyFrame.m_fSlope2     = keys[i].slope2;
+        }
+    }
+
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    BinaryWriter::BinaryWriter()
+        : m_pFile(nullptr)
+        , m_uiPosition(0)
+        , m_bFailed(false)
+    {
+    }
+
+    BinaryWriter::~BinaryWriter()
+    {
+        // Never finished, don't leave a file behind that looks valid
+        if (m_pFile)
+        {
+            fclose(m_pFile);
+            remove(m_filePath.c_str());
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool BinaryWriter::Open(const char* filePath)
+    {
+        m_filePath = filePath;
+        m_pFile = fopen(filePath, "wb");
+        if (!m_pFile)
+            return false;
+
+        // Header is filled in by Close
+        Header header = {};
+        Write(&header, sizeof(header));
+        return !m_bFailed;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryWriter::AddModel(const FMDL& fmdl)
+    {
+        ModelRecord record = {};
+        record.name          = AddString(fmdl.name);
+        record.boneCount     = fmdl.fskl.boneCount;
+        record.totalVertices = static_cast<uint32>(fmdl.totalVertices);
+        record.boneList      = WriteArray(fmdl.fskl.boneList);
+
+        std::vector<BoneRecord> bones(fmdl.fskl.bones.size());
+        for (size_t i = 0; i < bones.size(); i++)
+        {
+            const Bone& bone = fmdl.fskl.bones[i];
+            BoneRecord& boneRecord = bones[i];
+            boneRecord.name              = AddString(bone.name);
+            boneRecord.index             = bone.index;
+            boneRecord.rigidMatrixIndex  = bone.rigidMatrixIndex;
+            boneRecord.smoothMatrixIndex = bone.smoothMatrixIndex;
+            boneRecord.billboardIndex    = bone.billboardIndex;
+            boneRecord.parentIndex       = bone.parentIndex;
+            boneRecord.rotationType      = static_cast<uint32>(bone.rotationType);
+            boneRecord.isVisible         = bone.isVisible ? 1 : 0;
+            boneRecord.useRigidMatrix    = bone.useRigidMatrix ? 1 : 0;
+            boneRecord.useSmoothMatrix   = bone.useSmoothMatrix ? 1 : 0;
+            boneRecord.scale             = bone.scale;
+            boneRecord.rotation          = bone.rotation;
+            boneRecord.position          = bone.position;
+        }
+        record.bones = WriteArray(bones);
+
+        std::vector<MaterialRecord> materials(fmdl.fmats.size());
+        for (size_t i = 0; i < materials.size(); i++)
+        {
+            const FMAT& fmat = fmdl.fmats[i];
+            std::vector<TextureRecord> textures(fmat.textureRefs.textures.size());
+            for (size_t j = 0; j < textures.size(); j++)
+            {
+                const TextureRef& texture = fmat.textureRefs.textures[j];
+                TextureRecord& textureRecord = textures[j];
+                textureRecord.name                = AddString(texture.name);
+                textureRecord.samplerName         = AddString(texture.samplerName);
+                textureRecord.useSampler          = AddString(texture.useSampler);
+                textureRecord.clampX              = static_cast<uint32>(texture.clampX);
+                textureRecord.clampY              = static_cast<uint32>(texture.clampY);
+                textureRecord.clampZ              = static_cast<uint32>(texture.clampZ);
+                textureRecord.minFilter           = static_cast<uint32>(texture.minFilter);
+                textureRecord.magFilter           = static_cast<uint32>(texture.magFilter);
+                textureRecord.zFilter             = static_cast<uint32>(texture.zFilter);
+                textureRecord.mipFilter           = static_cast<uint32>(texture.mipFilter);
+                textureRecord.maxAnisotropicRatio = static_cast<uint32>(texture.maxAnisotropicRatio);
+                textureRecord.borderType          = static_cast<uint32>(texture.borderType);
+                textureRecord.depthCompareFunc    = static_cast<uint32>(texture.depthCompareFunc);
+                textureRecord.type                = static_cast<uint32>(texture.type);
+                textureRecord.minLod              = texture.minLod;
+                textureRecord.maxLod              = texture.maxLod;
+                textureRecord.lodBias             = texture.lodBias;
+                textureRecord.depthCompareEnabled = texture.depthCompareEnabled ? 1 : 0;
+                textureRecord.textureUnit         = texture.textureUnit;
+            }
+
+            materials[i].name      = AddString(fmat.name);
+            materials[i].isVisible = fmat.isVisible ? 1 : 0;
+            materials[i].textures  = WriteArray(textures);
+        }
+        record.materials = WriteArray(materials);
+
+        std::vector<ShapeRecord> shapes(fmdl.fshps.size());
+        for (size_t i = 0; i < shapes.size(); i++)
+            WriteShape(fmdl.fshps[i], shapes[i]);
+        record.shapes = WriteArray(shapes);
+
+        m_models.push_back(record);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryWriter::WriteShape(const FSHP& fshp, ShapeRecord& record)
+    {
+        record.name                 = AddString(fshp.name);
+        record.materialIndex        = fshp.materialIndex;
+        record.boneIndex            = fshp.boneIndex;
+        record.vertexBufferIndex    = fshp.vertexBufferIndex;
+        record.vertexSkinCount      = fshp.vertexSkinCount;
+        record.targetAttributeCount = fshp.targetAttributeCount;
+        record.vertexCount          = fshp.vertices.count;
+        record.radiusArray          = WriteArray(fshp.radiusArray);
+        record.skinBoneIndices      = WriteArray(fshp.skinBoneIndices);
+
+        // The file keeps 32 bit indices whatever they fit in, as the importer writes them
+        std::vector<LODMeshRecord> lodMeshes(fshp.lodMeshes.size());
+        std::vector<int32> faceVertices;
+        for (size_t i = 0; i < lodMeshes.size(); i++)
+        {
+            const LODMesh& lodMesh = fshp.lodMeshes[i];
+            faceVertices.resize(lodMesh.faceVertices.size());
+            for (size_t j = 0; j < faceVertices.size(); j++)
+                faceVertices[j] = static_cast<int32>(lodMesh.faceVertices[j]);
+
+            lodMeshes[i].primitiveType = static_cast<uint32>(lodMesh.primitiveType);
+            lodMeshes[i].indexFormat   = static_cast<uint32>(lodMesh.indexFormat);
+            lodMeshes[i].indexCount    = lodMesh.indexCount;
+            lodMeshes[i].firstVertex   = lodMesh.firstVertex;
+            lodMeshes[i].faceVertices  = WriteArray(faceVertices);
+            lodMeshes[i].subMeshCount  = lodMesh.subMesh.count;
+            lodMeshes[i].subMeshOffset = lodMesh.subMesh.offset;
+        }
+        record.lodMeshes = WriteArray(lodMeshes);
+
+        // The streams go out as they are, the ones the shape doesn't have stay empty
+        record.streams[eStreamPosition0]    = WriteArray(fshp.vertices.position0);
+        record.streams[eStreamPosition1]    = WriteArray(fshp.vertices.position1);
+        record.streams[eStreamPosition2]    = WriteArray(fshp.vertices.position2);
+        record.streams[eStreamNormal]       = WriteArray(fshp.vertices.normal);
+        record.streams[eStreamUV0]          = WriteArray(fshp.vertices.uv0);
+        record.streams[eStreamUV1]          = WriteArray(fshp.vertices.uv1);
+        record.streams[eStreamUV2]          = WriteArray(fshp.vertices.uv2);
+        record.streams[eStreamColor0]       = WriteArray(fshp.vertices.color0);
+        record.streams[eStreamColor1]       = WriteArray(fshp.vertices.color1);
+        record.streams[eStreamTangent]      = WriteArray(fshp.vertices.tangent);
+        record.streams[eStreamBinormal]     = WriteArray(fshp.vertices.binormal);
+        record.streams[eStreamBlendWeights] = WriteArray(fshp.vertices.blendWeights);
+        record.streams[eStreamBlendIndex]   = WriteArray(fshp.vertices.blendIndex);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryWriter::AddAnim(const Anim& anim)
+    {
+        AnimRecord record = {};
+        record.name        = AddString(anim.m_szName);
+        record.isBaked     = anim.m_bIsBaked ? 1 : 0;
+        record.isLooping   = anim.m_bIsLooping ? 1 : 0;
+        record.scalingType = static_cast<uint32>(anim.m_eScalingType);
+        record.frameCount  = anim.m_cFrames;
+
+        std::vector<BoneAnimRecord> boneAnims(anim.m_vBoneAnims.size());
+        std::vector<KeyFrameRecord> keys;
+        for (size_t i = 0; i < boneAnims.size(); i++)
+        {
+            const BoneAnim& boneAnim = anim.m_vBoneAnims[i];
+            BoneAnimRecord& boneAnimRecord = boneAnims[i];
+            boneAnimRecord.name                      = AddString(boneAnim.m_szName);
+            boneAnimRecord.hash                      = boneAnim.m_iHash;
+            boneAnimRecord.rotType                   = static_cast<uint32>(boneAnim.m_eRotType);
+            boneAnimRecord.useSegmentScaleCompensate = boneAnim.m_bUseSegmentScaleCompensate ? 1 : 0;
+
+            const AnimTrack* tracks[s_uiTrackCount] =
+            {
+                &boneAnim.m_XSCA, &boneAnim.m_YSCA, &boneAnim.m_ZSCA,
+                &boneAnim.m_XROT, &boneAnim.m_YROT, &boneAnim.m_ZROT, &boneAnim.m_WROT,
+                &boneAnim.m_XPOS, &boneAnim.m_YPOS, &boneAnim.m_ZPOS
+            };
+            for (uint32 j = 0; j < s_uiTrackCount; j++)
+            {
+                // Frames are floats in the file, see FrameToUInt
+                const AnimTrack& track = *tracks[j];
+                TrackRecord& trackRecord = boneAnimRecord.tracks[j];
+                trackRecord.name              = AddString(track.m_szName);
+                trackRecord.interpolationType = static_cast<uint32>(track.m_eInterpolationType);
+                trackRecord.constant          = track.m_bConstant ? 1 : 0;
+                trackRecord.frameCount        = static_cast<float>(static_cast<int32>(track.m_cFrames));
+                trackRecord.startFrame        = static_cast<float>(static_cast<int32>(track.m_uiStartFrame));
+                trackRecord.endFrame          = static_cast<float>(static_cast<int32>(track.m_uiEndFrame));
+                trackRecord.delta             = track.m_fDelta;
+
+                keys.resize(track.m_vKeyFrames.size());
+                for (size_t k = 0; k < keys.size(); k++)
+                {
+                    const KeyFrame& keyFrame = track.m_vKeyFrames[k];
+                    keys[k].frame      = static_cast<float>(static_cast<int32>(keyFrame.m_uiFrame));
+                    keys[k].value      = keyFrame.m_fValue;
+                    keys[k].slope1     = keyFrame.m_fSlope1;
+                    keys[k].slope2     = keyFrame.m_fSlope2;
+                    keys[k].isDegrees  = keyFrame.m_bIsDegrees ? 1 : 0;
+                    keys[k].isWeighted = keyFrame.m_bIsWeighted ? 1 : 0;
+                    keys[k].padding    = 0;
+                }
+                trackRecord.keys = WriteArray(keys);
+            }
+        }
+        record.boneAnims = WriteArray(boneAnims);
+
+        std::vector<UserDataRecord> userDatas(anim.m_vUserData.size());
+        for (size_t i = 0; i < userDatas.size(); i++)
+        {
+            userDatas[i].name   = AddString(anim.m_vUserData[i].m_szName);
+            userDatas[i].type   = static_cast<uint32>(anim.m_vUserData[i].m_eType);
+            userDatas[i].values = WriteArray(anim.m_vUserData[i].m_vfValues);
+        }
+        record.userData = WriteArray(userDatas);
+
+        m_anims.push_back(record);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool BinaryWriter::Close(uint64_t uiSourceHash, ParseProfile eProfile)
+    {
+        if (!m_pFile)
+            return false;
+
+        Header header = {};
+        header.magic         = s_uiMagic;
+        header.version       = s_uiVersion;
+        header.models        = WriteArray(m_models);
+        header.anims         = WriteArray(m_anims);
+        header.sourceHash[0] = static_cast<uint32>(uiSourceHash);
+        header.sourceHash[1] = static_cast<uint32>(uiSourceHash >> 32);
+        header.parseProfile  = static_cast<uint32>(eProfile);
+
+        Align();
+        header.stringTable.offset = m_uiPosition;
+        header.stringTable.count  = static_cast<uint32>(m_strings.size());
+        Write(m_strings.data(), m_strings.size());
+        header.fileSize = m_uiPosition;
+
+        if (fseek(m_pFile, 0, SEEK_SET) != 0)
+            m_bFailed = true;
+        Write(&header, sizeof(header));
+        m_uiPosition = header.fileSize;
+
+        if (fclose(m_pFile) != 0)
+            m_bFailed = true;
+        m_pFile = nullptr;
+
+        if (m_bFailed)
+            remove(m_filePath.c_str());
+        return !m_bFailed;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template<typename T>
+    ArrayRef BinaryWriter::WriteArray(const T* pData, size_t uiCount)
+    {
+        ArrayRef arrayRef = {};
+        if (uiCount == 0)
+            return arrayRef;
+
+        Align();
+        arrayRef.offset = m_uiPosition;
+        arrayRef.count  = static_cast<uint32>(uiCount);
+        Write(pData, uiCount * sizeof(T));
+        return arrayRef;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    StringRef BinaryWriter::AddString(const std::pmr::string& str)
+    {
+        // The table keeps its keys on the heap, the tree's strings may live in an arena that goes first
+        std::string key(str.data(), str.size());
+        auto it = m_stringOffsets.find(key);
+        if (it == m_stringOffsets.end())
+        {
+            it = m_stringOffsets.emplace(std::move(key), static_cast<uint32>(m_strings.size())).first;
+            m_strings.append(str.data(), str.size());
+            m_strings.push_back('\0');
+        }
+
+        StringRef stringRef;
+        stringRef.offset = it->second;
+        stringRef.length = static_cast<uint32>(str.size());
+        return stringRef;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryWriter::Write(const void* pData, size_t uiSize)
+    {
+        if (m_bFailed || uiSize == 0)
+            return;
+
+        // Offsets are 32 bit
+        if (static_cast<unsigned long long>(m_uiPosition) + uiSize > 0xFFFFFFFFull || fwrite(pData, 1, uiSize, m_pFile) != uiSize)
+        {
+            m_bFailed = true;
+            return;
+        }
+        m_uiPosition += static_cast<uint32>(uiSize);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void BinaryWriter::Align()
+    {
+        static const char s_padding[16] = {};
+        Write(s_padding, (16 - (m_uiPosition & 15)) & 15);
+    }
+
+}
@@ -0,0 +1,293 @@
+#include "ParseCache.h"
+#include "MappedFile.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    double SecondsSince(const Clock::time_point& start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // XXH64 constants and rounds, the hash only has to tell dumps apart, not resist anyone
+    const uint64_t s_uiPrime1 = 0x9E3779B185EBCA87ull;
+    const uint64_t s_uiPrime2 = 0xC2B2AE3D27D4EB4Full;
+    const uint64_t s_uiPrime3 = 0x165667B19E3779F9ull;
+    const uint64_t s_uiPrime4 = 0x85EBCA77C2B2AE63ull;
+    const uint64_t s_uiPrime5 = 0x27D4EB2F165667C5ull;
+
+    inline uint64_t RotateLeft(uint64_t uiValue, int iBits)
+    {
+        return (uiValue << iBits) | (uiValue >> (64 - iBits));
+    }
+
+    inline uint64_t Read64(const char* pData)
+    {
+        uint64_t uiValue;
+        memcpy(&uiValue, pData, sizeof(uiValue));
+        return uiValue;
+    }
+
+    inline uint32 Read32(const char* pData)
+    {
+        uint32 uiValue;
+        memcpy(&uiValue, pData, sizeof(uiValue));
+        return uiValue;
+    }
+
+    inline uint64_t Round(uint64_t uiAcc, uint64_t uiInput)
+    {
+        uiAcc += uiInput * s_uiPrime2;
+        uiAcc = RotateLeft(uiAcc, 31);
+        return uiAcc * s_uiPrime1;
+    }
+
+    inline uint64_t MergeRound(uint64_t uiAcc, uint64_t uiValue)
+    {
+        uiAcc ^= Round(0, uiValue);
+        return uiAcc * s_uiPrime1 + s_uiPrime4;
+    }
+
+    uint64_t Hash64(const char* pData, size_t uiSize)
+    {
+        const char* pEnd = pData + uiSize;
+        uint64_t uiHash;
+
+        if (uiSize >= 32)
+        {
+            uint64_t v1 = s_uiPrime1 + s_uiPrime2;
+            uint64_t v2 = s_uiPrime2;
+            uint64_t v3 = 0;
+            uint64_t v4 = 0 - s_uiPrime1;
+
+            const char* pLimit = pEnd - 32;
+            do
+            {
+                v1 = Round(v1, Read64(pData));
+                v2 = Round(v2, Read64(pData + 8));
+                v3 = Round(v3, Read64(pData + 16));
+                v4 = Round(v4, Read64(pData + 24));
+                pData += 32;
+            } while (pData <= pLimit);
+
+            uiHash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+            uiHash = MergeRound(uiHash, v1);
+            uiHash = MergeRound(uiHash, v2);
+            uiHash = MergeRound(uiHash, v3);
+            uiHash = MergeRound(uiHash, v4);
+        }
+        else
+        {
+            uiHash = s_uiPrime5;
+        }
+
+        uiHash += static_cast<uint64_t>(uiSize);
+
+        for (; pData + 8 <= pEnd; pData += 8)
+            uiHash = RotateLeft(uiHash ^ Round(0, Read64(pData)), 27) * s_uiPrime1 + s_uiPrime4;
+        if (pData + 4 <= pEnd)
+        {
+            uiHash = RotateLeft(uiHash ^ (static_cast<uint64_t>(Read32(pData)) * s_uiPrime1), 23) * s_uiPrime2 + s_uiPrime3;
+            pData += 4;
+        }
+        for (; pData < pEnd; pData++)
+            uiHash = RotateLeft(uiHash ^ (static_cast<uint64_t>(static_cast<unsigned char>(*pData)) * s_uiPrime5), 11) * s_uiPrime1;
+
+        uiHash ^= uiHash >> 33;
+        uiHash *= s_uiPrime2;
+        uiHash ^= uiHash >> 29;
+        uiHash *= s_uiPrime3;
+        uiHash ^= uiHash >> 32;
+        return uiHash;
+    }
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+ParseCache::ParseCache(const std::string& sourcePath, const std::string& cachePath)
+    : m_sourcePath(sourcePath)
+    , m_cachePath(cachePath)
+    , m_uiSourceHash(0)
+    , m_bStoring(false)
+    , m_eStoreProfile(ParseProfile::Full)
+{
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+uint64_t ParseCache::HashFile(const char* filePath, uint64_t& uiSize)
+{
+    MappedFile mappedFile;
+    uiSize = 0;
+    if (!mappedFile.Open(filePath, false))
+        return 0;
+
+    uiSize = mappedFile.GetSize();
+    return Hash64(mappedFile.GetData(), mappedFile.GetSize());
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// Hashes the dump and opens the cache if it was built from exactly these contents, with at least eProfile
+bool ParseCache::OpenCache(MedianBinary::MedianFile& file, ParseProfile eProfile)
+{
+    Clock::time_point start = Clock::now();
+    m_uiSourceHash = HashFile(m_sourcePath.c_str(), m_stats.uiSourceBytes);
+    m_stats.fHashSeconds = SecondsSince(start);
+
+    // A stale or broken cache is just a miss, it gets rewritten after the parse
+    if (m_uiSourceHash == 0 || !file.Open(m_cachePath.c_str()))
+        return false;
+
+    const MedianBinary::Header& header = file.GetHeader();
+    uint64_t uiCachedHash = (static_cast<uint64_t>(header.sourceHash[1]) << 32) | header.sourceHash[0];
+    if (uiCachedHash != m_uiSourceHash || header.parseProfile > static_cast<uint32>(eProfile))
+        return false;
+
+    m_stats.uiCacheBytes = header.fileSize;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool ParseCache::Load(BFRES& bfres, ParseProfile eProfile)
+{
+    MedianBinary::MedianFile file;
+    if (!OpenCache(file, eProfile))
+        return false;
+
+    Clock::time_point start = Clock::now();
+    MedianBinary::BinaryParser::Parse(file, bfres, eProfile);
+    m_stats.fLoadSeconds = SecondsSince(start);
+    m_stats.bHit = true;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool ParseCache::LoadStreaming(const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile)
+{
+    MedianBinary::MedianFile file;
+    if (!OpenCache(file, eProfile))
+        return false;
+
+    // The callbacks do the actual export, only count the time spent reading the cache
+    double fCallbackSeconds = 0.0;
+    Clock::time_point start = Clock::now();
+    MedianBinary::BinaryParser::ParseStreaming(file,
+        [&](FMDL& fmdl)
+        {
+            Clock::time_point callbackStart = Clock::now();
+            onModel(fmdl);
+            fCallbackSeconds += SecondsSince(callbackStart);
+        },
+        [&](Anim& anim)
+        {
+            Clock::time_point callbackStart = Clock::now();
+            onAnim(anim);
+            fCallbackSeconds += SecondsSince(callbackStart);
+        },
+        eProfile);
+    m_stats.fLoadSeconds = SecondsSince(start) - fCallbackSeconds;
+    m_stats.bHit = true;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool ParseCache::Store(const BFRES& bfres, ParseProfile eProfile)
+{
+    if (!BeginStore(eProfile))
+        return false;
+
+    for (const FMDL& fmdl : bfres.fmdl)
+        StoreModel(fmdl);
+    for (const Anim& anim : bfres.fska.anims)
+        StoreAnim(anim);
+
+    return EndStore();
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool ParseCache::BeginStore(ParseProfile eProfile)
+{
+    // Nothing to key the cache on
+    if (m_uiSourceHash == 0)
+        return false;
+
+    Clock::time_point start = Clock::now();
+    m_eStoreProfile = eProfile;
+    m_bStoring = m_writer.Open(m_cachePath.c_str());
+    m_stats.fStoreSeconds += SecondsSince(start);
+    return m_bStoring;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void ParseCache::StoreModel(const FMDL& fmdl)
+{
+    if (!m_bStoring)
+        return;
+
+    Clock::time_point start = Clock::now();
+    m_writer.AddModel(fmdl);
+    m_stats.fStoreSeconds += SecondsSince(start);
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void ParseCache::StoreAnim(const Anim& anim)
+{
+    if (!m_bStoring)
+        return;
+
+    Clock::time_point start = Clock::now();
+    m_writer.AddAnim(anim);
+    m_stats.fStoreSeconds += SecondsSince(start);
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+bool ParseCache::EndStore()
+{
+    if (!m_bStoring)
+        return false;
+    m_bStoring = false;
+
+    Clock::time_point start = Clock::now();
+    m_stats.bStored = m_writer.Close(m_uiSourceHash, m_eStoreProfile);
+    m_stats.uiCacheBytes = m_stats.bStored ? m_writer.GetSize() : 0;
+    m_stats.fStoreSeconds += SecondsSince(start);
+    return m_stats.bStored;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+// One line per run so batch logs can be grepped for it
+void ParseCache::PrintStats() const
+{
+    printf("[ParseCache] %s source=%llu bytes cache=%llu bytes hash=%.3fs load=%.3fs store=%.3fs%s\n",
+        m_stats.bHit ? "hit" : "miss",
+        static_cast<unsigned long long>(m_stats.uiSourceBytes),
+        static_cast<unsigned long long>(m_stats.uiCacheBytes),
+        m_stats.fHashSeconds,
+        m_stats.fLoadSeconds,
+        m_stats.fStoreSeconds,
+        !m_stats.bHit && !m_stats.bStored ? " (not stored)" : "");
+}
@@ -0,0 +1,214 @@
+#include "SARC.h"
+#include "ThreadPool.h"
+#include "Yaz0.h"
+#include <string.h>
+#include <filesystem>
+
+namespace SARC
+{
+
+    enum SARCLayout
+    {
+        eSARCHeaderSize = 0x14,
+        eSARCByteOrder  = 0x06, // 0xFEFF read in the archive's byte order
+        eSARCDataOffset = 0x0C,
+        eSFATHeaderSize = 0x0C,
+        eSFATNodeCount  = 0x06, // uint16
+        eSFATNodeSize   = 0x10,
+        eSFNTHeaderSize = 0x08
+    };
+
+    static const uint32 s_uiSFATMagic = 0x53464154; // "SFAT"
+    static const uint32 s_uiSFNTMagic = 0x53464E54; // "SFNT"
+
+    // Set in a node's attributes when the file has a name, the low bits are the name offset in words
+    static const uint32 s_uiNodeHasName = 0x01000000;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Big or little endian reads, SARC comes in both depending on the platform
+    struct Reader
+    {
+        const uint8_t* pData;
+        bool           bBigEndian;
+
+        uint16 U16(size_t uiOffset) const
+        {
+            const uint8_t* p = pData + uiOffset;
+            return bBigEndian ? static_cast<uint16>((p[0] << 8) | p[1]) : static_cast<uint16>((p[1] << 8) | p[0]);
+        }
+
+        uint32 U32(size_t uiOffset) const
+        {
+            const uint8_t* p = pData + uiOffset;
+            if (bBigEndian)
+                return (static_cast<uint32>(p[0]) << 24) | (static_cast<uint32>(p[1]) << 16) | (static_cast<uint32>(p[2]) << 8) | p[3];
+            return (static_cast<uint32>(p[3]) << 24) | (static_cast<uint32>(p[2]) << 16) | (static_cast<uint32>(p[1]) << 8) | p[0];
+        }
+
+        // Magics read the same in both byte orders
+        uint32 Magic(size_t uiOffset) const
+        {
+            const uint8_t* p = pData + uiOffset;
+            return (static_cast<uint32>(p[0]) << 24) | (static_cast<uint32>(p[1]) << 16) | (static_cast<uint32>(p[2]) << 8) | p[3];
+        }
+    };
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool SplitPath(const std::string& path, std::string& archivePath, std::string& entryName)
+    {
+        std::error_code error;
+        if (std::filesystem::is_regular_file(path, error))
+            return false;
+
+        // The first leading part that is a file is the archive
+        for (size_t uiSeparator = path.find_first_of("\\/"); uiSeparator != std::string::npos; uiSeparator = path.find_first_of("\\/", uiSeparator + 1))
+        {
+            std::string prefix = path.substr(0, uiSeparator);
+            if (prefix.empty() || !std::filesystem::is_regular_file(prefix, error))
+                continue;
+
+            archivePath = prefix;
+            entryName = path.substr(uiSeparator + 1);
+            for (char& c : entryName)
+            {
+                if (c == '\\')
+                    c = '/';
+            }
+            return !entryName.empty();
+        }
+        return false;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Archive::Open(const char* filePath)
+    {
+        m_entries.clear();
+        m_pDecompressed.reset();
+        if (!m_mappedFile.Open(filePath, false))
+            return false;
+
+        const char* pData = m_mappedFile.GetData();
+        size_t uiSize = m_mappedFile.GetSize();
+        if (Yaz0::IsYaz0(pData, uiSize))
+        {
+            size_t uiDecompressedSize = Yaz0::GetDecompressedSize(pData, uiSize);
+            m_pDecompressed.reset(new char[uiDecompressedSize]);
+            if (!Yaz0::Decompress(pData, uiSize, m_pDecompressed.get(), uiDecompressedSize))
+                return false;
+
+            m_mappedFile.Close();
+            pData = m_pDecompressed.get();
+            uiSize = uiDecompressedSize;
+        }
+        return ReadEntries(pData, uiSize);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Archive::ReadEntries(const char* pData, size_t uiSize)
+    {
+        if (uiSize < eSARCHeaderSize + eSFATHeaderSize)
+            return false;
+
+        // The byte order mark is stored in the archive's own order
+        Reader reader = { reinterpret_cast<const uint8_t*>(pData), true };
+        if (reader.Magic(0) != s_uiMagic)
+            return false;
+        reader.bBigEndian = reader.pData[eSARCByteOrder] == 0xFE;
+
+        uint32 uiDataOffset = reader.U32(eSARCDataOffset);
+        size_t uiSFAT = reader.U16(4);
+        if (uiSFAT + eSFATHeaderSize > uiSize || reader.Magic(uiSFAT) != s_uiSFATMagic || uiDataOffset > uiSize)
+            return false;
+
+        size_t uiNodeCount = reader.U16(uiSFAT + eSFATNodeCount);
+        size_t uiNodes = uiSFAT + reader.U16(uiSFAT + 4);
+        size_t uiSFNT = uiNodes + uiNodeCount * eSFATNodeSize;
+        if (uiSFNT + eSFNTHeaderSize > uiSize || reader.Magic(uiSFNT) != s_uiSFNTMagic)
+            return false;
+        size_t uiNames = uiSFNT + reader.U16(uiSFNT + 4);
+
+        m_entries.resize(uiNodeCount);
+        for (size_t i = 0; i < uiNodeCount; i++)
+        {
+            size_t uiNode = uiNodes + i * eSFATNodeSize;
+            uint32 uiAttributes = reader.U32(uiNode + 4);
+            uint32 uiBegin = reader.U32(uiNode + 8);
+            uint32 uiEnd = reader.U32(uiNode + 12);
+            if (uiBegin > uiEnd || uiEnd > uiSize - uiDataOffset)
+                return false;
+
+            Entry& entry = m_entries[i];
+            entry.pData = pData + uiDataOffset + uiBegin;
+            entry.uiSize = uiEnd - uiBegin;
+
+            // Unnamed files are only known by their hash
+            if (uiAttributes & s_uiNodeHasName)
+            {
+                size_t uiName = uiNames + (uiAttributes & 0xFFFF) * 4;
+                const char* pEnd = uiName < uiDataOffset ? static_cast<const char*>(memchr(pData + uiName, 0, uiDataOffset - uiName)) : nullptr;
+                if (!pEnd)
+                    return false;
+                entry.name.assign(pData + uiName, pEnd);
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    const Archive::Entry* Archive::Find(const std::string& name) const
+    {
+        for (const Entry& entry : m_entries)
+        {
+            if (entry.name == name)
+                return &entry;
+        }
+        return nullptr;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    std::vector<std::string> FindEntries(const std::vector<std::string>& archivePaths, const char* szExtension)
+    {
+        size_t uiExtensionLength = strlen(szExtension);
+        std::vector<std::vector<std::string>> archiveEntries(archivePaths.size());
+        ThreadPool::Get().ParallelFor(archivePaths.size(), [&](size_t i)
+        {
+            Archive archive;
+            if (!archive.Open(archivePaths[i].c_str()))
+                return;
+
+            for (const Archive::Entry& entry : archive.GetEntries())
+            {
+                const std::string& name = entry.name;
+                if (name.size() < uiExtensionLength || name.compare(name.size() - uiExtensionLength, uiExtensionLength, szExtension) != 0)
+                    continue;
+
+                // Same separators as the archive path, so the result reads like a file path
+                std::string path = archivePaths[i] + '\\' + name;
+                for (size_t c = archivePaths[i].size(); c < path.size(); c++)
+                {
+                    if (path[c] == '/')
+                        path[c] = '\\';
+                }
+                archiveEntries[i].push_back(std::move(path));
+            }
+        });
+
+        std::vector<std::string> paths;
+        for (std::vector<std::string>& entries : archiveEntries)
+            paths.insert(paths.end(), std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+        return paths;
+    }
+
+}
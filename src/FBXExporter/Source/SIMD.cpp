@@ -0,0 +1,63 @@
+#include "SIMD.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace SIMD
+{
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool HasAVX2()
+    {
+#ifdef _MSC_VER
+        // AVX2 needs the CPU flag and the OS saving the YMM registers
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        bool bOSXSave = (info[2] & (1 << 27)) != 0;
+        bool bAVX = (info[2] & (1 << 28)) != 0;
+        if (!bOSXSave || !bAVX || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    Path GetFastestPath()
+    {
+        static const Path s_ePath = HasAVX2() ? Path::AVX2 : Path::SSE2;
+        return s_ePath;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    const char* GetPathName(Path ePath)
+    {
+        switch (ePath)
+        {
+        case Path::Scalar: return "scalar";
+        case Path::SSE2:   return "SSE2";
+        case Path::AVX2:   return "AVX2";
+        default:           return "unknown";
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    Path Resolve(Path ePath)
+    {
+        return ePath == Path::AVX2 && GetFastestPath() != Path::AVX2 ? Path::SSE2 : ePath;
+    }
+
+}
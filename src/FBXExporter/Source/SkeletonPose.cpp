@@ -0,0 +1,134 @@
+#include "SkeletonPose.h"
+#include <math.h>
+
+namespace SkeletonPose
+{
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Math::matrix4D Identity()
+    {
+        Math::matrix4D m = {};
+        for (int i = 0; i < 4; i++)
+            m.M[i][i] = 1.0;
+        return m;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // The 3x3 product a * b, the rest of the result is the identity's
+    static Math::matrix4D Multiply3x3(const Math::matrix4D& a, const Math::matrix4D& b)
+    {
+        Math::matrix4D m = Identity();
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                m.M[i][j] = a.M[i][0] * b.M[0][j] + a.M[i][1] * b.M[1][j] + a.M[i][2] * b.M[2][j];
+        return m;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Euler XYZ rotation of the node, from the degrees CreateBone sets it to
+    static Math::matrix4D LocalRotation(const Bone& bone)
+    {
+        if (bone.rotationType != Bone::RotationType::EulerXYZ)
+            return Identity();
+
+        const double fDegreesToRadians = Math::pi() / 180.0;
+        double fX = Math::ConvertRadiansToDegrees(bone.rotation.X) * fDegreesToRadians;
+        double fY = Math::ConvertRadiansToDegrees(bone.rotation.Y) * fDegreesToRadians;
+        double fZ = Math::ConvertRadiansToDegrees(bone.rotation.Z) * fDegreesToRadians;
+        double cx = cos(fX), sx = sin(fX);
+        double cy = cos(fY), sy = sin(fY);
+        double cz = cos(fZ), sz = sin(fZ);
+
+        // Rx * Ry * Rz, row vectors go through X first
+        Math::matrix4D m = Identity();
+        m.M[0][0] = cy * cz;                 m.M[0][1] = cy * sz;                 m.M[0][2] = -sy;
+        m.M[1][0] = sx * sy * cz - cx * sz;  m.M[1][1] = sx * sy * sz + cx * cz;  m.M[1][2] = sx * cy;
+        m.M[2][0] = cx * sy * cz + sx * sz;  m.M[2][1] = cx * sy * sz - sx * cz;  m.M[2][2] = cx * cy;
+        return m;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // The child's scale and rotation, then the parent's scale along the child's axes, then the parent's
+    // rotation. The translation goes through the parent's whole matrix.
+    static Math::matrix4D InheritRrSs(const Math::matrix4D& parent, const Bone& bone)
+    {
+        // The parent's scale is the length of its rows, its rotation the rows without it
+        double parentScale[3];
+        Math::matrix4D parentRotation = Identity();
+        for (int i = 0; i < 3; i++)
+        {
+            parentScale[i] = sqrt(parent.M[i][0] * parent.M[i][0] + parent.M[i][1] * parent.M[i][1] + parent.M[i][2] * parent.M[i][2]);
+            for (int j = 0; j < 3; j++)
+                parentRotation.M[i][j] = parentScale[i] > 0.0 ? parent.M[i][j] / parentScale[i] : 0.0;
+        }
+
+        Math::matrix4D scaledRotation = LocalRotation(bone);
+        const double localScale[3] = { bone.scale.X, bone.scale.Y, bone.scale.Z };
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+                scaledRotation.M[i][j] *= localScale[i] * parentScale[i];
+        }
+
+        Math::matrix4D global = Multiply3x3(scaledRotation, parentRotation);
+        const double localTranslation[3] = { bone.position.X, bone.position.Y, bone.position.Z };
+        for (int j = 0; j < 3; j++)
+            global.M[3][j] = localTranslation[0] * parent.M[0][j] + localTranslation[1] * parent.M[1][j] + localTranslation[2] * parent.M[2][j] + parent.M[3][j];
+        return global;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void ComputeGlobalTransforms(const FSKL& fskl, std::vector<Math::matrix4D>& globals)
+    {
+        const uint32 uiBoneCount = static_cast<uint32>(fskl.bones.size());
+        globals.assign(uiBoneCount, Identity());
+
+        // Children listed per parent, counted first so they fit one array
+        std::vector<uint32> childOffsets(uiBoneCount + 1, 0);
+        for (uint32 i = 0; i < uiBoneCount; i++)
+        {
+            int32 iParent = fskl.bones[i].parentIndex;
+            if (iParent >= 0 && static_cast<uint32>(iParent) < uiBoneCount)
+                childOffsets[iParent + 1]++;
+        }
+        for (uint32 i = 0; i < uiBoneCount; i++)
+            childOffsets[i + 1] += childOffsets[i];
+
+        std::vector<uint32> children(childOffsets[uiBoneCount]);
+        std::vector<uint32> cursors(childOffsets.begin(), childOffsets.end() - 1);
+        for (uint32 i = 0; i < uiBoneCount; i++)
+        {
+            int32 iParent = fskl.bones[i].parentIndex;
+            if (iParent >= 0 && static_cast<uint32>(iParent) < uiBoneCount)
+                children[cursors[iParent]++] = i;
+        }
+
+        // Breadth first from the roots, a bone's parent is always done before it
+        std::vector<uint32> order;
+        order.reserve(uiBoneCount);
+        for (uint32 i = 0; i < uiBoneCount; i++)
+        {
+            if (fskl.bones[i].parentIndex < 0)
+                order.push_back(i);
+        }
+
+        const Math::matrix4D identity = Identity();
+        for (size_t uiNext = 0; uiNext < order.size(); uiNext++)
+        {
+            uint32 uiBone = order[uiNext];
+            const Bone& bone = fskl.bones[uiBone];
+            globals[uiBone] = InheritRrSs(bone.parentIndex < 0 ? identity : globals[bone.parentIndex], bone);
+            order.insert(order.end(), children.begin() + childOffsets[uiBone], children.begin() + childOffsets[uiBone + 1]);
+        }
+    }
+
+}
@@ -0,0 +1,138 @@
+#include "SkinBuilder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <functional>
+
+namespace SkinBuilder
+{
+
+    // Vertices a range runs both passes over, meshes of one range are built on the calling thread alone
+    static const uint32 s_uiRangeVertices = 8192;
+
+    // Blend indices of a vertex, the most a vertex has
+    static const uint32 s_uiMaxInfluences = 4;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // The bones moving vertex v and their weights, returns how many there are
+    static uint32 GetInfluences(const VertexStreams& vertices, uint32 v, uint32 uiSkinCount, const std::vector<PaletteEntry>& palette,
+                                uint32 bones[s_uiMaxInfluences], float weights[s_uiMaxInfluences])
+    {
+        static const Math::vector4 s_firstBoneIndices = { 0, 0, 0, 0 };
+        static const Math::vector4F s_firstBoneWeights = Math::vector4F{ 1, 0, 0, 0 };
+
+        const Math::vector4& blendIndex = v < vertices.blendIndex.size() ? vertices.blendIndex[v] : s_firstBoneIndices;
+        const Math::vector4F& blendWeights = v < vertices.blendWeights.size() ? vertices.blendWeights[v] : s_firstBoneWeights;
+        const uint32 uiBlendIndices[s_uiMaxInfluences] = { blendIndex.X, blendIndex.Y, blendIndex.Z, blendIndex.W };
+        const float fBlendWeights[s_uiMaxInfluences] = { blendWeights.X, blendWeights.Y, blendWeights.Z, blendWeights.W };
+
+        if (uiBlendIndices[0] >= palette.size())
+            return 0;
+        if (palette[uiBlendIndices[0]].bRigid)
+        {
+            bones[0] = palette[uiBlendIndices[0]].uiBoneIndex;
+            weights[0] = 1.0f;
+            return 1;
+        }
+
+        uint32 uiInfluences = 0;
+        for (uint32 e = 0; e < uiSkinCount; e++)
+        {
+            if (fBlendWeights[e] > 0 && uiBlendIndices[e] < palette.size())
+            {
+                bones[uiInfluences] = palette[uiBlendIndices[e]].uiBoneIndex;
+                weights[uiInfluences] = fBlendWeights[e];
+                uiInfluences++;
+            }
+        }
+        return uiInfluences;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void Build(const VertexStreams& vertices, const uint32* pVertices, uint32 uiCount, uint32 uiSkinCount,
+               const std::vector<PaletteEntry>& palette, Skin& skin)
+    {
+        skin.bones.clear();
+        skin.offsets.clear();
+        skin.controlPoints.clear();
+        skin.weights.clear();
+        uiSkinCount = std::min(uiSkinCount, s_uiMaxInfluences);
+
+        uint32 uiBoneCount = 0;
+        for (const PaletteEntry& entry : palette)
+            uiBoneCount = std::max(uiBoneCount, entry.uiBoneIndex + 1);
+
+        // Runs func over the vertex ranges, in parallel when there is more than one
+        uint32 uiRanges = std::max(1u, (uiCount + s_uiRangeVertices - 1) / s_uiRangeVertices);
+        auto forEachRange = [&](const std::function<void(uint32, uint32, uint32)>& func)
+        {
+            auto runRange = [&](size_t r)
+            {
+                uint32 uiFirst = static_cast<uint32>(r) * s_uiRangeVertices;
+                func(static_cast<uint32>(r), uiFirst, std::min(uiCount, uiFirst + s_uiRangeVertices));
+            };
+            if (uiRanges == 1)
+                runRange(0);
+            else
+                ThreadPool::Get().ParallelFor(uiRanges, runRange);
+        };
+
+        // First pass, the influences of every bone per range
+        std::vector<uint32> cursors(static_cast<size_t>(uiRanges) * uiBoneCount, 0);
+        forEachRange([&](uint32 r, uint32 uiFirst, uint32 uiEnd)
+        {
+            uint32* pCounts = cursors.data() + static_cast<size_t>(r) * uiBoneCount;
+            uint32 bones[s_uiMaxInfluences];
+            float weights[s_uiMaxInfluences];
+            for (uint32 i = uiFirst; i < uiEnd; i++)
+            {
+                uint32 uiInfluences = GetInfluences(vertices, pVertices[i], uiSkinCount, palette, bones, weights);
+                for (uint32 j = 0; j < uiInfluences; j++)
+                    pCounts[bones[j]]++;
+            }
+        });
+
+        // A row per bone with influences, the counts become where every range starts writing into it
+        uint32 uiTotal = 0;
+        for (uint32 b = 0; b < uiBoneCount; b++)
+        {
+            uint32 uiRowStart = uiTotal;
+            for (uint32 r = 0; r < uiRanges; r++)
+            {
+                uint32& uiCursor = cursors[static_cast<size_t>(r) * uiBoneCount + b];
+                uint32 uiRangeCount = uiCursor;
+                uiCursor = uiTotal;
+                uiTotal += uiRangeCount;
+            }
+            if (uiTotal == uiRowStart)
+                continue;
+            skin.bones.push_back(b);
+            skin.offsets.push_back(uiRowStart);
+        }
+        skin.offsets.push_back(uiTotal);
+        skin.controlPoints.resize(uiTotal);
+        skin.weights.resize(uiTotal);
+
+        // Second pass, every range fills its part of the rows
+        forEachRange([&](uint32 r, uint32 uiFirst, uint32 uiEnd)
+        {
+            uint32* pCursors = cursors.data() + static_cast<size_t>(r) * uiBoneCount;
+            uint32 bones[s_uiMaxInfluences];
+            float weights[s_uiMaxInfluences];
+            for (uint32 i = uiFirst; i < uiEnd; i++)
+            {
+                uint32 uiInfluences = GetInfluences(vertices, pVertices[i], uiSkinCount, palette, bones, weights);
+                for (uint32 j = 0; j < uiInfluences; j++)
+                {
+                    uint32 uiSlot = pCursors[bones[j]]++;
+                    skin.controlPoints[uiSlot] = i;
+                    skin.weights[uiSlot] = weights[j];
+                }
+            }
+        });
+    }
+
+}
@@ -0,0 +1,124 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    // State of one ParallelFor call. Helpers still sitting in the queue when the loop finishes keep it
+    // alive through their shared_ptr, find no indices left and return straight away.
+    struct ParallelForState
+    {
+        std::function<void(size_t)> func;
+        size_t                      uiCount;
+        std::atomic<size_t>         uiNext;
+        std::atomic<size_t>         uiDone;
+        std::mutex                  mutex;
+        std::condition_variable     finished;
+
+        void Run()
+        {
+            size_t uiFinished = 0;
+            for (size_t i = uiNext++; i < uiCount; i = uiNext++)
+            {
+                func(i);
+                uiFinished++;
+            }
+
+            if (uiFinished > 0 && (uiDone += uiFinished) == uiCount)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    };
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+ThreadPool::ThreadPool(unsigned int uiThreadCount)
+    : m_bStopping(false)
+{
+    m_threads.reserve(uiThreadCount);
+    for (unsigned int i = 0; i < uiThreadCount; i++)
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStopping = true;
+    }
+    m_taskReady.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+ThreadPool& ThreadPool::Get()
+{
+    static ThreadPool s_pool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0);
+    return s_pool;
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void ThreadPool::ParallelFor(size_t uiCount, const std::function<void(size_t)>& func)
+{
+    // Not worth waking anyone up for
+    if (uiCount <= 1 || m_threads.empty())
+    {
+        for (size_t i = 0; i < uiCount; i++)
+            func(i);
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> pState = std::make_shared<ParallelForState>();
+    pState->func = func;
+    pState->uiCount = uiCount;
+    pState->uiNext = 0;
+    pState->uiDone = 0;
+
+    size_t uiHelpers = uiCount - 1 < m_threads.size() ? uiCount - 1 : m_threads.size();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < uiHelpers; i++)
+            m_tasks.emplace_back([pState]() { pState->Run(); });
+    }
+    m_taskReady.notify_all();
+
+    pState->Run();
+
+    // Only indices some other thread is already working on can be left at this point
+    std::unique_lock<std::mutex> lock(pState->mutex);
+    pState->finished.wait(lock, [&pState]() { return pState->uiDone == pState->uiCount; });
+}
+
+
+// -----------------------------------------------------------------------
+// -----------------------------------------------------------------------
+void ThreadPool::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskReady.wait(lock, [this]() { return m_bStopping || !m_tasks.empty(); });
+            if (m_bStopping && m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,892 @@
+#include "VertexAttrib.h"
+#include <string.h>
+#include <algorithm>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+namespace VertexAttrib
+{
+
+    // How a component is stored, each has its own conversion kernel
+    enum ComponentKind
+    {
+        eKindByte,
+        eKindNibble,  // 4_4, low nibble first
+        eKindShort,
+        eKindHalf,
+        eKindInt,
+        eKindFloat,
+        eKind1010102  // x, y and z in the low 30 bits, w in the top 2
+    };
+
+    struct Layout
+    {
+        uint8_t uiComponents;
+        uint8_t uiBits;   // per component, 0 for the packed layouts
+        bool    bFloat;
+    };
+
+    static const Layout s_layouts[] =
+    {
+        { 1, 8 , false }, // 0x00 8
+        { 2, 4 , false }, // 0x01 4_4
+        { 1, 16, false }, // 0x02 16
+        { 1, 16, true  }, // 0x03 16 float
+        { 2, 8 , false }, // 0x04 8_8
+        { 1, 32, false }, // 0x05 32
+        { 1, 32, true  }, // 0x06 32 float
+        { 2, 16, false }, // 0x07 16_16
+        { 2, 16, true  }, // 0x08 16_16 float
+        { 3, 0 , true  }, // 0x09 10_11_11 float, not supported
+        { 4, 8 , false }, // 0x0A 8_8_8_8
+        { 4, 0 , false }, // 0x0B 10_10_10_2
+        { 2, 32, false }, // 0x0C 32_32
+        { 2, 32, true  }, // 0x0D 32_32 float
+        { 4, 16, false }, // 0x0E 16_16_16_16
+        { 4, 16, true  }, // 0x0F 16_16_16_16 float
+        { 3, 32, false }, // 0x10 32_32_32
+        { 3, 32, true  }, // 0x11 32_32_32 float
+        { 4, 32, false }, // 0x12 32_32_32_32
+        { 4, 32, true  }  // 0x13 32_32_32_32 float
+    };
+
+    static const uint32 s_uiLayout4_4       = 0x01;
+    static const uint32 s_uiLayout10_11_11  = 0x09;
+    static const uint32 s_uiLayout10_10_10_2 = 0x0B;
+
+    // Elements gathered out of an interleaved buffer per pass, 16 bytes at most each
+    static const size_t s_uiChunkElements = 1024;
+    static const size_t s_uiMaxElementSize = 16;
+
+    // Integer to float: sign extended or not, then divided when normalized
+    struct Conversion
+    {
+        bool  bSigned;
+        bool  bNormalized;
+        float fDivisor;
+    };
+
+    struct ElementInfo
+    {
+        ComponentKind eKind;
+        uint32        uiSize;
+        uint32        uiComponents;
+        Conversion    conversion;   // of every component, the x, y and z of 10_10_10_2
+        Conversion    conversionW;  // the w of 10_10_10_2
+    };
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static Conversion GetConversion(uint32 uiBits, uint32 uiType)
+    {
+        switch (uiType)
+        {
+        case eTypeUNorm:
+            return { false, true, static_cast<float>((1ull << uiBits) - 1) };
+        case eTypeSNorm:
+            return { true, true, static_cast<float>((1ull << (uiBits - 1)) - 1) };
+        case eTypeSInt:
+        case eTypeSIntToSingle:
+            return { true, false, 1.0f };
+        default:
+            return { false, false, 1.0f };
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static bool GetElementInfo(uint32 uiFormat, ElementInfo& info)
+    {
+        uint32 uiLayout = uiFormat & 0xFF;
+        uint32 uiType = (uiFormat >> 8) & 0xF;
+        if (uiLayout >= sizeof(s_layouts) / sizeof(s_layouts[0]) || uiLayout == s_uiLayout10_11_11)
+            return false;
+
+        const Layout& layout = s_layouts[uiLayout];
+        info.uiComponents = layout.uiComponents;
+        if (uiLayout == s_uiLayout10_10_10_2)
+        {
+            info.eKind = eKind1010102;
+            info.uiSize = 4;
+            info.conversion = GetConversion(10, uiType);
+            // the two bit w is never normalized when signed
+            info.conversionW = GetConversion(2, uiType == eTypeSNorm ? static_cast<uint32>(eTypeSInt) : uiType);
+            return true;
+        }
+
+        info.uiSize = layout.uiComponents * std::max<uint32>(layout.uiBits, 4) / 8;
+        info.conversion = GetConversion(layout.uiBits, uiType);
+        info.conversionW = info.conversion;
+        if (uiLayout == s_uiLayout4_4)
+        {
+            info.eKind = eKindNibble;
+            info.uiSize = 1;
+        }
+        else if (layout.uiBits == 8)
+            info.eKind = eKindByte;
+        else if (layout.uiBits == 16)
+            info.eKind = layout.bFloat ? eKindHalf : eKindShort;
+        else
+            info.eKind = layout.bFloat ? eKindFloat : eKindInt;
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint32 GetElementSize(uint32 uiFormat)
+    {
+        ElementInfo info;
+        return GetElementInfo(uiFormat, info) ? info.uiSize : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint32 GetComponentCount(uint32 uiFormat)
+    {
+        ElementInfo info;
+        return GetElementInfo(uiFormat, info) ? info.uiComponents : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint16 ReadU16BE(const uint8_t* p)
+    {
+        return static_cast<uint16>((p[0] << 8) | p[1]);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 ReadU32BE(const uint8_t* p)
+    {
+        return (static_cast<uint32>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static float HalfToFloat(uint16 uiHalf)
+    {
+        uint32 uiSign     = (uiHalf & 0x8000u) << 16;
+        uint32 uiExponent = (uiHalf >> 10) & 0x1F;
+        uint32 uiMantissa = uiHalf & 0x3FF;
+
+        uint32 uiBits;
+        if (uiExponent == 0x1F)
+            uiBits = uiSign | 0x7F800000u | (uiMantissa << 13); // inf, nan
+        else if (uiExponent != 0)
+            uiBits = uiSign | ((uiExponent + 112) << 23) | (uiMantissa << 13);
+        else if (uiMantissa == 0)
+            uiBits = uiSign;
+        else
+        {
+            // Denormal half, normalize it for the float
+            uiExponent = 113;
+            while ((uiMantissa & 0x400) == 0)
+            {
+                uiMantissa <<= 1;
+                uiExponent--;
+            }
+            uiBits = uiSign | (uiExponent << 23) | ((uiMantissa & 0x3FF) << 13);
+        }
+
+        float fValue;
+        memcpy(&fValue, &uiBits, sizeof(fValue));
+        return fValue;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static float ConvertComponent(uint32 uiValue, uint32 uiBits, uint32 uiType)
+    {
+        // Sign extend for the signed types
+        int32 iValue = uiBits < 32 ? static_cast<int32>(uiValue << (32 - uiBits)) >> (32 - uiBits) : static_cast<int32>(uiValue);
+        switch (uiType)
+        {
+        case eTypeUNorm:
+            return static_cast<float>(uiValue) / static_cast<float>((1ull << uiBits) - 1);
+        case eTypeSNorm:
+            // the most negative value lies a step past -1 and clamps to it
+            return std::max(static_cast<float>(iValue) / static_cast<float>((1ull << (uiBits - 1)) - 1), -1.0f);
+        case eTypeSInt:
+        case eTypeSIntToSingle:
+            return static_cast<float>(iValue);
+        default:
+            return static_cast<float>(uiValue);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool DecodeReference(const char* pSrc, size_t uiStride, size_t uiCount, uint32 uiFormat, float* pDst)
+    {
+        uint32 uiLayout = uiFormat & 0xFF;
+        uint32 uiType = (uiFormat >> 8) & 0xF;
+        ElementInfo info;
+        if (!GetElementInfo(uiFormat, info))
+            return false;
+
+        for (size_t j = 0; j < uiCount; j++)
+        {
+            const uint8_t* pElement = reinterpret_cast<const uint8_t*>(pSrc) + uiStride * j;
+            float* pValues = pDst + info.uiComponents * j;
+            if (uiLayout == s_uiLayout10_10_10_2)
+            {
+                uint32 uiPacked = ReadU32BE(pElement);
+                for (uint32 i = 0; i < 3; i++)
+                    pValues[i] = ConvertComponent((uiPacked >> (10 * i)) & 0x3FF, 10, uiType);
+                // the two bit w is never normalized when signed
+                pValues[3] = ConvertComponent(uiPacked >> 30, 2, uiType == eTypeSNorm ? static_cast<uint32>(eTypeSInt) : uiType);
+            }
+            else if (uiLayout == s_uiLayout4_4)
+            {
+                pValues[0] = ConvertComponent(pElement[0] & 0xF, 4, uiType);
+                pValues[1] = ConvertComponent(pElement[0] >> 4, 4, uiType);
+            }
+            else
+            {
+                const Layout& layout = s_layouts[uiLayout];
+                for (uint32 i = 0; i < layout.uiComponents; i++)
+                {
+                    if (layout.uiBits == 8)
+                        pValues[i] = ConvertComponent(pElement[i], 8, uiType);
+                    else if (layout.uiBits == 16)
+                    {
+                        uint16 uiValue = ReadU16BE(pElement + 2 * i);
+                        pValues[i] = layout.bFloat ? HalfToFloat(uiValue) : ConvertComponent(uiValue, 16, uiType);
+                    }
+                    else
+                    {
+                        uint32 uiValue = ReadU32BE(pElement + 4 * i);
+                        if (layout.bFloat)
+                            memcpy(&pValues[i], &uiValue, sizeof(float));
+                        else
+                            pValues[i] = ConvertComponent(uiValue, 32, uiType);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // Scalar kernels, also the tails of the SIMD ones
+    // -----------------------------------------------------------------------
+    static float Convert(int32 iValue, const Conversion& conversion)
+    {
+        float fValue = static_cast<float>(iValue);
+        return conversion.bNormalized ? std::max(fValue / conversion.fDivisor, -1.0f) : fValue;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static float ConvertUnsigned(uint32 uiValue, const Conversion& conversion)
+    {
+        float fValue = static_cast<float>(uiValue);
+        return conversion.bNormalized ? fValue / conversion.fDivisor : fValue;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertBytesScalar(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        for (size_t i = 0; i < uiValues; i++)
+            pDst[i] = Convert(conversion.bSigned ? static_cast<int8_t>(pSrc[i]) : pSrc[i], conversion);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertNibblesScalar(const uint8_t* pSrc, size_t uiElements, const Conversion& conversion, float* pDst)
+    {
+        for (size_t i = 0; i < uiElements; i++)
+        {
+            int32 iLow = pSrc[i] & 0xF;
+            int32 iHigh = pSrc[i] >> 4;
+            if (conversion.bSigned)
+            {
+                iLow = (iLow ^ 8) - 8;
+                iHigh = (iHigh ^ 8) - 8;
+            }
+            pDst[2 * i] = Convert(iLow, conversion);
+            pDst[2 * i + 1] = Convert(iHigh, conversion);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertShortsScalar(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        for (size_t i = 0; i < uiValues; i++)
+        {
+            uint16 uiValue = ReadU16BE(pSrc + 2 * i);
+            pDst[i] = Convert(conversion.bSigned ? static_cast<int16_t>(uiValue) : uiValue, conversion);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertHalvesScalar(const uint8_t* pSrc, size_t uiValues, float* pDst)
+    {
+        for (size_t i = 0; i < uiValues; i++)
+            pDst[i] = HalfToFloat(ReadU16BE(pSrc + 2 * i));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertIntsScalar(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        for (size_t i = 0; i < uiValues; i++)
+        {
+            uint32 uiValue = ReadU32BE(pSrc + 4 * i);
+            pDst[i] = conversion.bSigned ? Convert(static_cast<int32>(uiValue), conversion) : ConvertUnsigned(uiValue, conversion);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertFloatsScalar(const uint8_t* pSrc, size_t uiValues, float* pDst)
+    {
+        for (size_t i = 0; i < uiValues; i++)
+        {
+            uint32 uiValue = ReadU32BE(pSrc + 4 * i);
+            memcpy(&pDst[i], &uiValue, sizeof(float));
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void Convert1010102Scalar(const uint8_t* pSrc, size_t uiElements, const ElementInfo& info, float* pDst)
+    {
+        for (size_t i = 0; i < uiElements; i++)
+        {
+            uint32 uiPacked = ReadU32BE(pSrc + 4 * i);
+            for (uint32 c = 0; c < 3; c++)
+            {
+                uint32 uiValue = (uiPacked >> (10 * c)) & 0x3FF;
+                pDst[4 * i + c] = Convert(info.conversion.bSigned ? (static_cast<int32>(uiValue) ^ 0x200) - 0x200 : static_cast<int32>(uiValue), info.conversion);
+            }
+            uint32 uiW = uiPacked >> 30;
+            pDst[4 * i + 3] = Convert(info.conversionW.bSigned ? (static_cast<int32>(uiW) ^ 2) - 2 : static_cast<int32>(uiW), info.conversionW);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // SSE2 kernels
+    // -----------------------------------------------------------------------
+    static __m128 NormalizeSSE2(__m128i values, const Conversion& conversion)
+    {
+        __m128 fValues = _mm_cvtepi32_ps(values);
+        return conversion.bNormalized ? _mm_max_ps(_mm_div_ps(fValues, _mm_set1_ps(conversion.fDivisor)), _mm_set1_ps(-1.0f)) : fValues;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static __m128i ByteSwap16SSE2(__m128i values)
+    {
+        return _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static __m128i ByteSwap32SSE2(__m128i values)
+    {
+        values = ByteSwap16SSE2(values);
+        return _mm_or_si128(_mm_slli_epi32(values, 16), _mm_srli_epi32(values, 16));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // 8 shorts to two times 4 ints, sign extended or not
+    static void WidenShortsSSE2(__m128i values, bool bSigned, __m128i& low, __m128i& high)
+    {
+        if (bSigned)
+        {
+            low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+            high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+        }
+        else
+        {
+            low = _mm_unpacklo_epi16(values, _mm_setzero_si128());
+            high = _mm_unpackhi_epi16(values, _mm_setzero_si128());
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertBytesSSE2(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 16 <= uiValues; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+            __m128i shorts[2];
+            if (conversion.bSigned)
+            {
+                shorts[0] = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+                shorts[1] = _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8);
+            }
+            else
+            {
+                shorts[0] = _mm_unpacklo_epi8(bytes, _mm_setzero_si128());
+                shorts[1] = _mm_unpackhi_epi8(bytes, _mm_setzero_si128());
+            }
+            for (uint32 h = 0; h < 2; h++)
+            {
+                __m128i low, high;
+                WidenShortsSSE2(shorts[h], conversion.bSigned, low, high);
+                _mm_storeu_ps(pDst + i + 8 * h, NormalizeSSE2(low, conversion));
+                _mm_storeu_ps(pDst + i + 8 * h + 4, NormalizeSSE2(high, conversion));
+            }
+        }
+        ConvertBytesScalar(pSrc + i, uiValues - i, conversion, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertShortsSSE2(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 8 <= uiValues; i += 8)
+        {
+            __m128i shorts = ByteSwap16SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * i)));
+            __m128i low, high;
+            WidenShortsSSE2(shorts, conversion.bSigned, low, high);
+            _mm_storeu_ps(pDst + i, NormalizeSSE2(low, conversion));
+            _mm_storeu_ps(pDst + i + 4, NormalizeSSE2(high, conversion));
+        }
+        ConvertShortsScalar(pSrc + 2 * i, uiValues - i, conversion, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // 4 halves in the low 16 bits of each lane to floats. Exponent and mantissa move into place and get
+    // rebiased; inf and nan get their exponent rebiased twice to reach all ones, denormals are normalized by
+    // a float subtraction, which is exact.
+    static __m128 HalfToFloatSSE2(__m128i halves)
+    {
+        const __m128i exponentMask = _mm_set1_epi32(0x7C00 << 13);
+        const __m128i rebias = _mm_set1_epi32(112 << 23);
+        __m128i sign = _mm_slli_epi32(_mm_and_si128(halves, _mm_set1_epi32(0x8000)), 16);
+        __m128i bits = _mm_slli_epi32(_mm_and_si128(halves, _mm_set1_epi32(0x7FFF)), 13);
+        __m128i exponent = _mm_and_si128(bits, exponentMask);
+        bits = _mm_add_epi32(bits, rebias);
+
+        __m128i infNan = _mm_cmpeq_epi32(exponent, exponentMask);
+        bits = _mm_add_epi32(bits, _mm_and_si128(infNan, rebias));
+
+        __m128i denormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+        __m128 normalized = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+        __m128i result = _mm_or_si128(_mm_andnot_si128(denormal, bits), _mm_and_si128(denormal, _mm_castps_si128(normalized)));
+        return _mm_castsi128_ps(_mm_or_si128(result, sign));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertHalvesSSE2(const uint8_t* pSrc, size_t uiValues, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 8 <= uiValues; i += 8)
+        {
+            __m128i halves = ByteSwap16SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * i)));
+            _mm_storeu_ps(pDst + i, HalfToFloatSSE2(_mm_unpacklo_epi16(halves, _mm_setzero_si128())));
+            _mm_storeu_ps(pDst + i + 4, HalfToFloatSSE2(_mm_unpackhi_epi16(halves, _mm_setzero_si128())));
+        }
+        ConvertHalvesScalar(pSrc + 2 * i, uiValues - i, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Unsigned ints don't fit cvtepi32_ps; both 16 bit halves convert exactly and their sum rounds once,
+    // like a plain cast
+    static __m128 UnsignedToFloatSSE2(__m128i values)
+    {
+        __m128 high = _mm_cvtepi32_ps(_mm_srli_epi32(values, 16));
+        __m128 low = _mm_cvtepi32_ps(_mm_and_si128(values, _mm_set1_epi32(0xFFFF)));
+        return _mm_add_ps(_mm_mul_ps(high, _mm_set1_ps(65536.0f)), low);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertIntsSSE2(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 4 <= uiValues; i += 4)
+        {
+            __m128i ints = ByteSwap32SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i)));
+            __m128 values = conversion.bSigned ? _mm_cvtepi32_ps(ints) : UnsignedToFloatSSE2(ints);
+            if (conversion.bNormalized)
+                values = _mm_max_ps(_mm_div_ps(values, _mm_set1_ps(conversion.fDivisor)), _mm_set1_ps(-1.0f));
+            _mm_storeu_ps(pDst + i, values);
+        }
+        ConvertIntsScalar(pSrc + 4 * i, uiValues - i, conversion, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void ConvertFloatsSSE2(const uint8_t* pSrc, size_t uiValues, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 4 <= uiValues; i += 4)
+        {
+            __m128i floats = ByteSwap32SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i)));
+            _mm_storeu_ps(pDst + i, _mm_castsi128_ps(floats));
+        }
+        ConvertFloatsScalar(pSrc + 4 * i, uiValues - i, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // One component of 10_10_10_2 words: shifted to the top, then down again with or without the sign
+    template <int iShift, int iBits>
+    static __m128i Extract1010102SSE2(__m128i packed, bool bSigned)
+    {
+        __m128i top = _mm_slli_epi32(packed, 32 - iShift - iBits);
+        return bSigned ? _mm_srai_epi32(top, 32 - iBits) : _mm_srli_epi32(top, 32 - iBits);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static void Convert1010102SSE2(const uint8_t* pSrc, size_t uiElements, const ElementInfo& info, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 4 <= uiElements; i += 4)
+        {
+            __m128i packed = ByteSwap32SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i)));
+            __m128 x = NormalizeSSE2(Extract1010102SSE2<0, 10>(packed, info.conversion.bSigned), info.conversion);
+            __m128 y = NormalizeSSE2(Extract1010102SSE2<10, 10>(packed, info.conversion.bSigned), info.conversion);
+            __m128 z = NormalizeSSE2(Extract1010102SSE2<20, 10>(packed, info.conversion.bSigned), info.conversion);
+            __m128 w = NormalizeSSE2(Extract1010102SSE2<30, 2>(packed, info.conversionW.bSigned), info.conversionW);
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_storeu_ps(pDst + 4 * i, x);
+            _mm_storeu_ps(pDst + 4 * i + 4, y);
+            _mm_storeu_ps(pDst + 4 * i + 8, z);
+            _mm_storeu_ps(pDst + 4 * i + 12, w);
+        }
+        Convert1010102Scalar(pSrc + 4 * i, uiElements - i, info, pDst + 4 * i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // AVX2 kernels, 8 values per conversion. The scalar tails are SSE code,
+    // the upper halves are cleared before them.
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static __m256 NormalizeAVX2(__m256i values, const Conversion& conversion)
+    {
+        __m256 fValues = _mm256_cvtepi32_ps(values);
+        return conversion.bNormalized ? _mm256_max_ps(_mm256_div_ps(fValues, _mm256_set1_ps(conversion.fDivisor)), _mm256_set1_ps(-1.0f)) : fValues;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static __m256i ByteSwap32AVX2(__m256i values)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        return _mm256_shuffle_epi8(values, shuffle);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static void ConvertBytesAVX2(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 16 <= uiValues; i += 16)
+        {
+            for (uint32 h = 0; h < 2; h++)
+            {
+                __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + i + 8 * h));
+                __m256i ints = conversion.bSigned ? _mm256_cvtepi8_epi32(bytes) : _mm256_cvtepu8_epi32(bytes);
+                _mm256_storeu_ps(pDst + i + 8 * h, NormalizeAVX2(ints, conversion));
+            }
+        }
+        _mm256_zeroupper();
+        ConvertBytesScalar(pSrc + i, uiValues - i, conversion, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static void ConvertShortsAVX2(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 16 <= uiValues; i += 16)
+        {
+            for (uint32 h = 0; h < 2; h++)
+            {
+                __m128i shorts = ByteSwap16SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * i + 16 * h)));
+                __m256i ints = conversion.bSigned ? _mm256_cvtepi16_epi32(shorts) : _mm256_cvtepu16_epi32(shorts);
+                _mm256_storeu_ps(pDst + i + 8 * h, NormalizeAVX2(ints, conversion));
+            }
+        }
+        _mm256_zeroupper();
+        ConvertShortsScalar(pSrc + 2 * i, uiValues - i, conversion, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // HalfToFloatSSE2 on 8 lanes
+    SIMD_TARGET_AVX2 static __m256 HalfToFloatAVX2(__m256i halves)
+    {
+        const __m256i exponentMask = _mm256_set1_epi32(0x7C00 << 13);
+        const __m256i rebias = _mm256_set1_epi32(112 << 23);
+        __m256i sign = _mm256_slli_epi32(_mm256_and_si256(halves, _mm256_set1_epi32(0x8000)), 16);
+        __m256i bits = _mm256_slli_epi32(_mm256_and_si256(halves, _mm256_set1_epi32(0x7FFF)), 13);
+        __m256i exponent = _mm256_and_si256(bits, exponentMask);
+        bits = _mm256_add_epi32(bits, rebias);
+
+        __m256i infNan = _mm256_cmpeq_epi32(exponent, exponentMask);
+        bits = _mm256_add_epi32(bits, _mm256_and_si256(infNan, rebias));
+
+        __m256i denormal = _mm256_cmpeq_epi32(exponent, _mm256_setzero_si256());
+        __m256 normalized = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_add_epi32(bits, _mm256_set1_epi32(1 << 23))),
+            _mm256_castsi256_ps(_mm256_set1_epi32(113 << 23)));
+        __m256i result = _mm256_blendv_epi8(bits, _mm256_castps_si256(normalized), denormal);
+        return _mm256_castsi256_ps(_mm256_or_si256(result, sign));
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static void ConvertHalvesAVX2(const uint8_t* pSrc, size_t uiValues, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 16 <= uiValues; i += 16)
+        {
+            for (uint32 h = 0; h < 2; h++)
+            {
+                __m128i halves = ByteSwap16SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 2 * i + 16 * h)));
+                _mm256_storeu_ps(pDst + i + 8 * h, HalfToFloatAVX2(_mm256_cvtepu16_epi32(halves)));
+            }
+        }
+        _mm256_zeroupper();
+        ConvertHalvesScalar(pSrc + 2 * i, uiValues - i, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static void ConvertIntsAVX2(const uint8_t* pSrc, size_t uiValues, const Conversion& conversion, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 8 <= uiValues; i += 8)
+        {
+            __m256i ints = ByteSwap32AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 4 * i)));
+            __m256 values;
+            if (conversion.bSigned)
+                values = _mm256_cvtepi32_ps(ints);
+            else
+            {
+                __m256 high = _mm256_cvtepi32_ps(_mm256_srli_epi32(ints, 16));
+                __m256 low = _mm256_cvtepi32_ps(_mm256_and_si256(ints, _mm256_set1_epi32(0xFFFF)));
+                values = _mm256_add_ps(_mm256_mul_ps(high, _mm256_set1_ps(65536.0f)), low);
+            }
+            if (conversion.bNormalized)
+                values = _mm256_max_ps(_mm256_div_ps(values, _mm256_set1_ps(conversion.fDivisor)), _mm256_set1_ps(-1.0f));
+            _mm256_storeu_ps(pDst + i, values);
+        }
+        _mm256_zeroupper();
+        ConvertIntsScalar(pSrc + 4 * i, uiValues - i, conversion, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static void ConvertFloatsAVX2(const uint8_t* pSrc, size_t uiValues, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 8 <= uiValues; i += 8)
+        {
+            __m256i floats = ByteSwap32AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 4 * i)));
+            _mm256_storeu_ps(pDst + i, _mm256_castsi256_ps(floats));
+        }
+        _mm256_zeroupper();
+        ConvertFloatsScalar(pSrc + 4 * i, uiValues - i, pDst + i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <int iShift, int iBits>
+    SIMD_TARGET_AVX2 static __m256i Extract1010102AVX2(__m256i packed, bool bSigned)
+    {
+        __m256i top = _mm256_slli_epi32(packed, 32 - iShift - iBits);
+        return bSigned ? _mm256_srai_epi32(top, 32 - iBits) : _mm256_srli_epi32(top, 32 - iBits);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    SIMD_TARGET_AVX2 static void Convert1010102AVX2(const uint8_t* pSrc, size_t uiElements, const ElementInfo& info, float* pDst)
+    {
+        size_t i = 0;
+        for (; i + 8 <= uiElements; i += 8)
+        {
+            __m256i packed = ByteSwap32AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 4 * i)));
+            __m256 x = NormalizeAVX2(Extract1010102AVX2<0, 10>(packed, info.conversion.bSigned), info.conversion);
+            __m256 y = NormalizeAVX2(Extract1010102AVX2<10, 10>(packed, info.conversion.bSigned), info.conversion);
+            __m256 z = NormalizeAVX2(Extract1010102AVX2<20, 10>(packed, info.conversion.bSigned), info.conversion);
+            __m256 w = NormalizeAVX2(Extract1010102AVX2<30, 2>(packed, info.conversionW.bSigned), info.conversionW);
+
+            // Transposed within each lane, so elements 0-3 are in the low lanes and 4-7 in the high ones
+            __m256 xyLow = _mm256_unpacklo_ps(x, y);
+            __m256 xyHigh = _mm256_unpackhi_ps(x, y);
+            __m256 zwLow = _mm256_unpacklo_ps(z, w);
+            __m256 zwHigh = _mm256_unpackhi_ps(z, w);
+            __m256 e0 = _mm256_shuffle_ps(xyLow, zwLow, 0x44);
+            __m256 e1 = _mm256_shuffle_ps(xyLow, zwLow, 0xEE);
+            __m256 e2 = _mm256_shuffle_ps(xyHigh, zwHigh, 0x44);
+            __m256 e3 = _mm256_shuffle_ps(xyHigh, zwHigh, 0xEE);
+            _mm256_storeu_ps(pDst + 4 * i, _mm256_permute2f128_ps(e0, e1, 0x20));
+            _mm256_storeu_ps(pDst + 4 * i + 8, _mm256_permute2f128_ps(e2, e3, 0x20));
+            _mm256_storeu_ps(pDst + 4 * i + 16, _mm256_permute2f128_ps(e0, e1, 0x31));
+            _mm256_storeu_ps(pDst + 4 * i + 24, _mm256_permute2f128_ps(e2, e3, 0x31));
+        }
+        _mm256_zeroupper();
+        Convert1010102Scalar(pSrc + 4 * i, uiElements - i, info, pDst + 4 * i);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Converts uiElements tightly packed elements
+    static void ConvertElements(const uint8_t* pSrc, size_t uiElements, const ElementInfo& info, float* pDst, SIMD::Path ePath)
+    {
+        size_t uiValues = uiElements * info.uiComponents;
+        const Conversion& conversion = info.conversion;
+        switch (info.eKind)
+        {
+        case eKindByte:
+            if (ePath == SIMD::Path::AVX2)        ConvertBytesAVX2(pSrc, uiValues, conversion, pDst);
+            else if (ePath == SIMD::Path::SSE2)   ConvertBytesSSE2(pSrc, uiValues, conversion, pDst);
+            else                                  ConvertBytesScalar(pSrc, uiValues, conversion, pDst);
+            break;
+        case eKindNibble:
+            ConvertNibblesScalar(pSrc, uiElements, conversion, pDst);
+            break;
+        case eKindShort:
+            if (ePath == SIMD::Path::AVX2)        ConvertShortsAVX2(pSrc, uiValues, conversion, pDst);
+            else if (ePath == SIMD::Path::SSE2)   ConvertShortsSSE2(pSrc, uiValues, conversion, pDst);
+            else                                  ConvertShortsScalar(pSrc, uiValues, conversion, pDst);
+            break;
+        case eKindHalf:
+            if (ePath == SIMD::Path::AVX2)        ConvertHalvesAVX2(pSrc, uiValues, pDst);
+            else if (ePath == SIMD::Path::SSE2)   ConvertHalvesSSE2(pSrc, uiValues, pDst);
+            else                                  ConvertHalvesScalar(pSrc, uiValues, pDst);
+            break;
+        case eKindInt:
+            if (ePath == SIMD::Path::AVX2)        ConvertIntsAVX2(pSrc, uiValues, conversion, pDst);
+            else if (ePath == SIMD::Path::SSE2)   ConvertIntsSSE2(pSrc, uiValues, conversion, pDst);
+            else                                  ConvertIntsScalar(pSrc, uiValues, conversion, pDst);
+            break;
+        case eKindFloat:
+            if (ePath == SIMD::Path::AVX2)        ConvertFloatsAVX2(pSrc, uiValues, pDst);
+            else if (ePath == SIMD::Path::SSE2)   ConvertFloatsSSE2(pSrc, uiValues, pDst);
+            else                                  ConvertFloatsScalar(pSrc, uiValues, pDst);
+            break;
+        case eKind1010102:
+            if (ePath == SIMD::Path::AVX2)        Convert1010102AVX2(pSrc, uiElements, info, pDst);
+            else if (ePath == SIMD::Path::SSE2)   Convert1010102SSE2(pSrc, uiElements, info, pDst);
+            else                                  Convert1010102Scalar(pSrc, uiElements, info, pDst);
+            break;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <size_t uiSize>
+    static void GatherElements(const char* pSrc, size_t uiStride, size_t uiCount, uint8_t* pDst)
+    {
+        for (size_t i = 0; i < uiCount; i++)
+            memcpy(pDst + uiSize * i, pSrc + uiStride * i, uiSize);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Copies elements out of their interleaved buffer, with a fixed size copy per element size
+    static void Gather(const char* pSrc, size_t uiStride, size_t uiCount, uint32 uiSize, uint8_t* pDst)
+    {
+        switch (uiSize)
+        {
+        case 1:  GatherElements<1>(pSrc, uiStride, uiCount, pDst); break;
+        case 2:  GatherElements<2>(pSrc, uiStride, uiCount, pDst); break;
+        case 4:  GatherElements<4>(pSrc, uiStride, uiCount, pDst); break;
+        case 8:  GatherElements<8>(pSrc, uiStride, uiCount, pDst); break;
+        case 12: GatherElements<12>(pSrc, uiStride, uiCount, pDst); break;
+        case 16: GatherElements<16>(pSrc, uiStride, uiCount, pDst); break;
+        default:
+            for (size_t i = 0; i < uiCount; i++)
+                memcpy(pDst + uiSize * i, pSrc + uiStride * i, uiSize);
+            break;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decode(const char* pSrc, size_t uiStride, size_t uiCount, uint32 uiFormat, float* pDst, SIMD::Path ePath)
+    {
+        ElementInfo info;
+        if (!GetElementInfo(uiFormat, info))
+            return false;
+        ePath = SIMD::Resolve(ePath);
+
+        // Tightly packed streams convert in place
+        if (uiStride == info.uiSize)
+        {
+            ConvertElements(reinterpret_cast<const uint8_t*>(pSrc), uiCount, info, pDst, ePath);
+            return true;
+        }
+
+        alignas(32) uint8_t chunk[s_uiChunkElements * s_uiMaxElementSize];
+        for (size_t uiFirst = 0; uiFirst < uiCount; uiFirst += s_uiChunkElements)
+        {
+            size_t uiElements = std::min(s_uiChunkElements, uiCount - uiFirst);
+            Gather(pSrc + uiStride * uiFirst, uiStride, uiElements, info.uiSize, chunk);
+            ConvertElements(chunk, uiElements, info, pDst + info.uiComponents * uiFirst, ePath);
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decode(const char* pSrc, size_t uiStride, size_t uiCount, uint32 uiFormat, float* pDst)
+    {
+        return Decode(pSrc, uiStride, uiCount, uiFormat, pDst, SIMD::GetFastestPath());
+    }
+
+}
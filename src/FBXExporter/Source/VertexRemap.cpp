@@ -0,0 +1,89 @@
+#include "VertexRemap.h"
+
+namespace VertexRemap
+{
+
+    static const uint32 s_uiUnused = 0xFFFFFFFF;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Marks the vertices of every triangle that is in range, counts the ones that aren't
+    template <typename T>
+    static size_t MarkVertices(const pmr::vector<T>& indices, uint32 uiVertexCount, std::vector<uint32>& remap)
+    {
+        size_t uiDropped = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            if (indices[i] >= uiVertexCount || indices[i + 1] >= uiVertexCount || indices[i + 2] >= uiVertexCount)
+            {
+                uiDropped++;
+                continue;
+            }
+            remap[indices[i]] = 0;
+            remap[indices[i + 1]] = 0;
+            remap[indices[i + 2]] = 0;
+        }
+        return uiDropped;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Writes the triangles that are in range through remap
+    template <typename TSrc, typename TDst>
+    static void RewriteFaces(const pmr::vector<TSrc>& indices, uint32 uiVertexCount, const std::vector<uint32>& remap, size_t uiTriangles, pmr::vector<TDst>& dst)
+    {
+        dst.resize(uiTriangles * 3);
+        TDst* pDst = dst.data();
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            if (indices[i] >= uiVertexCount || indices[i + 1] >= uiVertexCount || indices[i + 2] >= uiVertexCount)
+                continue;
+            *pDst++ = static_cast<TDst>(remap[indices[i]]);
+            *pDst++ = static_cast<TDst>(remap[indices[i + 1]]);
+            *pDst++ = static_cast<TDst>(remap[indices[i + 2]]);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    template <typename TSrc>
+    static size_t Build(const pmr::vector<TSrc>& indices, uint32 uiVertexCount, LODVertices& lod)
+    {
+        std::vector<uint32> remap(uiVertexCount, s_uiUnused);
+        size_t uiDropped = MarkVertices(indices, uiVertexCount, remap);
+
+        // Compact indices in the order of the shape's vertices
+        uint32 uiCompactCount = 0;
+        for (uint32 v = 0; v < uiVertexCount; v++)
+        {
+            if (remap[v] == s_uiUnused)
+                continue;
+            remap[v] = uiCompactCount++;
+            lod.vertices.push_back(v);
+        }
+
+        size_t uiTriangles = indices.size() / 3 - uiDropped;
+        if (uiCompactCount <= 0x10000)
+            RewriteFaces(indices, uiVertexCount, remap, uiTriangles, lod.faces.indices16);
+        else
+            RewriteFaces(indices, uiVertexCount, remap, uiTriangles, lod.faces.indices32);
+        return uiDropped;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    size_t Build(const FaceIndices& faces, uint32 uiVertexCount, LODVertices& lod)
+    {
+        lod.vertices.clear();
+        lod.faces.indices16.clear();
+        lod.faces.indices32.clear();
+        if (faces.indices32.empty())
+            return Build(faces.indices16, uiVertexCount, lod);
+        return Build(faces.indices32, uiVertexCount, lod);
+    }
+
+}
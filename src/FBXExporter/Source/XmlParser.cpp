@@ -1,4 +1,8 @@
 #include "XmlParser.h"
+#include "ThreadPool.h"
+#include "AllocationStats.h"
+#include <memory>
+#include <string.h>
 
 namespace XML
 {
@@ -6,34 +10,72 @@ namespace XML
 
     // -----------------------------------------------------------------------
     // -----------------------------------------------------------------------
-    void XmlParser::Parse(const char* filePath, BFRES& bfres)
+    void XmlParser::Parse(const char* filePath, BFRES& bfres, ParseProfile eProfile)
     {
-        File file(filePath);
+        Arena::Scope arenaScope(bfres.arena);
+        if (eProfile == ParseProfile::SkeletonOnly)
+        {
+            ParseSkeletonsAndAnims(filePath, bfres);
+            return;
+        }
+
+        // Parse in-situ from a copy-on-write mapping of the dump instead of reading it into a vector first.
+        // RapidXML needs a zero terminator, so fall back to rapidxml::file when there is no page slack for it.
+        MappedFile mappedFile;
+        std::unique_ptr<File> pFallbackFile;
+        char* pText = nullptr;
+        if (mappedFile.Open(filePath, true) && mappedFile.HasZeroTerminator())
+        {
+            pText = mappedFile.GetWritableData();
+        }
+        else
+        {
+            mappedFile.Close();
+            pFallbackFile.reset(new File(filePath));
+            pText = pFallbackFile->data();
+        }
+
+        AllocationStats::Counters allocations = AllocationStats::Get();
+
         Document doc;
-        ParseDocument(file, doc);
+        ParseDocument(pText, doc);
+
+        if (AllocationStats::IsEnabled())
+        {
+            AllocationStats::Print("XML document", allocations, 0);
+            allocations = AllocationStats::Get();
+        }
 
         Element* pRoot = doc.first_node();
-        std::string token = "";
 
         // Parse FMDLs
-        uint32 fmdlIndex = 0;
-        Element* pNode = pRoot->first_node("FMDL");
-        while (pNode)
+        std::vector<Element*> nodes;
+        CollectChildren(nodes, pRoot, "FMDL");
+        bfres.fmdl.resize(nodes.size());
+        ThreadPool::Get().ParallelFor(nodes.size(), [&](size_t i)
         {
-            FMDL fmdl;
-            fmdl.index = fmdlIndex;
-            ParseFMDL(fmdl, pNode);
-            bfres.fmdl.push_back(fmdl);
-            pNode = pNode->next_sibling("FMDL");
-            fmdlIndex++;
+            bfres.fmdl[i].index = static_cast<uint32>(i);
+            ParseFMDL(bfres.fmdl[i], nodes[i], eProfile);
+        });
+
+        if (AllocationStats::IsEnabled())
+        {
+            size_t uiShapeCount = 0;
+            for (const FMDL& fmdl : bfres.fmdl)
+                uiShapeCount += fmdl.fshps.size();
+            AllocationStats::Print("FMDLs", allocations, uiShapeCount);
+            allocations = AllocationStats::Get();
         }
 
-        pNode = pRoot->first_node("FSKA");
+        Element* pNode = pRoot->first_node("FSKA");
         if(pNode)
         {
             ParseFSKA(bfres.fska, pNode);
         }
 
+        if (AllocationStats::IsEnabled())
+            AllocationStats::Print("FSKA", allocations, 0);
+
         //pNode = pNode->first_node("Vertices")->first_node();
         //while(pNode)
         //{
@@ -55,18 +97,196 @@ namespace XML
 
     // -----------------------------------------------------------------------
     // -----------------------------------------------------------------------
-    void XmlParser::ParseDocument(File& file, Document& doc)
+    void XmlParser::ParseStreaming(const char* filePath, const ModelCallback& onModel, const AnimCallback& onAnim, ParseProfile eProfile)
     {
-        doc.parse<0>(file.data());
+        // Chunks get a temporary terminator written after them, so the mapping has to be copy-on-write
+        MappedFile mappedFile;
+        if (!mappedFile.Open(filePath, true))
+        {
+            assert(0 && "Failed to open median dump");
+            return;
+        }
+        char* pText = mappedFile.GetWritableData();
+        char* pEnd = pText + mappedFile.GetSize();
+
+        char* pModelsEnd = ParseModelChunks(pText, pEnd, eProfile, onModel);
+
+        char* pCursor = pModelsEnd;
+        while (char* pBegin = FindElementStart(pCursor, pEnd, "Anim"))
+        {
+            char* pChunkEnd = FindElementEnd(pBegin, pEnd, "Anim");
+            if (!pChunkEnd)
+                break;
+
+            Document doc;
+            Anim anim = Anim();
+            ParseAnim(anim, ParseChunk(doc, pBegin, pChunkEnd));
+            onAnim(anim);
+            pCursor = pChunkEnd;
+        }
     }
 
 
     // -----------------------------------------------------------------------
     // -----------------------------------------------------------------------
-    void XmlParser::ParseFMDL(FMDL& fmdl, Element* pElement)
+    // Skeleton only parse of the whole dump. Only the FSKL of every model and the FSKA section ever go
+    // through RapidXML, the materials and shapes in between are skipped over as plain text.
+    void XmlParser::ParseSkeletonsAndAnims(const char* filePath, BFRES& bfres)
     {
-        std::string token = "";
-        if (ParseAttributeString(token, pElement, "Name"))        fmdl.name = token;
+        Arena::Scope arenaScope(bfres.arena);
+        MappedFile mappedFile;
+        if (!mappedFile.Open(filePath, true))
+        {
+            assert(0 && "Failed to open median dump");
+            return;
+        }
+        char* pText = mappedFile.GetWritableData();
+        char* pEnd = pText + mappedFile.GetSize();
+
+        char* pModelsEnd = ParseModelChunks(pText, pEnd, ParseProfile::SkeletonOnly, [&](FMDL& fmdl)
+        {
+            bfres.fmdl.push_back(std::move(fmdl));
+        });
+
+        char* pFSKA = FindElementStart(pModelsEnd, pEnd, "FSKA");
+        char* pFSKAEnd = pFSKA ? FindElementEnd(pFSKA, pEnd, "FSKA") : nullptr;
+        if (pFSKAEnd)
+        {
+            Document doc;
+            ParseFSKA(bfres.fska, ParseChunk(doc, pFSKA, pFSKAEnd));
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Hands every FMDL before the FSKA section to onModel, one chunk at a time. Returns where the models end.
+    char* XmlParser::ParseModelChunks(char* pText, char* pEnd, ParseProfile eProfile, const ModelCallback& onModel)
+    {
+        // FMDLs all come before the FSKA section
+        char* pFSKA = FindElementStart(pText, pEnd, "FSKA");
+        char* pModelsEnd = pFSKA ? pFSKA : pEnd;
+
+        uint32 fmdlIndex = 0;
+        char* pCursor = pText;
+        while (char* pBegin = FindElementStart(pCursor, pModelsEnd, "FMDL"))
+        {
+            char* pChunkEnd = FindElementEnd(pBegin, pModelsEnd, "FMDL");
+            if (!pChunkEnd)
+                break;
+
+            Document doc;
+            FMDL fmdl = FMDL();
+            fmdl.index = fmdlIndex++;
+            if (eProfile == ParseProfile::SkeletonOnly)
+            {
+                // Only the skeleton is built as a DOM, the vertex data is never parsed
+                ParseStartTagAttribute(fmdl.name, pBegin, pChunkEnd, "Name");
+                char* pFSKL = FindElementStart(pBegin + 1, pChunkEnd, "FSKL");
+                char* pFSKLEnd = pFSKL ? FindElementEnd(pFSKL, pChunkEnd, "FSKL") : nullptr;
+                if (pFSKLEnd)
+                    ParseFSKL(fmdl.fskl, ParseChunk(doc, pFSKL, pFSKLEnd));
+            }
+            else
+            {
+                ParseFMDL(fmdl, ParseChunk(doc, pBegin, pChunkEnd), eProfile);
+            }
+            onModel(fmdl);
+            pCursor = pChunkEnd;
+        }
+        return pModelsEnd;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Reads one attribute straight out of the start tag at pBegin, for elements whose DOM is never built.
+    // Attribute values are written escaped, so the first '>' closes the tag.
+    bool XmlParser::ParseStartTagAttribute(std::pmr::string& value, const char* pBegin, const char* pEnd, const char* szName)
+    {
+        const char* pTagEnd = std::find(pBegin, pEnd, '>');
+        std::string pattern = std::string(" ") + szName + "=\"";
+        const char* pValue = std::search(pBegin, pTagEnd, pattern.begin(), pattern.end());
+        if (pValue == pTagEnd)
+            return false;
+
+        pValue += pattern.size();
+        value.assign(pValue, std::find(pValue, pTagEnd, '"'));
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Parses the single element in [pBegin, pEnd). The byte at pEnd is swapped for the terminator RapidXML
+    // needs and restored right after; with our non-destructive parse flags nothing else is written.
+    Element* XmlParser::ParseChunk(Document& doc, char* pBegin, char* pEnd)
+    {
+        // The root element always closes after its children, so pEnd is never the end of the file
+        char cSaved = *pEnd;
+        *pEnd = '\0';
+        doc.parse<s_iParseFlags>(pBegin);
+        *pEnd = cSaved;
+        return doc.first_node();
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Finds the next start tag <szName ...> in the range
+    char* XmlParser::FindElementStart(char* pBegin, char* pEnd, const char* szName)
+    {
+        const size_t uiNameLen = strlen(szName);
+        for (char* p = pBegin; (p = static_cast<char*>(memchr(p, '<', pEnd - p))) != nullptr; p++)
+        {
+            if (static_cast<size_t>(pEnd - p) <= uiNameLen + 1 || memcmp(p + 1, szName, uiNameLen) != 0)
+                continue;
+
+            char c = p[uiNameLen + 1];
+            if (c == ' ' || c == '>' || c == '/' || c == '\t' || c == '\r' || c == '\n')
+                return p;
+        }
+        return nullptr;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Finds the closing tag </szName> and returns the position right after it
+    char* XmlParser::FindElementEnd(char* pBegin, char* pEnd, const char* szName)
+    {
+        std::string closingTag = std::string("</") + szName + ">";
+        char* p = std::search(pBegin, pEnd, closingTag.begin(), closingTag.end());
+        return p == pEnd ? nullptr : p + closingTag.size();
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Gathers the szName children of pParent so the destination can be sized up front and filled in parallel.
+    // uiExpectedCount is the count the dump claims, it only sizes the node list.
+    void XmlParser::CollectChildren(std::vector<Element*>& nodes, Element* pParent, const char* szName, size_t uiExpectedCount)
+    {
+        nodes.clear();
+        nodes.reserve(uiExpectedCount);
+        for (Element* pNode = pParent->first_node(szName); pNode; pNode = pNode->next_sibling(szName))
+            nodes.push_back(pNode);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void XmlParser::ParseDocument(char* pText, Document& doc)
+    {
+        doc.parse<s_iParseFlags>(pText);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    void XmlParser::ParseFMDL(FMDL& fmdl, Element* pElement, ParseProfile eProfile)
+    {
+        ParseAttributeString(fmdl.name, pElement, "Name");
 
         // Parse FSKL
         {
@@ -74,6 +294,9 @@ namespace XML
             ParseFSKL(fmdl.fskl, pNode);
         }
 
+        if (eProfile == ParseProfile::SkeletonOnly)
+            return;
+
         // Parse Material
         {
             // TODO
@@ -85,7 +308,7 @@ namespace XML
         {
             // TODO
             Element* pNode = pElement->first_node("Shapes");
-            ParseShapes(fmdl.index, fmdl.fshps, pNode);
+            ParseShapes(fmdl.index, fmdl.fshps, pNode, eProfile);
         }
     }
 
@@ -94,18 +317,16 @@ namespace XML
     // -----------------------------------------------------------------------
     void XmlParser::ParseFSKL(FSKL& fskl, Element* pElement)
     {
-        std::string token = "";
-
         ParseAttributeUInt(fskl.boneCount, pElement, "SkeletonBoneCount");
         ParseAttributeUIntArray(fskl.boneList, pElement, "BoneList");
 
         // Parse Bones
+        fskl.bones.reserve(fskl.boneCount);
         Element* pNode = pElement->first_node("Bone");
         while (pNode)
         {
-            Bone bone;
-            ParseBone(bone, pNode);
-            fskl.bones.push_back(bone);
+            fskl.bones.emplace_back();
+            ParseBone(fskl.bones.back(), pNode);
             pNode = pNode->next_sibling("Bone");
         }
     }
@@ -137,11 +358,13 @@ namespace XML
     {
         pElement = pElement->first_node("TextureRefs");
         ParseAttributeUInt(textureRefs.textureCount   , pElement, "TextureCount");
+        textureRefs.textures.reserve(textureRefs.textureCount);
 
         pElement = pElement->first_node("Texture");
 		while (pElement)
 		{
-			TextureRef texture;
+			textureRefs.textures.emplace_back();
+			TextureRef& texture = textureRefs.textures.back();
 
 			ParseAttributeString             (texture.name               , pElement, "TextureName");
 			ParseAttributeGX2TexClamp        (texture.clampX             , pElement, "ClampX");
@@ -162,7 +385,6 @@ namespace XML
 			ParseAttributeGX2TextureMapType  (texture.type               , pElement, "Type");
 			ParseAttributeUInt               (texture.textureUnit        , pElement, "textureUnit");
 
-			textureRefs.textures.push_back(texture);
 			pElement = pElement->next_sibling("Texture");
 		}
     }
@@ -170,15 +392,18 @@ namespace XML
 
 	// -----------------------------------------------------------------------
 	// -----------------------------------------------------------------------
-	void XmlParser::ParseMaterials(std::vector<FMAT>& fmats, Element* pElement)
+	void XmlParser::ParseMaterials(std::pmr::vector<FMAT>& fmats, Element* pElement)
 	{
 		// Parse FMATs
+		uint32 fmatCount = 0;
+		ParseAttributeUInt(fmatCount, pElement, "FMATCount");
+		fmats.reserve(fmatCount);
+
 		Element* pNode = pElement->first_node("FMAT");
 		while (pNode)
 		{
-            FMAT fmat;
-            ParseFMAT(fmat, pNode);
-			fmats.push_back(fmat);
+			fmats.emplace_back();
+			ParseFMAT(fmats.back(), pNode);
 			pNode = pNode->next_sibling("FMAT");
 		}
 	}
@@ -196,24 +421,26 @@ namespace XML
 
     // -----------------------------------------------------------------------
     // -----------------------------------------------------------------------
-    void XmlParser::ParseShapes(uint32 modelIndex, std::vector<FSHP>& fshps, Element* pElement)
+    void XmlParser::ParseShapes(uint32 modelIndex, std::pmr::vector<FSHP>& fshps, Element* pElement, ParseProfile eProfile)
     {
-        // Parse FSHPs
-        Element* pNode = pElement->first_node("FSHP");
-        while (pNode)
+        // Parse FSHPs, every shape subtree is independent
+        uint32 fshpCount = 0;
+        ParseAttributeUInt(fshpCount, pElement, "FSHPCount");
+
+        std::vector<Element*> nodes;
+        CollectChildren(nodes, pElement, "FSHP", fshpCount);
+        fshps.resize(nodes.size());
+        ThreadPool::Get().ParallelFor(nodes.size(), [&](size_t i)
         {
-            FSHP fshp;
-            fshp.modelIndex = modelIndex;
-            ParseFSHP(fshp, pNode);
-            fshps.push_back(fshp);
-            pNode = pNode->next_sibling("FSHP");
-        }
+            fshps[i].modelIndex = modelIndex;
+            ParseFSHP(fshps[i], nodes[i], eProfile);
+        });
     }
 
 
     // -----------------------------------------------------------------------
     // -----------------------------------------------------------------------
-    void XmlParser::ParseFSHP(FSHP& fshp, Element* pElement)
+    void XmlParser::ParseFSHP(FSHP& fshp, Element* pElement, ParseProfile eProfile)
     {
         ParseAttributeString(fshp.name, pElement, "Name");
         // TODO ParseAttributeShapeFlags
@@ -226,24 +453,38 @@ namespace XML
         // TODO MORE CHILDREN
 
         // Parse Meshes
-        Element* pNode = pElement->first_node("Meshes")->first_node("LODMesh");
+        Element* pNode = pElement->first_node("Meshes");
+        uint32 lodMeshCount = 0;
+        ParseAttributeUInt(lodMeshCount, pNode, "LODMeshCount");
+        fshp.lodMeshes.reserve(lodMeshCount);
+
+        pNode = pNode->first_node("LODMesh");
         while (pNode)
         {
-            LODMesh lodMesh;
-            ParseLODMesh(lodMesh, pNode);
-            fshp.lodMeshes.push_back(lodMesh);
+            fshp.lodMeshes.emplace_back();
+            ParseLODMesh(fshp.lodMeshes.back(), pNode);
             pNode = pNode->next_sibling("LODMesh");
         }
 
-        // Parse Vertices
-        pNode = pElement->first_node("Vertices")->first_node("Vertex");
-        while (pNode)
+        // Parse Vertices, in blocks so a model with one huge shape still spreads over the pool
+        const size_t uiBlockSize = 1024;
+        Element* pVertices = pElement->first_node("Vertices");
+        uint32 vertexCount = 0;
+        ParseAttributeUInt(vertexCount, pVertices, "VertexCount");
+
+        std::vector<Element*> nodes;
+        CollectChildren(nodes, pVertices, "Vertex", vertexCount);
+        fshp.vertices = VertexStreams();
+        fshp.vertices.count = static_cast<uint32>(nodes.size());
+        if (!nodes.empty())
+            AddVertexStreams(fshp.vertices, nodes[0], eProfile);
+        ThreadPool::Get().ParallelFor((nodes.size() + uiBlockSize - 1) / uiBlockSize, [&](size_t uiBlock)
         {
-            FVTX fvtx;
-            ParseFVTX(fvtx, pNode);
-            fshp.vertices.push_back(fvtx);
-            pNode = pNode->next_sibling("Vertex");
-        }
+            size_t uiEnd = std::min(nodes.size(), (uiBlock + 1) * uiBlockSize);
+            for (size_t i = uiBlock * uiBlockSize; i < uiEnd; i++)
+                ParseVertex(fshp.vertices, i, nodes[i]);
+        });
+        fshp.vertices.DropDefaultStreams();
 
     }
 
@@ -257,31 +498,57 @@ namespace XML
         lodMesh.indexFormat = LODMesh::GX2IndexFormat::UInt16;
         ParseAttributeUInt(lodMesh.indexCount      , pElement, "IndexCount"  );
         ParseAttributeUInt(lodMesh.firstVertex     , pElement, "FirstVertex" );
-        ParseAttributeIntArray(lodMesh.faceVertices, pElement, "FaceVertices");
+        ParseAttributeFaceIndices(lodMesh.faceVertices, lodMesh.indexCount, pElement, "FaceVertices");
         // TODO add parse submesh function
     }
 
 
     // -----------------------------------------------------------------------
     // -----------------------------------------------------------------------
-    void XmlParser::ParseFVTX(FVTX& fvtx, Element* pElement)
+    // The importer writes the same attributes on every vertex, so the first one tells which streams the shape
+    // has. Positions are always there, they make the vertices.
+    void XmlParser::AddVertexStreams(VertexStreams& vertices, Element* pElement, ParseProfile eProfile)
     {
-        ParseAttributeUInt(fvtx.index           , pElement, "Index"       );
-        ParseAttributeVector3F(fvtx.position0   , pElement, "Position0"   );
-        ParseAttributeVector3F(fvtx.position1   , pElement, "Position1"   );
-        ParseAttributeVector3F(fvtx.position2   , pElement, "Position2"   );
-        ParseAttributeVector3F(fvtx.normal      , pElement, "Normal"      );
-        ParseAttributeVector2F(fvtx.uv0         , pElement, "UV0"         );
-        ParseAttributeVector2F(fvtx.uv1         , pElement, "UV1"         );
-        ParseAttributeVector2F(fvtx.uv2         , pElement, "UV2"         );
-        ParseAttributeVector4F(fvtx.color0      , pElement, "Color0"      );
-        ParseAttributeVector4F(fvtx.color1      , pElement, "Color1"      );
-        ParseAttributeVector4F(fvtx.tangent     , pElement, "Tangent"     );
-        ParseAttributeVector4F(fvtx.binormal    , pElement, "Binormal"    );
-        if (!ParseAttributeVector4F(fvtx.blendWeights, pElement, "BlendWeights"))
-            fvtx.blendWeights = { 1,0,0,0 };
-        if (!ParseAttributeVector4(fvtx.blendIndex, pElement, "BlendIndex"))
-            fvtx.blendIndex = { 0,0,0,0 };
+        const char* pBegin;
+        const char* pEnd;
+        vertices.Add(VertexStreams::ePosition0);
+        if (eProfile == ParseProfile::Full)
+        {
+            // Only the first position set is ever written out
+            if (ParseAttributeRange(pBegin, pEnd, pElement, "Position1")) vertices.Add(VertexStreams::ePosition1);
+            if (ParseAttributeRange(pBegin, pEnd, pElement, "Position2")) vertices.Add(VertexStreams::ePosition2);
+        }
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "Normal")) vertices.Add(VertexStreams::eNormal);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "UV0")) vertices.Add(VertexStreams::eUV0);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "UV1")) vertices.Add(VertexStreams::eUV1);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "UV2")) vertices.Add(VertexStreams::eUV2);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "Color0")) vertices.Add(VertexStreams::eColor0);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "Color1")) vertices.Add(VertexStreams::eColor1);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "Tangent")) vertices.Add(VertexStreams::eTangent);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "Binormal")) vertices.Add(VertexStreams::eBinormal);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "BlendWeights")) vertices.Add(VertexStreams::eBlendWeights);
+        if (ParseAttributeRange(pBegin, pEnd, pElement, "BlendIndex")) vertices.Add(VertexStreams::eBlendIndex);
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Fills vertex i of the streams the shape has, a vertex missing an attribute keeps its default
+    void XmlParser::ParseVertex(VertexStreams& vertices, size_t i, Element* pElement)
+    {
+        ParseAttributeVector3F(vertices.position0[i], pElement, "Position0");
+        if (vertices.Has(VertexStreams::ePosition1))    ParseAttributeVector3F(vertices.position1[i]   , pElement, "Position1"   );
+        if (vertices.Has(VertexStreams::ePosition2))    ParseAttributeVector3F(vertices.position2[i]   , pElement, "Position2"   );
+        if (vertices.Has(VertexStreams::eNormal))       ParseAttributeVector3F(vertices.normal[i]      , pElement, "Normal"      );
+        if (vertices.Has(VertexStreams::eUV0))          ParseAttributeVector2F(vertices.uv0[i]         , pElement, "UV0"         );
+        if (vertices.Has(VertexStreams::eUV1))          ParseAttributeVector2F(vertices.uv1[i]         , pElement, "UV1"         );
+        if (vertices.Has(VertexStreams::eUV2))          ParseAttributeVector2F(vertices.uv2[i]         , pElement, "UV2"         );
+        if (vertices.Has(VertexStreams::eColor0))       ParseAttributeVector4F(vertices.color0[i]      , pElement, "Color0"      );
+        if (vertices.Has(VertexStreams::eColor1))       ParseAttributeVector4F(vertices.color1[i]      , pElement, "Color1"      );
+        if (vertices.Has(VertexStreams::eTangent))      ParseAttributeVector4F(vertices.tangent[i]     , pElement, "Tangent"     );
+        if (vertices.Has(VertexStreams::eBinormal))     ParseAttributeVector4F(vertices.binormal[i]    , pElement, "Binormal"    );
+        if (vertices.Has(VertexStreams::eBlendWeights)) ParseAttributeVector4F(vertices.blendWeights[i], pElement, "BlendWeights");
+        if (vertices.Has(VertexStreams::eBlendIndex))   ParseAttributeVector4 (vertices.blendIndex[i]  , pElement, "BlendIndex"  );
     }
 
 
@@ -289,14 +556,13 @@ namespace XML
 	// -----------------------------------------------------------------------
 	void XmlParser::ParseFSKA(FSKA& fska, Element* pElement)
 	{
-		Element* pNode = pElement->first_node("Anim");
-		while (pNode)
+		std::vector<Element*> nodes;
+		CollectChildren(nodes, pElement, "Anim");
+		fska.anims.resize(nodes.size());
+		ThreadPool::Get().ParallelFor(nodes.size(), [&](size_t i)
 		{
-			Anim anim;
-			ParseAnim(anim, pNode);
-			fska.anims.push_back(anim);
-			pNode = pNode->next_sibling("Anim");
-		}
+			ParseAnim(fska.anims[i], nodes[i]);
+		});
 	}
 
 
@@ -312,28 +578,27 @@ namespace XML
         ParseAttributeUInt                  (anim.m_cBoneAnims  , pElement, "BoneAnimationCount");
         ParseAttributeUInt                  (anim.m_cUserData   , pElement, "UserDataCount"     );
 
-        // parse bone anims
-		Element* pNode = pElement->first_node("BoneAnims");
-        pNode = pNode->first_node("BoneAnim");
-		while (pNode)
+        // parse bone anims, each one only touches its own tracks
+		std::vector<Element*> nodes;
+		CollectChildren(nodes, pElement->first_node("BoneAnims"), "BoneAnim", anim.m_cBoneAnims);
+		anim.m_vBoneAnims.resize(nodes.size());
+		ThreadPool::Get().ParallelFor(nodes.size(), [&](size_t i)
 		{
-			BoneAnim boneAnim;
-			ParseBoneAnim(boneAnim, pNode);
-			anim.m_vBoneAnims.push_back(boneAnim);
-			pNode = pNode->next_sibling("BoneAnim");
-		}
+			ParseBoneAnim(anim.m_vBoneAnims[i], nodes[i]);
+		});
 
         // parse user data
-        pNode = pElement->first_node("UserDatas");
+        Element* pNode = pElement->first_node("UserDatas");
         pNode = pNode->first_node("UserData");
+        anim.m_vUserData.reserve(anim.m_cUserData);
         while (pNode)
         {
-            UserData userData;
+            anim.m_vUserData.emplace_back();
+            UserData& userData = anim.m_vUserData.back();
 
             ParseAttributeString(userData.m_szName, pNode, "Name");
             userData.m_eType = UserData::UserDataType::Single; // TODO don't hardcode this, come on
             ParseAttributeFloatArray(userData.m_vfValues, pNode, "Values");
-            anim.m_vUserData.push_back(userData);
             pNode = pNode->next_sibling("UserData");
         }
 	}
@@ -387,12 +652,12 @@ namespace XML
         ParseAttributeFloat                 (animTrack.m_fDelta            , pElement, "Delta"            );
         ParseAttributeUInt                  (animTrack.m_cKeys             , pElement, "KeyCount"         );
 
+        animTrack.m_vKeyFrames.reserve(animTrack.m_cKeys);
         Element* pNode = pElement->first_node("KeyFrame");
         while (pNode)
         {
-			KeyFrame keyFrame;
-			ParseKeyFrame(keyFrame, pNode);
-			animTrack.m_vKeyFrames.push_back(keyFrame);
+			animTrack.m_vKeyFrames.emplace_back();
+			ParseKeyFrame(animTrack.m_vKeyFrames.back(), pNode);
 			pNode = pNode->next_sibling("KeyFrame");
         }
 	}
@@ -0,0 +1,321 @@
+#include "Yaz0.h"
+#include <string.h>
+
+namespace Yaz0
+{
+
+    // Longest back reference a chunk can encode
+    static const size_t s_uiMaxCopy = 0x111;
+
+    // Most input a group can take, the flag byte and eight three byte back references
+    static const size_t s_uiMaxGroupInput = 1 + 8 * 3;
+
+    // Most output a group can produce, plus room for the up to seven bytes the wide copy writes past it
+    static const size_t s_uiMaxGroupOutput = 8 * s_uiMaxCopy + 8;
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    static uint32 ReadU32BE(const uint8_t* p)
+    {
+        return (static_cast<uint32>(p[0]) << 24) | (static_cast<uint32>(p[1]) << 16) | (static_cast<uint32>(p[2]) << 8) | p[3];
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Copies uiCount bytes from uiDistance bytes back. The source may overlap the destination, which is
+    // how runs are encoded. With bCanOverrun up to 7 bytes past the end may be written, the caller makes
+    // sure there is room for them and the next chunk overwrites them.
+    static inline void CopyMatch(uint8_t* pDst, size_t uiDistance, size_t uiCount, bool bCanOverrun)
+    {
+        const uint8_t* pSrc = pDst - uiDistance;
+        if (bCanOverrun && uiDistance >= 8)
+        {
+            // Every 8 byte block only reads output that is already written
+            for (size_t i = 0; i < uiCount; i += 8)
+                memcpy(pDst + i, pSrc + i, 8);
+        }
+        else if (uiDistance == 1)
+            memset(pDst, pSrc[0], uiCount);
+        else
+        {
+            for (size_t i = 0; i < uiCount; i++)
+                pDst[i] = pSrc[i];
+        }
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Decodes whole groups without per chunk range checks for as long as the input holds a complete group
+    // and the output has room for the largest one. Back reference distances are still checked. Returns
+    // false for corrupt data.
+    static bool DecodeGroups(const uint8_t*& pSrc, const uint8_t* pSrcEnd, const uint8_t* pBegin, uint8_t*& pDst, const uint8_t* pDstEnd)
+    {
+        const uint8_t* pIn = pSrc;
+        uint8_t* pOut = pDst;
+        while (static_cast<size_t>(pSrcEnd - pIn) >= s_uiMaxGroupInput && static_cast<size_t>(pDstEnd - pOut) >= s_uiMaxGroupOutput)
+        {
+            uint32 uiFlags = *pIn++;
+
+            // A group of literals only is common for uncompressible data
+            if (uiFlags == 0xFF)
+            {
+                memcpy(pOut, pIn, 8);
+                pIn += 8;
+                pOut += 8;
+                continue;
+            }
+
+            for (int i = 0; i < 8; i++, uiFlags <<= 1)
+            {
+                if (uiFlags & 0x80)
+                {
+                    *pOut++ = *pIn++;
+                    continue;
+                }
+
+                size_t uiDistance = (((pIn[0] & 0xF) << 8) | pIn[1]) + 1;
+                size_t uiCount = pIn[0] >> 4;
+                if (uiCount == 0)
+                {
+                    uiCount = pIn[2] + 0x12;
+                    pIn += 3;
+                }
+                else
+                {
+                    uiCount += 2;
+                    pIn += 2;
+                }
+
+                if (uiDistance > static_cast<size_t>(pOut - pBegin))
+                {
+                    pSrc = pIn;
+                    pDst = pOut;
+                    return false;
+                }
+                CopyMatch(pOut, uiDistance, uiCount, true);
+                pOut += uiCount;
+            }
+        }
+
+        pSrc = pIn;
+        pDst = pOut;
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool IsYaz0(const char* pData, size_t uiSize)
+    {
+        return uiSize >= s_uiHeaderSize && ReadU32BE(reinterpret_cast<const uint8_t*>(pData)) == s_uiMagic;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    uint32 GetDecompressedSize(const char* pData, size_t uiSize)
+    {
+        return IsYaz0(pData, uiSize) ? ReadU32BE(reinterpret_cast<const uint8_t*>(pData) + 4) : 0;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decompress(const char* pData, size_t uiSize, char* pDst, size_t uiDstSize)
+    {
+        if (!IsYaz0(pData, uiSize) || uiDstSize < GetDecompressedSize(pData, uiSize))
+            return false;
+
+        const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(pData) + s_uiHeaderSize;
+        const uint8_t* pSrcEnd = reinterpret_cast<const uint8_t*>(pData) + uiSize;
+        uint8_t* pBegin = reinterpret_cast<uint8_t*>(pDst);
+        uint8_t* pOut = pBegin;
+        uint8_t* pOutEnd = pBegin + GetDecompressedSize(pData, uiSize);
+
+        // The bulk of the file goes through the unchecked groups, the last ones are decoded chunk by chunk
+        if (!DecodeGroups(pSrc, pSrcEnd, pBegin, pOut, pOutEnd))
+            return false;
+
+        while (pOut < pOutEnd)
+        {
+            if (pSrc >= pSrcEnd)
+                return false;
+
+            uint32 uiFlags = *pSrc++;
+            for (int i = 0; i < 8 && pOut < pOutEnd; i++, uiFlags <<= 1)
+            {
+                if (uiFlags & 0x80)
+                {
+                    if (pSrc >= pSrcEnd)
+                        return false;
+                    *pOut++ = *pSrc++;
+                    continue;
+                }
+
+                if (pSrcEnd - pSrc < 2 || ((pSrc[0] >> 4) == 0 && pSrcEnd - pSrc < 3))
+                    return false;
+
+                size_t uiDistance = (((pSrc[0] & 0xF) << 8) | pSrc[1]) + 1;
+                size_t uiCount = pSrc[0] >> 4;
+                if (uiCount == 0)
+                {
+                    uiCount = pSrc[2] + 0x12;
+                    pSrc += 3;
+                }
+                else
+                {
+                    uiCount += 2;
+                    pSrc += 2;
+                }
+
+                if (uiDistance > static_cast<size_t>(pOut - pBegin) || uiCount > static_cast<size_t>(pOutEnd - pOut))
+                    return false;
+                CopyMatch(pOut, uiDistance, uiCount, false);
+                pOut += uiCount;
+            }
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    Decoder::Decoder()
+        : m_uiSize(0)
+        , m_uiDecoded(0)
+        , m_uiHeaderBytes(0)
+        , m_uiPending(0)
+        , m_uiFlags(0)
+        , m_uiFlagCount(0)
+        , m_bFailed(false)
+    {
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    bool Decoder::Feed(const char* pData, size_t uiSize)
+    {
+        const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(pData);
+        const uint8_t* pSrcEnd = pSrc + uiSize;
+
+        if (m_bFailed || (!HasHeader() && !FeedHeader(pSrc, pSrcEnd)))
+            return !m_bFailed;
+
+        uint8_t* pBegin = reinterpret_cast<uint8_t*>(m_pOutput.get());
+        while (pSrc < pSrcEnd && m_uiDecoded < m_uiSize)
+        {
+            // Between groups the fast path can take over until the input gets short
+            if (m_uiFlagCount == 0 && m_uiPending == 0)
+            {
+                uint8_t* pOut = pBegin + m_uiDecoded;
+                bool bValid = DecodeGroups(pSrc, pSrcEnd, pBegin, pOut, pBegin + m_uiSize);
+                m_uiDecoded = pOut - pBegin;
+                if (!bValid)
+                {
+                    m_bFailed = true;
+                    return false;
+                }
+                if (pSrc == pSrcEnd || m_uiDecoded == m_uiSize)
+                    break;
+            }
+
+            if (!FeedChunk(pSrc, pSrcEnd))
+                return !m_bFailed;
+        }
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Collects the header, then allocates the output. Returns false while the header is incomplete.
+    bool Decoder::FeedHeader(const uint8_t*& pSrc, const uint8_t* pSrcEnd)
+    {
+        while (m_uiHeaderBytes < s_uiHeaderSize && pSrc < pSrcEnd)
+            m_header[m_uiHeaderBytes++] = *pSrc++;
+        if (m_uiHeaderBytes < s_uiHeaderSize)
+            return false;
+
+        if (ReadU32BE(m_header) != s_uiMagic)
+        {
+            m_bFailed = true;
+            return false;
+        }
+
+        // Not value initialized, every byte gets written by the decoder
+        m_uiSize = ReadU32BE(m_header + 4);
+        m_pOutput.reset(new char[m_uiSize]);
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    // Decodes a single chunk, reading the group's flag byte first when needed. Returns false when the input
+    // ran out before the chunk was complete, the bytes read so far are kept, or when the data is corrupt.
+    bool Decoder::FeedChunk(const uint8_t*& pSrc, const uint8_t* pSrcEnd)
+    {
+        if (m_uiFlagCount == 0)
+        {
+            if (pSrc >= pSrcEnd)
+                return false;
+            m_uiFlags = *pSrc++;
+            m_uiFlagCount = 8;
+        }
+
+        uint8_t* pBegin = reinterpret_cast<uint8_t*>(m_pOutput.get());
+        if (m_uiFlags & 0x80)
+        {
+            if (pSrc >= pSrcEnd)
+                return false;
+            pBegin[m_uiDecoded++] = *pSrc++;
+        }
+        else
+        {
+            // A back reference is two bytes, three when the length nibble is zero
+            while (m_uiPending < 2 && pSrc < pSrcEnd)
+                m_pending[m_uiPending++] = *pSrc++;
+            if (m_uiPending < 2)
+                return false;
+
+            size_t uiLength = (m_pending[0] >> 4) == 0 ? 3 : 2;
+            while (m_uiPending < uiLength && pSrc < pSrcEnd)
+                m_pending[m_uiPending++] = *pSrc++;
+            if (m_uiPending < uiLength)
+                return false;
+
+            size_t uiDistance = (((m_pending[0] & 0xF) << 8) | m_pending[1]) + 1;
+            size_t uiCount = uiLength == 3 ? m_pending[2] + 0x12 : (m_pending[0] >> 4) + 2;
+            m_uiPending = 0;
+            if (uiDistance > m_uiDecoded || uiCount > m_uiSize - m_uiDecoded)
+            {
+                m_bFailed = true;
+                return false;
+            }
+            CopyMatch(pBegin + m_uiDecoded, uiDistance, uiCount, false);
+            m_uiDecoded += uiCount;
+        }
+
+        m_uiFlags <<= 1;
+        m_uiFlagCount--;
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------
+    // -----------------------------------------------------------------------
+    std::unique_ptr<char[]> Decoder::Release()
+    {
+        m_uiSize = 0;
+        m_uiDecoded = 0;
+        m_uiHeaderBytes = 0;
+        m_uiPending = 0;
+        m_uiFlagCount = 0;
+        return std::move(m_pOutput);
+    }
+
+}